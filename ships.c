@@ -55,6 +55,17 @@ Licence
 #include <string.h>
 #include <assert.h>
 #include <ctype.h>
+#include <time.h>
+#include <limits.h>
+#ifdef SHIPS_THREADS
+#  include <pthread.h>
+#  ifdef STANDALONE_SOLVER
+#    include <signal.h>
+#    include <unistd.h>
+#    include <sys/socket.h>
+#    include <sys/un.h>
+#  endif
+#endif
 #ifdef NO_TGMATH_H
 #  include <math.h>
 #else
@@ -123,20 +134,476 @@ enum Difficulty {
 #define SIZEMIN 7
 #define SIZEMAX 25
 
+/* macro value as a string literal (for SIZEMIN, SIZEMAX) */
+#define STRINGIFY_(x) #x
+#define STRINGIFY(x)  STRINGIFY_(x)
+
+/* largest number of ships chosen by the generator */
+#define NUM_SHIPS_MAX 12
+
+/* largest number of ships of the generator's base fleet, 2 sizes from 
+each of 4 groups (see generator_fleet()) */
+#define NUM_SHIPS_BASE 8
+
+/* share of the grid the generator aims to fill with ship cells, in 
+percent (see generator_fleet()) */
+#define FLEET_DENSITY 20
+
+/* bound of the feasibility check of the generator's fleet, in percent 
+(see fleet_fits()) */
+#define FLEET_FILL 80
+
 /* solution returned by solver */
+struct solve_ctl;
+
 struct sol {
     // 2D array of the size num_ships x 3 array of ship coordinates 
     // (vert, y, x); vert = 0/1: horizontal/vertical; y,x: left top cell
     int **ship_coord;
     // possibly a second solution
     int **ship_coord2;
-    // number of times the recursive function place_ship() was called. 
-    // Used to estimate the complexity of the puzzle
-    int count;
-    // error value (0: no error/1: count_lim exceeded/2: non-unique solution
-    // 3: no solution exist, when no limit set, i.e., count_lim <= 0)
+    // number of nodes of the search of place_ship() (ships tried at a
+    // further depth). Used to estimate the complexity of the puzzle
+    long long count;
+    // error value (0: no error/1: count_lim exceeded or search interrupted 
+    // through ctl/2: non-unique solution/3: no solution exist, when no 
+    // limit set, i.e., count_lim <= 0)
+    int err;
+    // progress report and cancellation of the search (NULL if not needed)
+    struct solve_ctl *ctl;
+    // known solution (num_ships x 3, ships of equal size ordered by 
+    // position, see solver_alt()): only a different solution is sought, 
+    // NULL for the usual search
+    int **ship_ref;
+};
+
+
+/* Progress and cancellation of a running solver() */
+struct solve_ctl {
+    // wall clock time (see time_us()) after which the search is given up,
+    // 0 for no time limit
+    double deadline;
+    // function called every SOLVE_CTL_INTERVAL nodes, returns true to 
+    // cancel the search (NULL if not needed), and its context
+    bool (*progress)(const struct solve_ctl *ctl, void *ctx);
+    void *ctx;
+    // progress: nodes of the search so far; positions of the first
+    // (longest) ship tried so far and in total
+    long long nodes;
+    int first_done, first_total;
+    // reason of an interruption
+    bool cancelled, timed_out;
+};
+
+/* number of nodes of the search between checks of struct solve_ctl */
+#define SOLVE_CTL_INTERVAL 4096
+
+/* time limit of solve_game() in seconds */
+#define SOLVE_TIMEOUT 10
+
+/* limit on the nodes of the search when the solution for the check of 
+the player's marks is sought in new_game(), and again for its backbone
+(see live_backbone()) */
+#define LIVE_COUNT_LIM 20000
+
+/* sharded search: the prefixes are the positions of the first two ships
+(instead of the first one) if the first ship has fewer than SHARD_SPREAD 
+positions per shard (see search_shard()) */
+#define SHARD_SPREAD 4
+
+
+struct game_state_const;
+
+/* frame of the search of the solver: position (vert, y, x) tried for a 
+ship (the ship number is the index of the frame, see struct search) */
+struct search_frame {
+    int vert, y, x;
+};
+
+/* state of the search of the solver, see place_ship_body() */
+struct search {
+    const struct game_state_const *init_state;
+    long long count_lim;
+    struct sol *soln;
+    // enriched init array (see solver_init()), H x W field of ship 
+    // positions, ns x 3 array of ship coordinates for currently tried 
+    // positions, H x W layers of positions blocked by the 1st, 2nd, ... 
+    // ships
+    int **init_ext;
+    bool **ship_pos;
+    int **ship_coord_tmp;
+    bool ***blocked;
+    // stack of ns frames, one per ship; depth: number of frames on the
+    // stack (0: the search is finished). Below the top frame, the ships 
+    // are placed at the positions of their frames and their layers of
+    // blocked set
+    struct search_frame *frame;
+    int depth;
+    // the top frame has just been pushed (its node is not counted yet);
+    // else the search returns to it from the next ship
+    bool enter;
+    // shard of the search (see search_shard()): the prefixes (positions 
+    // of the first shard_depth ships) are numbered in the order of the 
+    // search, and only those with number % num_shards == shard are 
+    // searched; prefix: number of the next prefix. The nodes above the 
+    // prefixes are counted by shard 0 only. num_shards = 1, shard_depth
+    // = 0: the whole search
+    int shard, num_shards, shard_depth, prefix;
+};
+
+/* search of the solver, see place_ship() */
+typedef bool (*place_ship_fn)(struct search *s, long nodes);
+
+/* force inlining (used to specialize the solver for given grid sizes) */
+#if defined(__GNUC__) || defined(__clang__)
+#  define ALWAYS_INLINE inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+#  define ALWAYS_INLINE __forceinline
+#else
+#  define ALWAYS_INLINE inline
+#endif
+
+
+/* scratch memory (arena) for the solver and the generator, sized once
+for given height, width and number of ships and reused between calls
+(see scratch_new()) */
+struct scratch_block {
+    // previous block; further blocks are only added if the first one
+    // turns out to be too small
+    struct scratch_block *prev;
+    // size of the memory area in bytes, bytes in use
+    size_t size, used;
+    char *mem;
+};
+
+struct scratch {
+    // height, width, number of ships the arena is sized for
+    int H, W, num_ships;
+    // block from which memory is currently taken
+    struct scratch_block *top;
+};
+
+/* position in the arena to which it can be reset */
+struct scratch_mark {
+    struct scratch_block *block;
+    size_t used;
+};
+
+/* alignment of the arrays taken from the arena */
+#define SCRATCH_ALIGN 16
+
+/* array of given type and length taken from the arena (cf. snewn) */
+#define scratch_newn(sc, number, type) \
+    ((type *) scratch_alloc((sc), (number) * sizeof(type)))
+
+
+/* Instrumentation of the solvers and the generator, compiled in only if
+SHIPS_STATS is defined (otherwise the macros below expand to nothing).
+The counters and the phase timings are collected in the global struct
+ships_stats, which is printed to stderr at exit; if the environment 
+variable SHIPS_TRACE names a file, the timed phases are also written to
+it in the Chrome trace-event format (chrome://tracing, Perfetto). The 
+instrumentation is meant for single-threaded profiling runs. */
+
+/* timed phases */
+enum Phase {
+    PHASE_SHIPS,    // generator_diff(): selection of the ship sizes
+    PHASE_LAYOUT,   // generator_diff(): sampling of the ship layout
+    PHASE_CLUES,    // generator_diff(): initial sums and disclosed cells
+    PHASE_REPAIR,   // generator_diff(): adjustment of the difficulty
+    PHASE_LOGIC,    // solve_by_logic()
+    PHASE_SOLVER,   // solver()
+    NPHASES
+};
+
+/* branches of the repair loop in generator_diff() */
+enum Repair {
+    REPAIR_ACCEPT,      // difficulty reached, puzzle accepted
+    REPAIR_HIDE_SUM,    // too easy: hide a sum
+    REPAIR_HIDE_CELL,   // too easy: hide a disclosed cell
+    REPAIR_AMBIGUOUS,   // non-unique: disclose a cell as vacant
+    REPAIR_SHOW_SUM,    // too difficult: show a hidden sum
+    REPAIR_SHOW_VACANT, // too difficult: disclose a vacant cell
+    REPAIR_SHOW_SHIP,   // too difficult: disclose a ship cell
+    NREPAIRS
+};
+
+/* strategies of solve_by_logic(): 0 (solver_init()), 1 .. 7 */
+#define NSTRATEGIES 8
+
+#ifdef SHIPS_STATS
+
+/* trace event: phase, start time and duration in microseconds */
+struct stats_event {
+    enum Phase phase;
+    double ts, dur;
+};
+
+struct ships_stats {
+    // nodes of place_ship(); placements rejected because a row/column
+    // sum is exceeded (or not reached by the last ship), because a cell 
+    // is blocked by a previously placed ship (halo), or because of 
+    // a conflict with the initially disclosed cells
+    long place_ship_nodes, prune_sum, prune_halo, prune_init;
+    // calls of place_ship_rng(), failed layout attempts, dropped ships
+    long rng_nodes, rng_fail, ship_drops;
+    // iterations of the repair loop per branch (enum Repair)
+    long repair[NREPAIRS];
+    // cells resolved by solve_by_logic() per strategy: 0 (neighbors of
+    // occupied cells, solver_init()), 1 .. 7 (see solve_by_logic())
+    long logic_hits[NSTRATEGIES];
+    // occupied and vacant cells before the strategy currently applied
+    int logic_occ, logic_vac;
+    // number of calls, accumulated time in microseconds, start time of 
+    // the running call per phase
+    long phase_calls[NPHASES];
+    double phase_us[NPHASES], phase_t0[NPHASES];
+    // recorded trace events
+    struct stats_event *events;
+    int num_events, size_events;
+};
+
+static struct ships_stats ships_stats;
+
+static void stats_phase_end(enum Phase phase);
+static void stats_logic_count(int h, int w, int **grid, int *occ, int *vac);
+static void stats_print(void);
+
+#  define STATS_INC(field)        (ships_stats.field++)
+#  define STATS_PHASE_BEGIN(ph)   (ships_stats.phase_t0[ph] = time_us())
+#  define STATS_PHASE_END(ph)     stats_phase_end(ph)
+   // cells resolved by a strategy: count before (_BEGIN) and after; 
+   // VACANT cells are credited to strategy kv, OCCUP cells to ko
+#  define STATS_LOGIC_BEGIN(h, w, grid) \
+    stats_logic_count( \
+      h, w, grid, &ships_stats.logic_occ, &ships_stats.logic_vac \
+    )
+#  define STATS_LOGIC_END(h, w, grid, kv, ko) do { \
+    int occ_, vac_; \
+    stats_logic_count(h, w, grid, &occ_, &vac_); \
+    ships_stats.logic_hits[kv] += vac_ - ships_stats.logic_vac; \
+    ships_stats.logic_hits[ko] += occ_ - ships_stats.logic_occ; \
+  } while (0)
+
+#else
+
+#  define STATS_INC(field)                      ((void) 0)
+#  define STATS_PHASE_BEGIN(ph)                 ((void) 0)
+#  define STATS_PHASE_END(ph)                   ((void) 0)
+#  define STATS_LOGIC_BEGIN(h, w, grid)         ((void) 0)
+#  define STATS_LOGIC_END(h, w, grid, kv, ko)   ((void) 0)
+
+#endif
+
+
+/* Telemetry record of a single run of new_game_desc(), passed to the 
+hook set by ships_set_telemetry_hook() (if any) */
+struct gen_telemetry {
+    // parameters of the generated game
+    int H, W, diff;
+    // duration of the phases PHASE_SHIPS .. PHASE_REPAIR (see enum Phase)
+    // and of the whole generation in milliseconds
+    double phase_ms[PHASE_REPAIR + 1], total_ms;
+    // attempts to sample a ship layout, ships dropped because no layout
+    // was found, final number of ships
+    int layout_attempts, ship_drops, num_ships;
+    // iterations of the repair loop
+    int repair_iters;
+    // initially disclosed cells of type VACANT, OCCUP, NORTH .. INNER
+    // (index = configuration + 1), hidden row/column sums
+    int clues[INNER + 2], sums_hidden;
+    // calls of solve_by_logic() and solver(), calls of place_ship() 
+    // summed over all solver() calls
+    int logic_calls, solver_calls;
+    long solver_count;
+};
+
+typedef void (*gen_telemetry_fn)(const struct gen_telemetry *tel, void *ctx);
+
+void ships_set_telemetry_hook(gen_telemetry_fn fn, void *ctx);
+
+static gen_telemetry_fn telemetry_hook = NULL;
+static void *telemetry_ctx = NULL;
+
+char *ships_generate(const game_params *params, const char *seed);
+
+int ships_generate_chain(
+  const game_params *params, const char *seed, char **descs
+);
+
+/* rule by which the cell of a hint is determined (see ships_hint()) */
+enum HintRule {
+    HINT_NONE,        // no hint available
+    HINT_MISTAKE,     // the user's mark contradicts every solution
+    HINT_NEIGHBORS,   // neighbors of occupied cells (see solver_init())
+    HINT_SUMS,        // sum totals (strategies 1, 2 of solve_by_logic())
+    HINT_STRIPES,     // longest unfinished ship (strategy 3)
+    HINT_SHORT_GAPS,  // gaps shorter than the shortest ship (strategy 4)
+    HINT_FILL_GAPS,   // gaps that fit the longest ships (strategy 5)
+    HINT_CENSUS,      // placements of the unfinished ships (strategy 7)
+    HINT_LINES,       // complete line solver (strategy 6)
+    HINT_SOLUTION,    // none of the above: cell fixed in every solution
+    NHINTS
+};
+
+/* next deduction from the user's marks */
+struct ships_hint {
+    // cell, its value (OCCUP or VACANT; for HINT_MISTAKE the wrong mark)
+    int y, x;
+    enum Configuration conf;
+    enum HintRule rule;
+};
+
+bool ships_hint(const game_state *state, struct ships_hint *hint);
+
+/* search of the solver run in steps, see ships_search_new() */
+struct ships_search;
+
+struct ships_search *ships_search_new(
+  const game_state *state, long long count_lim
+);
+struct ships_search *ships_search_shard(
+  const game_state *state, long long count_lim, int shard, int num_shards
+);
+int ships_shard_merge(
+  int num_shards, const int *err, const long long *count, 
+  long long count_lim, long long *total
+);
+bool ships_search_step(
+  struct ships_search *ss, long nodes, long long *count
+);
+int ships_search_err(const struct ships_search *ss);
+char *ships_search_checkpoint(const struct ships_search *ss);
+struct ships_search *ships_search_resume(
+  const game_state *state, const char *checkpoint
+);
+char *ships_search_finish(struct ships_search *ss, const char **error);
+
+/* Library interface on typed data, without the description and move
+strings of the framework: a puzzle is a struct game_state_const (see
+ships_puzzle_new()), and the game of a player on it a game_state (see
+ships_game_new()). new_game_desc(), new_game(), solve_game() and
+execute_move() only translate the strings to and from these calls. The
+functions keep no state of their own (apart from the settings of
+ships_set_telemetry_hook() and ships_set_repair_workers()), so they can
+be called from several threads at once; a puzzle can be read by several
+threads, but it is only created, referenced and freed by one. */
+
+/* solution of a puzzle, see ships_solve() */
+struct ships_solution {
+    // error value and nodes of the search (see struct sol)
+    int err;
+    long long count;
+    // num_ships x 3 arrays of the ship coordinates (vert, y, x) of the
+    // first solution (err = 0, 2) and of a second one (err = 2), else NULL
+    int **ship_coord, **ship_coord2;
+};
+
+/* difficulty of a puzzle, see ships_grade() */
+struct ships_grade {
+    // lowest difficulty level whose criteria the puzzle meets, -1 if the
+    // puzzle has no unique solution (or the search exceeded its limit)
+    int diff;
+    // result of solve_by_logic() with all strategies, occupied and vacant
+    // cells it determines
+    int logic, occ, vac;
+    // error value and nodes of solver()
     int err;
+    long long count;
+};
+
+/* kind of a move of the player, see struct ships_move */
+enum MoveKind {
+    MOVE_CELL,    // mark of a cell
+    MOVE_DRAG,    // cells of a row or column set vacant or cleared
+    MOVE_ROW,     // row marked as done or not done
+    MOVE_COL,     // column marked as done or not done
+    MOVE_SOLVE    // solution filled in (Solve button)
+};
+
+/* move of the player, see ships_apply_move() */
+struct ships_move {
+    enum MoveKind kind;
+    // MOVE_CELL: cell (y, x) and its mark conf; MOVE_DRAG: first (y, x)
+    // and last cell (y2, x2), in one row or column, and whether vacant
+    // cells are cleared (else undefined ones set vacant); MOVE_ROW,
+    // MOVE_COL: row y, column x
+    int y, x, y2, x2;
+    enum Configuration conf;
+    bool clear;
+    // MOVE_SOLVE: array of size H*W of the solution (UNDEF: the cell 
+    // keeps its disclosed value, if any, else it is set vacant)
+    const enum Configuration *grid;
+};
+
+const char *ships_validate(
+  const game_params *params, int num_ships, const int *ships,
+  const int *rows, const int *cols, const int *init
+);
+struct game_state_const *ships_puzzle_new(
+  const game_params *params, int num_ships, const int *ships,
+  const int *rows, const int *cols, const int *init, const char **error
+);
+struct game_state_const *ships_puzzle_generate(
+  const game_params *params, random_state *rs, struct gen_telemetry *tel
+);
+void ships_puzzle_free(struct game_state_const *puzzle);
+struct ships_solution *ships_solve(
+  const struct game_state_const *puzzle, long long count_lim,
+  struct solve_ctl *ctl
+);
+void ships_solution_free(struct ships_solution *soln);
+void ships_grade(
+  const struct game_state_const *puzzle, long long count_lim,
+  struct ships_grade *grade
+);
+game_state *ships_game_new(struct game_state_const *puzzle);
+game_state *ships_apply_move(
+  const game_state *state, const struct ships_move *move
+);
+void ships_game_free(game_state *state);
+
+#ifdef SHIPS_THREADS
+/* solver running on a worker thread, see ships_solve_start() */
+struct ships_async_solve;
+
+struct ships_async_solve *ships_solve_start(const game_state *state);
+bool ships_solve_progress(
+  struct ships_async_solve *as, long long *nodes, double *fraction
+);
+void ships_solve_cancel(struct ships_async_solve *as);
+char *ships_solve_finish(struct ships_async_solve *as, const char **error);
+
+/* threads evaluating the repair candidates of the generator */
+void ships_set_repair_workers(int workers);
+
+static int repair_workers = 0;
+#endif
+
+
+#ifdef STANDALONE_SOLVER
+/* The headless driver at the end of the file counts the memory allocated
+by the game: smalloc(), srealloc(), sfree() and dupstr() are redirected to 
+versions which keep the block size in a header in front of the block */
+struct alloc_count {
+    // calls of malloc/realloc and free, bytes requested in total
+    long allocs, frees;
+    size_t bytes;
+    // bytes currently allocated, maximum thereof
+    size_t live, peak;
 };
+static struct alloc_count alloc_count;
+
+static void *count_malloc(size_t size);
+static void *count_realloc(void *p, size_t size);
+static void count_free(void *p);
+static char *count_dupstr(const char *s);
+
+#  define smalloc  count_malloc
+#  define srealloc count_realloc
+#  define sfree    count_free
+#  define dupstr   count_dupstr
+#endif
 
 
 /* persistent elements in game state */
@@ -154,6 +621,10 @@ struct game_state_const {
     int *rows, *cols;
     // 2D-array of size H x W with the initial configuration
     int **init;    
+    // array of size H*W: OCCUP or VACANT for the cells which are so in 
+    // every solution (the whole solution if it is unique), UNDEF for the 
+    // others; NULL if no such cell is known (see live_backbone())
+    enum Configuration *fixed;
 };
 
 /* comparison function for sorting (ctx = 1/-1: assending, descending) */
@@ -177,6 +648,14 @@ int cmp(const void *a, const void *b, void *ctx) {
 /* completion flash */
 #define FLASH_TIME 0.4F
 
+/* round(x*num/den) for integer x >= 0 in integer arithmetic (halves are 
+rounded up), so that the generator does not depend on floating point */
+#define ROUND_FRAC(x, num, den)  ((2*(num)*(x) + (den))/(2*(den)))
+
+/* number of candidate changes of the clues compared by the generator 
+in each repair step (see clue_select()) */
+#define CLUE_CANDIDATES 4
+
 /* condition for a corrupt string */
 #define BADSTRING(p, atoi_p, pmin, pmax) *(p) && \
   (atoi_p < pmin || atoi_p > pmax - 1 || atoi_p == 0 && *(p) != '0') \
@@ -198,15 +677,56 @@ int cmp(const void *a, const void *b, void *ctx) {
 /* ----------------------------------------------------------------------
  *-*-* headers of my functions that are specified at the end
  */
+static struct scratch *scratch_new(int h, int w, int ns);
+
+static void scratch_free(struct scratch *sc);
+
+static struct scratch_mark scratch_mark(const struct scratch *sc);
+
+static void scratch_reset(struct scratch *sc, struct scratch_mark mark);
+
+static void *scratch_alloc(struct scratch *sc, size_t size);
+
+static int **scratch_grid_int(struct scratch *sc, int h, int w);
+
+static bool **scratch_grid_bool(struct scratch *sc, int h, int w);
+
+static bool ***scratch_layers(struct scratch *sc, int n, int h, int w);
+
+static void scratch_sol(struct scratch *sc, int ns, struct sol *soln);
+
+static double time_us(void);
+
+static void telemetry_phase(
+  struct gen_telemetry *tel, enum Phase phase, double *t
+);
+
+static char *encode_desc(
+  int h, int w, int num_ships, const int *ships, const int *rows, 
+  const int *cols, enum Configuration **init
+);
+
 static void solver_init (const int h, const int w, int **init_ext);
 
 static void solver (
-  const struct game_state_const *init_state, int count_lim, struct sol *soln
+  const struct game_state_const *init_state, long long count_lim,
+  struct sol *soln, struct scratch *sc
+);
+
+static void solver_alt(
+  const struct game_state_const *init_state, int **ship_coord_ref, 
+  long long count_lim, struct sol *soln, struct scratch *sc
+);
+
+static bool backbone(
+  const struct game_state_const *init_state, int **ship_coord, 
+  long long count_lim, enum Configuration *bb, int *var, 
+  struct scratch *sc
 );
 
 static int solve_by_logic(
-  int diff, const struct game_state_const *init_state, 
-  enum Configuration **grid, int *occ, int *vac
+  int diff, const struct game_state_const *init_state,
+  enum Configuration **grid, int *occ, int *vac, struct scratch *sc
 );
  
 static void render_grid_conf(
@@ -214,19 +734,125 @@ static void render_grid_conf(
   bool remove
 );
 
-static void place_ship(
-  const struct game_state_const *init_state, int **init_ext, bool ***blocked, 
-  bool **ship_pos, int **ship_coord_tmp, int ship_num, int vert0, int y0, 
-  int x0, int count_lim, struct sol *soln
+static void logic_sums(
+  const struct game_state_const *init_state, enum Configuration **grid
+);
+
+static void logic_stripes(
+  const struct game_state_const *init_state, enum Configuration **grid, 
+  const int *distr_all, int *distr_compl
+);
+
+static void logic_short_gaps(
+  const struct game_state_const *init_state, enum Configuration **grid, 
+  const int *distr_all, int *distr_compl
+);
+
+static void logic_fill_gaps(
+  const struct game_state_const *init_state, enum Configuration **grid, 
+  const int *distr_all, const int *distr_compl, int *gaps
+);
+
+static void logic_lines(
+  const struct game_state_const *init_state, enum Configuration **grid, 
+  const int *distr_all, struct scratch *sc
 );
 
+static void logic_census(
+  const struct game_state_const *init_state, enum Configuration **grid, 
+  const int *distr_all, int *distr_compl, bool *alive, struct scratch *sc
+);
+
+static void solver_kernel(
+  const struct game_state_const *init_state, long long count_lim,
+  struct sol *soln, struct scratch *sc, place_ship_fn kernel
+);
+
+static bool solve_ctl_poll(struct solve_ctl *ctl, long long count);
+
+static char *solve_init_state(
+  const struct game_state_const *init_state, struct solve_ctl *ctl,
+  const char **error
+);
+
+static char *solution_move(
+  const struct game_state_const *init_state, int **ship_coord
+);
+
+static void search_init(
+  struct search *s, const struct game_state_const *init_state, 
+  long long count_lim, struct sol *soln, struct scratch *sc
+);
+
+static void search_shard(struct search *s, int shard, int num_shards);
+
+static place_ship_fn search_kernel(int h, int w);
+
+static bool place_ship(struct search *s, long nodes);
+
+static bool place_ship_7x7(struct search *s, long nodes);
+
+static bool place_ship_8x10(struct search *s, long nodes);
+
+static bool place_ship_10x12(struct search *s, long nodes);
+
 static bool compl_ships_distr(
   int h, int w, int **grid, int max_size, int *distr
 );
 
+static int clue_amounts(
+  int diff, int h, int w, int num_cells, random_state *rs, int *ini_cells
+);
+
+static int clue_sample(int *cand, int num, random_state *rs);
+
+static void clue_shuffle(
+  int *cand, int num, enum Configuration **grid, 
+  const struct game_state_const *init_state, random_state *rs
+);
+
+static void clue_topup(
+  int diff, const struct game_state_const *init_state, 
+  enum Configuration **layout, const int *rows0, const int *cols0, 
+  int *ini_cells, int *sums_ex, int *cand, enum Configuration **grid, 
+  random_state *rs
+);
+
+static int clue_apply(struct game_state_const *init_state, int pos, int val);
+
+static int clue_select(
+  int diff, struct game_state_const *init_state, const int *pos, 
+  const int *val, int num, bool harder, enum Configuration **grid, 
+  struct scratch *sc
+);
+
+#ifdef SHIPS_THREADS
+struct clue_pool;
+
+static struct clue_pool *clue_pool_new(
+  const struct game_state_const *init_state, int threads
+);
+
+static void clue_pool_free(struct clue_pool *pool);
+
+static int clue_pool_run(
+  struct clue_pool *pool, const struct game_state_const *init_state, 
+  int **ship_coord, const int *count_int, const int *pos, const int *val, 
+  int num, int *log_solve, struct sol *soln, struct gen_telemetry *tel
+);
+#endif
+
+static bool fleet_fits(int h, int w, int ns, const int *ships);
+
+static int *generator_fleet(
+  const game_params *params, int diff_fleet, random_state *rs, 
+  int *num_ships
+);
+
 static void generator_diff(
-  const game_params *params, random_state *rs, int *num_ships, int **ships, 
-  int *rows, int *cols, int **init
+  const game_params *params, random_state *rs, int *num_ships, int **ships,
+  int *rows, int *cols, int **init, struct scratch *sc,
+  struct gen_telemetry *tel, char **chain
 );
 
 static bool place_ship_rng(
@@ -234,6 +860,15 @@ static bool place_ship_rng(
   bool ***blocked, random_state *rs, int **ship_coord, int *count, 
   int count_lim
 );
+
+static bool layout7_fleet(const struct game_state_const *init_state);
+
+static void layout7_sample(random_state *rs, int **ship_coord);
+
+static int layout7_match(
+  const struct game_state_const *init_state, int max, int **coord, 
+  int **coord2, int *occupied
+);
  
 static void draw_segment(
   drawing *dr, const enum Configuration conf, const int tilesize, 
@@ -247,6 +882,20 @@ static void draw_cell(
 );
 
 static void validation(game_state *state, bool *solved);
+
+static enum Configuration *live_backbone(
+  const struct game_state_const *init_state
+);
+
+static bool marks_sums_ok(
+  const struct game_state_const *init_state, enum Configuration **grid
+);
+
+static bool marks_propagate(
+  const struct game_state_const *init_state, enum Configuration **grid
+);
+
+static bool still_solvable(const game_state *state);
 /* ----------------------------------------------------------------------
  *-*-* end of headers 
  */
@@ -286,6 +935,9 @@ struct game_state {
     bool ships_err;
     //-*-* flags showing if the game is solved and if cheated (solve function)
     bool completed, cheated;
+    //-*-* variable is true if the marks of the user contradict every
+    // solution of the puzzle (see still_solvable())
+    bool unsolvable;
 };
 
 
@@ -438,11 +1090,9 @@ static game_params *custom_params(const config_item *cfg)
 /*-*-* validate parameter substring */
 static const char *validate_params(const game_params *params, bool full)
 {    
-    char s[256];
-    
+    //-*-* the message is not freed by the caller, so it must be a literal
     if (full && (params->diff < 0 || params->diff > 3)) {    
-        sprintf(s, "Unknown difficulty rating."); 
-        return dupstr(s);
+        return "Unknown difficulty rating.";
     } 
     
     else if (
@@ -450,10 +1100,10 @@ static const char *validate_params(const game_params *params, bool full)
       params->W < SIZEMIN || params->W > SIZEMAX 
     ) 
     { 
-        sprintf(s, 
-          "Height and width must be between %d and %d.", SIZEMIN, SIZEMAX
-        );
-        return dupstr(s);
+        return 
+          "Height and width must be between " STRINGIFY(SIZEMIN) " and " 
+          STRINGIFY(SIZEMAX) "."
+        ;
     }        
     
     return NULL;
@@ -464,68 +1114,20 @@ static const char *validate_params(const game_params *params, bool full)
 static char *new_game_desc(const game_params *params, random_state *rs,
 			   char **aux, bool interactive)
 {
-    //-*-* game is generated in generator_diff(); here pointers for the
-    // return data are defined and, where possible, nondynamically allocated;
-    // the rest is allocated in the fuction
-    int i, j;
-    int h = params->H, w = params->W;
-    int rows[h], cols[w];
-    int num_ships, *ships;
-    
-    int *init[h], init_[h*w];
-    for (i = 0; i < h; i++) {
-        init[i] = init_ + i*w;
-    }
-    
-    //-*-* generator
-    generator_diff(params, rs, &num_ships, &ships, rows, cols, init);
-
-    //-*-* define strings
+    //-*-* game is generated by ships_puzzle_generate(); the telemetry
+    // record is only filled in if a hook is set
+    struct gen_telemetry tel, *ptel = (telemetry_hook ? &tel : NULL);
+    struct game_state_const *puzzle = 
+      ships_puzzle_generate(params, rs, ptel)
+    ;
+    if (ptel) telemetry_hook(&tel, telemetry_ctx);
 
-    //-*-* string has the format as in following simplified example 
-    // s5s5s4r11r0r-1r7r1c7c2c-1y0x11z-1y7x2z5, where s..s.. is
-    // array ships, here [5,5,4], r..r.. is array rows, here 
-    // [11,0,-1,7,1], c..c.. is array cols, here [7,2,-1], y..x..z..y..
-    // is 2D-array of initially disclosed cells (not equal to -2), 
-    // here [[0,11,-1],[7,2,5]]; its elements are [H-coord., W-coord., config.]
-    
-    //-*-* Max. length of the string: 
-    // (num_ships + H + W)*3 + (# init > -2)*8 + 1
-    // Calculate # init > -2
-    int num_init = 0;
-    for (i = 0; i < h*w; i++) {
-        if (init_[i] > -2) num_init++;
-    }
-    
-    //-*-* create string
-    char *ret, *str;    
-    str = snewn((num_ships + h + w)*3 + num_init*8 + 1, char); 
-    ret = str; 
-    
-    for (i = 0; i < num_ships; i++) {
-        sprintf(ret, "s%d", ships[i]);    
-        ret += 2 + (ships[i] > 9); 
-    }
-    for (i = 0; i < h; i++) {
-        sprintf(ret, "r%d", rows[i]);
-        ret += 2 + (rows[i] < 0 || rows[i] > 9); 
-    }
-    for (i = 0; i < w; i++) {
-        sprintf(ret, "c%d", cols[i]);
-        ret += 2 + (cols[i] < 0 || cols[i] > 9); 
-    }
-    for (i = 0; i < h; i++) {
-        for (j = 0; j < w; j++) {
-            if (init[i][j] > -2) {
-                sprintf(ret, "y%dx%dz%d", i, j, init[i][j]);
-                ret += 6 + (i > 9) + (j > 9) + (init[i][j] < 0); 
-            }
-        }
-    }
-    
-    ret = '\0';
-        
-    sfree(ships);
+    //-*-* description string
+    char *str = encode_desc(
+      puzzle->H, puzzle->W, puzzle->num_ships, puzzle->ships, puzzle->rows,
+      puzzle->cols, puzzle->init
+    );
+    ships_puzzle_free(puzzle);
       
     return str;
 }
@@ -648,86 +1250,42 @@ static const char *validate_desc(const game_params *params, const char *desc)
 static game_state *new_game(midend *me, const game_params *params,
                             const char *desc)
 {
-    int i, j;
+    int i;
     int h = params->H, w = params->W;
-
-    game_state *state = snew(game_state);
-
-    
-    //-*-* initializations without using desc
-    
-    state->init_state = snew(struct game_state_const);
-    state->init_state->refcount = 1;
-
-    state->init_state->H = h;
-    state->init_state->W = w;
     
-    state->init_state->rows = snewn(h, int);
-    state->init_state->cols = snewn(w, int);
-    state->rows_state = snewn(h, bool);
-    state->cols_state = snewn(w, bool);
-    state->rows_err   = snewn(h, bool);
-    state->cols_err   = snewn(w, bool);
-    for (i = 0; i < h; i++) state->rows_state [i] = false;
-    for (i = 0; i < w; i++) state->cols_state [i] = false;
-
-    //-*-* 2D arrays
-    state->init_state->init = snewn(h, int*);
-    state->grid_state       = snewn(h, int*);
-    state->grid_state_err   = snewn(h, bool*);
-    *(state->init_state->init) = snewn(h*w, int); 
-    *(state->grid_state)       = snewn(h*w, int); 
-    *(state->grid_state_err)   = snewn(h*w, bool); 
-    for (i = 1; i < h; i++) {
-      state->init_state->init [i] = state->init_state->init [0] + i*w;
-      state->grid_state [i]       = state->grid_state [0]       + i*w;
-      state->grid_state_err [i]   = state->grid_state_err [0]   + i*w;
-    }
-    for (i = 0; i < h; i++) {
-        for (j = 0; j < w; j++) {
-            state->init_state->init [i][j] = -2;
-            state->grid_state       [i][j] = -2;
-        }
-    }
-
-    //-*-* initializations using desc
-
     //-*-* determine num_ships and number of initially disclosed cells
     char const *p = desc;
-    int num_init = 0;
-    state->init_state->num_ships = 0;
+    int ns = 0, num_init = 0;
     while (*p) {    
-        if      (*p == 's') (state->init_state->num_ships)++;
+        if      (*p == 's') ns++;
         else if (*p == 'y') num_init++;
         p++;
     }
     
-    int ns = state->init_state->num_ships;
-    state->init_state->ships = snewn(ns, int); 
-    state->ships_state       = snewn(ns, bool); 
-    
     //-*-* read from desc
     p = desc;
     int 
       count_s = 0, count_r = 0, count_c = 0, count_y = 0, count_x = 0,
       count_z = 0
     ;
-    int y[num_init], x[num_init], z[num_init];
+    //-*-* (at least one element: a zero-length array is undefined)
+    int ships[ns + 1], rows[h], cols[w], init[h*w];
+    int y[num_init + 1], x[num_init + 1], z[num_init + 1];
     
     while (*p) {    
         if (*p == 's') {
             p++;
-            state->init_state->ships [count_s] = atoi(p);
+            ships[count_s] = atoi(p);
             count_s++;
         }
         else if (*p == 'r') {
             p++;
-            state->init_state->rows [count_r] = atoi(p);
+            rows[count_r] = atoi(p);
             count_r++;
         }
         else if (*p == 'c') {
             p++;
-            state->init_state->cols [count_c] = atoi(p);
+            cols[count_c] = atoi(p);
             count_c++;
         }
         else if (*p == 'y') {
@@ -748,54 +1306,17 @@ static game_state *new_game(midend *me, const game_params *params,
         else p++;   
     }
     
-    //-*-* sums
-    state->init_state->ships_sum = 0;
-    for (i = 0; i < ns; i++) 
-      state->init_state->ships_sum += state->init_state->ships[i]
-    ;
-    state->init_state->rows_sum = 0;
-    for (i = 0; i < h; i++) {
-      if (state->init_state->rows[i] > -1) 
-        state->init_state->rows_sum += state->init_state->rows[i]
-      ;
-    }
-    state->init_state->cols_sum = 0;
-    for (i = 0; i < w; i++) {
-      if (state->init_state->cols[i] > -1) 
-        state->init_state->cols_sum += state->init_state->cols[i]
-      ;
-    }
-    
-    //-*-* fill initially disclosed cells (grid_state gets the same value)
-    for (i = 0; i < num_init; i++){
-        state->init_state->init  [y[i]] [x[i]] = z[i];
-        state->grid_state        [y[i]] [x[i]] = z[i];
-    }
+    //-*-* initially disclosed cells
+    for (i = 0; i < h*w; i++) init[i] = UNDEF;
+    for (i = 0; i < num_init; i++) init[y[i]*w + x[i]] = z[i];
     
-    //-*-* specify type (1 to 6) of OCCUP cells wherever possible
-    render_grid_conf(h, w, state->grid_state, state->init_state->init, false);
-
-    //-*-* sort ships
-    int ctx = -1;
-    arraysort(state->init_state->ships, ns, cmp, &ctx);
-        
-    //-*-* ship distribution
-    state->init_state->ships_distr = 
-      snewn(state->init_state->ships [0], int)
-    ;    
-    for (i = 0; i < state->init_state->ships [0]; i++){
-        state->init_state->ships_distr [i] = 0;
-    }
-    for (i = 0; i < ns; i++){
-        (state->init_state->ships_distr [state->init_state->ships [i] - 1])++;
-    }
-        
-    //-*-* check for errors
-    bool solved; 
-    validation(state, &solved);
-    state->completed = solved;
-
-    state->cheated   = false;
+    //-*-* the description is validated by validate_desc() beforehand
+    const char *error;
+    struct game_state_const *puzzle = 
+      ships_puzzle_new(params, ns, ships, rows, cols, init, &error)
+    ;
+    game_state *state = ships_game_new(puzzle);
+    ships_puzzle_free(puzzle);
       
     return state;
 }
@@ -810,9 +1331,10 @@ static game_state *dup_game(const game_state *state)
     int h = state->init_state->H, w = state->init_state->W;
     int ns = state->init_state->num_ships;
     
-    ret->ships_err = state->ships_err;
-    ret->completed = state->completed;
-    ret->cheated   = state->cheated;
+    ret->ships_err  = state->ships_err;
+    ret->completed  = state->completed;
+    ret->cheated    = state->cheated;
+    ret->unsolvable = state->unsolvable;
 
     ret->grid_state    = snewn(h,   int*);
     *(ret->grid_state) = snewn(h*w, int); 
@@ -870,79 +1392,29 @@ static void free_game(game_state *state)
     
     sfree(state->ships_state);
     
-    if (--state->init_state->refcount <= 0) {
-        sfree(*(state->init_state->init));
-        sfree(state->init_state->init);
-        sfree(state->init_state->ships);
-        sfree(state->init_state->ships_distr);
-        sfree(state->init_state->rows);
-        sfree(state->init_state->cols);
-        sfree(state->init_state);
-    }
+    ships_puzzle_free(state->init_state);
         
     sfree(state);
 }
 
 
-/*-*-* yield solution (called when pressing Solve button) */
+/*-*-* yield solution (called when pressing Solve button) 
+
+The framework expects the move string to be returned, so the search runs 
+on the calling (UI) thread and blocks it: for at most SOLVE_TIMEOUT 
+seconds, after which it is given up with an error, so that hard 
+user-entered descriptions cannot hang the game. Frontends built with 
+SHIPS_THREADS which must stay responsive meanwhile can solve on a worker 
+instead (see ships_solve_start()), showing progress and letting the 
+player cancel. */
 static char *solve_game(const game_state *state, const game_state *currstate,
                         const char *aux, const char **error)
 {
-    int i, j;
-    int h = state->init_state->H, w = state->init_state->W;
-    int ns = state->init_state->num_ships;
-    int ships_sum = state->init_state->ships_sum;
-    int *ships = state->init_state->ships;
-    
-    //-*-* define solution struct
-    struct sol soln;
-    soln.ship_coord  = snewn(ns, int*);
-    soln.ship_coord2 = snewn(ns, int*);
-    *(soln.ship_coord)  = snewn(ns*3, int);
-    *(soln.ship_coord2) = snewn(ns*3, int);
-    for (i = 1; i < ns; i++) {
-        soln.ship_coord  [i] = soln.ship_coord  [0] + i*3;
-        soln.ship_coord2 [i] = soln.ship_coord2 [0] + i*3;
-    }
-    
-    solver (state->init_state, 0, &soln);
-    
-    if (soln.err == 2) { 
-    	*error = "Multiple solutions exist for this puzzle";
-	    return NULL; 
-	}
-    if (soln.err == 3) { 
-    	*error = "No solution exists for this puzzle";
-	    return NULL; 
-	}
-	
-    char out[8*ships_sum + 2], *ptr = out;
-    int vert, y, x, z;
-    strcpy(ptr++, "S"); //-*-* first symbol S to indicate Solve usage
-    for (i = 0; i < ns; i++) {
-        for (j = 0; j < ships[i]; j++) {
-            vert = soln.ship_coord[i][0];
-            y    = soln.ship_coord[i][1] + j*vert;
-            x    = soln.ship_coord[i][2] + j*(1 - vert);
-            if      (ships[i] == 1)               z = ONE;
-            else if (j == 0            &&   vert) z = NORTH;
-            else if (j == 0            && ! vert) z = WEST;
-            else if (j == ships[i] - 1 &&   vert) z = SOUTH;
-            else if (j == ships[i] - 1 && ! vert) z = EAST;
-            else                                  z = INNER;
-            sprintf(ptr, "y%dx%dz%d", y, x, z);
-            ptr += 6 + (y > 9) + (x > 9) + (z < 0);
-        }
-    }
-    *ptr = '\0';
+    struct solve_ctl ctl;
+    memset(&ctl, 0, sizeof(ctl));
+    ctl.deadline = time_us() + SOLVE_TIMEOUT*1e6;
     
-	sfree(*(soln.ship_coord));
-	sfree(*(soln.ship_coord2));
-	sfree(soln.ship_coord);
-	sfree(soln.ship_coord2);
-	
-    return dupstr(out);
-
+    return solve_init_state(state->init_state, &ctl, error);
 }
 
 
@@ -958,6 +1430,8 @@ struct game_ui {
     int hy, hx;
     //-*-* flag indicating if the cursor is currently visible
     bool hshow;
+    //-*-* number of changes of the game state (see game_changed_state())
+    int changes;
 };
 
 static game_ui *new_ui(const game_state *state)
@@ -967,6 +1441,7 @@ static game_ui *new_ui(const game_state *state)
     ui->drag = ui->clear = false;
     ui->hy = ui->hx = 0;
     ui->hshow = false;
+    ui->changes = 0;
     return ui;
 }
 
@@ -982,6 +1457,8 @@ static void free_ui(game_ui *ui)
 static void game_changed_state(game_ui *ui, const game_state *oldstate,
                                const game_state *newstate)
 {
+    //-*-* tells game_redraw() that the cursor is not the only change
+    ui->changes++;
 }
 
 
@@ -997,6 +1474,8 @@ struct game_drawstate {
     int hy, hx;
     //-*-* flag indicating if the drawstate has changed after start
     bool started;
+    //-*-* ui->changes at the last redraw
+    int changes;
 };
 
 
@@ -1043,6 +1522,19 @@ static char *interpret_move(const game_state *state, game_ui *ui,
             return dupstr(move);
         }
     }
+    
+    //-*-* hint: the next deduction is marked and the cursor placed on it
+    // (a wrong mark is only pointed to by the cursor)
+    if (button == 'h' || button == 'H') {
+        struct ships_hint hint;
+        if (! ships_hint(state, &hint)) return MOVE_UNUSED;
+        ui->hy = hint.y;
+        ui->hx = hint.x;
+        ui->hshow = true;
+        if (hint.rule == HINT_MISTAKE) return MOVE_UI_UPDATE;
+        sprintf(move, "y%dx%dz%d", hint.y, hint.x, hint.conf);
+        return dupstr(move);
+    }
 
     
     
@@ -1152,7 +1644,7 @@ static game_state *execute_move(const game_state *oldstate, const char *move)
     int isy = 0, isx = 0, isz = 0;
     int dy[2], dx[2], idx = 0, idy = 0;
     bool clear;
-    int i, j;
+    int i;
 	    
     int y = -10, x = -10, z = -10, r = -10, c = -10;	    
 	char const *p = move;
@@ -1228,77 +1720,46 @@ static game_state *execute_move(const game_state *oldstate, const char *move)
     ) return NULL;
     
 
-    game_state *state;
-    state = dup_game(oldstate);
+    struct ships_move mv;
+    enum Configuration grid[h*w];
+    mv.grid = NULL;
         
     //-*-* Solve button pressed
     if (move[0] == 'S') {
-    
         if (isy < ships_sum || isx < ships_sum || isz < ships_sum)
           return NULL
         ;
+        for (i = 0; i < h*w; i++) grid[i] = UNDEF;
+        for (i = 0; i < ships_sum; i++) grid[sy[i]*w + sx[i]] = sz[i];
+        mv.kind = MOVE_SOLVE;
+        mv.grid = grid;
+    }
     
-	    memcpy(
-	      *(state->grid_state), *(state->init_state->init),
-	      sizeof(**(state->init_state->init))*h*w
-	    );
-	    
-	    for (i = 0; i < ships_sum; i++) {
-	        state->grid_state [sy[i]][sx[i]] = sz[i];
-	    }
-	    
-		for (i = 0; i < h*w; i++) {
-    		if ((*(state->grid_state)) [i] == UNDEF) 
-    		  (*(state->grid_state)) [i] = VACANT
-	    	;
-		}
-	        
-	    state->cheated = true;	    
-	}
-	    
     //-*-* right drag/click
     else if (move[0] == 'd') {
-    
-        if (idy < 2 || idx < 2 || dy[0] != dy[1] && dx[0] != dx[1]) 
-          return NULL
-        ;
-        
-        for (i = min(dy[0], dy[1]); i <= max(dy[0], dy[1]); i++) {
-            for (j = min(dx[0], dx[1]); j <= max(dx[0], dx[1]); j++) {
-                if (
-                  clear && state->init_state->init [i][j] == UNDEF &&
-                   state->grid_state [i][j] == VACANT
-                ) 
-	              state->grid_state [i][j] = UNDEF
-	            ;
-	            if (! clear && state->grid_state [i][j] == UNDEF)
-	              state->grid_state [i][j] = VACANT
-	            ;
-            }
-        }
-        
+        if (idy < 2 || idx < 2) return NULL;
+        mv.kind = MOVE_DRAG;
+        mv.y = dy[0];  mv.x = dx[0];
+        mv.y2 = dy[1]; mv.x2 = dx[1];
+        mv.clear = clear;
     }
     
     //-*-* single move
+    else if (y != -10 && x != -10 && z != -10) {
+        mv.kind = MOVE_CELL;
+        mv.y = y; mv.x = x;
+        mv.conf = z;
+    }
+    else if (r != -10) {
+        mv.kind = MOVE_ROW;
+        mv.y = r;
+    }
     else {
-	    if (y != -10 && x != -10 && z != -10) {
-	        if (state->init_state->init [y][x] == UNDEF) {
-	            state->grid_state [y][x] = z;
-	        }
-	        else state->grid_state [y][x] = state->init_state->init [y][x];
-	    }
-	    else if (r != -10) state->rows_state[r] = ! oldstate->rows_state[r];
-	    else               state->cols_state[c] = ! oldstate->cols_state[c];
-	}
-	
-    //-*-* specify type (1 to 6) of OCCUP cells wherever possible
-    render_grid_conf(h, w, state->grid_state, state->init_state->init, true);
-    
-	bool solved; 
-	validation(state, &solved);
-	state->completed |= solved;
-	    	    
-	return state;
+        mv.kind = MOVE_COL;
+        mv.x = c;
+    }
+    
+    return ships_apply_move(oldstate, &mv);
 }
 
 /* ----------------------------------------------------------------------
@@ -1369,6 +1830,7 @@ static game_drawstate *game_new_drawstate(drawing *dr, const game_state *state)
 
     //-*-* receives the actual tilesize later via game_set_size()
     ds->started = false;
+    ds->changes = 0;
 
     return ds;
 }
@@ -1439,8 +1901,11 @@ static void game_redraw(drawing *dr, game_drawstate *ds,
     }
         
       
-    //-*-* cursor moves only
-    if (ui->hshow && ui->hy != ds->hy || ui->hx != ds->hx) {
+    //-*-* cursor moves only (a hint moves the cursor and changes the state)
+    if (
+      (ui->hshow && ui->hy != ds->hy || ui->hx != ds->hx) && 
+      ui->changes == ds->changes
+    ) {
             
         // redraw old
         i = ds->hy;
@@ -1465,6 +1930,10 @@ static void game_redraw(drawing *dr, game_drawstate *ds,
     //-*-* redraw at start or when cursor not moved
     else {
     
+        ds->hy = ui->hy;
+        ds->hx = ui->hx;
+        ds->changes = ui->changes;
+    
         //-*-* fill cells
         for (i = 0; i < h; i++) {
             for (j = 0; j < w; j++) {
@@ -1549,7 +2018,8 @@ static void game_redraw(drawing *dr, game_drawstate *ds,
         draw_text(
           dr, BORDER_LEFT(ts) + dx_ships, y_ships, FONT_VARIABLE,
           min((dx_ships > 38 ? dx_ships*4/10 : dx_ships*6/10), 2*SHIPS(ts)/5), 
-          ALIGN_VCENTRE | ALIGN_HCENTRE, COL_SHIPS, text
+          ALIGN_VCENTRE | ALIGN_HCENTRE, 
+          (state->unsolvable ? COL_ERROR : COL_SHIPS), text
         );
         for (i = 0; i < state->init_state->num_ships; i++) {
             sprintf(text, "%d", (state->init_state->ships)[i]);
@@ -1776,6 +2246,255 @@ const struct game thegame = {
  *-*-* my functions
  */
 
+/*
+Create a scratch arena for the solver and the generator
+
+Parameters:
+  h, w: height, width of the grid;
+  ns: (largest) number of ships.
+
+The arena consists of a single block of memory which is large enough for
+the arrays of generator_diff() together with those of solver() and
+solve_by_logic() called from it, so that it can be reused for any number
+of calls with the same h, w and at most ns ships. If it turns out to be 
+too small anyway, further blocks are added (and freed again by 
+scratch_reset()).
+
+*/
+static struct scratch *scratch_new(int h, int w, int ns)
+{
+    struct scratch *sc = snew(struct scratch);
+    size_t a = SCRATCH_ALIGN;
+    
+    // sizes of the arrays, each rounded up to the alignment
+    size_t grid_int  = h*sizeof(int*)  + h*w*sizeof(int)  + 2*a;
+    size_t grid_bool = h*sizeof(bool*) + h*w*sizeof(bool) + 2*a;
+    size_t coord     = ns*(sizeof(int*) + 3*sizeof(int))  + 2*a;
+    size_t layers    = 
+      ns*(sizeof(bool**) + h*sizeof(bool*) + h*w*sizeof(bool)) + 3*a
+    ;
+    size_t vec       = (h*w + h + w + 4*ns)*sizeof(int)     + a;
+    size_t n         = max(h, w) + 2;
+    size_t lines     = 
+      3*n*sizeof(int) + 2*n*sizeof(bool) + 3*n*n*sizeof(bool) + 8*a
+    ;
+    size_t census    = 
+      2*n*h*w*sizeof(bool) + (2*h*w + h + w)*sizeof(int) + h*w*sizeof(bool)
+      + 6*a
+    ;
+    size_t bb        = 2*grid_int + 2*coord + 2*h*w*sizeof(bool) + 2*a;
+    
+    sc->H = h;
+    sc->W = w;
+    sc->num_ships = ns;
+    
+    // generator_diff(): blocked, ship_coord, soln, ship_pos, layout, 
+    // grid, ten vectors; solver(): blocked, init_ext, ship_pos, 
+    // ship_coord_tmp, reference of solver_alt(); backbone(): init, 
+    // init_ext, solutions, positions; solve_by_logic(): gaps, arrays of 
+    // logic_lines() and logic_census(); caller: init, rows, cols
+    sc->top = snew(struct scratch_block);
+    sc->top->prev = NULL;
+    sc->top->size = 
+      2*layers + 4*grid_int + 2*grid_bool + 5*coord + 13*vec + lines + 
+      census + bb
+    ;
+    sc->top->used = 0;
+    sc->top->mem  = snewn(sc->top->size, char);
+    
+    return sc;
+}
+
+
+/* Free the scratch arena */
+static void scratch_free(struct scratch *sc)
+{
+    struct scratch_block *b;
+    
+    while (sc->top) {
+        b = sc->top;
+        sc->top = b->prev;
+        sfree(b->mem);
+        sfree(b);
+    }
+    sfree(sc);
+}
+
+
+/* Current position in the scratch arena */
+static struct scratch_mark scratch_mark(const struct scratch *sc)
+{
+    struct scratch_mark mark;
+    mark.block = sc->top;
+    mark.used  = sc->top->used;
+    return mark;
+}
+
+
+/* Release everything taken from the scratch arena after the given mark */
+static void scratch_reset(struct scratch *sc, struct scratch_mark mark)
+{
+    struct scratch_block *b;
+    
+    while (sc->top != mark.block) {
+        b = sc->top;
+        sc->top = b->prev;
+        sfree(b->mem);
+        sfree(b);
+    }
+    sc->top->used = mark.used;
+}
+
+
+/* 
+Take size bytes from the scratch arena (the memory is not initialized)
+
+If the current block is too small, a new block at least as large as 
+the first one is added.
+
+*/
+static void *scratch_alloc(struct scratch *sc, size_t size)
+{
+    struct scratch_block *b = sc->top, *first = sc->top;
+    void *ret;
+
+    size = (size + SCRATCH_ALIGN - 1) / SCRATCH_ALIGN * SCRATCH_ALIGN;
+
+    if (b->used + size > b->size) {
+        while (first->prev) first = first->prev;
+        b = snew(struct scratch_block);
+        b->prev = sc->top;
+        b->size = max(first->size, size);
+        b->used = 0;
+        b->mem  = snewn(b->size, char);
+        sc->top = b;
+    }
+    
+    ret = b->mem + b->used;
+    b->used += size;
+    return ret;
+}
+
+
+/* 2D arrays of size h x w taken from the scratch arena; the elements 
+are contiguous, i.e., the array can be accessed as (*m)[i*w + j] */
+static int **scratch_grid_int(struct scratch *sc, int h, int w)
+{
+    int i;
+    int **m = scratch_newn(sc, h, int*);
+    
+    *m = scratch_newn(sc, h*w, int);
+    for (i = 1; i < h; i++) m[i] = m[0] + i*w;
+    return m;
+}
+
+static bool **scratch_grid_bool(struct scratch *sc, int h, int w)
+{
+    int i;
+    bool **m = scratch_newn(sc, h, bool*);
+    
+    *m = scratch_newn(sc, h*w, bool);
+    for (i = 1; i < h; i++) m[i] = m[0] + i*w;
+    return m;
+}
+
+
+/* n layers of 2D arrays of size h x w taken from the scratch arena; all 
+elements are contiguous, i.e., the layer k can be accessed as 
+(*m[k])[i*w + j] and the whole array as (**m)[(k*h + i)*w + j] */
+static bool ***scratch_layers(struct scratch *sc, int n, int h, int w)
+{
+    int i, k;
+    bool ***m   = scratch_newn(sc, n,   bool**);
+    bool **m_   = scratch_newn(sc, n*h, bool*);
+    bool *m__   = scratch_newn(sc, n*h*w, bool);
+    
+    for (k = 0; k < n; k++) {
+        m[k] = m_ + k*h;
+        for (i = 0; i < h; i++) m_[k*h + i] = m__ + (k*h + i)*w;
+    }
+    return m;
+}
+
+
+/* solution structure for ns ships with the arrays taken from the 
+scratch arena */
+static void scratch_sol(struct scratch *sc, int ns, struct sol *soln)
+{
+    soln->ship_coord  = scratch_grid_int(sc, ns, 3);
+    soln->ship_coord2 = scratch_grid_int(sc, ns, 3);
+    soln->ctl = NULL;
+    soln->ship_ref = NULL;
+}
+
+
+/*
+Create the game description string
+
+The string has the format as in following simplified example 
+s5s5s4r11r0r-1r7r1c7c2c-1y0x11z-1y7x2z5, where s..s.. is array ships, 
+here [5,5,4], r..r.. is array rows, here [11,0,-1,7,1], c..c.. is array 
+cols, here [7,2,-1], y..x..z..y.. is 2D-array of initially disclosed cells 
+(not equal to -2), here [[0,11,-1],[7,2,5]]; its elements are [H-coord., 
+W-coord., config.]
+
+Parameters:
+  h, w: height, width of the grid;
+  num_ships: number of ships;
+  *ships: array of ship sizes;
+  *rows, *cols: arrays of sizes h, w of row/column sums (-1 if hidden);
+  **init: 2D array of size h x w of initially disclosed cells.
+
+Returns the string, to be freed by the caller.
+
+*/
+static char *encode_desc(
+  int h, int w, int num_ships, const int *ships, const int *rows, 
+  const int *cols, enum Configuration **init
+)
+{
+    int i, j;
+
+    // max. length of the string: 
+    // (num_ships + H + W)*3 + (# init > -2)*8 + 1
+    // calculate # init > -2
+    int num_init = 0;
+    for (i = 0; i < h*w; i++) {
+        if ((*init)[i] > -2) num_init++;
+    }
+    
+    // create string
+    char *ret, *str;    
+    str = snewn((num_ships + h + w)*3 + num_init*8 + 1, char); 
+    ret = str; 
+    
+    for (i = 0; i < num_ships; i++) {
+        sprintf(ret, "s%d", ships[i]);    
+        ret += 2 + (ships[i] > 9); 
+    }
+    for (i = 0; i < h; i++) {
+        sprintf(ret, "r%d", rows[i]);
+        ret += 2 + (rows[i] < 0 || rows[i] > 9); 
+    }
+    for (i = 0; i < w; i++) {
+        sprintf(ret, "c%d", cols[i]);
+        ret += 2 + (cols[i] < 0 || cols[i] > 9); 
+    }
+    for (i = 0; i < h; i++) {
+        for (j = 0; j < w; j++) {
+            if (init[i][j] > -2) {
+                sprintf(ret, "y%dx%dz%d", i, j, init[i][j]);
+                ret += 6 + (i > 9) + (j > 9) + (init[i][j] < 0); 
+            }
+        }
+    }
+    
+    *ret = '\0';
+
+    return str;
+}
+
+
 /*
 Enrich the init array using information that it provides
 
@@ -1899,13 +2618,12 @@ static void solver_init(const int h, const int w, int **init_ext)
 Solver
 
 The procedure tries ship orientations and positions beginning with
-the longest ship. The trial is performed by place_ship(), called for
-the longest ship. If a position satisfies the conditions
-given in the input arrays rows, cols and is compatible with the
-initially disclosed cells, place_ship() calls itself with the second
-longest ship, and so on. If a correct position of the smallest ship is
-found, the solution is recorded and the search is continued in order
-to check the uniqueness of the solution. 
+the longest ship (see place_ship_body()). If a position satisfies the 
+conditions given in the input arrays rows, cols and is compatible with 
+the initially disclosed cells, the search goes on with the second longest
+ship, and so on. If a correct position of the smallest ship is found, the
+solution is recorded and the search is continued in order to check the 
+uniqueness of the solution. 
 
 Error codes:
   0: a unique solution is found;
@@ -1915,2300 +2633,8928 @@ Error codes:
 
 Parameters:
   *init_state: constant part of game_state (*ships_distr can be undefined);
-  count_lim: maximum number of times the recursive function place_ship()
-can be called, before the search is interrupted and an error returned; set 
-to a value of 0 or less if no limit is desired;
-  *soln: solution structure where the results are saved.
-  
+  count_lim: maximum number of nodes of the search (see place_ship_body())
+before the search is interrupted and an error returned; set to a value of
+0 or less if no limit is desired;
+  *soln: solution structure where the results are saved;
+  *sc: scratch arena from which the working arrays are taken (they are
+released before returning).
+
+The search runs in a kernel specialized for the grid size if there is one 
+(see PLACE_SHIP_KERNEL), else in the generic place_ship().
+
 */
 static void solver(
-  const struct game_state_const *init_state, int count_lim, struct sol *soln
+  const struct game_state_const *init_state, long long count_lim,
+  struct sol *soln, struct scratch *sc
 )
 {
-    int i, k;
+    solver_kernel(
+      init_state, count_lim, soln, sc, 
+      search_kernel(init_state->H, init_state->W)
+    );
+}
+
+
+/* search kernel for the grid size: specialized if there is one, else the 
+generic place_ship() */
+static place_ship_fn search_kernel(int h, int w)
+{
+    static const struct {int h, w; place_ship_fn kernel;} kernels[] = {
+        { 7,  7, place_ship_7x7},
+        { 8, 10, place_ship_8x10},
+        {10, 12, place_ship_10x12},
+    };
+    int k;
+    
+    for (k = 0; k < lenof(kernels); k++) {
+        if (h == kernels[k].h && w == kernels[k].w) return kernels[k].kernel;
+    }
+    return place_ship;
+}
+
+
+/* solver() with the given search kernel (see place_ship()) */
+static void solver_kernel(
+  const struct game_state_const *init_state, long long count_lim,
+  struct sol *soln, struct scratch *sc, place_ship_fn kernel
+)
+{
+    struct scratch_mark mark = scratch_mark(sc);
+    struct search s;
+
+    search_init(&s, init_state, count_lim, soln, sc);
+    STATS_PHASE_BEGIN(PHASE_SOLVER);
+    kernel(&s, 0);
+    STATS_PHASE_END(PHASE_SOLVER);
+
+    scratch_reset(sc, mark);
+}
+
+
+/*
+Set up the search of solver() at its start
+
+Parameters:
+  *s: state of the search, which is set up;
+  *init_state, count_lim, *soln: see solver();
+  *sc: scratch arena from which the working arrays of the search are taken
+(they must be kept as long as the search runs).
+
+*/
+static void search_init(
+  struct search *s, const struct game_state_const *init_state, 
+  long long count_lim, struct sol *soln, struct scratch *sc
+)
+{
+    int i;
     int h = init_state->H, w = init_state->W;
     int ns = init_state->num_ships;
     int **init = init_state->init;
+    
+    s->init_state = init_state;
+    s->count_lim = count_lim;
+    s->soln = soln;
 
     // enrich the init array using information that it provides
-    int *init_ext[h], init_ext_[h*w];
-    for (i = 0; i < h; i++) {
-        init_ext[i] = init_ext_ + i*w;
-    }
-    memcpy(init_ext_, *init, sizeof(**init)*h*w);
-    solver_init(h, w, init_ext);
+    s->init_ext = scratch_grid_int(sc, h, w);
+    memcpy(*s->init_ext, *init, sizeof(**init)*h*w);
+    solver_init(h, w, s->init_ext);
+
+    s->ship_pos = scratch_grid_bool(sc, h, w);
+    for (i = 0; i < h*w; i++) (*s->ship_pos)[i] = 0;
 
-    // H x W field of ship positions
-    bool *ship_pos[h], ship_pos_[h*w];
-    for (i = 0; i < h; i++) ship_pos[i] = ship_pos_ + i*w;
-    for (i = 0; i < h*w; i++) ship_pos_[i] = 0;
-    
-    // ns x 3 array of ship coordinates for currently tried positons;
     // they will be copied to soln->ship_coord for correct solution
-    int *ship_coord_tmp[ns], ship_coord_tmp_[ns*3];
-    for (k = 0; k < ns; k++) ship_coord_tmp[k] = ship_coord_tmp_ + k*3;
+    s->ship_coord_tmp = scratch_grid_int(sc, ns, 3);
 
-    // H x W layers of positions blocked by the 1st, 2nd, ... ships
-    bool **blocked[ns-1], *blocked_[(ns-1)*h], blocked__[(ns-1)*h*w];
-    for (k = 0; k < ns-1; k++) {
-        blocked[k] = blocked_ + k*h;
-        for (i = 0; i < h; i++) {
-            blocked_[k*h+i] = blocked__ + (k*h+i)*w;
-        }
+    s->blocked = scratch_layers(sc, ns-1, h, w);
+    if (ns > 1) {
+        for (i = 0; i < (ns-1)*h*w; i++) (**s->blocked)[i] = 0;
     }
-    for (k = 0; k < (ns-1)*h*w; k++) blocked__[k] = 0;
+    
+    // the first ship is tried from the first position on
+    s->frame = scratch_newn(sc, ns, struct search_frame);
+    s->frame[0].vert = s->frame[0].y = s->frame[0].x = 0;
+    s->depth = 1;
+    s->enter = true;
+    s->shard = s->shard_depth = s->prefix = 0;
+    s->num_shards = 1;
 
     soln->count = 0;
-    soln->err = 3;  
-    place_ship(
-      init_state, init_ext, blocked, ship_pos, ship_coord_tmp, 0, 0, 0, 0, 
-      count_lim, soln
-    ); 
-
+    soln->err = 3;
+    if (soln->ctl) {
+        int ship = init_state->ships[0];
+        soln->ctl->nodes = 0;
+        soln->ctl->first_done = 0;
+        soln->ctl->first_total = 
+          h*(w - ship + 1) + (ship > 1 ? (h - ship + 1)*w : 0)
+        ;
+        soln->ctl->cancelled = soln->ctl->timed_out = false;
+    }
 }
 
 
 /*
+Search for a solution different from a known one
 
-Recursive procedure for the function solver() that tries possible
-positions of a given ship. 
+As solver(), but the solution is known (during the generation, the
+layout the puzzle is made from): the search is interrupted as soon as a
+different solution is found, and the known one is only recognized, not 
+taken as a first solution. The subtrees which can only reproduce the
+known solution are cut (see place_ship_ref_rest()): a unique puzzle 
+costs at most as many calls of place_ship() as with solver(), an
+ambiguous one usually much fewer.
+
+Error codes:
+  0: the known solution is the only one (it is copied to 
+soln->ship_coord);
+  1: count_lim is exceeded, the search is interrupted;
+  2: a different solution is found (saved in soln->ship_coord2, the known
+one in soln->ship_coord), the search is interrupted;
+  3: no solution is found (the known one violates the clues).
 
 Parameters:
-  *init_state: constant part of game_state (*ships_distr can be undefined);
-  **init_ext: enriched 2D array of initially disclosed information produced by
-solver_init();
-  ***blocked: 3D array which consists of H x W layers of positions blocked by
-the 1st, 2nd, ... ships;
-  **ship_pos: H x W field of ship positions;
-  **ship_coord_tmp: ns x 3 temporary array of ship coordinates analogous to 
-soln->ship_coord (ns = number of ships);
-  ship_num: current ship number 0, ..., ns-1;
-  vert0, y0, x0: initial ship orientation and coordinates of upper left cell
-at which the search is started (different from 0, 0, 0 if the ship 
-ship_num-1 has the same size);
-  count_lim: maximum number of times the recursive function place_ship()
-can be called, before the search is interrupted and an error returned;
-  *soln: solution structure where the results are saved.
+  *init_state: constant part of game_state;
+  **ship_coord_ref: num_ships x 3 array of the ship coordinates of the 
+known solution (in the order of init_state->ships);
+  count_lim, *soln, *sc: see solver().
 
 */
-static void place_ship(
-  const struct game_state_const *init_state, int **init_ext, bool ***blocked, 
-  bool **ship_pos, int **ship_coord_tmp, int ship_num, int vert0, int y0, 
-  int x0, int count_lim, struct sol *soln
+static void solver_alt(
+  const struct game_state_const *init_state, int **ship_coord_ref, 
+  long long count_lim, struct sol *soln, struct scratch *sc
 )
 {
-
-    (soln->count)++;
-    if (0 < count_lim && count_lim < soln->count) {
-        soln->err = 1;
-        return;
+    int i, k, t;
+    int h = init_state->H, w = init_state->W;
+    int ns = init_state->num_ships;
+    int *ships = init_state->ships;
+    struct scratch_mark mark = scratch_mark(sc);
+    
+    // the known solution in the order in which place_ship() finds it:
+    // single orientation for ships of size 1; ships of equal size by
+    // position (insertion sort, the number of ships is small)
+    int **ref = scratch_grid_int(sc, ns, 3);
+    memcpy(*ref, *ship_coord_ref, ns*3*sizeof(**ref));
+    for (k = 0; k < ns; k++) {
+        if (ships[k] == 1) ref[k][0] = 0;
+    }
+    for (k = 1; k < ns; k++) {
+        for (i = k; i > 0 && ships[i-1] == ships[i]; i--) {
+            if (
+              ref[i-1][0]*h*w + ref[i-1][1]*w + ref[i-1][2] <
+              ref[i][0]*h*w + ref[i][1]*w + ref[i][2]
+            ) break;
+            for (t = 0; t < 3; t++) {
+                int tmp = ref[i][t];
+                ref[i][t] = ref[i-1][t];
+                ref[i-1][t] = tmp;
+            }
+        }
     }
     
-    int i, j, k, sum, sum_hid, pos_No, vert0_new, y0_new, x0_new;
-    bool brk, blk; // break/interrupt; cells were blocked
+    soln->ship_ref = ref;
+    solver(init_state, count_lim, soln, sc);
+    soln->ship_ref = NULL;
+    
+    scratch_reset(sc, mark);
+}
+
+
+/*
+Backbone of the puzzle: cells which are occupied, or vacant, in all 
+solutions
+
+Parameters:
+  *init_state: constant part of game_state;
+  **ship_coord: num_ships x 3 array of the ship coordinates of a 
+solution (which must satisfy the clues);
+  count_lim: maximum total number of calls of place_ship() (0 or less: 
+no limit);
+  *bb: array of size H*W where OCCUP or VACANT is saved for the cells 
+found to be fixed, UNDEF for the others;
+  *var: array of size H*W where, per cell, the number of the solutions 
+found which differ from the known one at the cell is saved (NULL if not
+required);
+  *sc: scratch arena from which the working arrays are taken (they are
+released before returning).
+
+The cells are taken one after another: the opposite of the known 
+solution is disclosed at the cell, and a solution of the changed puzzle
+is sought with solver_alt(). If there is none, the cell is fixed. 
+Otherwise all cells where the new solution differs from the known one 
+are not fixed and need no search of their own, so that the solutions are
+intersected without enumerating them. If count_lim is reached, the cells
+left are saved as UNDEF. With the fleet of the 7x7 grid, the solutions
+are enumerated by layout7_match() instead (count_lim is not needed, and
+var counts all solutions).
+
+Returns true if all cells are decided, false if count_lim is reached.
+
+*/
+static bool backbone(
+  const struct game_state_const *init_state, int **ship_coord, 
+  long long count_lim, enum Configuration *bb, int *var, 
+  struct scratch *sc
+)
+{
+    int i, k, y, x;
     int h = init_state->H, w = init_state->W;
     int ns = init_state->num_ships;
-    int ships_sum = init_state->ships_sum;
-    int rows_sum = init_state->rows_sum; 
-    int cols_sum = init_state->cols_sum;
-    int *rows = init_state->rows, *cols = init_state->cols;
+    int *ships = init_state->ships;
+    long long budget = count_lim;
+    bool complete = true;
+    struct scratch_mark mark = scratch_mark(sc);
+    
+    // occupied cells of the known and of the new solution
+    bool *pos = scratch_newn(sc, h*w, bool);
+    bool *pos2 = scratch_newn(sc, h*w, bool);
+    // puzzle with the changed cell
+    struct game_state_const is = *init_state;
+    is.init = scratch_grid_int(sc, h, w);
+    memcpy(*is.init, *init_state->init, h*w*sizeof(**is.init));
+    struct sol soln;
+    scratch_sol(sc, ns, &soln);
     
+    // number of solutions found which differ at the cell
+    int *num = (var ? var : scratch_newn(sc, h*w, int));
     
-    int ship = init_state->ships [ship_num];
-    int vert, y, x, ship_H, ship_W, y_max, x_max;
+    for (i = 0; i < h*w; i++) pos[i] = false;
+    for (k = 0; k < ns; k++) {
+        for (i = 0; i < ships[k]; i++) {
+            y = ship_coord[k][1] + i*ship_coord[k][0];
+            x = ship_coord[k][2] + i*(1 - ship_coord[k][0]);
+            pos[y*w + x] = true;
+        }
+    }
     
-    // ortientation 0: horiz.; 1: vertical (single orientation if ship = 1)
-    for (vert = 0; vert < min(2, ship); vert++) {
+    // undecided cells: UNDEF; the cells decided by the disclosed ones 
+    // (see solver_init()) are fixed, and only the others are changed, so 
+    // that solver_init() cannot overwrite a disclosed cell with them
+    int **init_ext = scratch_grid_int(sc, h, w);
+    memcpy(*init_ext, *init_state->init, h*w*sizeof(**init_ext));
+    solver_init(h, w, init_ext);
+    for (i = 0; i < h*w; i++) {
+        bb[i] = ((*init_ext)[i] == UNDEF ? UNDEF : (pos[i] ? OCCUP : VACANT));
+        num[i] = 0;
+    }
     
-        // ship dimensions
-        ship_H = vert*ship + 1 - vert;
-        ship_W = (1 - vert)*ship + vert;
+    // fleet of the 7x7 grid: all solutions are taken from the table of 
+    // layouts and intersected at once
+    if (layout7_fleet(init_state)) {
+        int *occupied = scratch_newn(sc, h*w, int);
+        int n = layout7_match(init_state, 0, NULL, NULL, occupied);
+        for (i = 0; i < h*w; i++) {
+            num[i] = (pos[i] ? n - occupied[i] : occupied[i]);
+            if (bb[i] == UNDEF && num[i] == 0) {
+                bb[i] = (pos[i] ? OCCUP : VACANT);
+            }
+        }
+        scratch_reset(sc, mark);
+        return true;
+    }
+    
+    for (i = 0; i < h*w; i++) {
+        if (bb[i] != UNDEF || num[i] > 0) continue;
+        if (count_lim > 0 && budget <= 0) {
+            complete = false; 
+            break;
+        }
         
-        // left/top cell coordinates of the ship x, y max values (+1)
-        y_max = h - ship_H + 1;
-        x_max = w - ship_W + 1;
-        for (y = 0; y < y_max; y++) {
-            for (x = 0; x < x_max; x++) {
-            
-                // skip until the new initial position
-                if (                                   
-                  vert <  vert0                      ||                      
-                  vert == vert0 && y <  y0           ||          
-                  vert == vert0 && y == y0 && x < x0 
-                ) continue;
-                
-                // check that ship ends are not placed on internal cells
-                // or ship of size 1 not placed on UNDEF, OCCUP, or ONE
-                if (
-                  init_ext[y][x] == INNER                   || 
-                  init_ext[y+ship_H-1][x+ship_W-1] == INNER ||
-                  ship == 1 && ! (
-                    init_ext[y][x] == UNDEF || init_ext[y][x] == OCCUP ||
-                    init_ext[y][x] == ONE
-                  )
-                ) continue;
-                
-                // check that cells are not blocked
-                brk = false;
-                for (i = 0; i < ship_H; i++) {
-                    for (j = 0; j < ship_W; j++) {
-                        if (init_ext[y+i][x+j] == VACANT) {brk = true; break;}
-                        for (k = 0; k < ship_num; k++) {
-                            if (blocked[k][y+i][x+j]) {brk = true; break;}
-                        }
-                        if (brk) break;
-                    }
-                    if (brk) break;
-                }
-                if (brk) continue;
-                
-                // save position
-                for (i = 0; i < ship_H; i++) {
-                    for (j = 0; j < ship_W; j++) {
-                        ship_pos[y+i][x+j] = 1;
-                    }
-                }
-                ship_coord_tmp[ship_num][0] = vert;
-                ship_coord_tmp[ship_num][1] = y;
-                ship_coord_tmp[ship_num][2] = x;
-                
-                
-                // not last ship
-                if (ship_num < ns - 1) {
-                
-                    // check: sums of open and hidden rows/cols below limits
-                    sum_hid = 0;
-                    for (i = 0; i < h; i++) {
-                        sum = 0;
-                        if (rows[i] >= 0) {
-                            for (j = 0; j < w; j++) sum += ship_pos[i][j];
-                            if (sum > rows[i]) {brk = true; break;}
-                        }
-                        else {
-                            for (j = 0; j < w; j++) sum_hid += ship_pos[i][j];
-                        }
-                    }
-                    if (sum_hid > ships_sum - rows_sum) brk = true;
-                    
-                    if (! brk) {
-                        sum_hid = 0;
-                        for (j = 0; j < w; j++) {
-                            sum = 0;
-                            if (cols[j] >= 0) {
-                                for (i = 0; i < h; i++) sum += ship_pos[i][j];
-                                if (sum > cols[j]) {brk = true; break;}
-                            }
-                            else {
-                                for (i = 0; i < h; i++) 
-                                  sum_hid += ship_pos[i][j]
-                                ;
-                            }
-                        }
-                        if (sum_hid > ships_sum - cols_sum) brk = true;
-                    }
-                    
-                    // block cells and further checks
-                    blk = false;
-                    if (! brk) {
-                        blk = true;
-                        
-                        // block cells of and around the ship
-                        for (i = max(y-1, 0); i < min(y + ship_H + 1, h); i++) 
-                        {
-                            for (
-                              j = max(x-1, 0); j < min(x + ship_W + 1, w); j++
-                            ) {
-                                blocked[ship_num][i][j] = 1;
-                            }
-                        }
-                    
-                        // block rows/columns that are full
-                        sum_hid = 0;
-                        for (i = 0; i < h; i++) {
-                            sum = 0;
-                            if (rows[i] >= 0) {
-                                for (j = 0; j < w; j++) sum += ship_pos[i][j];
-                                if (sum == rows[i]) {
-                                    for (j = 0; j < w; j++) 
-                                      blocked[ship_num][i][j] = 1
-                                    ;
-                                }
-                            }
-                            else {
-                                for (j = 0; j < w; j++) 
-                                  sum_hid += ship_pos[i][j]
-                                ;
-                            }
-                        }
-                        if (sum_hid == ships_sum - rows_sum) {
-                            for (i = 0; i < h; i++) {
-                                if (rows[i] == -1) {
-                                    for (j = 0; j < w; j++) 
-                                      blocked[ship_num][i][j] = 1
-                                    ;
-                                }
-                            }
-                        }
-                        
-                        sum_hid = 0;
-                        for (j = 0; j < w; j++) {
-                            sum = 0;
-                            if (cols[j] >= 0) {
-                                for (i = 0; i < h; i++) sum += ship_pos[i][j];
-                                if (sum == cols[j]) {
-                                    for (i = 0; i < h; i++) 
-                                      blocked[ship_num][i][j] = 1
-                                    ;
-                                }
-                            }
-                            else {
-                                for (i = 0; i < h; i++) 
-                                  sum_hid += ship_pos[i][j]
-                                ;
-                            }
-                        }
-                        if (sum_hid == ships_sum - cols_sum) {
-                            for (j = 0; j < w; j++) {
-                                if (cols[j] == -1) {
-                                    for (i = 0; i < h; i++) 
-                                      blocked[ship_num][i][j] = 1
-                                    ;
-                                }
-                            }
-                        }
-                        
-                        // check: blocked cells do not overlap with initially
-                        // occupied
-                        for (i = 0; i < h*w; i++) {
-                            if (
-                              (*(blocked[ship_num]))[i] && 
-                              ! (*ship_pos)[i]          &&
-                              ((*init_ext)[i] >= 0)
-                            )  {brk = true; break;}
-                        }
-                    }
-                    
-                    // next ship
-                    if (! brk) {
-                        
-                        // search start position: if same size, start after
-                        // current ship
-                        if (init_state->ships[ship_num + 1] == ship) {
-                            pos_No = vert*h*w + y*w + x + 1;
-                            vert0_new = (int) pos_No/(h*w);
-                            y0_new = (int) (pos_No - vert0_new*h*w)/w;
-                            x0_new = pos_No - vert0_new*h*w - y0_new*w;
-                        }
-                        else {
-                            vert0_new = 0;
-                            y0_new = 0;
-                            x0_new = 0;
-                        }
-                        
-                        // call recursively
-                        place_ship(
-                          init_state, init_ext, blocked, ship_pos, 
-                          ship_coord_tmp, ship_num + 1, vert0_new, 
-                          y0_new, x0_new, count_lim, soln
-                        );
-                        
-                        if (soln->err == 1) return;
-                    }
-                    
-                    // unblock cells before shifting ship position
-                    if (blk) {
-                        for (i = 0; i < h*w; i++) 
-                          (*(blocked[ship_num]))[i] = 0
-                        ;
-                    }
-                }
-                
-                
-                // last ship
-                else {
-                
-                    // final checks
-                    
-                    // check raw & column sums
-                    for (i = 0; i < h; i++) {
-                        sum = 0;
-                        if (rows[i] >= 0) {
-                            for (j = 0; j < w; j++) sum += ship_pos[i][j];
-                            if (sum != rows[i]) {brk = true; break;}
-                        }
-                    }
-                
-                    if (! brk) {
-                        for (j = 0; j < w; j++) {
-                            sum = 0;
-                            if (cols[j] >= 0) {
-                                for (i = 0; i < h; i++) sum += ship_pos[i][j];
-                                if (sum != cols[j]) {brk = true; break;}
-                            }
-                        }
-                    }
-                    
-                    // check initial conditions
-                    if (! brk) {
-                        for (i = 0; i < h; i++) {
-                            for (j = 0; j < w; j++) {
-                        
-                                // if init_ext >= 0, the cell is occupied
-                                if (init_ext[i][j] >= 0 && ! ship_pos[i][j])
-                                {brk = true; break;}
-                                
-                                switch (init_ext[i][j]) {
-                                    // neighbor to the South occupied
-                                    case NORTH:
-                                        if (! ship_pos[i+1][j]) brk = true;
-                                        break;
-                                    case EAST:
-                                        if (! ship_pos[i][j-1]) brk = true;
-                                        break;
-                                    case SOUTH:
-                                        if (! ship_pos[i-1][j]) brk = true;
-                                        break;
-                                    case WEST:
-                                        if (! ship_pos[i][j+1]) brk = true;
-                                        break;
-                                    // at least two neighbors occupied
-                                    case INNER:
-                                        if ( ! (
-                                          i > 0   && ship_pos[i-1][j] &&
-                                          i < h-1 && ship_pos[i+1][j]    ||
-                                          j > 0   && ship_pos[i][j-1] &&
-                                          j < w-1 && ship_pos[i][j+1]
-                                        )) brk = true;
-                                }
-                                if (brk) break;
-                            }
-                            if (brk) break;
-                        }
-                    }
-                    
-                    // if checks OK, save solution; check uniqueness
-                    if (! brk) {
-                        if (soln->err == 3) {
-                            memcpy(
-                              *(soln->ship_coord), *ship_coord_tmp, 
-                              ns*3*sizeof(**ship_coord_tmp)
-                            );
-                            soln->err = 0;
-                        }
-                        else {
-                            memcpy(
-                              *(soln->ship_coord2), *ship_coord_tmp, 
-                              ns*3*sizeof(**ship_coord_tmp)
-                            );
-                            soln->err = 2;
-                        }
-                    }
-                }
-                
-                
-                // delete current position before shifting
-                for (i = 0; i < ship_H; i++) {
-                    for (j = 0; j < ship_W; j++) {
-                        ship_pos[y+i][x+j] = 0;
-                    }
+        (*is.init)[i] = (pos[i] ? VACANT : OCCUP);
+        solver_alt(&is, ship_coord, (count_lim > 0 ? budget : 0), &soln, sc);
+        (*is.init)[i] = UNDEF;
+        budget -= soln.count;
+        
+        if (soln.err == 1) {
+            complete = false; 
+            break;
+        }
+        else if (soln.err != 2) bb[i] = (pos[i] ? OCCUP : VACANT);
+        // the new solution: the cells where it differs are not fixed
+        else {
+            int **c2 = soln.ship_coord2, t;
+            for (k = 0; k < h*w; k++) pos2[k] = false;
+            for (k = 0; k < ns; k++) {
+                for (t = 0; t < ships[k]; t++) {
+                    y = c2[k][1] + t*c2[k][0];
+                    x = c2[k][2] + t*(1 - c2[k][0]);
+                    pos2[y*w + x] = true;
                 }
-            
             }
-        }        
+            for (k = 0; k < h*w; k++) num[k] += (pos2[k] != pos[k]);
+        }
     }
     
-    return;
+    scratch_reset(sc, mark);
+    return complete;
 }
 
 
-
 /*
-Check if a solution using predefined logical strategies is possible.
+Check the limits of a running search and report its progress
+
+Parameters:
+  *ctl: control structure of the search;
+  count: calls of place_ship() so far.
+
+Returns true if the search is to be interrupted (ctl->cancelled or 
+ctl->timed_out is set).
+
+*/
+static bool solve_ctl_poll(struct solve_ctl *ctl, long long count)
+{
+    ctl->nodes = count;
+    if (ctl->deadline > 0 && time_us() > ctl->deadline) ctl->timed_out = true;
+    if (ctl->progress && ctl->progress(ctl, ctl->ctx)) ctl->cancelled = true;
+    return ctl->cancelled || ctl->timed_out;
+}
 
 
+/*
+Solve a game and create the move string of the solution (as solve_game())
+
 Parameters:
-  diff: difficulty level;
-  *init_state: constant part of game_state (*ships_distr can be undefined);
-  **grid: h x w array which will be filled with the information 
-determined by the solver (completed or unfinished solution);
-  *occ, *vac: points to the variable with number of occupied / vacant cells
-found by the solver.
+  *init_state: constant part of game_state;
+  *ctl: progress report and limits of the search (NULL if not needed);
+  **error: set to an error message if no move string is returned.
 
-Returns 
-  0: solution by simpler strategies is possible;
-  1: solution is only is possible if applying more complex strategies in
-addition to the simpler strategies;
-  2: solution by the predefined strategies is not possible.
+Returns the move string, to be freed by the caller, or NULL.
 
-NB: Additional strategies are tried for diff > 1 only; for diff = 0, 1,
-the function returns 0 or 2.
+*/
+static char *solve_init_state(
+  const struct game_state_const *init_state, struct solve_ctl *ctl,
+  const char **error
+)
+{
+    char *move = NULL;
+    struct ships_solution *soln = ships_solve(init_state, 0, ctl);
+
+    if (soln->err == 1) {
+        if (ctl && ctl->timed_out) 
+          *error = "Solver gave up: the puzzle takes too long to solve"
+        ;
+        else *error = "Solver was cancelled";
+    }
+    else if (soln->err == 2) {
+        *error = "Multiple solutions exist for this puzzle";
+    }
+    else if (soln->err == 3) {
+        *error = "No solution exists for this puzzle";
+    }
+    else move = solution_move(init_state, soln->ship_coord);
+    
+    ships_solution_free(soln);
+    return move;
+}
+
+
+/*
+Move string of a solution (as solve_game())
+
+Parameters:
+  *init_state: constant part of game_state;
+  **ship_coord: num_ships x 3 array of the ship coordinates (see struct 
+sol).
+
+Returns the move string, to be freed by the caller.
 
 */
-static int solve_by_logic(
-  int diff, const struct game_state_const *init_state, 
-  enum Configuration **grid, int *occ, int *vac
-) 
+static char *solution_move(
+  const struct game_state_const *init_state, int **ship_coord
+)
 {
-    int i, j, k, l, y, x; 
-    int checksum, checksum_init, sum_occ1, sum_occ2, sum_und1, sum_und2;
-    int h = init_state->H, w = init_state->W;
+    int i, j;
     int ns = init_state->num_ships;
-    int *ships = init_state->ships;
-    int **init = init_state->init;
     int ships_sum = init_state->ships_sum;
-    int rows_sum = init_state->rows_sum; 
-    int cols_sum = init_state->cols_sum;
-    int *rows = init_state->rows, *cols = init_state->cols;
-    int distr_all[ships[0]], distr_compl[ships[0]]; 
-    int ship_min, ship_max, num_ship_max;
-    int gap, num_gaps, num_full_gaps, ships_per_gap;
-    
-    // initialize array where the current configuration is kept
-    memcpy(*grid, *init, sizeof(**init)*h*w);
-    
-    // check sum to determine whether grid was changed after 
-    // applying the strategies
-    checksum = 0;
-    for (i = 0; i < h*w; i++) checksum += (*grid)[i]; 
-    
-    // distribution of ship lengths
-    for (k = 0; k < ships[0]; k++) distr_all[k] = 0;
-    for (i = 0; i < ns; i++) (distr_all[ships[i] - 1])++;
+    int *ships = init_state->ships;
     
+    char out[8*ships_sum + 2], *ptr = out;
+    int vert, y, x, z;
+    strcpy(ptr++, "S"); // first symbol S to indicate Solve usage
+    for (i = 0; i < ns; i++) {
+        for (j = 0; j < ships[i]; j++) {
+            vert = ship_coord[i][0];
+            y    = ship_coord[i][1] + j*vert;
+            x    = ship_coord[i][2] + j*(1 - vert);
+            if      (ships[i] == 1)               z = ONE;
+            else if (j == 0            &&   vert) z = NORTH;
+            else if (j == 0            && ! vert) z = WEST;
+            else if (j == ships[i] - 1 &&   vert) z = SOUTH;
+            else if (j == ships[i] - 1 && ! vert) z = EAST;
+            else                                  z = INNER;
+            sprintf(ptr, "y%dx%dz%d", y, x, z);
+            ptr += 6 + (y > 9) + (x > 9) + (z < 0);
+        }
+    }
+    *ptr = '\0';
 
-    // flags that switch additional strategies and indicate if they helped
-    bool add_strat = false, complex_solve = false;
-    
-    // apply the strategies as long as they work
-    do {      
-        // mark cells next to occupied cells as occupied where possible;
-        // mark cells around occupied cells vacant
-        solver_init(h, w, grid);
-        
-        
-        // try two strategies:
-        // 1. if number of occupied cells of a row/column is equal to 
-        // the sum total (incl. 0), mark the remaining cells vacant;
-        // 2. if number of unmarked cells in a row/column is equal to 
-        // the row/column sum minus occupied cells, mark the remaining 
-        // cells occupied
-        
-        // rows
-        sum_occ1 = sum_und1 = 0;
-        for (i = 0; i < h; i++) {
-            sum_occ2 = sum_und2 = 0;
-            for (j = 0; j < w; j++) {
-                if (grid[i][j] >= 0) {
-                    if (rows[i] > -1) sum_occ2++;
-                    else              sum_occ1++;
-                }
-                else if (grid[i][j] == UNDEF) {
-                    if (rows[i] > -1) sum_und2++;
-                    else              sum_und1++;
+    return dupstr(out);
+}
+
+
+/*
+Check that a ship can be placed at a position of the search of solver():
+its ends are not placed on inner cells (a ship of size 1 only on UNDEF,
+OCCUP or ONE), and its cells are neither vacant nor blocked by the
+previous ships
+
+Parameters:
+  *s: state of the search;
+  ship_num: ship number 0, ..., ns-1 (ns = number of ships);
+  vert, y, x: orientation and coordinates of the upper left cell.
+
+*/
+static ALWAYS_INLINE bool place_ship_fits(
+  const struct search *s, int ship_num, int vert, int y, int x
+)
+{
+    int i, j, k;
+    int **init_ext = s->init_ext;
+    bool ***blocked = s->blocked;
+    int ship = s->init_state->ships[ship_num];
+    int ship_H = vert*ship + 1 - vert;
+    int ship_W = (1 - vert)*ship + vert;
+
+    // check that ship ends are not placed on internal cells
+    // or ship of size 1 not placed on UNDEF, OCCUP, or ONE
+    if (
+      init_ext[y][x] == INNER                   ||
+      init_ext[y+ship_H-1][x+ship_W-1] == INNER ||
+      ship == 1 && ! (
+        init_ext[y][x] == UNDEF || init_ext[y][x] == OCCUP ||
+        init_ext[y][x] == ONE
+      )
+    ) {
+        STATS_INC(prune_init);
+        return false;
+    }
+
+    // check that cells are not blocked
+    for (i = 0; i < ship_H; i++) {
+        for (j = 0; j < ship_W; j++) {
+            if (init_ext[y+i][x+j] == VACANT) {
+                STATS_INC(prune_init);
+                return false;
+            }
+            for (k = 0; k < ship_num; k++) {
+                if (blocked[k][y+i][x+j]) {
+                    STATS_INC(prune_halo);
+                    return false;
                 }
             }
-            if (sum_occ2 == rows[i]) {
-                for (j = 0; j < w; j++) 
-                  if (grid[i][j] == UNDEF) grid[i][j] = VACANT
-                ;                    
+        }
+    }
+    return true;
+}
+
+
+/*
+Block the cells around a ship placed by the search of solver() (not the
+last one)
+
+The sums of the rows and columns with the ship (in ship_pos) are checked
+not to exceed the sum totals. Then the cells of and around the ship, and
+the rows and columns which are full, are blocked in the layer
+blocked[ship_num], and the blocked cells are checked not to be disclosed
+as occupied.
+
+Parameters:
+  *s: state of the search;
+  ship_num: ship number 0, ..., ns-2;
+  vert, y, x: orientation and coordinates of the upper left cell;
+  hc, wc: see place_ship_body().
+
+Returns true if the checks are passed; otherwise the layer is left clear.
+
+*/
+static ALWAYS_INLINE bool place_ship_block(
+  struct search *s, int ship_num, int vert, int y, int x,
+  const int hc, const int wc
+)
+{
+    const struct game_state_const *init_state = s->init_state;
+    int i, j, sum, sum_hid;
+    const int h = (hc ? hc : init_state->H), w = (wc ? wc : init_state->W);
+    int ships_sum = init_state->ships_sum;
+    int rows_sum = init_state->rows_sum;
+    int cols_sum = init_state->cols_sum;
+    int *rows = init_state->rows, *cols = init_state->cols;
+    int **init_ext = s->init_ext;
+    bool **ship_pos = s->ship_pos, **layer = s->blocked[ship_num];
+    int ship = init_state->ships[ship_num];
+    int ship_H = vert*ship + 1 - vert;
+    int ship_W = (1 - vert)*ship + vert;
+
+    // check: sums of open and hidden rows/cols below limits
+    sum_hid = 0;
+    for (i = 0; i < h; i++) {
+        sum = 0;
+        if (rows[i] >= 0) {
+            for (j = 0; j < w; j++) sum += ship_pos[i][j];
+            if (sum > rows[i]) {
+                STATS_INC(prune_sum);
+                return false;
             }
-            else if (sum_und2 == rows[i] - sum_occ2) {
-                for (j = 0; j < w; j++) 
-                  if (grid[i][j] == UNDEF) grid[i][j] = OCCUP
-                ;                    
+        }
+        else {
+            for (j = 0; j < w; j++) sum_hid += ship_pos[i][j];
+        }
+    }
+    if (sum_hid > ships_sum - rows_sum) {
+        STATS_INC(prune_sum);
+        return false;
+    }
+
+    sum_hid = 0;
+    for (j = 0; j < w; j++) {
+        sum = 0;
+        if (cols[j] >= 0) {
+            for (i = 0; i < h; i++) sum += ship_pos[i][j];
+            if (sum > cols[j]) {
+                STATS_INC(prune_sum);
+                return false;
             }
         }
-        // rows with hidden sum total
-        if (sum_occ1 == ships_sum - rows_sum) {
-            for (i = 0; i < h; i++) {
-                if (rows[i] == -1) {
-                    for (j = 0; j < w; j++) 
-                      if (grid[i][j] == UNDEF) grid[i][j] = VACANT
-                    ;
-                }
-            }
-        }        
-        else if (sum_und1 == ships_sum - rows_sum - sum_occ1) {
-            for (i = 0; i < h; i++) {
-                if (rows[i] == -1) {
-                    for (j = 0; j < w; j++) 
-                      if (grid[i][j] == UNDEF) grid[i][j] = OCCUP
-                    ;
-                }
-            }
-        }        
-        // columns
-        sum_occ1 = sum_und1 = 0;
-        for (j = 0; j < w; j++) {
-            sum_occ2 = sum_und2 = 0;
-            for (i = 0; i < h; i++) {
-                if (grid[i][j] >= 0) {
-                    if (cols[j] > -1) sum_occ2++;
-                    else              sum_occ1++;
-                }
-                else if (grid[i][j] == UNDEF) {
-                    if (cols[j] > -1) sum_und2++;
-                    else              sum_und1++;
-                }
-            }
-            if (sum_occ2 == cols[j]) {
-                for (i = 0; i < h; i++) 
-                  if (grid[i][j] == UNDEF) grid[i][j] = VACANT
-                ;                    
-            }
-            else if (sum_und2 == cols[j] - sum_occ2) {
-                for (i = 0; i < h; i++) 
-                  if (grid[i][j] == UNDEF) grid[i][j] = OCCUP
-                ;                    
-            }
+        else {
+            for (i = 0; i < h; i++) sum_hid += ship_pos[i][j];
         }
-        // columns with hidden sum total
-        if (sum_occ1 == ships_sum - cols_sum) {
-            for (j = 0; j < w; j++) {
-                if (cols[j] == -1) {
-                    for (i = 0; i < h; i++) 
-                      if (grid[i][j] == UNDEF) grid[i][j] = VACANT
-                    ;
-                }
-            }
+    }
+    if (sum_hid > ships_sum - cols_sum) {
+        STATS_INC(prune_sum);
+        return false;
+    }
+
+    // block cells of and around the ship
+    for (i = max(y-1, 0); i < min(y + ship_H + 1, h); i++) {
+        for (j = max(x-1, 0); j < min(x + ship_W + 1, w); j++) {
+            layer[i][j] = 1;
         }
-        else if (sum_und1 == ships_sum - cols_sum - sum_occ1) {
-            for (j = 0; j < w; j++) {
-                if (cols[j] == -1) {
-                    for (i = 0; i < h; i++) 
-                      if (grid[i][j] == UNDEF) grid[i][j] = OCCUP
-                    ;
-                }
-            }
-        }        
-        
-        
-        // 3. if a stripe of occupied cells is of the size of 
-        // the longest unfinished ship, mark the cells next to the
-        // end cells vacant
-        
-        // specify the type of occupied cells
-        render_grid_conf(h, w, grid, init, false);
-        
-        // determine the longest unfinished ship size and their number;
-        compl_ships_distr(h, w, grid, ships[0], distr_compl);
-        ship_max = 0;
-        for (i = ships[0] - 1; i >= 0; i--) {
-            if (distr_compl[i] < distr_all[i]) {
-                ship_max = i + 1; 
-                break;
+    }
+
+    // block rows/columns that are full
+    sum_hid = 0;
+    for (i = 0; i < h; i++) {
+        sum = 0;
+        if (rows[i] >= 0) {
+            for (j = 0; j < w; j++) sum += ship_pos[i][j];
+            if (sum == rows[i]) {
+                for (j = 0; j < w; j++) layer[i][j] = 1;
             }
         }
-        
-        // find stripes of occupied cells
-        // rows
+        else {
+            for (j = 0; j < w; j++) sum_hid += ship_pos[i][j];
+        }
+    }
+    if (sum_hid == ships_sum - rows_sum) {
         for (i = 0; i < h; i++) {
-            k = 1;
-            for (j = 0; j < w; j++) {
-                if (grid[i][j] >= 0) {
-                    if (k < ship_max) k++;
-                    else if (
-                      ship_max > 1 ||
-                      (i == 0   || grid[i-1][j] < 0) &&
-                      (i == h-1 || grid[i+1][j] < 0) 
-                    ) {
-                        if (j < w-1 && grid[i][j+1] == UNDEF) 
-                          grid[i][j+1] = VACANT
-                        ;
-                        if (j-k >= 0 && grid[i][j-k] == UNDEF) 
-                          grid[i][j-k] = VACANT
-                        ;
-                    }
-                }
-                
-                else k = 1;
+            if (rows[i] == -1) {
+                for (j = 0; j < w; j++) layer[i][j] = 1;
+            }
+        }
+    }
+
+    sum_hid = 0;
+    for (j = 0; j < w; j++) {
+        sum = 0;
+        if (cols[j] >= 0) {
+            for (i = 0; i < h; i++) sum += ship_pos[i][j];
+            if (sum == cols[j]) {
+                for (i = 0; i < h; i++) layer[i][j] = 1;
             }
         }
-        // columns
+        else {
+            for (i = 0; i < h; i++) sum_hid += ship_pos[i][j];
+        }
+    }
+    if (sum_hid == ships_sum - cols_sum) {
         for (j = 0; j < w; j++) {
-            k = 1;
-            for (i = 0; i < h; i++) {
-                if (grid[i][j] >= 0) {
-                    if (k < ship_max) k++;
-                    else if (
-                      ship_max > 1 ||
-                      (j == 0   || grid[i][j-1] < 0) &&
-                      (j == w-1 || grid[i][j+1] < 0) 
-                    ) {
-                        if (i < h-1 && grid[i+1][j] == UNDEF) 
-                          grid[i+1][j] = VACANT
-                        ;
-                        if (i-k >= 0 && grid[i-k][j] == UNDEF) 
-                          grid[i-k][j] = VACANT
-                        ;
-                    }
-                }
-                
-                else k = 1;
+            if (cols[j] == -1) {
+                for (i = 0; i < h; i++) layer[i][j] = 1;
             }
         }
+    }
 
-       
-        // initial check sum
-        checksum_init = checksum;
-        
-        // check if configuration has changed
-        checksum = 0;
-        for (i = 0; i < h*w; i++) checksum += (*grid)[i];
-        
-        // apply additional strategies for a higher difficulty if
-        // the simpler strategies no longer work
-        if (diff > 1) {
-            // turn on/off additional strategies
-            if (checksum == checksum_init) add_strat = ! add_strat;
-            // record if additional strategies caused to 
-            // change the check sum at least once
-            else if (add_strat) complex_solve = true;
+    // check: blocked cells do not overlap with initially occupied
+    for (i = 0; i < h*w; i++) {
+        if ((*layer)[i] && ! (*ship_pos)[i] && (*init_ext)[i] >= 0) {
+            STATS_INC(prune_init);
+            for (i = 0; i < h*w; i++) (*layer)[i] = 0;
+            return false;
         }
-        if (diff > 1 && add_strat) {
-            // specify the type of occupied cells
-            render_grid_conf(h, w, grid, init, false);
-            
-            
-            // 4. mark cells vacant where the available gaps are shorter
-            // than the shortest unfinished ship
-            
-            // determine the shortest unfinished ship
-            compl_ships_distr(h, w, grid, ships[0], distr_compl);
-            ship_min = 0;
-            for (i = 0; i < ships[0]; i++) {
-                if (distr_compl[i] < distr_all[i]) {
-                    ship_min = i + 1; break;
-                }
+    }
+    return true;
+}
+
+
+/*
+Final checks of the search of solver() when the last ship is placed: the
+sums of the rows and columns are equal to the sum totals, and the
+disclosed cells agree with ship_pos
+
+Parameters:
+  *s: state of the search;
+  hc, wc: see place_ship_body().
+
+*/
+static ALWAYS_INLINE bool place_ship_final(
+  const struct search *s, const int hc, const int wc
+)
+{
+    const struct game_state_const *init_state = s->init_state;
+    int i, j, sum;
+    const int h = (hc ? hc : init_state->H), w = (wc ? wc : init_state->W);
+    int *rows = init_state->rows, *cols = init_state->cols;
+    int **init_ext = s->init_ext;
+    bool **ship_pos = s->ship_pos;
+    bool brk = false;
+
+    // check raw & column sums
+    for (i = 0; i < h; i++) {
+        sum = 0;
+        if (rows[i] >= 0) {
+            for (j = 0; j < w; j++) sum += ship_pos[i][j];
+            if (sum != rows[i]) {brk = true; break;}
+        }
+    }
+    if (! brk) {
+        for (j = 0; j < w; j++) {
+            sum = 0;
+            if (cols[j] >= 0) {
+                for (i = 0; i < h; i++) sum += ship_pos[i][j];
+                if (sum != cols[j]) {brk = true; break;}
             }
+        }
+    }
+    if (brk) {
+        STATS_INC(prune_sum);
+        return false;
+    }
 
-            // determine the gaps
-            for (i = 0; i < h; i++) {for (j = 0; j < w; j++) {
-                if (grid[i][j] == UNDEF) {
-                    // go down
-                    k = 1;
-                    while (
-                      k < ship_min && i+k < h && grid[i+k][j] != VACANT
-                    ) k++;
-                    gap = k;
-                    if (gap >= ship_min) continue;
-                    // go up
-                    k = 1;
-                    while (
-                      gap+k-1 < ship_min && i-k >= 0 && grid[i-k][j] != VACANT 
-                    ) k++;
-                    gap += k-1;
-                    if (gap >= ship_min) continue;
-                    // go right
-                    k = 1;
-                    while (
-                      k < ship_min && j+k < w && grid[i][j+k] != VACANT 
-                    ) k++;
-                    gap = k;
-                    if (gap >= ship_min) continue;
-                    // go left
-                    k = 1;
-                    while (
-                      gap+k-1 < ship_min && j-k >= 0 && grid[i][j-k] != VACANT 
-                    ) k++;
-                    gap += k-1;
-                    if (gap < ship_min) grid[i][j] = VACANT;
-                }
-            }}
-            
+    // check initial conditions
+    for (i = 0; i < h; i++) {
+        for (j = 0; j < w; j++) {
+
+            // if init_ext >= 0, the cell is occupied
+            if (init_ext[i][j] >= 0 && ! ship_pos[i][j]) {brk = true; break;}
 
-            // 5. Determine the number of gaps where the longest 
-            // unfinished ship would fit. Exclude rows and columns
-            // with sum totals smaller than the longest unfinished ship.
-            // If number of gaps is equal to the number of longest 
-            // unfinished ships, fill the gaps as much as possible.
-
-            // determine the longest unfinished ship size and their number;
-            // no need for compl_ships_distr(), because strategy No. 4
-            // cannot generate new completed ships
-            ship_max = num_ship_max = 0;
-            for (i = ships[0] - 1; i >= 0; i--) {
-                if (distr_compl[i] < distr_all[i]) {
-                    ship_max = i + 1; 
-                    num_ship_max = distr_all[i] - distr_compl[i];
+            switch (init_ext[i][j]) {
+                // neighbor to the South occupied
+                case NORTH:
+                    if (! ship_pos[i+1][j]) brk = true;
                     break;
-                }
+                case EAST:
+                    if (! ship_pos[i][j-1]) brk = true;
+                    break;
+                case SOUTH:
+                    if (! ship_pos[i-1][j]) brk = true;
+                    break;
+                case WEST:
+                    if (! ship_pos[i][j+1]) brk = true;
+                    break;
+                // at least two neighbors occupied
+                case INNER:
+                    if ( ! (
+                      i > 0   && ship_pos[i-1][j] &&
+                      i < h-1 && ship_pos[i+1][j]    ||
+                      j > 0   && ship_pos[i][j-1] &&
+                      j < w-1 && ship_pos[i][j+1]
+                    )) brk = true;
             }
-            if (ship_max == 1) continue; // more complex logic, won't consider
-            
-            // array to record the gaps; per gap, vert (0/1), y, x, length 
-            int gaps[num_ship_max*4];
-            
-            // determine the number of gaps (conservatively, the upper 
-            // boundary)
-            num_gaps = 0; // count more than once if more than one ships fit
-            num_full_gaps = 0; // count each gap once (capped by num_ship_max)
-            // rows
-            for (i = 0; i < h; i++) { 
+            if (brk) break;
+        }
+        if (brk) break;
+    }
+    if (brk) {
+        STATS_INC(prune_init);
+        return false;
+    }
+    return true;
+}
+
+
+/* the position of ship ship_num ends a prefix of the search which belongs
+to another shard (see struct search): its layer of blocked cells (of h*w
+cells) is cleared */
+static ALWAYS_INLINE bool place_ship_other_shard(
+  struct search *s, int ship_num, int hw
+)
+{
+    int i;
+    
+    if (ship_num + 1 != s->shard_depth) return false;
+    if ((s->prefix)++ % s->num_shards == s->shard) return false;
+    for (i = 0; i < hw; i++) (*(s->blocked[ship_num]))[i] = 0;
+    return true;
+}
+
+
+/* mark the cells of a ship in ship_pos (val = 1), or delete it (val = 0) */
+static ALWAYS_INLINE void place_ship_mark(
+  struct search *s, int ship_num, int vert, int y, int x, bool val
+)
+{
+    int i, j;
+    int ship = s->init_state->ships[ship_num];
+    int ship_H = vert*ship + 1 - vert;
+    int ship_W = (1 - vert)*ship + vert;
+
+    for (i = 0; i < ship_H; i++) {
+        for (j = 0; j < ship_W; j++) s->ship_pos[y+i][x+j] = val;
+    }
+}
+
+
+/*
+Pruning of solver_alt(): the ships 0 ... ship_num are placed as in the
+known solution, and the cells disclosed as occupied (init_ext >= 0) which
+are not covered yet are as many as the cells of the remaining ships.
+Then these cover exactly those cells, which are split into ships in a
+single way (the ships do not touch), so the subtree can only reproduce
+the completion of the known solution, if that covers them. It is checked
+once (place_ship_final()) and recorded instead of being searched, and
+the layer of blocked cells of ship_num is cleared.
+
+Parameters:
+  *s: state of the search, with soln->ship_ref set;
+  ship_num: ship just placed (not the last one);
+  hc, wc: see place_ship_body().
+
+Returns true if the subtree is cut.
+
+*/
+static ALWAYS_INLINE bool place_ship_ref_rest(
+  struct search *s, int ship_num, const int hc, const int wc
+)
+{
+    const struct game_state_const *init_state = s->init_state;
+    struct sol *soln = s->soln;
+    int **ref = soln->ship_ref;
+    int **init_ext = s->init_ext;
+    bool **ship_pos = s->ship_pos;
+    const int h = (hc ? hc : init_state->H), w = (wc ? wc : init_state->W);
+    int ns = init_state->num_ships;
+    int i, k, rest = 0, forced = 0;
+    bool cover = true, valid;
+
+    if (
+      ! ref ||
+      memcmp(*ref, *(s->ship_coord_tmp), (ship_num + 1)*3*sizeof(**ref))
+    ) return false;
+    for (k = ship_num + 1; k < ns; k++) rest += init_state->ships[k];
+    for (i = 0; i < h*w; i++) {
+        if ((*init_ext)[i] >= 0 && ! (*ship_pos)[i]) forced++;
+    }
+    if (forced != rest) return false;
+
+    // the remaining ships of the known solution must cover the cells
+    for (k = ship_num + 1; k < ns; k++) {
+        place_ship_mark(s, k, ref[k][0], ref[k][1], ref[k][2], 1);
+    }
+    for (i = 0; i < h*w; i++) {
+        if ((*init_ext)[i] >= 0 && ! (*ship_pos)[i]) cover = false;
+    }
+    valid = cover && place_ship_final(s, hc, wc);
+    for (k = ship_num + 1; k < ns; k++) {
+        place_ship_mark(s, k, ref[k][0], ref[k][1], ref[k][2], 0);
+    }
+    if (! cover) return false;
+
+    if (valid) {
+        memcpy(*(soln->ship_coord), *ref, ns*3*sizeof(**ref));
+        soln->err = 0;
+    }
+    for (i = 0; i < h*w; i++) (*(s->blocked[ship_num]))[i] = 0;
+    return true;
+}
+
+
+/*
+Search of solver(): try the positions of the ships, from the longest one
+to the shortest one
+
+The search runs on an explicit stack with a frame per ship (see struct
+search): the frame of ship k holds the position tried. If a position
+satisfies the conditions given by rows, cols and init_ext, ship k is
+placed there, the cells around it are blocked in its layer blocked[k]
+and the frame of the next ship is pushed; it starts after the position
+of ship k if the ships have the same size. If a position of the last
+ship satisfies the final checks, the solution is recorded and the search
+is continued in order to check the uniqueness of the solution. When all
+positions of a ship have been tried, its frame is popped, and the
+previous ship is removed and shifted. Each frame pushed is a node of the
+search (counted in soln->count).
+
+Parameters:
+  *s: state of the search (see search_init()), which is advanced;
+  nodes: number of nodes after which the search is paused (0 or less:
+until it is finished);
+  hc, wc: height, width as compile-time constants, or 0 to take them from
+*init_state.
+
+The body is inlined into place_ship() (generic) and into the kernels for
+the preset sizes, where hc, wc are constants, so that the loops over rows
+and columns have fixed bounds (see PLACE_SHIP_KERNEL).
+
+Returns true if the search is finished (soln->err is final), false if it
+is paused; it continues where it stopped when called again.
+
+*/
+static ALWAYS_INLINE bool place_ship_body(
+  struct search *s, long nodes, const int hc, const int wc
+)
+{
+    const struct game_state_const *init_state = s->init_state;
+    struct sol *soln = s->soln;
+    int **ship_coord_tmp = s->ship_coord_tmp;
+    bool ***blocked = s->blocked;
+    long long count_lim = s->count_lim;
+    const int h = (hc ? hc : init_state->H), w = (wc ? wc : init_state->W);
+    int ns = init_state->num_ships;
+
+    int i, pos_No, ship_num, ship, vert, y, x, y_max, x_max;
+    bool push; // frame of the next ship pushed
+    struct search_frame *f, *next;
+    long steps = 0;
+
+    while (s->depth > 0) {
+        ship_num = s->depth - 1;
+        ship = init_state->ships[ship_num];
+        f = &s->frame[ship_num];
+
+        // new frame: count the node, check the limits
+        if (s->enter) {
+            if (nodes > 0 && steps == nodes) return false;
+            steps++;
+            s->enter = false;
+
+            if (s->shard == 0 || ship_num >= s->shard_depth) {
+                (soln->count)++;
+                STATS_INC(place_ship_nodes);
                 if (
-                  rows[i] >= ship_max || 
-                  rows[i] == -1 && ships_sum - rows_sum >= ship_max
+                  0 < count_lim && count_lim < soln->count ||
+                  soln->ctl && soln->count % SOLVE_CTL_INTERVAL == 0 &&
+                  solve_ctl_poll(soln->ctl, soln->count)
                 ) {
-                    for (j = 0; j < w; j++) {
-                        if (grid[i][j] == UNDEF) {
-                            // go left
-                            k = 1;
-                            while (j-k >= 0 && grid[i][j-k] != VACANT) k++;
-                            gap = k;
-                            // go right
-                            k = 1;
-                            while (j+k < w && grid[i][j+k] != VACANT) k++;
-                            gap += k-1;
-                            // record
-                            if (
-                              gap >= ship_max && num_full_gaps < num_ship_max
-                            ) {
-                                gaps[num_full_gaps*4    ] = 0;
-                                gaps[num_full_gaps*4 + 1] = i;
-                                gaps[num_full_gaps*4 + 2] = j + k - gap;
-                                gaps[num_full_gaps*4 + 3] = gap;
-                                num_full_gaps++;
-                            }
-                            // upper bound
-                            num_gaps += (int) (gap + 1)/(ship_max + 1); 
-                            // shift to the end of gap
-                            j += k-1;
-                        }
-                    }
+                    soln->err = 1;
+                    s->depth = 0;
+                    return true;
                 }
             }
-            // columns
-            for (j = 0; j < w; j++) {
-                if (
-                  cols[j] >= ship_max || 
-                  cols[j] == -1 && ships_sum - cols_sum >= ship_max
-                ) {
-                    for (i = 0; i < h; i++) {
-                        if (grid[i][j] == UNDEF) {
-                            // go up
-                            k = 1;
-                            while (i-k >= 0 && grid[i-k][j] != VACANT) k++;
-                            gap = k;
-                            // go down
-                            k = 1;
-                            while (i+k < h && grid[i+k][j] != VACANT) k++;
-                            gap += k-1;
-                            if (
-                              gap >= ship_max && num_full_gaps < num_ship_max
-                            ) {
-                                gaps[num_full_gaps*4    ] = 1;
-                                gaps[num_full_gaps*4 + 1] = i + k - gap;
-                                gaps[num_full_gaps*4 + 2] = j;
-                                gaps[num_full_gaps*4 + 3] = gap;
-                                num_full_gaps++;
+        }
+        // back from the next ship: unblock cells, delete the position
+        // and shift it
+        else {
+            for (i = 0; i < h*w; i++) (*(blocked[ship_num]))[i] = 0;
+            place_ship_mark(s, ship_num, f->vert, f->y, f->x, 0);
+            (f->x)++;
+        }
+
+        // orientation 0: horiz.; 1: vertical (single orientation if
+        // ship = 1); continue from the position of the frame
+        push = false;
+        vert = f->vert;
+        y = f->y;
+        x = f->x;
+        for (; vert < min(2, ship); vert++, y = 0) {
+
+            // left/top cell coordinates of the ship x, y max values (+1)
+            y_max = h - (vert*ship + 1 - vert) + 1;
+            x_max = w - ((1 - vert)*ship + vert) + 1;
+            for (; y < y_max; y++, x = 0) {
+                for (; x < x_max; x++) {
+
+                    // progress of the search: positions of the first ship
+                    if (ship_num == 0 && soln->ctl) (soln->ctl->first_done)++;
+
+                    if (! place_ship_fits(s, ship_num, vert, y, x)) continue;
+
+                    // save position
+                    place_ship_mark(s, ship_num, vert, y, x, 1);
+                    ship_coord_tmp[ship_num][0] = vert;
+                    ship_coord_tmp[ship_num][1] = y;
+                    ship_coord_tmp[ship_num][2] = x;
+
+                    // not last ship: block cells, push the next ship
+                    // unless it starts a prefix of another shard or can
+                    // only reproduce the known solution; if same size,
+                    // start after current ship
+                    if (ship_num < ns - 1) {
+                        if (
+                          place_ship_block(s, ship_num, vert, y, x, hc, wc)
+                          && ! place_ship_other_shard(s, ship_num, h*w)
+                          && ! place_ship_ref_rest(s, ship_num, hc, wc)
+                        ) {
+                            f->vert = vert;
+                            f->y = y;
+                            f->x = x;
+                            next = &s->frame[ship_num + 1];
+                            if (init_state->ships[ship_num + 1] == ship) {
+                                pos_No = vert*h*w + y*w + x + 1;
+                                next->vert = (int) pos_No/(h*w);
+                                next->y = (int) (pos_No - next->vert*h*w)/w;
+                                next->x = pos_No - next->vert*h*w - next->y*w;
                             }
-                            num_gaps += (int) (gap + 1)/(ship_max + 1);
-                            i += k-1;
+                            else next->vert = next->y = next->x = 0;
+
+                            (s->depth)++;
+                            s->enter = true;
+                            push = true;
+                            break;
                         }
                     }
-                }
-            }
-            
-            // fill the gaps (as in a nonogram)
-            if (num_gaps == num_ship_max) {
-                for (i = 0; i < num_full_gaps; i++) {
-                    k = (gaps[i*4 + 3] + 1) % (ship_max + 1);
-                    ships_per_gap = (int) (gaps[i*4 + 3] + 1)/(ship_max + 1);
-                    for (j = 0; j < ships_per_gap; j++) {
-                        for (l = 0; l < ship_max; l++) {
-                            y = gaps[i*4+1] + gaps[i*4]*(j*(ship_max+1) + l);
-                            x = 
-                              gaps[i*4+2] + (1-gaps[i*4])*(j*(ship_max+1) + l)
-                            ;
-                            if (l >= k && grid[y][x] == UNDEF) 
-                              grid[y][x] = OCCUP
-                            ;
+
+                    // last ship: if checks OK, save solution; check
+                    // uniqueness (relative to the known solution: stop at
+                    // the first different one)
+                    else if (place_ship_final(s, hc, wc)) {
+                        if (soln->ship_ref) {
+                            if (! memcmp(
+                              *(soln->ship_ref), *ship_coord_tmp,
+                              ns*3*sizeof(**ship_coord_tmp)
+                            )) {
+                                memcpy(
+                                  *(soln->ship_coord), *ship_coord_tmp,
+                                  ns*3*sizeof(**ship_coord_tmp)
+                                );
+                                soln->err = 0;
+                            }
+                            else {
+                                memcpy(
+                                  *(soln->ship_coord), *(soln->ship_ref),
+                                  ns*3*sizeof(**ship_coord_tmp)
+                                );
+                                memcpy(
+                                  *(soln->ship_coord2), *ship_coord_tmp,
+                                  ns*3*sizeof(**ship_coord_tmp)
+                                );
+                                soln->err = 2;
+                                s->depth = 0;
+                                return true;
+                            }
+                        }
+                        else if (soln->err == 3) {
+                            memcpy(
+                              *(soln->ship_coord), *ship_coord_tmp,
+                              ns*3*sizeof(**ship_coord_tmp)
+                            );
+                            soln->err = 0;
+                        }
+                        else {
+                            memcpy(
+                              *(soln->ship_coord2), *ship_coord_tmp,
+                              ns*3*sizeof(**ship_coord_tmp)
+                            );
+                            soln->err = 2;
                         }
                     }
+
+                    // delete current position before shifting
+                    place_ship_mark(s, ship_num, vert, y, x, 0);
                 }
+                if (push) break;
             }
-                        
+            if (push) break;
         }
-        
-    } while (checksum != checksum_init || add_strat);
-    
-    // count occupied / vacant cells found
-    *occ = *vac = 0;
-    for (i = 0; i < h*w; i++) {
-        *occ += ((*grid)[i] >= 0);
-        *vac += ((*grid)[i] == -1);
-    }
-    
-    // check if all occupied cells were found
-    if (*occ == ships_sum) {
-        if (diff <= 1 || ! complex_solve) return 0;
-        else                              return 1;
+
+        // all positions tried: back to the previous ship
+        if (! push) (s->depth)--;
     }
-    else                                  return 2;
+
+    return true;
 }
 
 
+/*
+Search kernels: place_ship_body() instantiated for height H and width W
+(0, 0: generic)
+*/
+#define PLACE_SHIP_KERNEL(name, H, W)                                        \
+static bool name(struct search *s, long nodes)                               \
+{                                                                            \
+    return place_ship_body(s, nodes, H, W);                                  \
+}
+
+PLACE_SHIP_KERNEL(place_ship, 0, 0)
+PLACE_SHIP_KERNEL(place_ship_7x7, 7, 7)
+PLACE_SHIP_KERNEL(place_ship_8x10, 8, 10)
+PLACE_SHIP_KERNEL(place_ship_10x12, 10, 12)
 
 
 /*
-Where possible, change cell state OCCUP to a specific state 1 to 6, and back.
+Restrict a search of solver(), set up by search_init(), to one of 
+num_shards shards
+
+The prefixes of the search are the positions of the first ship, or of 
+the first two ships if the first one has fewer than SHARD_SPREAD 
+positions per shard, which pass the checks of the search; they are dealt
+out to the shards in turn (see struct search). The shards are independent
+searches: their results are combined by ships_shard_merge(). The sum of
+their counts is the count of the whole search, and a solution is found by
+the shard of its prefix.
 
 Parameters:
-  h, w: height, width of the grid;
-  **grid: 2D array of size H x W of grid configuration;
-  **init: 2D array of size H x W of initial grid configuration 
-(disregarded if remove == false);
-  remove: if true, the value of the cell will be set back to OCCUP, if not
-uniquely defined and not fixed by the init array; if false, the value 
-can only be promoted from OCCUP to 1..6.
+  *s: state of the search, which is restricted;
+  shard: number of the shard, 0, ..., num_shards-1;
+  num_shards: number of shards.
 
 */
-static void render_grid_conf(
-  int h, int w, enum Configuration **grid, enum Configuration **init, 
-  bool remove
-)
+static void search_shard(struct search *s, int shard, int num_shards)
 {
-    int i, j;
-    enum Configuration **g = grid;
-
-    for (i = 0; i < h; i++) {
-        for (j = 0; j < w; j++) {
-            if (g[i][j] == OCCUP) {
-            
-                // set OCCUP to 1..6
-                if (
-                  (i == 0 || g[i-1][j] == VACANT) && i < h-1 && g[i+1][j] >= 0
-                ) g[i][j] = NORTH;
-                
-                else if (
-                  (i == h-1 || g[i+1][j] == VACANT) && i > 0 && g[i-1][j] >= 0
-                ) g[i][j] = SOUTH;
-                
-                else if (
-                  (j == 0 || g[i][j-1] == VACANT) && j < w-1 && g[i][j+1] >= 0
-                ) g[i][j] = WEST;
-                
-                else if (
-                  (j == w-1 || g[i][j+1] == VACANT) && j > 0 && g[i][j-1] >= 0
-                ) g[i][j] = EAST;              
-                
-                else if (
-                  (i == 0   || g[i-1][j] == VACANT) && 
-                  (i == h-1 || g[i+1][j] == VACANT) &&
-                  (j == 0   || g[i][j-1] == VACANT) &&
-                  (j == w-1 || g[i][j+1] == VACANT) 
-                ) g[i][j] = ONE;              
-                
-                else if (
-                  i > 0 && g[i-1][j] >= 0 && i < h-1 && g[i+1][j] >= 0 ||
-                  j > 0 && g[i][j-1] >= 0 && j < w-1 && g[i][j+1] >= 0
-                ) g[i][j] = INNER;   
-                         
+    const struct game_state_const *init_state = s->init_state;
+    int h = init_state->H, w = init_state->W;
+    int ns = init_state->num_ships;
+    int ship = init_state->ships[0];
+    int i, vert, y, x, num = 0;
+    
+    s->shard = shard;
+    s->num_shards = num_shards;
+    
+    // a single ship: no prefixes, shard 0 takes the whole search
+    if (ns == 1) {
+        if (shard > 0) s->depth = 0;
+        return;
+    }
+    
+    // positions of the first ship which are prefixes
+    for (vert = 0; vert < min(2, ship); vert++) {
+        for (y = 0; y < h - (vert*ship + 1 - vert) + 1; y++) {
+            for (x = 0; x < w - ((1 - vert)*ship + vert) + 1; x++) {
+                if (! place_ship_fits(s, 0, vert, y, x)) continue;
+                place_ship_mark(s, 0, vert, y, x, 1);
+                if (place_ship_block(s, 0, vert, y, x, 0, 0)) {
+                    num++;
+                    for (i = 0; i < h*w; i++) (**(s->blocked))[i] = 0;
+                }
+                place_ship_mark(s, 0, vert, y, x, 0);
             }
-           
-            
-            // set back to OCCUP
-            else if (remove && g[i][j] > 0 && init[i][j] <= 0 && 
-              (
-                g[i][j] == NORTH && 
-                (i > 0 && g[i-1][j] != VACANT || g[i+1][j] < 0)
-                ||
-                g[i][j] == SOUTH && 
-                (i < h-1 && g[i+1][j] != VACANT || g[i-1][j] < 0)
-                || 
-                g[i][j] == WEST && 
-                (j > 0 && g[i][j-1] != VACANT || g[i][j+1] < 0)
-                ||
-                g[i][j] == EAST && 
-                (j < w-1 && g[i][j+1] != VACANT || g[i][j-1] < 0)
-                ||
-                g[i][j] == ONE && ! (
-                  (i == 0   || g[i-1][j] == VACANT) &&
-                  (i == h-1 || g[i+1][j] == VACANT) &&
-                  (j == 0   || g[i][j-1] == VACANT) &&
-                  (j == w-1 || g[i][j+1] == VACANT) 
-                )
-                ||
-                g[i][j] == INNER && ! (
-                  i > 0 && g[i-1][j] >= 0 && i < h-1 && g[i+1][j] >= 0 ||
-                  j > 0 && g[i][j-1] >= 0 && j < w-1 && g[i][j+1] >= 0
-                )
-              )
-            ) g[i][j] = OCCUP;
-           
         }
     }
-    
-    
+    s->shard_depth = (ns > 2 && num < SHARD_SPREAD*num_shards ? 2 : 1);
 }
 
 
 
 /*
-Search for completed ships and determine their size distribution.
+Check if a solution using predefined logical strategies is possible.
+
 
 Parameters:
-  h, w: height, width of the grid;
-  **grid: 2D array of size H x W of grid configuration;
-  max_size: the largest ship searched for (given by ships[0], the 0th element
-of the array of ship lengths); larger completed ships will be ignored;
-  *distr: array of size max_size of size distribution; in distr[i] the
-number of completed ships of length i+1 will be saved.
+  diff: difficulty level;
+  *init_state: constant part of game_state (*ships_distr can be undefined);
+  **grid: h x w array which will be filled with the information 
+determined by the solver (completed or unfinished solution);
+  *occ, *vac: points to the variable with number of occupied / vacant cells
+found by the solver;
+  *sc: scratch arena from which the working arrays are taken (they are
+released before returning).
 
-The function returns "true" (error) if max_size is exceeded, otherwise 
-"false".
+Returns 
+  0: solution by simpler strategies is possible;
+  1: solution is only is possible if applying more complex strategies in
+addition to the simpler strategies;
+  2: solution by the predefined strategies is not possible (also if the
+strategies contradict each other, as for clues without a solution).
+
+NB: Additional strategies are tried for diff > 1 only; for diff = 0, 1,
+the function returns 0 or 2.
 
 */
-static bool compl_ships_distr(
-  int h, int w, int **grid, int max_size, int *distr
+static int solve_by_logic(
+  int diff, const struct game_state_const *init_state,
+  enum Configuration **grid, int *occ, int *vac, struct scratch *sc
 )
 {
-    int i, j, k;
-    bool err = false;
-    int **g = grid;
+    int i, k; 
+    int checksum, checksum_init;
+    bool contra = false;
+    int h = init_state->H, w = init_state->W;
+    int ns = init_state->num_ships;
+    int *ships = init_state->ships;
+    int **init = init_state->init;
+    int ships_sum = init_state->ships_sum;
+    int distr_all[ships[0]], distr_compl[ships[0]]; 
+    struct scratch_mark mark = scratch_mark(sc);
+
+    // array to record the gaps for strategy 5; per gap, vert (0/1), y, x,
+    // length (at most as many gaps as ships are recorded)
+    int *gaps = scratch_newn(sc, ns*4, int);
+    // placements of the ships still possible, for strategy 7
+    bool *alive = scratch_newn(sc, 2*ships[0]*h*w, bool);
+    for (i = 0; i < 2*ships[0]*h*w; i++) alive[i] = true;
+    // configuration before the current pass, to detect contradictions
+    enum Configuration *prev = scratch_newn(sc, h*w, enum Configuration);
+
+    STATS_PHASE_BEGIN(PHASE_LOGIC);
+
+    // initialize array where the current configuration is kept
+    memcpy(*grid, *init, sizeof(**init)*h*w);
     
-    for (k = 0; k < max_size; k++) distr[k] = 0;
+    // check sum to determine whether grid was changed after 
+    // applying the strategies
+    checksum = 0;
+    for (i = 0; i < h*w; i++) checksum += (*grid)[i]; 
     
-    // determine completed ships that start with NORTH
-    // or WEST and end with SOUTH or EAST, also ONE-ships
-    for (i = 0; i < h; i++) {
-        for (j = 0; j < w; j++) {
+    // distribution of ship lengths
+    for (k = 0; k < ships[0]; k++) distr_all[k] = 0;
+    for (i = 0; i < ns; i++) (distr_all[ships[i] - 1])++;
+    
+
+    // flags that switch additional strategies and indicate if they helped
+    bool add_strat = false, complex_solve = false;
+    
+    // apply the strategies as long as they work
+    do {      
+        memcpy(prev, *grid, h*w*sizeof(*prev));
+
+        // mark cells next to occupied cells as occupied where possible;
+        // mark cells around occupied cells vacant
+        STATS_LOGIC_BEGIN(h, w, grid);
+        solver_init(h, w, grid);
+        STATS_LOGIC_END(h, w, grid, 0, 0);
         
-            if (i < h-1 && g[i][j] == NORTH) {
-                k = 0;
-                do {k++;} 
-                  while (i+k < h-1 && g[i+k][j] == INNER && k < max_size-1)
-                ; 
-                if (g[i+k][j] == SOUTH) (distr[k])++;
-                else if (g[i+k][j] == INNER) err = true;
-            }
-            
-            else if (j < w-1 && g[i][j] == WEST) {
-                k = 0;
-                do {k++;} 
-                  while (j+k < w-1 && g[i][j+k] == INNER && k < max_size-1)
-                ; 
-                if (g[i][j+k] == EAST) (distr[k])++;
-                else if (g[i][j+k] == INNER) err = true;
-            }
+        
+        // 1., 2. sum totals of rows and columns
+        logic_sums(init_state, grid);
+        
+        // 3. stripes of the longest unfinished ship
+        logic_stripes(init_state, grid, distr_all, distr_compl);
+
+       
+        // initial check sum
+        checksum_init = checksum;
+        
+        // check if configuration has changed
+        checksum = 0;
+        for (i = 0; i < h*w; i++) checksum += (*grid)[i];
+        
+        // apply additional strategies for a higher difficulty if
+        // the simpler strategies no longer work
+        if (diff > 1) {
+            // turn on/off additional strategies
+            if (checksum == checksum_init) add_strat = ! add_strat;
+            // record if additional strategies caused to 
+            // change the check sum at least once
+            else if (add_strat) complex_solve = true;
+        }
+        if (diff > 1 && add_strat) {
+            // 4. gaps shorter than the shortest unfinished ship
+            logic_short_gaps(init_state, grid, distr_all, distr_compl);
+
+            // 5. gaps that fit the longest unfinished ships
+            logic_fill_gaps(init_state, grid, distr_all, distr_compl, gaps);
             
-            else if (g[i][j] == ONE) (distr[0])++;
+            // 6. complete line solver
+            STATS_LOGIC_BEGIN(h, w, grid);
+            logic_lines(init_state, grid, distr_all, sc);
+            STATS_LOGIC_END(h, w, grid, 6, 6);
             
+            // 7. census of the placements of the unfinished ships
+            logic_census(init_state, grid, distr_all, distr_compl, alive, sc);
+        }
+        
+        // a decided cell may only be refined from OCCUP to a ship part; 
+        // any other change comes from contradictory clues (the strategies 
+        // would then overwrite each other's cells without end)
+        for (i = 0; i < h*w; i++) {
+            if (
+              prev[i] != UNDEF && prev[i] != OCCUP && (*grid)[i] != prev[i] ||
+              prev[i] == OCCUP && (*grid)[i] < OCCUP
+            ) contra = true;
         }
+        
+    } while (! contra && (checksum != checksum_init || add_strat));
+
+    scratch_reset(sc, mark);
+    STATS_PHASE_END(PHASE_LOGIC);
+
+    // count occupied / vacant cells found
+    *occ = *vac = 0;
+    for (i = 0; i < h*w; i++) {
+        *occ += ((*grid)[i] >= 0);
+        *vac += ((*grid)[i] == -1);
     }
     
-    return err;
+    // check if all occupied cells were found
+    if (*occ == ships_sum && ! contra) {
+        if (diff <= 1 || ! complex_solve) return 0;
+        else                              return 1;
+    }
+    else                                  return 2;
 }
 
 
 
+
 /*
-Generate puzzle with given difficulty. 
+Strategies 1 and 2 of solve_by_logic() (sum totals of rows and columns)
 
 Parameters:
-  *params: game parameters;
-  *rs: random state;
-  *num_ships: pointer under which the generated number of ships will be saved;
-  **ships: array of size *num_ships where ship sizes will be saved (sorted in
-descending order);
-  *rows, *cols: arrays of sizes H, W, resp., where the row and column sums 
-will be saved;
-  **init: 2D array of size H x W where the initially disclosed information
-for the grid will be saved.
+  *init_state: constant part of game_state;
+  **grid: h x w array of the current configuration, which is updated.
 
 */
-static void generator_diff(
-  const game_params *params, random_state *rs, int *num_ships, int **ships,
-  int *rows, int *cols, enum Configuration **init
+static void logic_sums(
+  const struct game_state_const *init_state, enum Configuration **grid
 )
 {
-    int i, j, k, ship_ex, change, ex, num_init, num_wrong, log_solve;
-    bool err, flag_break;
-    int h = params->H, w = params->W, diff = params->diff;
-    int *ns = num_ships;
-        
-        
-    //****** determine ships
+    int i, j, sum_occ1, sum_occ2, sum_und1, sum_und2;
+    int h = init_state->H, w = init_state->W;
+    int ships_sum = init_state->ships_sum;
+    int rows_sum = init_state->rows_sum; 
+    int cols_sum = init_state->cols_sum;
+    int *rows = init_state->rows, *cols = init_state->cols;
+
+    // try two strategies:
+    // 1. if number of occupied cells of a row/column is equal to 
+    // the sum total (incl. 0), mark the remaining cells vacant;
+    // 2. if number of unmarked cells in a row/column is equal to 
+    // the row/column sum minus occupied cells, mark the remaining 
+    // cells occupied
     
-    if (min(h, w) == 7) {
-        *ns = 7;  
-        *ships = snewn(*ns, int);
-        (*ships)[0] = (*ships)[1] = 4;
-        (*ships)[2] = (*ships)[3] = 3;
-        (*ships)[4] = (*ships)[5] = (*ships)[6] = 2;
-    }
-    else {
-        // number of ships 7 or 8
-        if (diff == BASIC) *ns = 7;
-        else               *ns = 7 + random_upto(rs, 2);
-        *ships = snewn(*ns, int);
-        // maximal ship size
-        int ship_max = round(min(h, w)*.6);
-        // divide ship sizes in 4 groups; pick 2 sizes from each group
-        // (if 7 ships then one size from the lowest group)
-        float group_size = (ship_max - 1)/3.9999F; 
-        // not integer! divisor slightly shifted from 4.0 for stability
-                
-        // if difficulty <= INTERMEDIATE then pick the biggest size from
-        // 1st group (small ships are more difficult to find)
-        if (diff <= INTERMEDIATE) {
-            (*ships)[6]     = (int) group_size + 1;
-            (*ships)[*ns-1] = (*ships)[6];
+    // rows
+    STATS_LOGIC_BEGIN(h, w, grid);
+    sum_occ1 = sum_und1 = 0;
+    for (i = 0; i < h; i++) {
+        sum_occ2 = sum_und2 = 0;
+        for (j = 0; j < w; j++) {
+            if (grid[i][j] >= 0) {
+                if (rows[i] > -1) sum_occ2++;
+                else              sum_occ1++;
+            }
+            else if (grid[i][j] == UNDEF) {
+                if (rows[i] > -1) sum_und2++;
+                else              sum_und1++;
+            }
         }
-        else {
-            (*ships)[6]     = 1 + random_upto(rs, (int) group_size + 1);
-            (*ships)[*ns-1] = 1 + random_upto(rs, (int) group_size + 1);
+        if (sum_occ2 == rows[i]) {
+            for (j = 0; j < w; j++) 
+              if (grid[i][j] == UNDEF) grid[i][j] = VACANT
+            ;                    
         }
-        
-        // 2nd, 3rd, 4th groups
-        for (i = 0; i < 3; i++) {
-            (*ships)[i*2] = 
-              ((int) group_size*(i+1)) + 2 +
-              random_upto(
-                rs, ((int) group_size*(i+2)) - ((int) group_size*(i+1)) 
-              )
-            ;
-            (*ships)[i*2+1] = 
-              ((int) group_size*(i+1)) + 2 + 
-              random_upto(
-                rs, ((int) group_size*(i+2)) - ((int) group_size*(i+1)) 
-              )
-            ;
+        else if (sum_und2 == rows[i] - sum_occ2) {
+            for (j = 0; j < w; j++) 
+              if (grid[i][j] == UNDEF) grid[i][j] = OCCUP
+            ;                    
         }
-        
-        int ctx = -1;
-        arraysort(*ships, *ns, cmp, &ctx);    
     }
-    
-    
-
-    //****** generate ship configuration
-
-    // H x W layers of positions blocked by the 1st, 2nd, ... ships
-    bool **blocked[*ns-1], *blocked_[(*ns-1)*h], blocked__[(*ns-1)*h*w];
-    for (k = 0; k < *ns-1; k++) {
-        blocked[k] = blocked_ + k*h;
+    // rows with hidden sum total
+    if (sum_occ1 == ships_sum - rows_sum) {
         for (i = 0; i < h; i++) {
-            blocked_[k*h+i] = blocked__ + (k*h+i)*w;
+            if (rows[i] == -1) {
+                for (j = 0; j < w; j++) 
+                  if (grid[i][j] == UNDEF) grid[i][j] = VACANT
+                ;
+            }
         }
-    }
-    for (k = 0; k < (*ns-1)*h*w; k++) blocked__[k] = 0;
-
-    // num_ships x 3 array of ship coordinates (vert, y, x);
-    int *ship_coord[*ns], ship_coord_[*ns*3];
-    for (k = 0; k < *ns; k++) ship_coord[k] = ship_coord_ + k*3;
-
-    // count the total number of calls of the recursive function
-    int gen_count[1];
-    // limit on calls of the recursive function before another attempt 
-    // to generate a solution is made
-    int gen_count_lim = 1200;
-    // maximum number of attempts to generate a solution before
-    // number of ships is reduced 
-    int attempt_lim = 5;
-
-    while (true) {
-        
-        for (i = 0; i < attempt_lim; i++) {
-            for (k = 0; k < (*ns-1)*h*w; k++) blocked__[k] = 0;
-            for (k = 0; k < *ns*3; k++) ship_coord_[k] = 0;
-            *gen_count = 0;
-            
-            err = place_ship_rng(
-              0, params, *ships, ns, blocked, rs, ship_coord, 
-              gen_count, gen_count_lim
-            ); 
-            
-            if (! err) break;
+    }        
+    else if (sum_und1 == ships_sum - rows_sum - sum_occ1) {
+        for (i = 0; i < h; i++) {
+            if (rows[i] == -1) {
+                for (j = 0; j < w; j++) 
+                  if (grid[i][j] == UNDEF) grid[i][j] = OCCUP
+                ;
+            }
+        }
+    }        
+    // columns
+    sum_occ1 = sum_und1 = 0;
+    for (j = 0; j < w; j++) {
+        sum_occ2 = sum_und2 = 0;
+        for (i = 0; i < h; i++) {
+            if (grid[i][j] >= 0) {
+                if (cols[j] > -1) sum_occ2++;
+                else              sum_occ1++;
+            }
+            else if (grid[i][j] == UNDEF) {
+                if (cols[j] > -1) sum_und2++;
+                else              sum_und1++;
+            }
+        }
+        if (sum_occ2 == cols[j]) {
+            for (i = 0; i < h; i++) 
+              if (grid[i][j] == UNDEF) grid[i][j] = VACANT
+            ;                    
+        }
+        else if (sum_und2 == cols[j] - sum_occ2) {
+            for (i = 0; i < h; i++) 
+              if (grid[i][j] == UNDEF) grid[i][j] = OCCUP
+            ;                    
         }
-        if (! err) break;
-    
-        // ship configuration could not be generated: remove one ship
-        ship_ex = ((int) (*ns + 1)/2) - 1; 
-        memcpy(
-          *ships + ship_ex, *ships + ship_ex + 1, 
-          sizeof(int)*(*ns - ship_ex - 1)
-        );
-        (*ns)--;
     }
- 
-
+    // columns with hidden sum total
+    if (sum_occ1 == ships_sum - cols_sum) {
+        for (j = 0; j < w; j++) {
+            if (cols[j] == -1) {
+                for (i = 0; i < h; i++) 
+                  if (grid[i][j] == UNDEF) grid[i][j] = VACANT
+                ;
+            }
+        }
+    }
+    else if (sum_und1 == ships_sum - cols_sum - sum_occ1) {
+        for (j = 0; j < w; j++) {
+            if (cols[j] == -1) {
+                for (i = 0; i < h; i++) 
+                  if (grid[i][j] == UNDEF) grid[i][j] = OCCUP
+                ;
+            }
+        }
+    }        
+    STATS_LOGIC_END(h, w, grid, 1, 2);
+}
 
-    //****** define parameters for puzzle generation
-    
-    // target solver count for difficulty 3 (min, max)
-    int solver_count_int [2] = {50, 600};
-    // values of array specify how many cells of the type -1/0/(1..6), 
-    // respectively, are initially disclosed
-    int ini_cells[3];
-    // number of the sum values along the border that are hidden
-    int sums_ex;
-    // sum of all ship sizes
-    int num_cells = 0;
-    for (i = 0; i < *ns; i++) num_cells += (*ships)[i];
-    
-    int type_12, type_1;
 
-    // specify parameters according to difficulty
-    switch (diff) {
-        case BASIC:
-            sums_ex = 0;
-            // no cells of type OCCUP disclosed; number of disclosed cells 
-            // of type VACANT determined as a proportion of empty cells; 
-            // number of disclosed cells of type (1..6) determined 
-            // as a proportion of filled cells
-            ini_cells[0] = round((h*w - num_cells)*0.2);
-            ini_cells[1] = 0;
-            ini_cells[2] = round(num_cells*0.6);
-            break;
-        case INTERMEDIATE:
-            sums_ex = 0;
-            ini_cells[0] = round((h*w - num_cells)*0.1);
-            // count types 0 and (1..6) together with type 0 half-weighted
-            type_12 = round(num_cells*0.3);
-            type_1 = random_upto(rs, round(num_cells*0.2));
-            ini_cells[1] = type_1*2;
-            ini_cells[2] = type_12 - type_1;
-            break;
-        case ADVANCED:
-            sums_ex = round((h + w)*.1) + random_upto(rs, 2);
-            ini_cells[0] = round((h*w - num_cells)*0.05);
-            type_12 = round(num_cells*0.2);
-            type_1 = random_upto(rs, type_12); // 0, ..., type_12 - 1
-            ini_cells[1] = type_1*2; 
-            ini_cells[2] = type_12 - type_1;
-            break;
-        case UNREASONABLE:
-            sums_ex = round((h + w)*.2) + random_upto(rs, 3);
-            ini_cells[0] = 0; // no cells of type -1
-            type_12 = round(num_cells*0.15);
-            type_1 = random_upto(rs, type_12 + 1); // 0, ..., type_12
-            ini_cells[1] = type_1;  // not multiplied by 2
-            ini_cells[2] = type_12 - type_1;
-    }
-    ini_cells[0] = min(ini_cells[0], h*w - num_cells);
-    if (ini_cells[1] + ini_cells[2] > num_cells) {
-        ini_cells[1] = 0; ini_cells[2] = num_cells;
-    }
+/*
+Strategy 3 of solve_by_logic() (stripes of the longest unfinished ship)
 
+Parameters:
+  *init_state: constant part of game_state;
+  **grid: h x w array of the current configuration, which is updated;
+  *distr_all: array of size ships[0] of the size distribution of all ships;
+  *distr_compl: array of size ships[0] where the size distribution of 
+the completed ships is saved (see compl_ships_distr()).
 
+*/
+static void logic_stripes(
+  const struct game_state_const *init_state, enum Configuration **grid, 
+  const int *distr_all, int *distr_compl
+)
+{
+    int i, j, k, ship_max;
+    int h = init_state->H, w = init_state->W;
+    int *ships = init_state->ships;
+    int **init = init_state->init;
 
-    //****** 1st attempt to determine sum values along the border
-    //****** and initially disclosed cells
+    // 3. if a stripe of occupied cells is of the size of 
+    // the longest unfinished ship, mark the cells next to the
+    // end cells vacant
     
-    // H x W array of ship positions
-    bool *ship_pos[h], ship_pos_[h*w];
-    for (i = 0; i < h; i++) ship_pos[i] = ship_pos_ + i*w;
-    for (i = 0; i < h*w; i++) ship_pos_[i] = 0;
+    // specify the type of occupied cells
+    STATS_LOGIC_BEGIN(h, w, grid);
+    render_grid_conf(h, w, grid, init, false);
     
-    for (k = 0; k < *ns; k++) {
-        for (i = 0; i < (*ships)[k]; i++) {
-            ship_pos 
-              [ship_coord[k][1]+i*ship_coord[k][0]] 
-              [ship_coord[k][2]+i*(1-ship_coord[k][0])] 
-              = 1
-            ;
+    // determine the longest unfinished ship size and their number;
+    compl_ships_distr(h, w, grid, ships[0], distr_compl);
+    ship_max = 0;
+    for (i = ships[0] - 1; i >= 0; i--) {
+        if (distr_compl[i] < distr_all[i]) {
+            ship_max = i + 1; 
+            break;
         }
     }
     
-    // sum values along the border
+    // find stripes of occupied cells
+    // rows
     for (i = 0; i < h; i++) {
-        rows[i] = 0;
-        for (j = 0; j < w; j++) rows[i] += ship_pos[i][j];
+        k = 1;
+        for (j = 0; j < w; j++) {
+            if (grid[i][j] >= 0) {
+                if (k < ship_max) k++;
+                else if (
+                  ship_max > 1 ||
+                  (i == 0   || grid[i-1][j] < 0) &&
+                  (i == h-1 || grid[i+1][j] < 0) 
+                ) {
+                    if (j < w-1 && grid[i][j+1] == UNDEF) 
+                      grid[i][j+1] = VACANT
+                    ;
+                    if (j-k >= 0 && grid[i][j-k] == UNDEF) 
+                      grid[i][j-k] = VACANT
+                    ;
+                }
+            }
+            
+            else k = 1;
+        }
     }
+    // columns
     for (j = 0; j < w; j++) {
-        cols[j] = 0;
-        for (i = 0; i < h; i++) cols[j] += ship_pos[i][j];
-    }
-    // make copies
-    int rows0[h], cols0[w];
-    memcpy(rows0, rows, sizeof(*rows)*h);
-    memcpy(cols0, cols, sizeof(*cols)*w);
-    // to hide sums_ex values, shuffle array {0, 1, ..., h+w-1}
-    if (sums_ex > 0) {
-        int ind[h+w];
-        for (i = 0; i < h+w; i++) ind[i] = i;
-        shuffle(ind, h+w, sizeof(*ind), rs);
-        for (i = 0; i < sums_ex; i++) {
-            if (ind[i] < h) rows[ind[i]] = -1;
-            else            cols[ind[i]-h] = -1;
+        k = 1;
+        for (i = 0; i < h; i++) {
+            if (grid[i][j] >= 0) {
+                if (k < ship_max) k++;
+                else if (
+                  ship_max > 1 ||
+                  (j == 0   || grid[i][j-1] < 0) &&
+                  (j == w-1 || grid[i][j+1] < 0) 
+                ) {
+                    if (i < h-1 && grid[i+1][j] == UNDEF) 
+                      grid[i+1][j] = VACANT
+                    ;
+                    if (i-k >= 0 && grid[i-k][j] == UNDEF) 
+                      grid[i-k][j] = VACANT
+                    ;
+                }
+            }
+            
+            else k = 1;
         }
-    }    
-    
-    // initially disclosed cells
-    
-    // cumulated sum:
-    int ships_aggr[*ns];
-    ships_aggr[0] = (*ships)[0];
-    for (k = 1; k < *ns; k++) ships_aggr[k] = ships_aggr[k-1] + (*ships)[k];
+    }
+    STATS_LOGIC_END(h, w, grid, 3, 3);
+}
+
+
+/*
+Strategy 4 of solve_by_logic() (gaps shorter than the shortest unfinished 
+ship)
+
+Parameters as for logic_stripes().
+
+*/
+static void logic_short_gaps(
+  const struct game_state_const *init_state, enum Configuration **grid, 
+  const int *distr_all, int *distr_compl
+)
+{
+    int i, j, k, gap, ship_min;
+    int h = init_state->H, w = init_state->W;
+    int *ships = init_state->ships;
+    int **init = init_state->init;
     
-    // initialize array
-    for (i = 0; i < h*w; i++) (*init)[i] = UNDEF;
+    // specify the type of occupied cells
+    render_grid_conf(h, w, grid, init, false);
+
+    // 4. mark cells vacant where the available gaps are shorter
+    // than the shortest unfinished ship
     
-    // choose ini_cells[1] + ini_cells[2] cells from num_cells
-    int ind[num_cells], shift, ship;
-    for (i = 0; i < num_cells; i++) ind[i] = i;
-    shuffle(ind, num_cells, sizeof(*ind), rs);
-    // cells of type OCCUP
-    for (i = 0; i < ini_cells[1]; i++) {
-        for (k = 0; k < *ns; k++) {
-            if (ships_aggr[k] > ind[i]) break;
+    // determine the shortest unfinished ship
+    compl_ships_distr(h, w, grid, ships[0], distr_compl);
+    ship_min = 0;
+    for (i = 0; i < ships[0]; i++) {
+        if (distr_compl[i] < distr_all[i]) {
+            ship_min = i + 1; break;
         }
-        shift = ships_aggr[k] - ind[i] - 1; // shift along the ship
-        init 
-          [ship_coord[k][1] + shift*ship_coord[k][0]] 
-          [ship_coord[k][2] + shift*(1-ship_coord[k][0])] 
-          = OCCUP
-        ;
     }
-    // cells of type 1-6
-    for (i = ini_cells[1]; i < ini_cells[1] + ini_cells[2]; i++) {
-        for (k = 0; k < *ns; k++) {
-            if (ships_aggr[k] > ind[i]) break;
-        }
-        shift = ships_aggr[k] - ind[i] - 1;
-        ship = (*ships)[k];
-        if (ship == 1) init[ship_coord[k][1]] [ship_coord[k][2]] = ONE;
-        else if (shift == 0)
-          init [ship_coord[k][1]] [ship_coord[k][2]] =
-          NORTH*ship_coord[k][0] + WEST*(1 - ship_coord[k][0])
-        ;
-        else if (shift == ship - 1) 
-          init 
-            [ship_coord[k][1] + shift*ship_coord[k][0]] 
-            [ship_coord[k][2] + shift*(1-ship_coord[k][0])] 
-          = SOUTH*ship_coord[k][0] + EAST*(1 - ship_coord[k][0])
-        ;
-        else 
-          init 
-            [ship_coord[k][1] + shift*ship_coord[k][0]] 
-            [ship_coord[k][2] + shift*(1-ship_coord[k][0])] 
-          = INNER
-        ;
+
+    // determine the gaps
+    STATS_LOGIC_BEGIN(h, w, grid);
+    for (i = 0; i < h; i++) {for (j = 0; j < w; j++) {
+        if (grid[i][j] == UNDEF) {
+            // go down
+            k = 1;
+            while (
+              k < ship_min && i+k < h && grid[i+k][j] != VACANT
+            ) k++;
+            gap = k;
+            if (gap >= ship_min) continue;
+            // go up
+            k = 1;
+            while (
+              gap+k-1 < ship_min && i-k >= 0 && grid[i-k][j] != VACANT 
+            ) k++;
+            gap += k-1;
+            if (gap >= ship_min) continue;
+            // go right
+            k = 1;
+            while (
+              k < ship_min && j+k < w && grid[i][j+k] != VACANT 
+            ) k++;
+            gap = k;
+            if (gap >= ship_min) continue;
+            // go left
+            k = 1;
+            while (
+              gap+k-1 < ship_min && j-k >= 0 && grid[i][j-k] != VACANT 
+            ) k++;
+            gap += k-1;
+            if (gap < ship_min) grid[i][j] = VACANT;
+        }
+    }}
+    STATS_LOGIC_END(h, w, grid, 4, 4);
+}
+
+
+/*
+Strategy 5 of solve_by_logic() (gaps that fit the longest unfinished ships)
+
+Parameters:
+  *init_state: constant part of game_state;
+  **grid: h x w array of the current configuration, which is updated;
+  *distr_all: array of size ships[0] of the size distribution of all ships;
+  *distr_compl: array of size ships[0] of the size distribution of 
+the completed ships, as left by logic_short_gaps();
+  *gaps: array of size 4*num_ships to record the gaps.
+
+*/
+static void logic_fill_gaps(
+  const struct game_state_const *init_state, enum Configuration **grid, 
+  const int *distr_all, const int *distr_compl, int *gaps
+)
+{
+    int i, j, k, l, y, x; 
+    int h = init_state->H, w = init_state->W;
+    int *ships = init_state->ships;
+    int ships_sum = init_state->ships_sum;
+    int rows_sum = init_state->rows_sum; 
+    int cols_sum = init_state->cols_sum;
+    int *rows = init_state->rows, *cols = init_state->cols;
+    int ship_max, num_ship_max, gap, num_gaps, num_full_gaps, ships_per_gap;
+
+    // 5. Determine the number of gaps where the longest 
+    // unfinished ship would fit. Exclude rows and columns
+    // with sum totals smaller than the longest unfinished ship.
+    // If number of gaps is equal to the number of longest 
+    // unfinished ships, fill the gaps as much as possible.
+
+    // determine the longest unfinished ship size and their number;
+    // no need for compl_ships_distr(), because strategy No. 4
+    // cannot generate new completed ships
+    ship_max = num_ship_max = 0;
+    for (i = ships[0] - 1; i >= 0; i--) {
+        if (distr_compl[i] < distr_all[i]) {
+            ship_max = i + 1; 
+            num_ship_max = distr_all[i] - distr_compl[i];
+            break;
+        }
     }
-    // cells of type VACANT
-    if (ini_cells[0] > 0) {
-        int ind_[h*w - num_cells];
-        for (i = 0; i < h*w-num_cells; i++) ind_[i] = i;
-        shuffle(ind_, h*w-num_cells, sizeof(*ind_), rs);
-        // sort the first ini_cells[0] elements
-        int ctx = 1;
-        arraysort(ind_, ini_cells[0], cmp, &ctx);
-        int pos, pos0 = -1; 
-        k = 0;
-        for (pos = 0; pos < h*w; pos++) {
-            i = (int) (pos/w);
-            j = pos - i*w;
-            if (ship_pos[i][j] == 0) pos0++;
-            if (pos0 == ind_[k]) {
-                init[i][j] = VACANT;
-                k++;
-                if (k == ini_cells[0]) break;
+    if (ship_max == 1) return; // more complex logic, won't consider
+
+    // determine the number of gaps (conservatively, the upper 
+    // boundary)
+    num_gaps = 0; // count more than once if more than one ships fit
+    num_full_gaps = 0; // count each gap once (capped by num_ship_max)
+    // rows
+    for (i = 0; i < h; i++) { 
+        if (
+          rows[i] >= ship_max || 
+          rows[i] == -1 && ships_sum - rows_sum >= ship_max
+        ) {
+            for (j = 0; j < w; j++) {
+                if (grid[i][j] == UNDEF) {
+                    // go left
+                    k = 1;
+                    while (j-k >= 0 && grid[i][j-k] != VACANT) k++;
+                    gap = k;
+                    // go right
+                    k = 1;
+                    while (j+k < w && grid[i][j+k] != VACANT) k++;
+                    gap += k-1;
+                    // record
+                    if (
+                      gap >= ship_max && num_full_gaps < num_ship_max
+                    ) {
+                        gaps[num_full_gaps*4    ] = 0;
+                        gaps[num_full_gaps*4 + 1] = i;
+                        gaps[num_full_gaps*4 + 2] = j + k - gap;
+                        gaps[num_full_gaps*4 + 3] = gap;
+                        num_full_gaps++;
+                    }
+                    // upper bound
+                    num_gaps += (int) (gap + 1)/(ship_max + 1); 
+                    // shift to the end of gap
+                    j += k-1;
+                }
             }
         }
     }
-    
-    
-
-    //****** check solution; adjust disclosed information, if needed
-    
-    struct sol soln;
-    if (diff == 3) {
-        soln.ship_coord  = snewn(*ns, int*);
-        soln.ship_coord2 = snewn(*ns, int*);
-        soln.ship_coord[0]  = snewn(*ns*3, int);
-        soln.ship_coord2[0] = snewn(*ns*3, int);
-        for (i = 1; i < *ns; i++) {
-            soln.ship_coord[i]  = soln.ship_coord[0]  + i*3;
-            soln.ship_coord2[i] = soln.ship_coord2[0] + i*3;
+    // columns
+    for (j = 0; j < w; j++) {
+        if (
+          cols[j] >= ship_max || 
+          cols[j] == -1 && ships_sum - cols_sum >= ship_max
+        ) {
+            for (i = 0; i < h; i++) {
+                if (grid[i][j] == UNDEF) {
+                    // go up
+                    k = 1;
+                    while (i-k >= 0 && grid[i-k][j] != VACANT) k++;
+                    gap = k;
+                    // go down
+                    k = 1;
+                    while (i+k < h && grid[i+k][j] != VACANT) k++;
+                    gap += k-1;
+                    if (
+                      gap >= ship_max && num_full_gaps < num_ship_max
+                    ) {
+                        gaps[num_full_gaps*4    ] = 1;
+                        gaps[num_full_gaps*4 + 1] = i + k - gap;
+                        gaps[num_full_gaps*4 + 2] = j;
+                        gaps[num_full_gaps*4 + 3] = gap;
+                        num_full_gaps++;
+                    }
+                    num_gaps += (int) (gap + 1)/(ship_max + 1);
+                    i += k-1;
+                }
+            }
         }
     }
     
-    struct game_state_const init_state;
-    init_state.H         = h;
-    init_state.W         = w;
-    init_state.num_ships = *ns;
-    init_state.ships     = *ships;
-    init_state.init      = init;
-    init_state.rows      = rows;
-    init_state.cols      = cols;
-    init_state.ships_sum = num_cells;
-    
-    // array where the resulting configuration from logical solver is written
-    int *grid[h], grid_[h*w];
-    for (i = 0; i < h; i++) {
-        grid[i] = grid_ + i*w;
-    }
-    // variables where the number of occupied/vacant cells found 
-    // by the logical solver is written
-    int occ, vac;
-        
-    bool fast_return = false;
-    int try_before_fast_return = 0;
-    
-    while (true) {
-
-        init_state.rows_sum  = 0;
-        for (i = 0; i < h; i++) {
-            if (rows[i] > -1) init_state.rows_sum += rows[i];
-        } 
-        init_state.cols_sum = 0;
-        for (j = 0; j < w; j++) {
-            if (cols[j] > -1) init_state.cols_sum += cols[j];
+    // fill the gaps (as in a nonogram)
+    STATS_LOGIC_BEGIN(h, w, grid);
+    if (num_gaps == num_ship_max) {
+        for (i = 0; i < num_full_gaps; i++) {
+            k = (gaps[i*4 + 3] + 1) % (ship_max + 1);
+            ships_per_gap = (int) (gaps[i*4 + 3] + 1)/(ship_max + 1);
+            for (j = 0; j < ships_per_gap; j++) {
+                for (l = 0; l < ship_max; l++) {
+                    y = gaps[i*4+1] + gaps[i*4]*(j*(ship_max+1) + l);
+                    x = 
+                      gaps[i*4+2] + (1-gaps[i*4])*(j*(ship_max+1) + l)
+                    ;
+                    if (l >= k && grid[y][x] == UNDEF) 
+                      grid[y][x] = OCCUP
+                    ;
+                }
+            }
         }
-    
-        // check if a unique solution exists 
-        // logical solver
-        log_solve = solve_by_logic(diff, &init_state, grid, &occ, &vac);
-        // for unreasonable level solve with general solver
-        if (diff == 3) solver(&init_state, solver_count_int[diff*2+1], &soln);
-        
-               
-        // unique solution exists, difficulty ok or fast_return = true
-        if (
-          diff <= 1 && log_solve == 0  ||
-          diff == 2 && (log_solve == 1 || log_solve == 0 && fast_return) ||
-          diff == 3 && soln.err == 0 && 
-            (
-              soln.count >= solver_count_int[0] && log_solve == 2 ||
-              fast_return
-            )
-        ) return;
-            
-            
-        // unique solution exists, but too easy: increase difficulty
-        else if (
-          diff == 2 && log_solve == 0 ||
-          diff == 3 && soln.err == 0 && (
-            soln.count < solver_count_int[0] || log_solve < 2
-          )
-        ) {
+    }
+    STATS_LOGIC_END(h, w, grid, 5, 5);
+}
+
+
+/*
+Strategy 6 of solve_by_logic() (complete line solver)
+
+Parameters:
+  *init_state: constant part of game_state;
+  **grid: h x w array of the current configuration, which is updated;
+  *distr_all: array of size ships[0] of the size distribution of all ships;
+  *sc: scratch arena from which the working arrays are taken (they are
+released before returning).
+
+For every row and column, the arrangements of stripes of occupied cells
+that agree with the sum total (if shown), with the known cells of the 
+line and with the neighboring lines are enumerated by dynamic programming 
+(as in a nonogram line solver), and the cells that are occupied, or 
+vacant, in all arrangements are marked. A stripe of two or more cells is 
+a ship lying in the line: its length must be that of one of the ships, 
+its end and inner cells must allow this, and the neighboring cells in 
+the adjacent lines must be free. A single cell is a one-cell ship or part
+of a ship crossing the line. The time per line of length n is 
+O(n^2 * ships[0]).
+
+*/
+static void logic_lines(
+  const struct game_state_const *init_state, enum Configuration **grid, 
+  const int *distr_all, struct scratch *sc
+)
+{
+    int i, j, k, l, p, q;
+    int h = init_state->H, w = init_state->W;
+    int *ships = init_state->ships;
+    int nmax = max(h, w);
+    struct scratch_mark mark = scratch_mark(sc);
+    
+    // cells of the line and of the two adjacent lines (VACANT beyond the
+    // border), with the line as a row: NORTH/SOUTH and WEST/EAST are
+    // swapped for columns; c[n] is a virtual vacant cell
+    int *c  = scratch_newn(sc, nmax + 1, int);
+    int *s1 = scratch_newn(sc, nmax + 1, int);
+    int *s2 = scratch_newn(sc, nmax + 1, int);
+    // can_occ[j], can_vac[j]: cell j is occupied, vacant in some 
+    // arrangement
+    bool *can_occ = scratch_newn(sc, nmax + 1, bool);
+    bool *can_vac = scratch_newn(sc, nmax + 1, bool);
+    // fw[p*(nmax+1) + k]: cells 0 .. p-1 can be arranged with k occupied 
+    // cells and cell p-1 vacant (or p = 0); bw[p*(nmax+1) + k]: cells 
+    // p .. n can be arranged with k occupied cells (cell p-1 vacant)
+    bool *fw = scratch_newn(sc, (nmax + 2)*(nmax + 1), bool);
+    bool *bw = scratch_newn(sc, (nmax + 2)*(nmax + 1), bool);
+    // ok[p*(ships[0]+1) + l]: a stripe of length l can start at cell p
+    bool *ok = scratch_newn(sc, (nmax + 1)*(ships[0] + 1), bool);
+    
+    #define LINE_FW(p, k)  fw[(p)*(nmax + 1) + (k)]
+    #define LINE_BW(p, k)  bw[(p)*(nmax + 1) + (k)]
+    #define LINE_OK(p, l)  ok[(p)*(ships[0] + 1) + (l)]
+    
+    int vert, line, n, sum, t, num_lines;
+    
+    for (vert = 0; vert < 2; vert++) {
+        num_lines = (vert ? w : h);
+        n         = (vert ? h : w);
+        for (line = 0; line < num_lines; line++) {
         
-            change = random_upto(rs, 2);
-                
-            // increase sums_ex by 1
-            if (change == 0 && h + w - sums_ex > 0) {
-                ex = random_upto(rs, h + w - sums_ex);
-                k = 0;
-                for (j = 0; j < h; j++) {
-                     if (rows[j] != -1) {
-                        if (k == ex) {rows[j] = -1; break;}
-                        else k++;
-                    }
+            // read the line
+            sum = (vert ? init_state->cols[line] : init_state->rows[line]);
+            for (j = 0; j < n; j++) {
+                i = (vert ? j : line);
+                k = (vert ? line : j);
+                c[j] = grid[i][k];
+                if (vert) {
+                    s1[j] = (k > 0   ? grid[i][k-1] : VACANT);
+                    s2[j] = (k < w-1 ? grid[i][k+1] : VACANT);
+                    if      (c[j] == NORTH) c[j] = WEST;
+                    else if (c[j] == SOUTH) c[j] = EAST;
+                    else if (c[j] == WEST)  c[j] = NORTH;
+                    else if (c[j] == EAST)  c[j] = SOUTH;
                 }
-                if (k < ex) {
-                    for (j = h; j < h+w; j++) {
-                        if (rows[j-h] != -1) {
-                            if (k == ex) {rows[j-h] = -1; break;}
-                            else k++;
-                        }
-                    }
+                else {
+                    s1[j] = (i > 0   ? grid[i-1][k] : VACANT);
+                    s2[j] = (i < h-1 ? grid[i+1][k] : VACANT);
                 }
-                sums_ex++;
             }
-                
-            // change one element of init to -2
-            else {
-                num_init = ini_cells[0] + ini_cells[1] + ini_cells[2];
-                if (num_init > 0) {
-                    ex = random_upto(rs, num_init);
-                    k = 0;
-                    for (i = 0; i < h*w; i++) {
-                        if ((*init)[i] != UNDEF) {
-                            if (k == ex) {
-                                if ((*init)[i] == VACANT) 
-                                  (ini_cells[0])--
-                                ;
-                                else if ((*init)[i] == OCCUP)
-                                  (ini_cells[1])--
-                                ;
-                                else (ini_cells[2])--;
-                                (*init)[i] = UNDEF;
-                                break;
-                                }
-                                else k++;
+            c[n] = VACANT;
+            
+            // with the sum total hidden, the occupied cells are not counted
+            t = (sum >= 0 ? sum : 0);
+            
+            // stripes that can start at cell p
+            for (p = 0; p < n; p++) {
+                LINE_OK(p, 0) = false;
+                for (l = 1; l <= ships[0]; l++) {
+                    bool fit = (p + l <= n && c[p+l] <= VACANT);
+                    // single cell: one-cell ship or crossing ship
+                    if (fit && l == 1) {
+                        fit = (
+                          c[p] != VACANT && c[p] != WEST && c[p] != EAST && (
+                            distr_all[0] > 0 || 
+                            s1[p] != VACANT || s2[p] != VACANT
+                          )
+                        );
+                    }
+                    // ship lying in the line
+                    else if (fit) {
+                        fit = (distr_all[l-1] > 0);
+                        for (q = p; fit && q < p + l; q++) {
+                            fit = (
+                              (
+                                c[q] == UNDEF || c[q] == OCCUP ||
+                                q == p         && c[q] == WEST  ||
+                                q == p + l - 1 && c[q] == EAST  ||
+                                p < q && q < p + l - 1 && c[q] == INNER
+                              ) && 
+                              s1[q] < 0 && s2[q] < 0
+                            );
                         }
                     }
+                    LINE_OK(p, l) = fit;
                 }
             }
             
-        }
-        
-        
-        // more than one solution (diff == 3): set init = VACANT at one cell, 
-        // which is actually vacant, but the solver yields "occupied"; 
-        // return as soon as soln.count is below the upper limit 
-        // (set fast_return = true)
-        else if (diff == 3 && soln.err == 2) {
-            fast_return = true;
-            
-            // number of "wrong" cells
-            num_wrong = 0;
-            for (k = 0; k < *ns; k++) {
-                for (i = 0; i < (*ships)[k]; i++) {
-                    if (
-                      ship_pos 
-                        [soln.ship_coord[k][1]+i*soln.ship_coord[k][0]] 
-                        [soln.ship_coord[k][2]+i*(1-soln.ship_coord[k][0])] 
-                      == 0
-                      ||
-                      ship_pos 
-                        [soln.ship_coord2[k][1]+i*soln.ship_coord2[k][0]] 
-                        [soln.ship_coord2[k][2]+i*(1-soln.ship_coord2[k][0])] 
-                      == 0
-                    ) num_wrong++;
-                }
+            // forward
+            for (p = 0; p <= n + 1; p++) {
+                for (k = 0; k <= t; k++) LINE_FW(p, k) = false;
             }
-            
-            ex = random_upto(rs, num_wrong);
-            j = 0;
-            flag_break = false;
-            for (k = 0; k < *ns; k++) {
-                for (i = 0; i < (*ships)[k]; i++) {
-                    if (
-                      ship_pos 
-                        [soln.ship_coord[k][1]+i*soln.ship_coord[k][0]] 
-                        [soln.ship_coord[k][2]+i*(1-soln.ship_coord[k][0])] 
-                      == 0
-                      ||
-                      ship_pos 
-                        [soln.ship_coord2[k][1]+i*soln.ship_coord2[k][0]] 
-                        [soln.ship_coord2[k][2]+i*(1-soln.ship_coord2[k][0])] 
-                      == 0
-                    ) {
-                        if (j == ex) {
-                            (ini_cells[0])++;
-                            if (
-                              ship_pos 
-                                [
-                                  soln.ship_coord[k][1]
-                                  +i*soln.ship_coord[k][0]
-                                ] 
-                                [
-                                  soln.ship_coord[k][2]
-                                  +i*(1-soln.ship_coord[k][0])
-                                ] 
-                              == 0
-                            )
-                              init 
-                                [
-                                  soln.ship_coord[k][1]
-                                  +i*soln.ship_coord[k][0]
-                                ] 
-                                [
-                                  soln.ship_coord[k][2]
-                                  +i*(1-soln.ship_coord[k][0])
-                                ] 
-                              = VACANT
-                            ;
-                            else
-                              init 
-                                [
-                                  soln.ship_coord2[k][1]
-                                  +i*soln.ship_coord2[k][0]
-                                ] 
-                                [
-                                  soln.ship_coord2[k][2]
-                                  +i*(1-soln.ship_coord2[k][0])
-                                ] 
-                              = VACANT
-                            ;
-                            flag_break = true;
-                            break;
-                        }
-                        else j++;
+            LINE_FW(0, 0) = true;
+            for (p = 0; p <= n; p++) {
+                for (k = 0; k <= t; k++) {
+                    if (! LINE_FW(p, k)) continue;
+                    if (c[p] <= VACANT) LINE_FW(p + 1, k) = true;
+                    for (l = 1; l <= ships[0] && p < n; l++) {
+                        q = k + (sum >= 0 ? l : 0);
+                        if (LINE_OK(p, l) && q <= t) LINE_FW(p + l + 1, q) = true;
                     }
                 }
-                if (flag_break) break;
-            }            
-        }
-        
-        
-        // no solution found or too difficult:
-        // decrease difficulty, return as soon as not too difficult 
-        // (set fast_return = true) 
-        else {
-            try_before_fast_return++;
-            if (try_before_fast_return > 0) fast_return = true;
-            
-            change = random_upto(rs, 5);
+            }
+            if (! LINE_FW(n + 1, t)) continue; // contradiction, no deduction
             
-            // decrease sums_ex by 1
-            if (change == 0 && sums_ex > 0) {
-                ex = random_upto(rs, sums_ex);
-                k = 0;
-                for (j = 0; j < h; j++) {
-                    if (rows[j] == -1) {
-                        if (k == ex) {rows[j] = rows0[j]; break;}
-                        k++;
+            // backward
+            for (p = 0; p <= n + 1; p++) {
+                for (k = 0; k <= t; k++) LINE_BW(p, k) = false;
+            }
+            LINE_BW(n + 1, 0) = true;
+            for (p = n; p >= 0; p--) {
+                for (k = 0; k <= t; k++) {
+                    if (c[p] <= VACANT && LINE_BW(p + 1, k)) {
+                        LINE_BW(p, k) = true;
+                        continue;
                     }
-                }
-                if (k < ex) {
-                    for (j = h; j < h+w; j++) {
-                        if (cols[j-h] == -1) {
-                            if (k == ex) {cols[j-h] = cols0[j-h]; break;}
-                            k++;
+                    for (l = 1; l <= ships[0] && p < n; l++) {
+                        q = k - (sum >= 0 ? l : 0);
+                        if (
+                          LINE_OK(p, l) && q >= 0 && LINE_BW(p + l + 1, q)
+                        ) {
+                            LINE_BW(p, k) = true;
+                            break;
                         }
                     }
                 }
-                sums_ex--;
             }
             
-            // change one element of init from UNDEF to VACANT;
-            // in case of logical solution change elements not found by solver
-            else if (change < 4) {
-                if (diff <= 2) num_init = h*w - num_cells - vac;
-                else           num_init = h*w - num_cells - ini_cells[0];
-                k = 0;
-                if (num_init > 0) {
-                    ex = random_upto(rs, num_init);
-                    flag_break = false;
-                    for (i = 0; i < h; i++) {
-                        for (j = 0; j < w; j++) {
-                            if (
-                              (  diff <= 2 && grid[i][j] == UNDEF || 
-                                 diff == 3 && init[i][j] == UNDEF   ) &&
-                              ! ship_pos[i][j]
-                            ) {
-                                if (k == ex) {
-                                    init[i][j] = VACANT; 
-                                    flag_break = true;
-                                    (ini_cells[0])++;
-                                    break;
-                                }
-                                k++;
-                            }
+            // cells used by the arrangements that reach the end
+            for (j = 0; j < n; j++) can_occ[j] = can_vac[j] = false;
+            for (p = 0; p <= n; p++) {
+                for (k = 0; k <= t; k++) {
+                    if (! LINE_FW(p, k)) continue;
+                    if (c[p] <= VACANT && LINE_BW(p + 1, t - k)) 
+                      can_vac[p] = true
+                    ;
+                    for (l = 1; l <= ships[0] && p < n; l++) {
+                        q = k + (sum >= 0 ? l : 0);
+                        if (
+                          LINE_OK(p, l) && q <= t && 
+                          LINE_BW(p + l + 1, t - q)
+                        ) {
+                            for (j = p; j < p + l; j++) can_occ[j] = true;
+                            can_vac[p + l] = true;
                         }
-                        if (flag_break) break;
                     }
                 }
             }
             
-            // change one element of init from UNDEF to 1 .. 6
-            else {
-                if (diff <= 2) num_init = num_cells - occ;
-                else      num_init = num_cells - ini_cells[1] - ini_cells[2];
-                if (num_init > 0) {
-                    ex = random_upto(rs, num_init);
-                    j = 0;
-                    flag_break = false;
-                    for (k = 0; k < *ns; k++) {
-                        for (i = 0; i < (*ships)[k]; i++) {
-                            if (
-                              diff <= 2 &&
-                              grid 
-                                [ship_coord[k][1]+i*ship_coord[k][0]] 
-                                [ship_coord[k][2]+i*(1-ship_coord[k][0])] 
-                              == UNDEF ||
-                              diff == 3 &&
-                              init 
-                                [ship_coord[k][1]+i*ship_coord[k][0]] 
-                                [ship_coord[k][2]+i*(1-ship_coord[k][0])] 
-                              == UNDEF
-                            ) {
-                                if (j == ex) {
-                                    if ((*ships)[k] == 1)
-                                      init 
-                                        [ship_coord[k][1]] 
-                                        [ship_coord[k][2]] 
-                                      = ONE
-                                    ;
-                                    else if (0 < i && i < (*ships)[k] - 1)
-                                      init 
-                                        [ship_coord[k][1]+i*ship_coord[k][0]] 
-                                        [
-                                          ship_coord[k][2]+
-                                          i*(1-ship_coord[k][0])
-                                        ] 
-                                      = INNER
-                                    ;
-                                    else if (i == 0 && ship_coord[k][0])
-                                      init 
-                                        [ship_coord[k][1]+i*ship_coord[k][0]] 
-                                        [
-                                          ship_coord[k][2]+
-                                          i*(1-ship_coord[k][0])
-                                        ] 
-                                      = NORTH
-                                    ;
-                                    else if (i == 0 && ! ship_coord[k][0])
-                                      init 
-                                        [ship_coord[k][1]+i*ship_coord[k][0]] 
-                                        [
-                                          ship_coord[k][2]+
-                                          i*(1-ship_coord[k][0])
-                                        ] 
-                                      = WEST
-                                    ;
-                                    else if (
-                                      i == (*ships)[k]-1 && ship_coord[k][0]
-                                    )
-                                      init 
-                                        [ship_coord[k][1]+i*ship_coord[k][0]] 
-                                        [
-                                          ship_coord[k][2]+
-                                          i*(1-ship_coord[k][0])
-                                        ] 
-                                      = SOUTH
-                                    ;
-                                    else if (
-                                      i == (*ships)[k]-1 && ! ship_coord[k][0]
-                                    )
-                                      init 
-                                        [ship_coord[k][1]+i*ship_coord[k][0]] 
-                                        [
-                                          ship_coord[k][2]+
-                                          i*(1-ship_coord[k][0])
-                                        ] 
-                                      = EAST
-                                    ;
-                                    flag_break = true;
-                                    break;
-                                }
-                                else j++;
-                            }
-                        }
-                        if (flag_break) break;
-                    }
-                    (ini_cells[2])++;
-                }
-                // escape in the improbable case that all ship cells 
-                // are specified 1 .. 6
-                else return;
+            // mark the cells that agree in all arrangements
+            for (j = 0; j < n; j++) {
+                i = (vert ? j : line);
+                k = (vert ? line : j);
+                if (grid[i][k] != UNDEF) continue;
+                if      (! can_occ[j]) grid[i][k] = VACANT;
+                else if (! can_vac[j]) grid[i][k] = OCCUP;
             }
         }
-        
     }
     
-    if (diff == 3) {
-        sfree(soln.ship_coord[0]);
-        sfree(soln.ship_coord2[0]);
-        sfree(soln.ship_coord);
-        sfree(soln.ship_coord2);
-    }
+    #undef LINE_FW
+    #undef LINE_BW
+    #undef LINE_OK
+    
+    scratch_reset(sc, mark);
 }
 
 
-/* 
-Recursive procedure for the function generator_diff() to generate a random
-configuration of the ships.
+/*
+Strategy 7 of solve_by_logic() (census of the unfinished ships)
 
 Parameters:
-  ship_num: current ship number 0, ..., ns-1 (ns = number of ships);
-  *params: game parameters;
-  *ships: array of ship sizes;
-  *num_ships: number of ships;
-  ***blocked: 3D array which consists of H x W layers of positions blocked by
-the 1st, 2nd, ... ships (H = height, W= width);
-  *rs: random state;
-  **ship_coord: ns x 3 temporary array of ship coordinates (vert, y, x) 
-per ship;
-  *count: number of times the recursive function place_ship_rng() is called;
-  count_lim: maximum number of times the recursive function place_ship_rng()
-can be called, before the attempt is interrupted and an error returned; set 
-to a value of 0 or less if no limit is desired.
+  *init_state: constant part of game_state;
+  **grid: h x w array of the current configuration, which is updated;
+  *distr_all: array of size ships[0] of the size distribution of all ships;
+  *distr_compl: array of size ships[0] where the size distribution of 
+the completed ships is saved (see compl_ships_distr());
+  *alive: array of size 2*ships[0]*H*W of the placements of a ship that 
+are still possible, index ((length-1)*2 + vert)*H*W + y*W + x for a ship
+with the upper left cell (y, x); set to true by the caller before the 
+first call, the placements ruled out are cleared, so that the subsequent
+calls only examine the remaining ones;
+  *sc: scratch arena from which the working arrays are taken (they are
+released before returning).
+
+For every length, the placements of a ship which agree with the known 
+cells, with the sum totals and with the halo of the occupied cells are 
+counted against the number of unfinished ships of this length. The cells
+covered by all placements are occupied, the cells next to all placements
+are vacant; if there are exactly as many placements as unfinished ships,
+all of them are used. Cells not covered by any placement of an unfinished
+ship are vacant. As the grid only gains information, a placement once
+ruled out remains so, and the census is maintained incrementally across 
+the calls.
 
-The function returns an error value true/false.
-  
 */
-static bool place_ship_rng(
-  int ship_num, const game_params *params, int *ships, int *num_ships, 
-  bool ***blocked, random_state *rs, int **ship_coord, int *count, 
-  int count_lim
-) 
+static void logic_census(
+  const struct game_state_const *init_state, enum Configuration **grid, 
+  const int *distr_all, int *distr_compl, bool *alive, struct scratch *sc
+)
 {
-    (*count)++;
-    if (0 < count_lim && count_lim < *count) return true;
-
-    int h = params->H, w = params->W, ns = *num_ships;
-    int ship = ships[ship_num];
-    int num_pos, pos, vert, y, x, i, j, k, ship_H, ship_W;
-    bool err, brk;
-    
-    // number of positions for horizontal and vertical orientation
-    // (double count for ship length 1 does not lead to an error)
-    num_pos = h*(w - ship + 1) + (h - ship + 1)*w;
-    
-    while (true) {
-    
-        // generate position
-        pos = random_upto(rs, num_pos);
-        
-        // horizontal
-        if (pos < h*(w - ship + 1)) {
-            vert = 0;
-            y = (int) (pos/(w - ship + 1));
-            x = pos - y*(w - ship + 1);
-        }
-        // vertical
-        else {
-            pos = pos - h*(w - ship + 1);
-            vert = 1;
-            y = (int) (pos/w);
-            x = pos - y*w;
+    int i, j, k, l, y, x, y1, x1, vert, und, num, rem;
+    int h = init_state->H, w = init_state->W;
+    int *ships = init_state->ships;
+    int **init = init_state->init;
+    int *rows = init_state->rows, *cols = init_state->cols;
+    bool fit, full;
+    struct scratch_mark mark = scratch_mark(sc);
+    
+    // occupied cells per row and column; per cell, number of placements
+    // of the current length covering it or next to it; cells covered by 
+    // a placement of any unfinished ship
+    int *occ_rows = scratch_newn(sc, h, int);
+    int *occ_cols = scratch_newn(sc, w, int);
+    int *cover = scratch_newn(sc, h*w, int);
+    int *halo = scratch_newn(sc, h*w, int);
+    bool *any = scratch_newn(sc, h*w, bool);
+    
+    // specify the type of occupied cells
+    render_grid_conf(h, w, grid, init, false);
+    compl_ships_distr(h, w, grid, ships[0], distr_compl);
+    
+    for (i = 0; i < h; i++) occ_rows[i] = 0;
+    for (j = 0; j < w; j++) occ_cols[j] = 0;
+    for (i = 0; i < h; i++) {for (j = 0; j < w; j++) {
+        if (grid[i][j] >= 0) {
+            occ_rows[i]++;
+            occ_cols[j]++;
         }
-    
-        // ship dimensions
-        ship_H = vert*ship + 1 - vert;
-        ship_W = (1 - vert)*ship + vert;
+        any[i*w + j] = false;
+    }}
+    
+    STATS_LOGIC_BEGIN(h, w, grid);
+    for (l = ships[0]; l >= 1; l--) {
+        rem = distr_all[l-1] - distr_compl[l-1];
+        for (i = 0; i < h*w; i++) cover[i] = halo[i] = 0;
+        num = 0;
         
-        // check that cells not blocked 
-        brk = false;
-        for (k = 0; k < ship_num; k++) {
-            for (i = 0; i < ship_H; i++) {
-                for (j = 0; j < ship_W; j++) {
-                    if (blocked[k][y+i][x+j]) {brk = true; break;}
+        for (vert = 0; vert < (l > 1 ? 2 : 1); vert++) {
+            bool *al = alive + ((l-1)*2 + vert)*h*w;
+            for (y = 0; y < h; y++) {for (x = 0; x < w; x++) {
+                if (! al[y*w + x]) continue;
+                
+                // within the grid, no more ships of this length
+                fit = (
+                  rem > 0 && 
+                  (vert ? y + l <= h : x + l <= w)
+                );
+                
+                // cells of the ship: not vacant, shape along the axis;
+                // full: a completed ship (counted in distr_compl)
+                und = 0;
+                full = true;
+                for (k = 0; fit && k < l; k++) {
+                    y1 = y + vert*k;
+                    x1 = x + (1-vert)*k;
+                    int c = grid[y1][x1];
+                    if (c == UNDEF) und++;
+                    if (l == 1) {
+                        fit = (c == UNDEF || c == OCCUP || c == ONE);
+                        full = (c == ONE);
+                    }
+                    else if (k == 0) {
+                        fit = (
+                          c == UNDEF || c == OCCUP || 
+                          c == (vert ? NORTH : WEST)
+                        );
+                        full = full && (c == (vert ? NORTH : WEST));
+                    }
+                    else if (k == l-1) {
+                        fit = (
+                          c == UNDEF || c == OCCUP || 
+                          c == (vert ? SOUTH : EAST)
+                        );
+                        full = full && (c == (vert ? SOUTH : EAST));
+                    }
+                    else {
+                        fit = (c == UNDEF || c == OCCUP || c == INNER);
+                        full = full && (c == INNER);
+                    }
+                    // sum total of the line crossing the ship
+                    if (fit && c == UNDEF && vert) {
+                        fit = (rows[y1] < 0 || occ_rows[y1] < rows[y1]);
+                    }
+                    else if (fit && c == UNDEF) {
+                        fit = (cols[x1] < 0 || occ_cols[x1] < cols[x1]);
+                    }
                 }
-                if (brk) break;
-            }
-            if (brk) break;
-        }
-        if (brk) return true;
-        
-        // not last ship
-        if (ship_num < ns - 1) {
-                        
-            // block cells of and around the ship
-            for (i = max(y-1, 0); i < min(y + ship_H + 1, h); i++) {
-                for (j = max(x-1, 0); j < min(x + ship_W + 1, w); j++) {
-                    blocked[ship_num][i][j] = 1;
+                fit = fit && ! full;
+                
+                // sum total of the line along the ship
+                if (fit && vert) {
+                    fit = (cols[x] < 0 || occ_cols[x] + und <= cols[x]);
                 }
-            }
-           
-            //recursive call
-            err = place_ship_rng(
-              ship_num + 1, params, ships, num_ships, blocked, rs, ship_coord, 
-              count, count_lim
-            );
-
-            // if next ship could not be placed, replace current ship
-            // and unblock or return error if count_lim exceeded
-            if (err) {
-                if (count_lim <= 0 || *count <= count_lim) {
-                    for (i = 0; i < h*w; i++)  (*(blocked[ship_num]))[i] = 0;
+                else if (fit) {
+                    fit = (rows[y] < 0 || occ_rows[y] + und <= rows[y]);
                 }
-                else return true;
-            }
-            // record current position and return
-            else {
-                ship_coord[ship_num][0] = vert;
-                ship_coord[ship_num][1] = y;
-                ship_coord[ship_num][2] = x;
-                return false;
-            }
+                
+                // halo: no occupied cells next to the ship
+                for (y1 = y-1; fit && y1 <= y + (vert ? l : 1); y1++) {
+                    for (x1 = x-1; fit && x1 <= x + (vert ? 1 : l); x1++) {
+                        if (
+                          y1 < 0 || y1 >= h || x1 < 0 || x1 >= w ||
+                          vert  && x1 == x && y1 >= y && y1 < y+l ||
+                          ! vert && y1 == y && x1 >= x && x1 < x+l
+                        ) continue;
+                        fit = (grid[y1][x1] < 0);
+                    }
+                }
+                
+                if (! fit) {
+                    al[y*w + x] = false;
+                    continue;
+                }
+                
+                // count the placement
+                num++;
+                for (y1 = y-1; y1 <= y + (vert ? l : 1); y1++) {
+                    for (x1 = x-1; x1 <= x + (vert ? 1 : l); x1++) {
+                        if (y1 < 0 || y1 >= h || x1 < 0 || x1 >= w) continue;
+                        if (
+                          vert  && x1 == x && y1 >= y && y1 < y+l ||
+                          ! vert && y1 == y && x1 >= x && x1 < x+l
+                        ) cover[y1*w + x1]++;
+                        else halo[y1*w + x1]++;
+                    }
+                }
+            }}
         }
         
-        // last ship 
-        else {
-            ship_coord[ship_num][0] = vert;
-            ship_coord[ship_num][1] = y;
-            ship_coord[ship_num][2] = x;
-            return false;
-        }
+        if (rem == 0) continue;
+        // fewer placements than ships: contradiction, no further deduction
+        if (num < rem) break;
         
-    }
+        for (i = 0; i < h*w; i++) {
+            if (cover[i] > 0) any[i] = true;
+            if ((*grid)[i] != UNDEF) continue;
+            if (cover[i] == num || num == rem && cover[i] > 0) {
+                (*grid)[i] = OCCUP;
+            }
+            else if (halo[i] == num || num == rem && halo[i] > 0) {
+                (*grid)[i] = VACANT;
+            }
+        }
+    }
+    
+    // cells which no unfinished ship can cover
+    for (i = 0; l == 0 && i < h*w; i++) {
+        if ((*grid)[i] == UNDEF && ! any[i]) (*grid)[i] = VACANT;
+    }
+    STATS_LOGIC_END(h, w, grid, 7, 7);
+    
+    scratch_reset(sc, mark);
+}
+
+
+
+/*
+Where possible, change cell state OCCUP to a specific state 1 to 6, and back.
+
+Parameters:
+  h, w: height, width of the grid;
+  **grid: 2D array of size H x W of grid configuration;
+  **init: 2D array of size H x W of initial grid configuration 
+(disregarded if remove == false);
+  remove: if true, the value of the cell will be set back to OCCUP, if not
+uniquely defined and not fixed by the init array; if false, the value 
+can only be promoted from OCCUP to 1..6.
+
+*/
+static void render_grid_conf(
+  int h, int w, enum Configuration **grid, enum Configuration **init, 
+  bool remove
+)
+{
+    int i, j;
+    enum Configuration **g = grid;
+
+    for (i = 0; i < h; i++) {
+        for (j = 0; j < w; j++) {
+            if (g[i][j] == OCCUP) {
+            
+                // set OCCUP to 1..6
+                if (
+                  (i == 0 || g[i-1][j] == VACANT) && i < h-1 && g[i+1][j] >= 0
+                ) g[i][j] = NORTH;
+                
+                else if (
+                  (i == h-1 || g[i+1][j] == VACANT) && i > 0 && g[i-1][j] >= 0
+                ) g[i][j] = SOUTH;
+                
+                else if (
+                  (j == 0 || g[i][j-1] == VACANT) && j < w-1 && g[i][j+1] >= 0
+                ) g[i][j] = WEST;
+                
+                else if (
+                  (j == w-1 || g[i][j+1] == VACANT) && j > 0 && g[i][j-1] >= 0
+                ) g[i][j] = EAST;              
+                
+                else if (
+                  (i == 0   || g[i-1][j] == VACANT) && 
+                  (i == h-1 || g[i+1][j] == VACANT) &&
+                  (j == 0   || g[i][j-1] == VACANT) &&
+                  (j == w-1 || g[i][j+1] == VACANT) 
+                ) g[i][j] = ONE;              
+                
+                else if (
+                  i > 0 && g[i-1][j] >= 0 && i < h-1 && g[i+1][j] >= 0 ||
+                  j > 0 && g[i][j-1] >= 0 && j < w-1 && g[i][j+1] >= 0
+                ) g[i][j] = INNER;   
+                         
+            }
+           
+            
+            // set back to OCCUP
+            else if (remove && g[i][j] > 0 && init[i][j] <= 0 && 
+              (
+                g[i][j] == NORTH && 
+                (i > 0 && g[i-1][j] != VACANT || i == h-1 || g[i+1][j] < 0)
+                ||
+                g[i][j] == SOUTH && 
+                (i < h-1 && g[i+1][j] != VACANT || i == 0 || g[i-1][j] < 0)
+                || 
+                g[i][j] == WEST && 
+                (j > 0 && g[i][j-1] != VACANT || j == w-1 || g[i][j+1] < 0)
+                ||
+                g[i][j] == EAST && 
+                (j < w-1 && g[i][j+1] != VACANT || j == 0 || g[i][j-1] < 0)
+                ||
+                g[i][j] == ONE && ! (
+                  (i == 0   || g[i-1][j] == VACANT) &&
+                  (i == h-1 || g[i+1][j] == VACANT) &&
+                  (j == 0   || g[i][j-1] == VACANT) &&
+                  (j == w-1 || g[i][j+1] == VACANT) 
+                )
+                ||
+                g[i][j] == INNER && ! (
+                  i > 0 && g[i-1][j] >= 0 && i < h-1 && g[i+1][j] >= 0 ||
+                  j > 0 && g[i][j-1] >= 0 && j < w-1 && g[i][j+1] >= 0
+                )
+              )
+            ) g[i][j] = OCCUP;
+           
+        }
+    }
+    
+    
+}
+
+
+
+/*
+Search for completed ships and determine their size distribution.
+
+Parameters:
+  h, w: height, width of the grid;
+  **grid: 2D array of size H x W of grid configuration;
+  max_size: the largest ship searched for (given by ships[0], the 0th element
+of the array of ship lengths); larger completed ships will be ignored;
+  *distr: array of size max_size of size distribution; in distr[i] the
+number of completed ships of length i+1 will be saved.
+
+The function returns "true" (error) if max_size is exceeded, otherwise 
+"false".
+
+*/
+static bool compl_ships_distr(
+  int h, int w, int **grid, int max_size, int *distr
+)
+{
+    int i, j, k;
+    bool err = false;
+    int **g = grid;
+    
+    for (k = 0; k < max_size; k++) distr[k] = 0;
+    
+    // determine completed ships that start with NORTH
+    // or WEST and end with SOUTH or EAST, also ONE-ships
+    for (i = 0; i < h; i++) {
+        for (j = 0; j < w; j++) {
+        
+            if (i < h-1 && g[i][j] == NORTH) {
+                k = 0;
+                do {k++;} 
+                  while (i+k < h-1 && g[i+k][j] == INNER && k < max_size-1)
+                ; 
+                if (g[i+k][j] == SOUTH) (distr[k])++;
+                else if (g[i+k][j] == INNER) err = true;
+            }
+            
+            else if (j < w-1 && g[i][j] == WEST) {
+                k = 0;
+                do {k++;} 
+                  while (j+k < w-1 && g[i][j+k] == INNER && k < max_size-1)
+                ; 
+                if (g[i][j+k] == EAST) (distr[k])++;
+                else if (g[i][j+k] == INNER) err = true;
+            }
+            
+            else if (g[i][j] == ONE) (distr[0])++;
+            
+        }
+    }
+    
+    return err;
+}
+
+
+
+/*
+Determine the amounts of clues of a puzzle
+
+Parameters:
+  diff: difficulty level;
+  h, w: height, width of the grid;
+  num_cells: number of ship cells;
+  *rs: random state;
+  *ini_cells: array of size 3 where the numbers of initially disclosed 
+cells of the type VACANT, OCCUP and (1..6) will be saved.
+
+Returns the number of hidden row and column sums.
+
+*/
+static int clue_amounts(
+  int diff, int h, int w, int num_cells, random_state *rs, int *ini_cells
+)
+{
+    int sums_ex, type_12, type_1;
+
+    // specify parameters according to difficulty
+    switch (diff) {
+        case BASIC:
+            sums_ex = 0;
+            // no cells of type OCCUP disclosed; number of disclosed cells 
+            // of type VACANT determined as a proportion of empty cells; 
+            // number of disclosed cells of type (1..6) determined 
+            // as a proportion of filled cells
+            ini_cells[0] = ROUND_FRAC(h*w - num_cells, 1, 5);
+            ini_cells[1] = 0;
+            ini_cells[2] = ROUND_FRAC(num_cells, 3, 5);
+            break;
+        case INTERMEDIATE:
+            sums_ex = 0;
+            ini_cells[0] = ROUND_FRAC(h*w - num_cells, 1, 10);
+            // count types 0 and (1..6) together with type 0 half-weighted
+            type_12 = ROUND_FRAC(num_cells, 3, 10);
+            type_1 = random_upto(rs, ROUND_FRAC(num_cells, 1, 5));
+            ini_cells[1] = type_1*2;
+            ini_cells[2] = type_12 - type_1;
+            break;
+        case ADVANCED:
+            sums_ex = ROUND_FRAC(h + w, 1, 10) + random_upto(rs, 2);
+            ini_cells[0] = ROUND_FRAC(h*w - num_cells, 1, 20);
+            type_12 = ROUND_FRAC(num_cells, 1, 5);
+            type_1 = random_upto(rs, type_12); // 0, ..., type_12 - 1
+            ini_cells[1] = type_1*2; 
+            ini_cells[2] = type_12 - type_1;
+            break;
+        case UNREASONABLE:
+            sums_ex = ROUND_FRAC(h + w, 1, 5) + random_upto(rs, 3);
+            ini_cells[0] = 0; // no cells of type -1
+            type_12 = ROUND_FRAC(num_cells, 3, 20);
+            type_1 = random_upto(rs, type_12 + 1); // 0, ..., type_12
+            ini_cells[1] = type_1;  // not multiplied by 2
+            ini_cells[2] = type_12 - type_1;
+    }
+    ini_cells[0] = min(ini_cells[0], h*w - num_cells);
+    if (ini_cells[1] + ini_cells[2] > num_cells) {
+        ini_cells[1] = 0; ini_cells[2] = num_cells;
+    }
+    
+    return sums_ex;
+}
+
+
+/*
+Move a random selection of candidates to the front of an array.
+
+Parameters:
+  *cand: array of size num of the candidates, which is reordered;
+  num: number of candidates;
+  *rs: random state.
+
+Returns the number of candidates selected, min(num, CLUE_CANDIDATES).
+
+*/
+static int clue_sample(int *cand, int num, random_state *rs)
+{
+    int i, k, tmp;
+    int m = min(num, CLUE_CANDIDATES);
+    
+    // partial Fisher-Yates shuffle
+    for (i = 0; i < m; i++) {
+        k = i + random_upto(rs, num - i);
+        tmp = cand[i]; cand[i] = cand[k]; cand[k] = tmp;
+    }
+    return m;
+}
+
+
+/*
+Shuffle candidate cells, putting those first which tell something new
+
+Parameters:
+  *cand: array of size num of the cells y*W + x, which is reordered;
+  num: number of cells;
+  **grid: H x W array of the cells which follow from the clues (see 
+solver_init());
+  *init_state: constant part of game_state (H, W, rows, cols are used);
+  *rs: random state.
+
+A cell tells something new if it is undecided in grid and neither the 
+sum of its row nor that of its column is 0.
+
+*/
+static void clue_shuffle(
+  int *cand, int num, enum Configuration **grid, 
+  const struct game_state_const *init_state, random_state *rs
+)
+{
+    int i, k, y, x, tmp;
+    int w = init_state->W;
+    
+    shuffle(cand, num, sizeof(*cand), rs);
+    k = 0;
+    for (i = 0; i < num; i++) {
+        y = cand[i]/w;
+        x = cand[i] - y*w;
+        if (
+          grid[y][x] == UNDEF && 
+          init_state->rows[y] != 0 && init_state->cols[x] != 0
+        ) {
+            tmp = cand[i]; cand[i] = cand[k]; cand[k++] = tmp;
+        }
+    }
+}
+
+
+/*
+Add clues to a puzzle up to the amounts of an easier difficulty level
+
+Parameters:
+  diff: the easier difficulty level;
+  *init_state: constant part of game_state with the clues (init, rows, 
+cols), which are updated;
+  **layout: H x W array of the solution (VACANT or the shape of the ship
+cell);
+  *rows0, *cols0: arrays of size H, W of all row and column sums;
+  *ini_cells: array of size 3 of the numbers of disclosed cells of the 
+type VACANT, OCCUP and (1..6), updated;
+  *sums_ex: number of hidden sums, updated;
+  *cand: array of size H*W (working array);
+  **grid: H x W working array;
+  *rs: random state.
+
+Hidden sums are shown at random, and if the easier level has no cells of
+type OCCUP, the disclosed ones are given their shapes. Then vacant and 
+ship cells are disclosed, preferring those which tell something new (see
+clue_shuffle()), until the amounts given by clue_amounts() are reached. 
+Clues are only added, so that the puzzle keeps its unique solution.
+
+*/
+static void clue_topup(
+  int diff, const struct game_state_const *init_state, 
+  enum Configuration **layout, const int *rows0, const int *cols0, 
+  int *ini_cells, int *sums_ex, int *cand, enum Configuration **grid, 
+  random_state *rs
+)
+{
+    int i, j, k, ex, num, ini_max[3];
+    int h = init_state->H, w = init_state->W;
+    int **init = init_state->init;
+    int *rows = init_state->rows, *cols = init_state->cols;
+    int sums_max = 
+      clue_amounts(diff, h, w, init_state->ships_sum, rs, ini_max)
+    ;
+    
+    // show hidden sums
+    while (*sums_ex > sums_max) {
+        ex = random_upto(rs, *sums_ex);
+        for (j = 0; j < h+w; j++) {
+            if ((j < h ? rows[j] : cols[j-h]) == -1 && ex-- == 0) break;
+        }
+        if (j < h) rows[j] = rows0[j];
+        else       cols[j-h] = cols0[j-h];
+        (*sums_ex)--;
+    }
+    
+    // shapes of the occupied cells
+    for (i = 0; ini_max[1] == 0 && i < h*w; i++) {
+        if ((*init)[i] == OCCUP) {
+            (*init)[i] = (*layout)[i];
+            ini_cells[1]--;
+            ini_cells[2]++;
+        }
+    }
+    
+    // vacant cells (k = 0), ship cells (k = 1)
+    memcpy(*grid, *init, sizeof(**init)*h*w);
+    solver_init(h, w, grid);
+    for (k = 0; k < 2; k++) {
+        num = 0;
+        for (i = 0; i < h*w; i++) {
+            if ((*init)[i] == UNDEF && ((*layout)[i] >= 0) == k) {
+                cand[num++] = i;
+            }
+        }
+        clue_shuffle(cand, num, grid, init_state, rs);
+        for (
+          i = 0; 
+          i < num && (
+            k == 0 ? 
+            ini_cells[0] < ini_max[0] : 
+            ini_cells[1] + ini_cells[2] < ini_max[1] + ini_max[2]
+          ); 
+          i++
+        ) {
+            (*init)[cand[i]] = (*layout)[cand[i]];
+            (ini_cells[2*k])++;
+        }
+    }
+}
+
+
+/*
+Change a clue of a puzzle
+
+Parameters:
+  *init_state: constant part of game_state, whose init, rows or cols 
+(and rows_sum, cols_sum) are updated;
+  pos: y*W + x for the cell (y, x) of init, H*W + i for the sum of row i,
+H*W + H + j for the sum of column j;
+  val: new value.
+
+Returns the previous value.
+
+*/
+static int clue_apply(struct game_state_const *init_state, int pos, int val)
+{
+    int h = init_state->H, w = init_state->W;
+    int old, *p, *sum;
+    
+    if (pos < h*w) {
+        p = *init_state->init + pos;
+        sum = NULL;
+    }
+    else if (pos < h*w + h) {
+        p = init_state->rows + pos - h*w;
+        sum = &init_state->rows_sum;
+    }
+    else {
+        p = init_state->cols + pos - h*w - h;
+        sum = &init_state->cols_sum;
+    }
+    
+    old = *p;
+    *p = val;
+    if (sum) *sum += max(val, 0) - max(old, 0);
+    return old;
+}
+
+
+/*
+Choose the most useful of several candidate changes of the clues.
+
+Parameters:
+  diff: difficulty level;
+  *init_state: constant part of game_state with the current clues; each 
+candidate is applied to init, rows or cols in turn and undone again, so 
+that the clues are unchanged on return;
+  *pos: array of size num of the candidates: y*W + x for the cell (y, x)
+of init, H*W + i for the sum of row i, H*W + H + j for the sum of 
+column j;
+  *val: array of size num of the values which the candidates would set;
+  num: number of candidates (at least 1);
+  harder: true if the puzzle is to be made more difficult, false if 
+easier;
+  **grid: h x w array used by solve_by_logic() (overwritten);
+  *sc: scratch arena passed to solve_by_logic().
+
+Each candidate is scored by the logical solver: a change after which 
+solve_by_logic() gives the result wanted at the difficulty level comes 
+first; otherwise, the more (harder) or the fewer (easier) cells the 
+solver leaves undecided, the better. Ties go to the earlier candidate, 
+so the order of *pos (random) decides.
+
+Returns the index of the chosen candidate.
+
+*/
+static int clue_select(
+  int diff, struct game_state_const *init_state, const int *pos, 
+  const int *val, int num, bool harder, enum Configuration **grid, 
+  struct scratch *sc
+)
+{
+    int i, log_solve, occ, vac, old, score, best = 0, best_score = 0;
+    int h = init_state->H, w = init_state->W;
+    // result of solve_by_logic() for a puzzle of the difficulty level
+    int target = (diff <= 1 ? 0 : diff == 2 ? 1 : 2);
+    
+    if (num == 1) return 0;
+    
+    for (i = 0; i < num; i++) {
+        old = clue_apply(init_state, pos[i], val[i]);
+        log_solve = solve_by_logic(diff, init_state, grid, &occ, &vac, sc);
+        clue_apply(init_state, pos[i], old);
+        
+        score = 
+          (log_solve == target ? h*w + 1 : 0) + 
+          (harder ? h*w - occ - vac : occ + vac)
+        ;
+        if (i == 0 || score > best_score) {
+            best = i;
+            best_score = score;
+        }
+    }
+    
+    return best;
+}
+
+
+
+/*
+Feasibility check of a fleet for the generator
+
+Parameters:
+  h, w: height, width of the grid;
+  ns: number of ships;
+  *ships: array of ship sizes.
+
+If each ship of size s is widened to an (s + 1) x 2 rectangle reaching 
+one cell further down and to the right (or 2 x (s + 1) if vertical), 
+ships which do not touch each other, not even diagonally, give disjoint 
+rectangles within an (h + 1) x (w + 1) grid. The share of this grid 
+covered by the rectangles, the fill, is thus at most 100 percent for any 
+layout. How often place_ship_rng() finds a layout within its limit 
+of calls depends on the fill and on the number of ships: up to a fill 
+of FLEET_FILL - 2.5*ns percent, at least about one attempt in eight 
+succeeds.
+
+Returns true if the fill is within this bound.
+
+*/
+static bool fleet_fits(int h, int w, int ns, const int *ships)
+{
+    int k, area = 0;
+    for (k = 0; k < ns; k++) area += 2*(ships[k] + 1);
+    return 200*area <= (2*FLEET_FILL - 5*ns)*(h + 1)*(w + 1);
+}
+
+
+/*
+Fleet for the generator
+
+Parameters:
+  *params: game parameters;
+  diff_fleet: difficulty level whose rules determine the ships;
+  *rs: random state;
+  *num_ships: pointer under which the number of ships will be saved.
+
+The base fleet scales with the shorter side of the grid: the sizes up to 
+3/5 of it are divided into 4 groups, and 2 sizes are picked from each 
+group (NUM_SHIPS_BASE - 1 or NUM_SHIPS_BASE ships; if one less, one size 
+from the lowest group). If the shorter side is 7, the base fleet is 4, 4,
+3, 3, 2, 2, 2 instead (the fleet of layout7_sample()).
+
+Toward FLEET_DENSITY percent of ship cells, the base fleet is then 
+stretched in proportion, each size capped at the shorter side. The 
+number of ships is kept, since the cost of the general solver, and hence 
+of UNREASONABLE puzzles, grows steeply with it. Only if the cap leaves 
+the fleet short of the target (narrow grids) are ships added, and only 
+as long as the fleet passes fleet_fits(). The base fleet is not checked:
+if no layout of it is found, generator_diff() drops ships as before, so 
+that grids at or above the target (all presets) keep their fleets.
+
+Returns the array of ship sizes (sorted in descending order), to be freed
+by the caller.
+
+*/
+static int *generator_fleet(
+  const game_params *params, int diff_fleet, random_state *rs, 
+  int *num_ships
+)
+{
+    int i, k, size, ns_base, ctx = -1;
+    int h = params->H, w = params->W;
+    int *ns = num_ships;
+    int *ships = snewn(NUM_SHIPS_MAX, int);
+    // maximal ship size of the base fleet
+    int ship_max = ROUND_FRAC(min(h, w), 3, 5);
+    // divide ship sizes in 4 groups
+    int group_size = (ship_max - 1)/4; 
+    // maximal ship size after stretching
+    int size_cap = min(h, w);
+    // ship cells aimed at, sum of the ship sizes
+    int target = ROUND_FRAC(h*w, FLEET_DENSITY, 100), num_cells = 0;
+    
+    //-*-* base fleet
+    if (min(h, w) == 7) {
+        *ns = 7;  
+        ships[0] = ships[1] = 4;
+        ships[2] = ships[3] = 3;
+        ships[4] = ships[5] = ships[6] = 2;
+    }
+    else {
+        // number of ships NUM_SHIPS_BASE - 1 or NUM_SHIPS_BASE
+        if (diff_fleet == BASIC) *ns = NUM_SHIPS_BASE - 1;
+        else               *ns = NUM_SHIPS_BASE - 1 + random_upto(rs, 2);
+                
+        // if difficulty <= INTERMEDIATE then pick the biggest size from
+        // 1st group (small ships are more difficult to find)
+        if (diff_fleet <= INTERMEDIATE) {
+            ships[6]     = group_size + 1;
+            ships[*ns-1] = ships[6];
+        }
+        else {
+            ships[6]     = 1 + random_upto(rs, group_size + 1);
+            ships[*ns-1] = 1 + random_upto(rs, group_size + 1);
+        }
+        
+        // 2nd, 3rd, 4th groups
+        for (i = 0; i < 3; i++) {
+            ships[i*2]   = group_size*(i+1) + 2 + random_upto(rs, group_size);
+            ships[i*2+1] = group_size*(i+1) + 2 + random_upto(rs, group_size);
+        }
+    }
+    for (i = 0; i < *ns; i++) num_cells += ships[i];
+    
+    //-*-* stretch the sizes toward the target density
+    if (num_cells < target) {
+        int base_cells = num_cells;
+        num_cells = 0;
+        for (i = 0; i < *ns; i++) {
+            ships[i] = min(ROUND_FRAC(ships[i], target, base_cells), size_cap);
+            num_cells += ships[i];
+        }
+    }
+    arraysort(ships, *ns, cmp, &ctx);    
+    
+    //-*-* add ships if the cap leaves the fleet short of the target
+    // (narrow grids), repeating the sizes from the largest one down
+    ns_base = *ns;
+    for (k = 0; *ns < NUM_SHIPS_MAX && num_cells < target; k++) {
+        size = min(ships[k%ns_base], target - num_cells);
+        if (size < ships[ns_base-1]) break;
+        ships[*ns] = size;
+        if (! fleet_fits(h, w, *ns + 1, ships)) break;
+        (*ns)++;
+        num_cells += size;
+    }
+    arraysort(ships, *ns, cmp, &ctx);    
+    
+    return ships;
+}
+
+
+
+/*
+Generate puzzle with given difficulty. 
+
+Parameters:
+  *params: game parameters;
+  *rs: random state;
+  *num_ships: pointer under which the generated number of ships will be saved;
+  **ships: array of size *num_ships where ship sizes will be saved (sorted in
+descending order);
+  *rows, *cols: arrays of sizes H, W, resp., where the row and column sums 
+will be saved;
+  **init: 2D array of size H x W where the initially disclosed information
+for the grid will be saved;
+  *sc: scratch arena from which the working arrays of the generator and 
+the solvers are taken (they are released before returning);
+  *tel: telemetry record where phase durations, attempts, dropped ships, 
+repair iterations and solver calls are added up; NULL if not required;
+  **chain: array of size UNREASONABLE + 1 where the descriptions of a 
+chain of puzzles with the same layout, from params->diff down to BASIC, 
+will be saved (see ships_generate_chain()); NULL for a single puzzle.
+
+If chain is not NULL, the fleet is chosen as for BASIC. The puzzle of 
+the difficulty params->diff is generated first; each easier one is 
+derived from the previous one by adding clues (see clue_topup()) and 
+repairing it the same way, except that only clues are added. Since the 
+clue sets are nested, the solution stays unique along the chain, and 
+only the hardest puzzle needs the general solver. On return, the other 
+parameters hold the puzzle of the level BASIC. If the repair runs out of 
+ship cells to disclose, the chain stops: the elements of the current 
+level and the easier ones stay as they were (NULL).
+
+*/
+static void generator_diff(
+  const game_params *params, random_state *rs, int *num_ships, int **ships,
+  int *rows, int *cols, enum Configuration **init, struct scratch *sc,
+  struct gen_telemetry *tel, char **chain
+)
+{
+    int i, j, k, ship_ex, change, ex, num_cand, num_wrong, log_solve;
+    bool err;
+    int h = params->H, w = params->W, diff = params->diff;
+    int *ns = num_ships;
+    // difficulty level whose rules determine the ships
+    int diff_fleet = (chain ? BASIC : diff);
+    struct scratch_mark mark = scratch_mark(sc);
+    // start of the current phase (telemetry only)
+    double t_phase = (tel ? time_us() : 0);
+        
+        
+    //****** determine ships
+    
+    STATS_PHASE_BEGIN(PHASE_SHIPS);
+    *ships = generator_fleet(params, diff_fleet, rs, ns);
+    STATS_PHASE_END(PHASE_SHIPS);
+    telemetry_phase(tel, PHASE_SHIPS, &t_phase);
+    
+    
+
+    //****** generate ship configuration
+
+    // H x W layers of positions blocked by the 1st, 2nd, ... ships
+    bool ***blocked = scratch_layers(sc, *ns-1, h, w);
+    bool *blocked__ = (*ns > 1 ? **blocked : NULL);
+
+    // num_ships x 3 array of ship coordinates (vert, y, x);
+    int **ship_coord = scratch_grid_int(sc, *ns, 3);
+    int *ship_coord_ = *ship_coord;
+
+    // count the total number of calls of the recursive function
+    int gen_count[1];
+    // limit on calls of the recursive function before another attempt 
+    // to generate a solution is made
+    int gen_count_lim = 1200;
+    // maximum number of attempts to generate a solution before
+    // number of ships is reduced 
+    int attempt_lim = 5;
+
+    STATS_PHASE_BEGIN(PHASE_LAYOUT);
+    
+    // 7x7: uniform sample from the table of all layouts
+    if (h == 7 && w == 7) {
+        if (tel) tel->layout_attempts++;
+        layout7_sample(rs, ship_coord);
+    }
+    else {
+        while (true) {
+        
+            for (i = 0; i < attempt_lim; i++) {
+                for (k = 0; k < (*ns-1)*h*w; k++) blocked__[k] = 0;
+                for (k = 0; k < *ns*3; k++) ship_coord_[k] = 0;
+                *gen_count = 0;
+                if (tel) tel->layout_attempts++;
+            
+                err = place_ship_rng(
+                  0, params, *ships, ns, blocked, rs, ship_coord, 
+                  gen_count, gen_count_lim
+                ); 
+            
+                if (! err) break;
+                STATS_INC(rng_fail);
+            }
+            if (! err) break;
+    
+            // ship configuration could not be generated: remove one ship
+            ship_ex = ((int) (*ns + 1)/2) - 1; 
+            memmove(
+              *ships + ship_ex, *ships + ship_ex + 1, 
+              sizeof(int)*(*ns - ship_ex - 1)
+            );
+            (*ns)--;
+            STATS_INC(ship_drops);
+            if (tel) tel->ship_drops++;
+        }
+    }
+    STATS_PHASE_END(PHASE_LAYOUT);
+    telemetry_phase(tel, PHASE_LAYOUT, &t_phase);
+ 
+
+
+    //****** define parameters for puzzle generation
+    
+    // target solver count for difficulty 3 (min, max)
+    int solver_count_int [2] = {50, 600};
+    // values of array specify how many cells of the type -1/0/(1..6), 
+    // respectively, are initially disclosed
+    int ini_cells[3];
+    // number of the sum values along the border that are hidden
+    int sums_ex;
+    // sum of all ship sizes
+    int num_cells = 0;
+    for (i = 0; i < *ns; i++) num_cells += (*ships)[i];
+    
+    // target amounts of clues of the difficulty level
+    sums_ex = clue_amounts(diff, h, w, num_cells, rs, ini_cells);
+
+
+
+    //****** 1st attempt to determine sum values along the border
+    //****** and initially disclosed cells
+    
+    STATS_PHASE_BEGIN(PHASE_CLUES);
+
+    // H x W array of ship positions
+    bool **ship_pos = scratch_grid_bool(sc, h, w);
+    for (i = 0; i < h*w; i++) (*ship_pos)[i] = 0;
+    
+    for (k = 0; k < *ns; k++) {
+        for (i = 0; i < (*ships)[k]; i++) {
+            ship_pos 
+              [ship_coord[k][1]+i*ship_coord[k][0]] 
+              [ship_coord[k][2]+i*(1-ship_coord[k][0])] 
+              = 1
+            ;
+        }
+    }
+    
+    // H x W array of the layout with the shapes of the ship cells
+    int **layout = scratch_grid_int(sc, h, w);
+    for (i = 0; i < h*w; i++) {
+        (*layout)[i] = ((*ship_pos)[i] ? OCCUP : VACANT);
+    }
+    render_grid_conf(h, w, layout, NULL, false);
+    
+    // sum values along the border
+    for (i = 0; i < h; i++) {
+        rows[i] = 0;
+        for (j = 0; j < w; j++) rows[i] += ship_pos[i][j];
+    }
+    for (j = 0; j < w; j++) {
+        cols[j] = 0;
+        for (i = 0; i < h; i++) cols[j] += ship_pos[i][j];
+    }
+    // make copies
+    int *rows0 = scratch_newn(sc, h, int), *cols0 = scratch_newn(sc, w, int);
+    memcpy(rows0, rows, sizeof(*rows)*h);
+    memcpy(cols0, cols, sizeof(*cols)*w);
+    // to hide sums_ex values, shuffle array {0, 1, ..., h+w-1}
+    if (sums_ex > 0) {
+        int *ind = scratch_newn(sc, h+w, int);
+        for (i = 0; i < h+w; i++) ind[i] = i;
+        shuffle(ind, h+w, sizeof(*ind), rs);
+        for (i = 0; i < sums_ex; i++) {
+            if (ind[i] < h) rows[ind[i]] = -1;
+            else            cols[ind[i]-h] = -1;
+        }
+    }    
+    
+    // initially disclosed cells; they are random, but cells which tell 
+    // nothing new are avoided where possible
+    
+    // puzzle as seen by the solvers
+    struct game_state_const init_state;
+    init_state.H         = h;
+    init_state.W         = w;
+    init_state.num_ships = *ns;
+    init_state.ships     = *ships;
+    init_state.init      = init;
+    init_state.rows      = rows;
+    init_state.cols      = cols;
+    init_state.ships_sum = num_cells;
+    
+    // candidate cells (and, in the repair loop below, candidate changes 
+    // of the clues, see clue_select())
+    int *cand = scratch_newn(sc, h*w + h + w, int);
+    int *val = scratch_newn(sc, CLUE_CANDIDATES, int);
+    // array where the resulting configuration from logical solver is written
+    int **grid = scratch_grid_int(sc, h, w);
+    
+    // cumulated sum:
+    int *ships_aggr = scratch_newn(sc, *ns, int);
+    ships_aggr[0] = (*ships)[0];
+    for (k = 1; k < *ns; k++) ships_aggr[k] = ships_aggr[k-1] + (*ships)[k];
+    // number of cells of each ship counted
+    int *taken = scratch_newn(sc, *ns, int);
+    
+    // initialize array
+    for (i = 0; i < h*w; i++) (*init)[i] = UNDEF;
+    
+    // choose ini_cells[1] + ini_cells[2] cells from num_cells; the first 
+    // cell of every ship (in random order) comes before the second cell
+    // of any ship, and so on, so that the clues are spread over the fleet
+    int *ind = scratch_newn(sc, num_cells, int), shift, y, x, r;
+    for (i = 0; i < num_cells; i++) ind[i] = i;
+    shuffle(ind, num_cells, sizeof(*ind), rs);
+    num_cand = 0;
+    for (r = 0; num_cand < num_cells; r++) {
+        for (k = 0; k < *ns; k++) taken[k] = 0;
+        for (i = 0; i < num_cells; i++) {
+            for (k = 0; ships_aggr[k] <= ind[i]; k++);
+            if (taken[k]++ == r) cand[num_cand++] = ind[i];
+        }
+    }
+    // cells of type OCCUP (i < ini_cells[1]) and 1-6
+    for (i = 0; i < ini_cells[1] + ini_cells[2]; i++) {
+        for (k = 0; k < *ns; k++) {
+            if (ships_aggr[k] > cand[i]) break;
+        }
+        shift = ships_aggr[k] - cand[i] - 1; // shift along the ship
+        y = ship_coord[k][1] + shift*ship_coord[k][0];
+        x = ship_coord[k][2] + shift*(1-ship_coord[k][0]);
+        init[y][x] = (i < ini_cells[1] ? OCCUP : layout[y][x]);
+    }
+    // cells of type VACANT; first those which neither follow from the 
+    // ship cells disclosed (see solver_init()) nor from a sum 0
+    if (ini_cells[0] > 0) {
+        memcpy(*grid, *init, sizeof(**init)*h*w);
+        solver_init(h, w, grid);
+        num_cand = 0;
+        for (i = 0; i < h*w; i++) {
+            if (! (*ship_pos)[i]) cand[num_cand++] = i;
+        }
+        clue_shuffle(cand, num_cand, grid, &init_state, rs);
+        for (i = 0; i < ini_cells[0]; i++) (*init)[cand[i]] = VACANT;
+    }
+    
+    
+
+    STATS_PHASE_END(PHASE_CLUES);
+    telemetry_phase(tel, PHASE_CLUES, &t_phase);
+
+
+    //****** check solution; adjust disclosed information, if needed
+    
+    STATS_PHASE_BEGIN(PHASE_REPAIR);
+
+    struct sol soln;
+    if (diff == 3) scratch_sol(sc, *ns, &soln);
+    
+    // variables where the number of occupied/vacant cells found 
+    // by the logical solver is written
+    int occ, vac;
+        
+    bool fast_return = false;
+    int try_before_fast_return = 0;
+    // puzzle derived from a harder one of the chain: clues are only added
+    bool derived = false;
+    // result of the solvers already known for the change made (see 
+    // clue_pool_run())
+    bool evaluated = false;
+    
+    // choice among the candidate changes cand[], val[]: at the 
+    // Unreasonable level with worker threads, the candidates are solved 
+    // completely, otherwise only scored by the logical solver
+#ifdef SHIPS_THREADS
+    struct clue_pool *pool = NULL;
+    if (diff == 3 && repair_workers > 0) {
+        pool = clue_pool_new(&init_state, repair_workers);
+    }
+#  define CLUE_CHOICE(harder) ( \
+    pool && diff == 3 ? \
+    ( \
+      evaluated = true, \
+      clue_pool_run( \
+        pool, &init_state, ship_coord, solver_count_int, cand, val, \
+        num_cand, &log_solve, &soln, tel \
+      ) \
+    ) : \
+    clue_select(diff, &init_state, cand, val, num_cand, harder, grid, sc) \
+  )
+#else
+#  define CLUE_CHOICE(harder) \
+    clue_select(diff, &init_state, cand, val, num_cand, harder, grid, sc)
+#endif
+    
+    while (true) {
+
+        init_state.rows_sum  = 0;
+        for (i = 0; i < h; i++) {
+            if (rows[i] > -1) init_state.rows_sum += rows[i];
+        } 
+        init_state.cols_sum = 0;
+        for (j = 0; j < w; j++) {
+            if (cols[j] > -1) init_state.cols_sum += cols[j];
+        }
+    
+        // check if a unique solution exists (unless already known)
+        // logical solver
+        if (! evaluated) {
+            log_solve = 
+              solve_by_logic(diff, &init_state, grid, &occ, &vac, sc)
+            ;
+        }
+        // for unreasonable level solve with general solver; the layout
+        // is a solution, so only a different one is sought
+        if (diff == 3 && ! evaluated) {
+            solver_alt(&init_state, ship_coord, solver_count_int[1], &soln, sc);
+        }
+        evaluated = false;
+        
+        if (tel) {
+            tel->repair_iters++;
+            tel->logic_calls++;
+            if (diff == 3) {
+                tel->solver_calls++;
+                tel->solver_count += soln.count;
+            }
+        }
+        
+               
+        // unique solution exists, difficulty ok or fast_return = true
+        if (
+          diff <= 1 && log_solve == 0  ||
+          diff == 2 && (
+            log_solve == 1 || log_solve == 0 && (fast_return || derived)
+          ) ||
+          diff == 3 && soln.err == 0 && 
+            (
+              soln.count >= solver_count_int[0] && log_solve == 2 ||
+              fast_return
+            )
+        ) {
+            STATS_INC(repair[REPAIR_ACCEPT]);
+            if (! chain) break;
+            
+            // chain of puzzles: save this one, derive the next easier one
+            chain[diff] = encode_desc(h, w, *ns, *ships, rows, cols, init);
+            if (diff == BASIC) break;
+            diff--;
+            derived = true;
+            fast_return = false;
+            try_before_fast_return = 0;
+            clue_topup(
+              diff, &init_state, layout, rows0, cols0, ini_cells, &sums_ex,
+              cand, grid, rs
+            );
+            continue;
+        }
+            
+            
+        // unique solution exists, but too easy: increase difficulty;
+        // of a few random candidates, the change which leaves the most 
+        // to deduce for the logical solver is made
+        else if (
+          diff == 2 && log_solve == 0 ||
+          diff == 3 && soln.err == 0 && (
+            soln.count < solver_count_int[0] || log_solve < 2
+          )
+        ) {
+        
+            change = random_upto(rs, 2);
+                
+            // increase sums_ex by 1
+            if (change == 0 && h + w - sums_ex > 0) {
+                STATS_INC(repair[REPAIR_HIDE_SUM]);
+                num_cand = 0;
+                for (j = 0; j < h+w; j++) {
+                    if ((j < h ? rows[j] : cols[j-h]) != -1) {
+                        cand[num_cand++] = h*w + j;
+                    }
+                }
+                num_cand = clue_sample(cand, num_cand, rs);
+                for (k = 0; k < num_cand; k++) val[k] = -1;
+                ex = cand[CLUE_CHOICE(true)] - h*w;
+                if (ex < h) rows[ex] = -1;
+                else        cols[ex-h] = -1;
+                sums_ex++;
+            }
+                
+            // change one element of init to -2
+            else {
+                STATS_INC(repair[REPAIR_HIDE_CELL]);
+                num_cand = 0;
+                for (i = 0; i < h*w; i++) {
+                    if ((*init)[i] != UNDEF) cand[num_cand++] = i;
+                }
+                if (num_cand > 0) {
+                    num_cand = clue_sample(cand, num_cand, rs);
+                    for (k = 0; k < num_cand; k++) val[k] = UNDEF;
+                    i = cand[CLUE_CHOICE(true)];
+                    if      ((*init)[i] == VACANT) (ini_cells[0])--;
+                    else if ((*init)[i] == OCCUP)  (ini_cells[1])--;
+                    else                           (ini_cells[2])--;
+                    (*init)[i] = UNDEF;
+                }
+            }
+            
+        }
+        
+        
+        // more than one solution (diff == 3): set init = VACANT at one cell, 
+        // which is actually vacant, but the solver yields "occupied"; 
+        // return as soon as soln.count is below the upper limit 
+        // (set fast_return = true)
+        else if (diff == 3 && soln.err == 2) {
+            STATS_INC(repair[REPAIR_AMBIGUOUS]);
+            fast_return = true;
+            
+            // "wrong" cells: vacant in the layout, occupied in another
+            // solution; further solutions are found by a short backbone 
+            // search (limited to the lower target count of the solver), 
+            // and the cell at which most of them differ from the layout 
+            // is disclosed
+            struct scratch_mark mark_bb = scratch_mark(sc);
+            enum Configuration *bb = scratch_newn(sc, h*w, enum Configuration);
+            int *var = scratch_newn(sc, h*w, int), var_max = 0;
+            backbone(&init_state, ship_coord, solver_count_int[0], bb, var, sc);
+            for (k = 0; k < *ns; k++) {
+                for (i = 0; i < (*ships)[k]; i++) {
+                    var[
+                      (soln.ship_coord2[k][1] + i*soln.ship_coord2[k][0])*w +
+                      soln.ship_coord2[k][2] + i*(1 - soln.ship_coord2[k][0])
+                    ]++;
+                }
+            }
+            
+            num_wrong = 0;
+            for (i = 0; i < h*w; i++) {
+                if ((*ship_pos)[i] || var[i] == 0 || var[i] < var_max) {
+                    continue;
+                }
+                if (var[i] > var_max) {
+                    var_max = var[i];
+                    num_wrong = 0;
+                }
+                num_wrong++;
+            }
+            
+            ex = random_upto(rs, num_wrong);
+            for (i = 0; i < h*w; i++) {
+                if (! (*ship_pos)[i] && var[i] == var_max && ex-- == 0) {
+                    (*init)[i] = VACANT;
+                    (ini_cells[0])++;
+                    break;
+                }
+            }
+            scratch_reset(sc, mark_bb);
+        }
+        
+        
+        // no solution found or too difficult:
+        // decrease difficulty, return as soon as not too difficult 
+        // (set fast_return = true); of a few random candidates, the 
+        // change which lets the logical solver deduce the most is made
+        else {
+            try_before_fast_return++;
+            if (try_before_fast_return > 0) fast_return = true;
+            
+            change = random_upto(rs, 5);
+            
+            // decrease sums_ex by 1
+            if (change == 0 && sums_ex > 0) {
+                STATS_INC(repair[REPAIR_SHOW_SUM]);
+                num_cand = 0;
+                for (j = 0; j < h+w; j++) {
+                    if ((j < h ? rows[j] : cols[j-h]) == -1) {
+                        cand[num_cand++] = h*w + j;
+                    }
+                }
+                num_cand = clue_sample(cand, num_cand, rs);
+                for (k = 0; k < num_cand; k++) {
+                    j = cand[k] - h*w;
+                    val[k] = (j < h ? rows0[j] : cols0[j-h]);
+                }
+                ex = cand[CLUE_CHOICE(false)] - h*w;
+                if (ex < h) rows[ex] = rows0[ex];
+                else        cols[ex-h] = cols0[ex-h];
+                sums_ex--;
+            }
+            
+            // change one element of init from UNDEF to VACANT (change < 4)
+            // or to 1 .. 6; in case of logical solution change elements 
+            // not found by solver
+            else {
+                num_cand = 0;
+                for (i = 0; i < h*w; i++) {
+                    if (
+                      (diff <= 2 ? (*grid)[i] : (*init)[i]) == UNDEF &&
+                      (*ship_pos)[i] == (change == 4)
+                    ) cand[num_cand++] = i;
+                }
+                if (change < 4) STATS_INC(repair[REPAIR_SHOW_VACANT]);
+                else            STATS_INC(repair[REPAIR_SHOW_SHIP]);
+                // escape in the improbable case that all ship cells 
+                // are specified 1 .. 6
+                if (num_cand == 0 && change == 4) break;
+                if (num_cand > 0) {
+                    num_cand = clue_sample(cand, num_cand, rs);
+                    for (k = 0; k < num_cand; k++) val[k] = (*layout)[cand[k]];
+                    i = cand[CLUE_CHOICE(false)];
+                    (*init)[i] = (*layout)[i];
+                    if (change < 4) (ini_cells[0])++;
+                    else            (ini_cells[2])++;
+                }
+            }
+        }
+        
+    }
+    STATS_PHASE_END(PHASE_REPAIR);
+    telemetry_phase(tel, PHASE_REPAIR, &t_phase);
+    
+#undef CLUE_CHOICE
+#ifdef SHIPS_THREADS
+    if (pool) clue_pool_free(pool);
+#endif
+    scratch_reset(sc, mark);
+}
+
+
+/* 
+Recursive procedure for the function generator_diff() to generate a random
+configuration of the ships.
+
+Parameters:
+  ship_num: current ship number 0, ..., ns-1 (ns = number of ships);
+  *params: game parameters;
+  *ships: array of ship sizes;
+  *num_ships: number of ships;
+  ***blocked: 3D array which consists of H x W layers of positions blocked by
+the 1st, 2nd, ... ships (H = height, W= width);
+  *rs: random state;
+  **ship_coord: ns x 3 temporary array of ship coordinates (vert, y, x) 
+per ship;
+  *count: number of times the recursive function place_ship_rng() is called;
+  count_lim: maximum number of times the recursive function place_ship_rng()
+can be called, before the attempt is interrupted and an error returned; set 
+to a value of 0 or less if no limit is desired.
+
+The function returns an error value true/false.
+  
+*/
+static bool place_ship_rng(
+  int ship_num, const game_params *params, int *ships, int *num_ships, 
+  bool ***blocked, random_state *rs, int **ship_coord, int *count, 
+  int count_lim
+) 
+{
+    (*count)++;
+    STATS_INC(rng_nodes);
+    if (0 < count_lim && count_lim < *count) return true;
+
+    int h = params->H, w = params->W, ns = *num_ships;
+    int ship = ships[ship_num];
+    int num_pos, pos, vert, y, x, i, j, k, ship_H, ship_W;
+    bool err, brk;
+    
+    // number of positions for horizontal and vertical orientation
+    // (double count for ship length 1 does not lead to an error)
+    num_pos = h*(w - ship + 1) + (h - ship + 1)*w;
+    
+    while (true) {
+    
+        // generate position
+        pos = random_upto(rs, num_pos);
+        
+        // horizontal
+        if (pos < h*(w - ship + 1)) {
+            vert = 0;
+            y = (int) (pos/(w - ship + 1));
+            x = pos - y*(w - ship + 1);
+        }
+        // vertical
+        else {
+            pos = pos - h*(w - ship + 1);
+            vert = 1;
+            y = (int) (pos/w);
+            x = pos - y*w;
+        }
+    
+        // ship dimensions
+        ship_H = vert*ship + 1 - vert;
+        ship_W = (1 - vert)*ship + vert;
+        
+        // check that cells not blocked 
+        brk = false;
+        for (k = 0; k < ship_num; k++) {
+            for (i = 0; i < ship_H; i++) {
+                for (j = 0; j < ship_W; j++) {
+                    if (blocked[k][y+i][x+j]) {brk = true; break;}
+                }
+                if (brk) break;
+            }
+            if (brk) break;
+        }
+        if (brk) return true;
+        
+        // not last ship
+        if (ship_num < ns - 1) {
+                        
+            // block cells of and around the ship
+            for (i = max(y-1, 0); i < min(y + ship_H + 1, h); i++) {
+                for (j = max(x-1, 0); j < min(x + ship_W + 1, w); j++) {
+                    blocked[ship_num][i][j] = 1;
+                }
+            }
+           
+            //recursive call
+            err = place_ship_rng(
+              ship_num + 1, params, ships, num_ships, blocked, rs, ship_coord, 
+              count, count_lim
+            );
+
+            // if next ship could not be placed, replace current ship
+            // and unblock or return error if count_lim exceeded
+            if (err) {
+                if (count_lim <= 0 || *count <= count_lim) {
+                    for (i = 0; i < h*w; i++)  (*(blocked[ship_num]))[i] = 0;
+                }
+                else return true;
+            }
+            // record current position and return
+            else {
+                ship_coord[ship_num][0] = vert;
+                ship_coord[ship_num][1] = y;
+                ship_coord[ship_num][2] = x;
+                return false;
+            }
+        }
+        
+        // last ship 
+        else {
+            ship_coord[ship_num][0] = vert;
+            ship_coord[ship_num][1] = y;
+            ship_coord[ship_num][2] = x;
+            return false;
+        }
+        
+    }
+    
+}
+
+
+/* ----------------------------------------------------------------------
+Layouts of the 7x7 grid
+
+The fleet of the 7x7 grid is fixed (see generator_diff()), and its 
+layouts are few enough to be enumerated offline. layout7_table holds them
+in groups, one per position of the two ships of size 4; the other ships 
+of a layout are found by layout7_enum(), in the order of the search of 
+solver(). A position is p = vert*49 + y*7 + x, a set of cells a bit mask
+with bit 7*y + x.
+*/
+
+/* fleet of the 7x7 grid */
+static const int layout7_ships[7] = {4, 4, 3, 3, 2, 2, 2};
+
+/* group of layouts: positions of the two ships of size 4, number of the 
+layouts up to the end of the group, and per row (columns: cols) the 
+possible sums of the layouts of the group (bit 8*y + sum) */
+struct layout7_group {
+    unsigned char pos[2];
+    int end;
+    unsigned long long rows, cols;
+};
+
+/* generated by the headless driver (ships --layout-table) */
+static const struct layout7_group layout7_table[] = {
+    {{ 0, 14},   3309, 0x7e3f7e07700770ULL, 0x7f7f0f3c3c3c3cULL},
+    {{ 0, 15},   4608, 0x7e3f7e03300370ULL, 0x7e1f1e3c3c3c1eULL},
+    {{ 0, 16},   5146, 0x7e3f7e03300150ULL, 0x1e3e1e3c3c1e3eULL},
+    {{ 0, 17},   6432, 0x7e3f7e07700150ULL, 0x3e3e1e3c1e3e3eULL},
+    {{ 0, 21},   6444, 0x7c3d0630060360ULL, 0x7c3d060c180c18ULL},
+    {{ 0, 22},   6446, 0x30140230020360ULL, 0x60050c04100408ULL},
+    {{ 0, 23},   6450, 0x20040220020770ULL, 0x1c0e0804080420ULL},
+    {{ 0, 24},   6482, 0x6c2d0630060770ULL, 0x3c1e0c0c0c3434ULL},
+    {{ 0, 28},   7497, 0x7c0770077c0770ULL, 0x7f3f071c1c1c1cULL},
+    {{ 0, 29},   7885, 0x7c0330037c0770ULL, 0x7e0f0e1c1c1c0eULL},
+    {{ 0, 30},   8381, 0x7c0330037c0770ULL, 0x1f3e0e1c1c0e3eULL},
+    {{ 0, 31},   9448, 0x7c0770077c0770ULL, 0x3e3e0e1c0e3e3eULL},
+    {{ 0, 35},   9458, 0x0630062f7c0360ULL, 0x7435060c180c18ULL},
+    {{ 0, 36},   9460, 0x0220020c300360ULL, 0x60050c04100408ULL},
+    {{ 0, 37},   9461, 0x02200204200140ULL, 0x08040804080420ULL},
+    {{ 0, 38},   9479, 0x0630063f7c0770ULL, 0x1c1e0c0c0c3434ULL},
+    {{ 0, 42},  12132, 0x70077e3f7e0770ULL, 0x7f7f0f3c3c3c3cULL},
+    {{ 0, 43},  13242, 0x30037e3f7e0770ULL, 0x7e1f1e3c3c3c1eULL},
+    {{ 0, 44},  14035, 0x30037e3f7e0770ULL, 0x1f3e1e3c3c1e3eULL},
+    {{ 0, 45},  16251, 0x70077e3f7e0770ULL, 0x3e3e1e3c1e3e3eULL},
+    {{ 0, 54},  16372, 0x7c3f0e1e1c0220ULL, 0x0770073e3e3e3cULL},
+    {{ 0, 55},  18076, 0x7f7f1f3e3e0220ULL, 0x70071f3e3e3e3eULL},
+    {{ 0, 61},  18100, 0x60071c06180210ULL, 0x0320033c3e1638ULL},
+    {{ 0, 62},  18794, 0x7c0f3e3e3e0210ULL, 0x30031f3e3e3e3eULL},
+    {{ 0, 63},  20498, 0x1f3e3e3e3e0770ULL, 0x7f7f1f3e3e0220ULL},
+    {{ 0, 64},  20510, 0x08061806100360ULL, 0x78150a38022002ULL},
+    {{ 0, 65},  20872, 0x1f3e3e3e3e0770ULL, 0x7e3f1e02200238ULL},
+    {{ 0, 66},  20900, 0x1c0e180e380360ULL, 0x6d6d0120023434ULL},
+    {{ 0, 67},  21535, 0x1f3e3e3e3e0370ULL, 0x780310023e3e3eULL},
+    {{ 0, 68},  21545, 0x08061806100140ULL, 0x02200138141438ULL},
+    {{ 0, 69},  22395, 0x1f3e3e3e3e0150ULL, 0x30031f3e3e3e3eULL},
+    {{ 0, 70},  24099, 0x3e3e3e3e1f0770ULL, 0x7f7f1f3e3e0220ULL},
+    {{ 0, 71},  24111, 0x10061806080360ULL, 0x78150a38022002ULL},
+    {{ 0, 72},  24473, 0x3e3e3e3e1f0770ULL, 0x7e3f1e02200238ULL},
+    {{ 0, 73},  24501, 0x380e180e1c0360ULL, 0x6d6d0120023434ULL},
+    {{ 0, 74},  25420, 0x3e3e3e3e1f0770ULL, 0x7c0710023e3e3eULL},
+    {{ 0, 75},  25460, 0x10061806080770ULL, 0x07700138141438ULL},
+    {{ 0, 76},  27792, 0x3e3e3e3e1f0770ULL, 0x70071f3e3e3e3eULL},
+    {{ 1, 14},  28847, 0x7e3f7e07700330ULL, 0x7e1f1e3c3c3c1eULL},
+    {{ 1, 15},  29641, 0x7e1f7e03300330ULL, 0x7c0f3c3c3c3c0fULL},
+    {{ 1, 16},  29674, 0x78173c02300110ULL, 0x0e0a3c3c3c0618ULL},
+    {{ 1, 17},  29877, 0x7c177c07700110ULL, 0x1e1e3c3c1e3e1eULL},
+    {{ 1, 21},  29879, 0x30140610020220ULL, 0x60050c04100408ULL},
+    {{ 1, 22},  29880, 0x10100210020220ULL, 0x40011004100404ULL},
+    {{ 1, 23},  29881, 0x20040220020220ULL, 0x10021004080410ULL},
+    {{ 1, 24},  29889, 0x6c2d0630060220ULL, 0x3006180c0c341aULL},
+    {{ 1, 28},  30185, 0x780770077c0330ULL, 0x7e0f0e1c1c1c0eULL},
+    {{ 1, 29},  30281, 0x780330037c0330ULL, 0x78031c1c1c1807ULL},
+    {{ 1, 30},  30473, 0x780330037c0330ULL, 0x1e0e1c181c0e1eULL},
+    {{ 1, 31},  30895, 0x7c0770077c0330ULL, 0x3e0e1c1c0e3e1fULL},
+    {{ 1, 35},  30897, 0x0630060a300220ULL, 0x60050c0c180408ULL},
+    {{ 1, 36},  30898, 0x02200208100220ULL, 0x40011004100404ULL},
+    {{ 1, 38},  30904, 0x0410063e3c0230ULL, 0x100618040c1418ULL},
+    {{ 1, 42},  32014, 0x70077e3f7e0330ULL, 0x7e1f1e3c3c3c1eULL},
+    {{ 1, 43},  32471, 0x30037e3f7e0330ULL, 0x78033c3c3c3c0fULL},
+    {{ 1, 44},  32671, 0x30037e3f7e0330ULL, 0x1e0e3c3c3c0e1eULL},
+    {{ 1, 45},  33464, 0x70077e3f7e0330ULL, 0x3e1e3c3c1e3e1fULL},
+    {{ 1, 55},  35168, 0x7f7f1f3e3e0220ULL, 0x70073e3e3e3e1fULL},
+    {{ 1, 62},  35862, 0x7c0f3e3e3e0210ULL, 0x30033e3e3e3e1fULL},
+    {{ 1, 63},  36556, 0x1f3e3e3e3e0330ULL, 0x7c0f3e3e3e0210ULL},
+    {{ 1, 64},  36558, 0x08041002100220ULL, 0x60051430022001ULL},
+    {{ 1, 65},  36659, 0x1e3e1e3c3e0330ULL, 0x7c0f3c0220021cULL},
+    {{ 1, 66},  36665, 0x18061006180220ULL, 0x680d022002341aULL},
+    {{ 1, 67},  37075, 0x1f3e3e3e3e0330ULL, 0x700120023e1e1fULL},
+    {{ 1, 69},  37147, 0x1c163c16380110ULL, 0x100138163c161cULL},
+    {{ 1, 70},  37841, 0x3e3e3e3e1f0330ULL, 0x7c0f3e3e3e0210ULL},
+    {{ 1, 71},  37843, 0x10041002080220ULL, 0x60051430022001ULL},
+    {{ 1, 72},  37944, 0x3c3e1e3c1f0330ULL, 0x7c0f3c0220021cULL},
+    {{ 1, 73},  37950, 0x300610060c0220ULL, 0x680d022002341aULL},
+    {{ 1, 74},  38360, 0x3e3e3e3e1f0330ULL, 0x700120023e1e1fULL},
+    {{ 1, 75},  38370, 0x10061806080220ULL, 0x0410023814141cULL},
+    {{ 1, 76},  39220, 0x3e3e3e3e1f0330ULL, 0x50013e3e3e3e1fULL},
+    {{ 2, 14},  39423, 0x7c177c07700110ULL, 0x1e3e1e3c3c1e1eULL},
+    {{ 2, 15},  39456, 0x78173c02300110ULL, 0x18063c3c3c0a0eULL},
+    {{ 2, 16},  40250, 0x7e1f7e03300330ULL, 0x0f3c3c3c3c0f7cULL},
+    {{ 2, 17},  41305, 0x7e3f7e07700330ULL, 0x1e3c3c3c1e1f7eULL},
+    {{ 2, 21},  41313, 0x6c2d0630060220ULL, 0x1a340c0c180630ULL},
+    {{ 2, 22},  41314, 0x20040220020220ULL, 0x10040804100210ULL},
+    {{ 2, 23},  41315, 0x10100210020220ULL, 0x04041004100140ULL},
+    {{ 2, 24},  41317, 0x30140610020220ULL, 0x080410040c0560ULL},
+    {{ 2, 28},  41739, 0x7c0770077c0330ULL, 0x1f3e0e1c1c0e3eULL},
+    {{ 2, 29},  41931, 0x780330037c0330ULL, 0x1e0e1c181c0e1eULL},
+    {{ 2, 30},  42027, 0x780330037c0330ULL, 0x07181c1c1c0378ULL},
+    {{ 2, 31},  42323, 0x780770077c0330ULL, 0x0e1c1c1c0e0f7eULL},
+    {{ 2, 35},  42329, 0x0410063e3c0230ULL, 0x18140c04180610ULL},
+    {{ 2, 37},  42330, 0x02200208100220ULL, 0x04041004100140ULL},
+    {{ 2, 38},  42332, 0x0630060a300220ULL, 0x0804180c0c0560ULL},
+    {{ 2, 42},  43125, 0x70077e3f7e0330ULL, 0x1f3e1e3c3c1e3eULL},
+    {{ 2, 43},  43325, 0x30037e3f7e0330ULL, 0x1e0e3c3c3c0e1eULL},
+    {{ 2, 44},  43782, 0x30037e3f7e0330ULL, 0x0f3c3c3c3c0378ULL},
+    {{ 2, 45},  44892, 0x70077e3f7e0330ULL, 0x1e3c3c3c1e1f7eULL},
+    {{ 2, 49},  46596, 0x7f7f1f3e3e0220ULL, 0x1f3e3e3e3e0770ULL},
+    {{ 2, 56},  47290, 0x7c0f3e3e3e0210ULL, 0x1f3e3e3e3e0330ULL},
+    {{ 2, 63},  47362, 0x1c163c16380110ULL, 0x1c163c16380110ULL},
+    {{ 2, 65},  47772, 0x1f3e3e3e3e0330ULL, 0x1f1e3e02200170ULL},
+    {{ 2, 66},  47778, 0x18061006180220ULL, 0x1a340220020d68ULL},
+    {{ 2, 67},  47879, 0x1e3e1e3c3e0330ULL, 0x1c0220023c0f7cULL},
+    {{ 2, 68},  47881, 0x08041002100220ULL, 0x01200230140560ULL},
+    {{ 2, 69},  48575, 0x1f3e3e3e3e0330ULL, 0x10023e3e3e0f7cULL},
+    {{ 2, 70},  49425, 0x3e3e3e3e1f0330ULL, 0x1f3e3e3e3e0150ULL},
+    {{ 2, 71},  49435, 0x10061806080220ULL, 0x1c141438021004ULL},
+    {{ 2, 72},  49845, 0x3e3e3e3e1f0330ULL, 0x1f1e3e02200170ULL},
+    {{ 2, 73},  49851, 0x300610060c0220ULL, 0x1a340220020d68ULL},
+    {{ 2, 74},  49952, 0x3c3e1e3c1f0330ULL, 0x1c0220023c0f7cULL},
+    {{ 2, 75},  49954, 0x10041002080220ULL, 0x01200230140560ULL},
+    {{ 2, 76},  50648, 0x3e3e3e3e1f0330ULL, 0x10023e3e3e0f7cULL},
+    {{ 3, 14},  51934, 0x7e3f7e07700150ULL, 0x3e3e1e3c1e3e3eULL},
+    {{ 3, 15},  52472, 0x7e3f7e03300150ULL, 0x3e1e3c3c1e3e1eULL},
+    {{ 3, 16},  53771, 0x7e3f7e03300370ULL, 0x1e3c3c3c1e1f7eULL},
+    {{ 3, 17},  57080, 0x7e3f7e07700770ULL, 0x3c3c3c3c0f7f7fULL},
+    {{ 3, 21},  57112, 0x6c2d0630060770ULL, 0x34340c0c0c1e3cULL},
+    {{ 3, 22},  57116, 0x20040220020770ULL, 0x20040804080e1cULL},
+    {{ 3, 23},  57118, 0x30140230020360ULL, 0x080410040c0560ULL},
+    {{ 3, 24},  57130, 0x7c3d0630060360ULL, 0x180c180c063d7cULL},
+    {{ 3, 28},  58197, 0x7c0770077c0770ULL, 0x3e3e0e1c0e3e3eULL},
+    {{ 3, 29},  58693, 0x7c0330037c0770ULL, 0x3e0e1c1c0e3e1fULL},
+    {{ 3, 30},  59081, 0x7c0330037c0770ULL, 0x0e1c1c1c0e0f7eULL},
+    {{ 3, 31},  60096, 0x7c0770077c0770ULL, 0x1c1c1c1c073f7fULL},
+    {{ 3, 35},  60114, 0x0630063f7c0770ULL, 0x34340c0c0c1e1cULL},
+    {{ 3, 36},  60115, 0x02200204200140ULL, 0x20040804080408ULL},
+    {{ 3, 37},  60117, 0x0220020c300360ULL, 0x080410040c0560ULL},
+    {{ 3, 38},  60127, 0x0630062f7c0360ULL, 0x180c180c063574ULL},
+    {{ 3, 42},  62343, 0x70077e3f7e0770ULL, 0x3e3e1e3c1e3e3eULL},
+    {{ 3, 43},  63136, 0x30037e3f7e0770ULL, 0x3e1e3c3c1e3e1fULL},
+    {{ 3, 44},  64246, 0x30037e3f7e0770ULL, 0x1e3c3c3c1e1f7eULL},
+    {{ 3, 45},  66899, 0x70077e3f7e0770ULL, 0x3c3c3c3c0f7f7fULL},
+    {{ 3, 49},  68603, 0x7f7f1f3e3e0220ULL, 0x3e3e3e3e1f0770ULL},
+    {{ 3, 50},  68724, 0x7c3f0e1e1c0220ULL, 0x3c3e3e3e077007ULL},
+    {{ 3, 56},  69418, 0x7c0f3e3e3e0210ULL, 0x3e3e3e3e1f0330ULL},
+    {{ 3, 57},  69442, 0x60071c06180210ULL, 0x38163e3c032003ULL},
+    {{ 3, 63},  70292, 0x1f3e3e3e3e0150ULL, 0x3e3e3e3e1f0330ULL},
+    {{ 3, 64},  70302, 0x08061806100140ULL, 0x38141438012002ULL},
+    {{ 3, 65},  70937, 0x1f3e3e3e3e0370ULL, 0x3e3e3e02100378ULL},
+    {{ 3, 66},  70965, 0x1c0e180e380360ULL, 0x34340220016d6dULL},
+    {{ 3, 67},  71327, 0x1f3e3e3e3e0770ULL, 0x380220021e3f7eULL},
+    {{ 3, 68},  71339, 0x08061806100360ULL, 0x022002380a1578ULL},
+    {{ 3, 69},  73043, 0x1f3e3e3e3e0770ULL, 0x20023e3e1f7f7fULL},
+    {{ 3, 70},  75375, 0x3e3e3e3e1f0770ULL, 0x3e3e3e3e1f0770ULL},
+    {{ 3, 71},  75415, 0x10061806080770ULL, 0x38141438017007ULL},
+    {{ 3, 72},  76334, 0x3e3e3e3e1f0770ULL, 0x3e3e3e0210077cULL},
+    {{ 3, 73},  76362, 0x380e180e1c0360ULL, 0x34340220016d6dULL},
+    {{ 3, 74},  76724, 0x3e3e3e3e1f0770ULL, 0x380220021e3f7eULL},
+    {{ 3, 75},  76736, 0x10061806080360ULL, 0x022002380a1578ULL},
+    {{ 3, 76},  78440, 0x3e3e3e3e1f0770ULL, 0x20023e3e1f7f7fULL},
+    {{ 7, 21},  78452, 0x7c3d0630063006ULL, 0x7c3d060c180c18ULL},
+    {{ 7, 22},  78454, 0x30140230023006ULL, 0x60050c04100408ULL},
+    {{ 7, 28},  78455, 0x40014001041004ULL, 0x10100204080808ULL},
+    {{ 7, 30},  78456, 0x40012002041004ULL, 0x08100404080410ULL},
+    {{ 7, 31},  78460, 0x40017007041004ULL, 0x10100404041c1cULL},
+    {{ 7, 42},  78470, 0x60037c2f063006ULL, 0x7435060c180c18ULL},
+    {{ 7, 43},  78472, 0x2002300a063006ULL, 0x60050c0c180408ULL},
+    {{ 7, 44},  78478, 0x30023c3e061004ULL, 0x18140c04180610ULL},
+    {{ 7, 45},  78496, 0x70077c3f063006ULL, 0x34340c0c0c1e1cULL},
+    {{ 7, 55},  78508, 0x78150a38022002ULL, 0x60030806180610ULL},
+    {{ 7, 62},  78510, 0x60051430022001ULL, 0x20020802100410ULL},
+    {{ 7, 69},  78520, 0x1c141438021004ULL, 0x20020806180610ULL},
+    {{ 7, 70},  78641, 0x3c3e3e3e077007ULL, 0x7c3f0e1e1c0220ULL},
+    {{ 7, 72},  78692, 0x3c1e3c3e077007ULL, 0x381e0e02200218ULL},
+    {{ 7, 74},  78729, 0x3c3e1e3c037007ULL, 0x78071002180e18ULL},
+    {{ 7, 76},  78769, 0x38141438017007ULL, 0x70070806180610ULL},
+    {{ 8, 21},  78771, 0x30140610022002ULL, 0x60050c04100408ULL},
+    {{ 8, 22},  78772, 0x10100210022002ULL, 0x40011004100404ULL},
+    {{ 8, 42},  78774, 0x6003300c022002ULL, 0x60050c04100408ULL},
+    {{ 8, 43},  78775, 0x20021008022002ULL, 0x40011004100404ULL},
+    {{ 8, 45},  78776, 0x40012004022002ULL, 0x20040804080408ULL},
+    {{ 8, 55},  78788, 0x78150a38022002ULL, 0x60031006180608ULL},
+    {{ 8, 62},  78790, 0x60051430022001ULL, 0x20021002100408ULL},
+    {{ 8, 70},  78814, 0x38163e3c032003ULL, 0x60071c06180210ULL},
+    {{ 8, 72},  78818, 0x38141438012002ULL, 0x20021002200208ULL},
+    {{ 8, 74},  78834, 0x38141e38032003ULL, 0x6001200218040cULL},
+    {{ 8, 76},  78844, 0x38141438012002ULL, 0x40011006180608ULL},
+    {{ 9, 23},  78845, 0x10100210022002ULL, 0x04041004100140ULL},
+    {{ 9, 24},  78847, 0x30140610022002ULL, 0x080410040c0560ULL},
+    {{ 9, 42},  78848, 0x40012004022002ULL, 0x08040804080420ULL},
+    {{ 9, 44},  78849, 0x20021008022002ULL, 0x04041004100140ULL},
+    {{ 9, 45},  78851, 0x6003300c022002ULL, 0x080410040c0560ULL},
+    {{ 9, 49},  78863, 0x78150a38022002ULL, 0x08061806100360ULL},
+    {{ 9, 56},  78865, 0x60051430022001ULL, 0x08041002100220ULL},
+    {{ 9, 70},  78875, 0x38141438012002ULL, 0x08061806100140ULL},
+    {{ 9, 72},  78891, 0x38141e38032003ULL, 0x0c041802200160ULL},
+    {{ 9, 74},  78895, 0x38141438012002ULL, 0x08022002100220ULL},
+    {{ 9, 76},  78919, 0x38163e3c032003ULL, 0x100218061c0760ULL},
+    {{10, 23},  78921, 0x30140230023006ULL, 0x080410040c0560ULL},
+    {{10, 24},  78933, 0x7c3d0630063006ULL, 0x180c180c063d7cULL},
+    {{10, 28},  78937, 0x40017007041004ULL, 0x1c1c0404041010ULL},
+    {{10, 29},  78938, 0x40012002041004ULL, 0x10040804041008ULL},
+    {{10, 31},  78939, 0x40014001041004ULL, 0x08080804021010ULL},
+    {{10, 42},  78957, 0x70077c3f063006ULL, 0x1c1e0c0c0c3434ULL},
+    {{10, 43},  78963, 0x30023c3e061004ULL, 0x100618040c1418ULL},
+    {{10, 44},  78965, 0x2002300a063006ULL, 0x0804180c0c0560ULL},
+    {{10, 45},  78975, 0x60037c2f063006ULL, 0x180c180c063574ULL},
+    {{10, 49},  78987, 0x78150a38022002ULL, 0x10061806080360ULL},
+    {{10, 56},  78989, 0x60051430022001ULL, 0x10041002080220ULL},
+    {{10, 63},  78999, 0x1c141438021004ULL, 0x10061806080220ULL},
+    {{10, 70},  79039, 0x38141438017007ULL, 0x10061806080770ULL},
+    {{10, 72},  79076, 0x3c3e1e3c037007ULL, 0x180e1802100778ULL},
+    {{10, 74},  79127, 0x3c1e3c3e077007ULL, 0x180220020e1e38ULL},
+    {{10, 76},  79248, 0x3c3e3e3e077007ULL, 0x20021c1e0e3f7cULL},
+    {{14, 28},  80603, 0x7c07700770077cULL, 0x7f3f071c1c1c1cULL},
+    {{14, 29},  81073, 0x7c03300370077cULL, 0x7e0f0e1c1c1c0eULL},
+    {{14, 30},  81273, 0x7c033001700778ULL, 0x1e3e0e1c1c0e3eULL},
+    {{14, 31},  81847, 0x7c07700170077cULL, 0x3e3e0e1c0e3e3eULL},
+    {{14, 35},  81848, 0x04100401400140ULL, 0x10100204080808ULL},
+    {{14, 38},  81852, 0x04100407700140ULL, 0x1c1c0404041010ULL},
+    {{14, 42},  82867, 0x70077c0770077cULL, 0x7f3f071c1c1c1cULL},
+    {{14, 43},  83163, 0x30037c07700778ULL, 0x7e0f0e1c1c1c0eULL},
+    {{14, 44},  83585, 0x30037c0770077cULL, 0x1f3e0e1c1c0e3eULL},
+    {{14, 45},  84652, 0x70077c0770077cULL, 0x3e3e0e1c0e3e3eULL},
+    {{14, 54},  84703, 0x381e0e02200218ULL, 0x0770073e3c1e3cULL},
+    {{14, 55},  85065, 0x7e3f1e02200238ULL, 0x70071f3e3e3e3eULL},
+    {{14, 61},  85069, 0x20021002200208ULL, 0x02200138141438ULL},
+    {{14, 62},  85170, 0x7c0f3c0220021cULL, 0x30031f3c1e3e3cULL},
+    {{14, 68},  85186, 0x0c041802200160ULL, 0x032003381e1438ULL},
+    {{14, 69},  85596, 0x1f1e3e02200170ULL, 0x30031f3e3e3e3eULL},
+    {{14, 75},  85633, 0x180e1802100778ULL, 0x0770033c1e3e3cULL},
+    {{14, 76},  86552, 0x3e3e3e0210077cULL, 0x70071f3e3e3e3eULL},
+    {{15, 28},  87022, 0x7c07700330037cULL, 0x7e0f0e1c1c1c0eULL},
+    {{15, 29},  87306, 0x78033003300378ULL, 0x7c071c1c1c1807ULL},
+    {{15, 30},  87354, 0x78033001300378ULL, 0x1e0e1c181c0e1eULL},
+    {{15, 31},  87554, 0x7807700130037cULL, 0x3e0e1c1c0e3e1eULL},
+    {{15, 38},  87555, 0x04100402200140ULL, 0x10040804041008ULL},
+    {{15, 42},  87943, 0x70077c0330037cULL, 0x7e0f0e1c1c1c0eULL},
+    {{15, 43},  88039, 0x30037c03300378ULL, 0x78031c1c1c1807ULL},
+    {{15, 44},  88231, 0x30037c03300378ULL, 0x1e0e1c181c0e1eULL},
+    {{15, 45},  88727, 0x70077c0330037cULL, 0x3e0e1c1c0e3e1fULL},
+    {{15, 55},  89089, 0x7e3f1e02200238ULL, 0x70073e3e3e3e1fULL},
+    {{15, 62},  89190, 0x7c0f3c0220021cULL, 0x30033e3c1e3e1eULL},
+    {{15, 69},  89600, 0x1f1e3e02200170ULL, 0x30033e3e3e3e1fULL},
+    {{15, 76},  90235, 0x3e3e3e02100378ULL, 0x70033e3e3e3e1fULL},
+    {{16, 28},  90435, 0x7807700130037cULL, 0x1e3e0e1c1c0e3eULL},
+    {{16, 29},  90483, 0x78033001300378ULL, 0x1e0e1c181c0e1eULL},
+    {{16, 30},  90767, 0x78033003300378ULL, 0x07181c1c1c077cULL},
+    {{16, 31},  91237, 0x7c07700330037cULL, 0x0e1c1c1c0e0f7eULL},
+    {{16, 35},  91238, 0x04100402200140ULL, 0x08100404080410ULL},
+    {{16, 42},  91734, 0x70077c0330037cULL, 0x1f3e0e1c1c0e3eULL},
+    {{16, 43},  91926, 0x30037c03300378ULL, 0x1e0e1c181c0e1eULL},
+    {{16, 44},  92022, 0x30037c03300378ULL, 0x07181c1c1c0378ULL},
+    {{16, 45},  92410, 0x70077c0330037cULL, 0x0e1c1c1c0e0f7eULL},
+    {{16, 49},  92772, 0x7e3f1e02200238ULL, 0x1f3e3e3e3e0770ULL},
+    {{16, 56},  92873, 0x7c0f3c0220021cULL, 0x1e3e1e3c3e0330ULL},
+    {{16, 63},  93283, 0x1f1e3e02200170ULL, 0x1f3e3e3e3e0330ULL},
+    {{16, 70},  93918, 0x3e3e3e02100378ULL, 0x1f3e3e3e3e0370ULL},
+    {{17, 28},  94492, 0x7c07700170077cULL, 0x3e3e0e1c0e3e3eULL},
+    {{17, 29},  94692, 0x7c033001700778ULL, 0x3e0e1c1c0e3e1eULL},
+    {{17, 30},  95162, 0x7c03300370077cULL, 0x0e1c1c1c0e0f7eULL},
+    {{17, 31},  96517, 0x7c07700770077cULL, 0x1c1c1c1c073f7fULL},
+    {{17, 35},  96521, 0x04100407700140ULL, 0x10100404041c1cULL},
+    {{17, 38},  96522, 0x04100401400140ULL, 0x08080804021010ULL},
+    {{17, 42},  97589, 0x70077c0770077cULL, 0x3e3e0e1c0e3e3eULL},
+    {{17, 43},  98011, 0x30037c0770077cULL, 0x3e0e1c1c0e3e1fULL},
+    {{17, 44},  98307, 0x30037c07700778ULL, 0x0e1c1c1c0e0f7eULL},
+    {{17, 45},  99322, 0x70077c0770077cULL, 0x1c1c1c1c073f7fULL},
+    {{17, 49},  99684, 0x7e3f1e02200238ULL, 0x3e3e3e3e1f0770ULL},
+    {{17, 50},  99735, 0x381e0e02200218ULL, 0x3c1e3c3e077007ULL},
+    {{17, 56},  99836, 0x7c0f3c0220021cULL, 0x3c3e1e3c1f0330ULL},
+    {{17, 57},  99840, 0x20021002200208ULL, 0x38141438012002ULL},
+    {{17, 63}, 100250, 0x1f1e3e02200170ULL, 0x3e3e3e3e1f0330ULL},
+    {{17, 64}, 100266, 0x0c041802200160ULL, 0x38141e38032003ULL},
+    {{17, 70}, 101185, 0x3e3e3e0210077cULL, 0x3e3e3e3e1f0770ULL},
+    {{17, 71}, 101222, 0x180e1802100778ULL, 0x3c3e1e3c037007ULL},
+    {{21, 35}, 101234, 0x06300630063d7cULL, 0x7c3d060c180c18ULL},
+    {{21, 36}, 101236, 0x02200210061430ULL, 0x60050c04100408ULL},
+    {{21, 42}, 101248, 0x60030630063d7cULL, 0x7c3d060c180c18ULL},
+    {{21, 43}, 101250, 0x20020210061430ULL, 0x60050c04100408ULL},
+    {{21, 44}, 101258, 0x20020630062d6cULL, 0x1a340c0c180630ULL},
+    {{21, 45}, 101290, 0x70070630062d6cULL, 0x34340c0c0c1e3cULL},
+    {{21, 55}, 101318, 0x6d6d0120023434ULL, 0x60031c0e180e38ULL},
+    {{21, 62}, 101324, 0x680d022002341aULL, 0x20020c06100630ULL},
+    {{21, 69}, 101330, 0x1a340220020d68ULL, 0x20020c06100630ULL},
+    {{21, 76}, 101358, 0x34340220016d6dULL, 0x60031c0e180e38ULL},
+    {{22, 35}, 101360, 0x06300230021430ULL, 0x60050c04100408ULL},
+    {{22, 36}, 101361, 0x02200210021010ULL, 0x40011004100404ULL},
+    {{22, 42}, 101363, 0x60030230021430ULL, 0x60050c04100408ULL},
+    {{22, 43}, 101364, 0x20020210021010ULL, 0x40011004100404ULL},
+    {{22, 44}, 101365, 0x20020220020420ULL, 0x10040804100210ULL},
+    {{22, 45}, 101369, 0x70070220020420ULL, 0x20040804080e1cULL},
+    {{22, 55}, 101397, 0x6d6d0120023434ULL, 0x6003380e180e1cULL},
+    {{22, 62}, 101403, 0x680d022002341aULL, 0x20021806100618ULL},
+    {{22, 69}, 101409, 0x1a340220020d68ULL, 0x20021806100618ULL},
+    {{22, 76}, 101437, 0x34340220016d6dULL, 0x6003380e180e1cULL},
+    {{23, 37}, 101438, 0x02200210021010ULL, 0x04041004100140ULL},
+    {{23, 38}, 101440, 0x06300230021430ULL, 0x080410040c0560ULL},
+    {{23, 42}, 101444, 0x70070220020420ULL, 0x1c0e0804080420ULL},
+    {{23, 43}, 101445, 0x20020220020420ULL, 0x10021004080410ULL},
+    {{23, 44}, 101446, 0x20020210021010ULL, 0x04041004100140ULL},
+    {{23, 45}, 101448, 0x60030230021430ULL, 0x080410040c0560ULL},
+    {{23, 49}, 101476, 0x6d6d0120023434ULL, 0x1c0e180e380360ULL},
+    {{23, 56}, 101482, 0x680d022002341aULL, 0x18061006180220ULL},
+    {{23, 63}, 101488, 0x1a340220020d68ULL, 0x18061006180220ULL},
+    {{23, 70}, 101516, 0x34340220016d6dULL, 0x1c0e180e380360ULL},
+    {{24, 37}, 101518, 0x02200210061430ULL, 0x080410040c0560ULL},
+    {{24, 38}, 101530, 0x06300630063d7cULL, 0x180c180c063d7cULL},
+    {{24, 42}, 101562, 0x70070630062d6cULL, 0x3c1e0c0c0c3434ULL},
+    {{24, 43}, 101570, 0x20020630062d6cULL, 0x3006180c0c341aULL},
+    {{24, 44}, 101572, 0x20020210061430ULL, 0x080410040c0560ULL},
+    {{24, 45}, 101584, 0x60030630063d7cULL, 0x180c180c063d7cULL},
+    {{24, 49}, 101612, 0x6d6d0120023434ULL, 0x380e180e1c0360ULL},
+    {{24, 56}, 101618, 0x680d022002341aULL, 0x300610060c0220ULL},
+    {{24, 63}, 101624, 0x1a340220020d68ULL, 0x300610060c0220ULL},
+    {{24, 70}, 101652, 0x34340220016d6dULL, 0x380e180e1c0360ULL},
+    {{28, 42}, 104961, 0x700770077e3f7eULL, 0x7f7f0f3c3c3c3cULL},
+    {{28, 43}, 106016, 0x300370077e3f7eULL, 0x7e1f1e3c3c3c1eULL},
+    {{28, 44}, 106219, 0x100170077c177cULL, 0x1e3e1e3c3c1e1eULL},
+    {{28, 45}, 107505, 0x500170077e3f7eULL, 0x3e3e1e3c1e3e3eULL},
+    {{28, 54}, 107542, 0x78071002180e18ULL, 0x0770033c1e3e3cULL},
+    {{28, 55}, 108461, 0x7c0710023e3e3eULL, 0x70071f3e3e3e3eULL},
+    {{28, 61}, 108477, 0x6001200218040cULL, 0x032003381e1438ULL},
+    {{28, 62}, 108887, 0x700120023e1e1fULL, 0x30031f3e3e3e3eULL},
+    {{28, 68}, 108891, 0x08022002100220ULL, 0x02200138141438ULL},
+    {{28, 69}, 108992, 0x1c0220023c0f7cULL, 0x30031f3c1e3e3cULL},
+    {{28, 75}, 109043, 0x180220020e1e38ULL, 0x0770073e3c1e3cULL},
+    {{28, 76}, 109405, 0x380220021e3f7eULL, 0x70071f3e3e3e3eULL},
+    {{29, 42}, 110704, 0x700330037e3f7eULL, 0x7e1f1e3c3c3c1eULL},
+    {{29, 43}, 111498, 0x300330037e1f7eULL, 0x7c0f3c3c3c3c0fULL},
+    {{29, 44}, 111531, 0x100130023c1778ULL, 0x18063c3c3c0a0eULL},
+    {{29, 45}, 112069, 0x500130037e3f7eULL, 0x3e1e3c3c1e3e1eULL},
+    {{29, 55}, 112704, 0x780310023e3e3eULL, 0x70033e3e3e3e1fULL},
+    {{29, 62}, 113114, 0x700120023e1e1fULL, 0x30033e3e3e3e1fULL},
+    {{29, 69}, 113215, 0x1c0220023c0f7cULL, 0x30033e3c1e3e1eULL},
+    {{29, 76}, 113577, 0x380220021e3f7eULL, 0x70073e3e3e3e1fULL},
+    {{30, 42}, 114115, 0x500130037e3f7eULL, 0x1e3e1e3c3c1e3eULL},
+    {{30, 43}, 114148, 0x100130023c1778ULL, 0x0e0a3c3c3c0618ULL},
+    {{30, 44}, 114942, 0x300330037e1f7eULL, 0x0f3c3c3c3c0f7cULL},
+    {{30, 45}, 116241, 0x700330037e3f7eULL, 0x1e3c3c3c1e1f7eULL},
+    {{30, 49}, 116876, 0x780310023e3e3eULL, 0x1f3e3e3e3e0370ULL},
+    {{30, 56}, 117286, 0x700120023e1e1fULL, 0x1f3e3e3e3e0330ULL},
+    {{30, 63}, 117387, 0x1c0220023c0f7cULL, 0x1e3e1e3c3e0330ULL},
+    {{30, 70}, 117749, 0x380220021e3f7eULL, 0x1f3e3e3e3e0770ULL},
+    {{31, 42}, 119035, 0x500170077e3f7eULL, 0x3e3e1e3c1e3e3eULL},
+    {{31, 43}, 119238, 0x100170077c177cULL, 0x1e1e3c3c1e3e1eULL},
+    {{31, 44}, 120293, 0x300370077e3f7eULL, 0x1e3c3c3c1e1f7eULL},
+    {{31, 45}, 123602, 0x700770077e3f7eULL, 0x3c3c3c3c0f7f7fULL},
+    {{31, 49}, 124521, 0x7c0710023e3e3eULL, 0x3e3e3e3e1f0770ULL},
+    {{31, 50}, 124558, 0x78071002180e18ULL, 0x3c3e1e3c037007ULL},
+    {{31, 56}, 124968, 0x700120023e1e1fULL, 0x3e3e3e3e1f0330ULL},
+    {{31, 57}, 124984, 0x6001200218040cULL, 0x38141e38032003ULL},
+    {{31, 63}, 125085, 0x1c0220023c0f7cULL, 0x3c3e1e3c1f0330ULL},
+    {{31, 64}, 125089, 0x08022002100220ULL, 0x38141438012002ULL},
+    {{31, 70}, 125451, 0x380220021e3f7eULL, 0x3e3e3e3e1f0770ULL},
+    {{31, 71}, 125502, 0x180220020e1e38ULL, 0x3c1e3c3e077007ULL},
+    {{35, 49}, 125623, 0x0770073e3e3e3cULL, 0x7c3f0e1e1c0220ULL},
+    {{35, 51}, 125674, 0x0770073e3c1e3cULL, 0x381e0e02200218ULL},
+    {{35, 53}, 125711, 0x0770033c1e3e3cULL, 0x78071002180e18ULL},
+    {{35, 55}, 125751, 0x07700138141438ULL, 0x70070806180610ULL},
+    {{35, 62}, 125761, 0x0410023814141cULL, 0x20020806180610ULL},
+    {{35, 69}, 125763, 0x01200230140560ULL, 0x20020802100410ULL},
+    {{35, 76}, 125775, 0x022002380a1578ULL, 0x60030806180610ULL},
+    {{36, 49}, 125799, 0x0320033c3e1638ULL, 0x60071c06180210ULL},
+    {{36, 51}, 125803, 0x02200138141438ULL, 0x20021002200208ULL},
+    {{36, 53}, 125819, 0x032003381e1438ULL, 0x6001200218040cULL},
+    {{36, 55}, 125829, 0x02200138141438ULL, 0x40011006180608ULL},
+    {{36, 69}, 125831, 0x01200230140560ULL, 0x20021002100408ULL},
+    {{36, 76}, 125843, 0x022002380a1578ULL, 0x60031006180608ULL},
+    {{37, 49}, 125853, 0x02200138141438ULL, 0x08061806100140ULL},
+    {{37, 51}, 125869, 0x032003381e1438ULL, 0x0c041802200160ULL},
+    {{37, 53}, 125873, 0x02200138141438ULL, 0x08022002100220ULL},
+    {{37, 55}, 125897, 0x0320033c3e1638ULL, 0x100218061c0760ULL},
+    {{37, 63}, 125899, 0x01200230140560ULL, 0x08041002100220ULL},
+    {{37, 70}, 125911, 0x022002380a1578ULL, 0x08061806100360ULL},
+    {{38, 49}, 125951, 0x07700138141438ULL, 0x10061806080770ULL},
+    {{38, 51}, 125988, 0x0770033c1e3e3cULL, 0x180e1802100778ULL},
+    {{38, 53}, 126039, 0x0770073e3c1e3cULL, 0x180220020e1e38ULL},
+    {{38, 55}, 126160, 0x0770073e3e3e3cULL, 0x20021c1e0e3f7cULL},
+    {{38, 56}, 126170, 0x0410023814141cULL, 0x10061806080220ULL},
+    {{38, 63}, 126172, 0x01200230140560ULL, 0x10041002080220ULL},
+    {{38, 70}, 126184, 0x022002380a1578ULL, 0x10061806080360ULL},
+    {{42, 49}, 127888, 0x70071f3e3e3e3eULL, 0x7f7f1f3e3e0220ULL},
+    {{42, 50}, 127900, 0x60030806180610ULL, 0x78150a38022002ULL},
+    {{42, 51}, 128262, 0x70071f3e3e3e3eULL, 0x7e3f1e02200238ULL},
+    {{42, 52}, 128290, 0x60031c0e180e38ULL, 0x6d6d0120023434ULL},
+    {{42, 53}, 129209, 0x70071f3e3e3e3eULL, 0x7c0710023e3e3eULL},
+    {{42, 54}, 129249, 0x70070806180610ULL, 0x07700138141438ULL},
+    {{42, 55}, 131581, 0x70071f3e3e3e3eULL, 0x70071f3e3e3e3eULL},
+    {{42, 56}, 133285, 0x70073e3e3e3e1fULL, 0x7f7f1f3e3e0220ULL},
+    {{42, 57}, 133297, 0x60031006180608ULL, 0x78150a38022002ULL},
+    {{42, 58}, 133659, 0x70073e3e3e3e1fULL, 0x7e3f1e02200238ULL},
+    {{42, 59}, 133687, 0x6003380e180e1cULL, 0x6d6d0120023434ULL},
+    {{42, 60}, 134322, 0x70033e3e3e3e1fULL, 0x780310023e3e3eULL},
+    {{42, 61}, 134332, 0x40011006180608ULL, 0x02200138141438ULL},
+    {{42, 62}, 135182, 0x50013e3e3e3e1fULL, 0x30031f3e3e3e3eULL},
+    {{42, 68}, 135206, 0x100218061c0760ULL, 0x0320033c3e1638ULL},
+    {{42, 69}, 135900, 0x10023e3e3e0f7cULL, 0x30031f3e3e3e3eULL},
+    {{42, 75}, 136021, 0x20021c1e0e3f7cULL, 0x0770073e3e3e3cULL},
+    {{42, 76}, 137725, 0x20023e3e1f7f7fULL, 0x70071f3e3e3e3eULL},
+    {{43, 49}, 138419, 0x30031f3e3e3e3eULL, 0x7c0f3e3e3e0210ULL},
+    {{43, 50}, 138421, 0x20020802100410ULL, 0x60051430022001ULL},
+    {{43, 51}, 138522, 0x30031f3c1e3e3cULL, 0x7c0f3c0220021cULL},
+    {{43, 52}, 138528, 0x20020c06100630ULL, 0x680d022002341aULL},
+    {{43, 53}, 138938, 0x30031f3e3e3e3eULL, 0x700120023e1e1fULL},
+    {{43, 54}, 138948, 0x20020806180610ULL, 0x0410023814141cULL},
+    {{43, 55}, 139798, 0x30031f3e3e3e3eULL, 0x50013e3e3e3e1fULL},
+    {{43, 56}, 140492, 0x30033e3e3e3e1fULL, 0x7c0f3e3e3e0210ULL},
+    {{43, 57}, 140494, 0x20021002100408ULL, 0x60051430022001ULL},
+    {{43, 58}, 140595, 0x30033e3c1e3e1eULL, 0x7c0f3c0220021cULL},
+    {{43, 59}, 140601, 0x20021806100618ULL, 0x680d022002341aULL},
+    {{43, 60}, 141011, 0x30033e3e3e3e1fULL, 0x700120023e1e1fULL},
+    {{43, 62}, 141083, 0x100138163c161cULL, 0x100138163c161cULL},
+    {{43, 69}, 141777, 0x10023e3e3e0f7cULL, 0x30033e3e3e3e1fULL},
+    {{43, 76}, 143481, 0x20023e3e1f7f7fULL, 0x70073e3e3e3e1fULL},
+    {{44, 49}, 144331, 0x30031f3e3e3e3eULL, 0x1f3e3e3e3e0150ULL},
+    {{44, 50}, 144341, 0x20020806180610ULL, 0x1c141438021004ULL},
+    {{44, 51}, 144751, 0x30031f3e3e3e3eULL, 0x1f1e3e02200170ULL},
+    {{44, 52}, 144757, 0x20020c06100630ULL, 0x1a340220020d68ULL},
+    {{44, 53}, 144858, 0x30031f3c1e3e3cULL, 0x1c0220023c0f7cULL},
+    {{44, 54}, 144860, 0x20020802100410ULL, 0x01200230140560ULL},
+    {{44, 55}, 145554, 0x30031f3e3e3e3eULL, 0x10023e3e3e0f7cULL},
+    {{44, 56}, 145626, 0x100138163c161cULL, 0x1c163c16380110ULL},
+    {{44, 58}, 146036, 0x30033e3e3e3e1fULL, 0x1f1e3e02200170ULL},
+    {{44, 59}, 146042, 0x20021806100618ULL, 0x1a340220020d68ULL},
+    {{44, 60}, 146143, 0x30033e3c1e3e1eULL, 0x1c0220023c0f7cULL},
+    {{44, 61}, 146145, 0x20021002100408ULL, 0x01200230140560ULL},
+    {{44, 62}, 146839, 0x30033e3e3e3e1fULL, 0x10023e3e3e0f7cULL},
+    {{44, 63}, 147533, 0x10023e3e3e0f7cULL, 0x1f3e3e3e3e0330ULL},
+    {{44, 70}, 149237, 0x20023e3e1f7f7fULL, 0x1f3e3e3e3e0770ULL},
+    {{45, 49}, 151569, 0x70071f3e3e3e3eULL, 0x3e3e3e3e1f0770ULL},
+    {{45, 50}, 151609, 0x70070806180610ULL, 0x38141438017007ULL},
+    {{45, 51}, 152528, 0x70071f3e3e3e3eULL, 0x3e3e3e0210077cULL},
+    {{45, 52}, 152556, 0x60031c0e180e38ULL, 0x34340220016d6dULL},
+    {{45, 53}, 152918, 0x70071f3e3e3e3eULL, 0x380220021e3f7eULL},
+    {{45, 54}, 152930, 0x60030806180610ULL, 0x022002380a1578ULL},
+    {{45, 55}, 154634, 0x70071f3e3e3e3eULL, 0x20023e3e1f7f7fULL},
+    {{45, 56}, 155484, 0x50013e3e3e3e1fULL, 0x3e3e3e3e1f0330ULL},
+    {{45, 57}, 155494, 0x40011006180608ULL, 0x38141438012002ULL},
+    {{45, 58}, 156129, 0x70033e3e3e3e1fULL, 0x3e3e3e02100378ULL},
+    {{45, 59}, 156157, 0x6003380e180e1cULL, 0x34340220016d6dULL},
+    {{45, 60}, 156519, 0x70073e3e3e3e1fULL, 0x380220021e3f7eULL},
+    {{45, 61}, 156531, 0x60031006180608ULL, 0x022002380a1578ULL},
+    {{45, 62}, 158235, 0x70073e3e3e3e1fULL, 0x20023e3e1f7f7fULL},
+    {{45, 63}, 158929, 0x10023e3e3e0f7cULL, 0x3e3e3e3e1f0330ULL},
+    {{45, 64}, 158953, 0x100218061c0760ULL, 0x38163e3c032003ULL},
+    {{45, 70}, 160657, 0x20023e3e1f7f7fULL, 0x3e3e3e3e1f0770ULL},
+    {{45, 71}, 160778, 0x20021c1e0e3f7cULL, 0x3c3e3e3e077007ULL},
+    {{49, 51}, 164087, 0x7f7f0f3c3c3c3cULL, 0x7e3f7e07700770ULL},
+    {{49, 52}, 164099, 0x7c3d060c180c18ULL, 0x7c3d0630060360ULL},
+    {{49, 53}, 165114, 0x7f3f071c1c1c1cULL, 0x7c0770077c0770ULL},
+    {{49, 54}, 165124, 0x7435060c180c18ULL, 0x0630062f7c0360ULL},
+    {{49, 55}, 167777, 0x7f7f0f3c3c3c3cULL, 0x70077e3f7e0770ULL},
+    {{49, 58}, 169076, 0x7e1f1e3c3c3c1eULL, 0x7e3f7e03300370ULL},
+    {{49, 59}, 169078, 0x60050c04100408ULL, 0x30140230020360ULL},
+    {{49, 60}, 169466, 0x7e0f0e1c1c1c0eULL, 0x7c0330037c0770ULL},
+    {{49, 61}, 169468, 0x60050c04100408ULL, 0x0220020c300360ULL},
+    {{49, 62}, 170578, 0x7e1f1e3c3c3c1eULL, 0x30037e3f7e0770ULL},
+    {{49, 65}, 171116, 0x1e3e1e3c3c1e3eULL, 0x7e3f7e03300150ULL},
+    {{49, 66}, 171120, 0x1c0e0804080420ULL, 0x20040220020770ULL},
+    {{49, 67}, 171616, 0x1f3e0e1c1c0e3eULL, 0x7c0330037c0770ULL},
+    {{49, 68}, 171617, 0x08040804080420ULL, 0x02200204200140ULL},
+    {{49, 69}, 172410, 0x1f3e1e3c3c1e3eULL, 0x30037e3f7e0770ULL},
+    {{49, 72}, 173696, 0x3e3e1e3c1e3e3eULL, 0x7e3f7e07700150ULL},
+    {{49, 73}, 173728, 0x3c1e0c0c0c3434ULL, 0x6c2d0630060770ULL},
+    {{49, 74}, 174795, 0x3e3e0e1c0e3e3eULL, 0x7c0770077c0770ULL},
+    {{49, 75}, 174813, 0x1c1e0c0c0c3434ULL, 0x0630063f7c0770ULL},
+    {{49, 76}, 177029, 0x3e3e1e3c1e3e3eULL, 0x70077e3f7e0770ULL},
+    {{50, 52}, 177041, 0x7c3d060c180c18ULL, 0x7c3d0630063006ULL},
+    {{50, 53}, 177042, 0x10100204080808ULL, 0x40014001041004ULL},
+    {{50, 55}, 177052, 0x7435060c180c18ULL, 0x60037c2f063006ULL},
+    {{50, 59}, 177054, 0x60050c04100408ULL, 0x30140230023006ULL},
+    {{50, 62}, 177056, 0x60050c0c180408ULL, 0x2002300a063006ULL},
+    {{50, 67}, 177057, 0x08100404080410ULL, 0x40012002041004ULL},
+    {{50, 69}, 177063, 0x18140c04180610ULL, 0x30023c3e061004ULL},
+    {{50, 74}, 177067, 0x10100404041c1cULL, 0x40017007041004ULL},
+    {{50, 76}, 177085, 0x34340c0c0c1e1cULL, 0x70077c3f063006ULL},
+    {{51, 53}, 178440, 0x7f3f071c1c1c1cULL, 0x7c07700770077cULL},
+    {{51, 54}, 178441, 0x10100204080808ULL, 0x04100401400140ULL},
+    {{51, 55}, 179456, 0x7f3f071c1c1c1cULL, 0x70077c0770077cULL},
+    {{51, 56}, 180511, 0x7e1f1e3c3c3c1eULL, 0x7e3f7e07700330ULL},
+    {{51, 60}, 180981, 0x7e0f0e1c1c1c0eULL, 0x7c03300370077cULL},
+    {{51, 62}, 181277, 0x7e0f0e1c1c1c0eULL, 0x30037c07700778ULL},
+    {{51, 63}, 181480, 0x1e3e1e3c3c1e1eULL, 0x7c177c07700110ULL},
+    {{51, 67}, 181680, 0x1e3e0e1c1c0e3eULL, 0x7c033001700778ULL},
+    {{51, 69}, 182102, 0x1f3e0e1c1c0e3eULL, 0x30037c0770077cULL},
+    {{51, 70}, 183388, 0x3e3e1e3c1e3e3eULL, 0x7e3f7e07700150ULL},
+    {{51, 74}, 183962, 0x3e3e0e1c0e3e3eULL, 0x7c07700170077cULL},
+    {{51, 75}, 183966, 0x1c1c0404041010ULL, 0x04100407700140ULL},
+    {{51, 76}, 185033, 0x3e3e0e1c0e3e3eULL, 0x70077c0770077cULL},
+    {{52, 54}, 185045, 0x7c3d060c180c18ULL, 0x06300630063d7cULL},
+    {{52, 55}, 185057, 0x7c3d060c180c18ULL, 0x60030630063d7cULL},
+    {{52, 56}, 185059, 0x60050c04100408ULL, 0x30140610020220ULL},
+    {{52, 57}, 185061, 0x60050c04100408ULL, 0x30140610022002ULL},
+    {{52, 61}, 185063, 0x60050c04100408ULL, 0x02200210061430ULL},
+    {{52, 62}, 185065, 0x60050c04100408ULL, 0x20020210061430ULL},
+    {{52, 63}, 185073, 0x1a340c0c180630ULL, 0x6c2d0630060220ULL},
+    {{52, 69}, 185081, 0x1a340c0c180630ULL, 0x20020630062d6cULL},
+    {{52, 70}, 185113, 0x34340c0c0c1e3cULL, 0x6c2d0630060770ULL},
+    {{52, 76}, 185145, 0x34340c0c0c1e3cULL, 0x70070630062d6cULL},
+    {{53, 55}, 188454, 0x7f7f0f3c3c3c3cULL, 0x700770077e3f7eULL},
+    {{53, 56}, 188750, 0x7e0f0e1c1c1c0eULL, 0x780770077c0330ULL},
+    {{53, 58}, 189220, 0x7e0f0e1c1c1c0eULL, 0x7c07700330037cULL},
+    {{53, 62}, 190275, 0x7e1f1e3c3c3c1eULL, 0x300370077e3f7eULL},
+    {{53, 63}, 190697, 0x1f3e0e1c1c0e3eULL, 0x7c0770077c0330ULL},
+    {{53, 65}, 190897, 0x1e3e0e1c1c0e3eULL, 0x7807700130037cULL},
+    {{53, 69}, 191100, 0x1e3e1e3c3c1e1eULL, 0x100170077c177cULL},
+    {{53, 70}, 192167, 0x3e3e0e1c0e3e3eULL, 0x7c0770077c0770ULL},
+    {{53, 71}, 192171, 0x1c1c0404041010ULL, 0x40017007041004ULL},
+    {{53, 72}, 192745, 0x3e3e0e1c0e3e3eULL, 0x7c07700170077cULL},
+    {{53, 76}, 194031, 0x3e3e1e3c1e3e3eULL, 0x500170077e3f7eULL},
+    {{54, 56}, 194033, 0x60050c0c180408ULL, 0x0630060a300220ULL},
+    {{54, 59}, 194035, 0x60050c04100408ULL, 0x06300230021430ULL},
+    {{54, 63}, 194041, 0x18140c04180610ULL, 0x0410063e3c0230ULL},
+    {{54, 65}, 194042, 0x08100404080410ULL, 0x04100402200140ULL},
+    {{54, 70}, 194060, 0x34340c0c0c1e1cULL, 0x0630063f7c0770ULL},
+    {{54, 72}, 194064, 0x10100404041c1cULL, 0x04100407700140ULL},
+    {{55, 56}, 195174, 0x7e1f1e3c3c3c1eULL, 0x70077e3f7e0330ULL},
+    {{55, 57}, 195176, 0x60050c04100408ULL, 0x6003300c022002ULL},
+    {{55, 58}, 195564, 0x7e0f0e1c1c1c0eULL, 0x70077c0330037cULL},
+    {{55, 59}, 195566, 0x60050c04100408ULL, 0x60030230021430ULL},
+    {{55, 60}, 196865, 0x7e1f1e3c3c3c1eULL, 0x700330037e3f7eULL},
+    {{55, 63}, 197658, 0x1f3e1e3c3c1e3eULL, 0x70077e3f7e0330ULL},
+    {{55, 64}, 197659, 0x08040804080420ULL, 0x40012004022002ULL},
+    {{55, 65}, 198155, 0x1f3e0e1c1c0e3eULL, 0x70077c0330037cULL},
+    {{55, 66}, 198159, 0x1c0e0804080420ULL, 0x70070220020420ULL},
+    {{55, 67}, 198697, 0x1e3e1e3c3c1e3eULL, 0x500130037e3f7eULL},
+    {{55, 70}, 200913, 0x3e3e1e3c1e3e3eULL, 0x70077e3f7e0770ULL},
+    {{55, 71}, 200931, 0x1c1e0c0c0c3434ULL, 0x70077c3f063006ULL},
+    {{55, 72}, 201998, 0x3e3e0e1c0e3e3eULL, 0x70077c0770077cULL},
+    {{55, 73}, 202030, 0x3c1e0c0c0c3434ULL, 0x70070630062d6cULL},
+    {{55, 74}, 203316, 0x3e3e1e3c1e3e3eULL, 0x500170077e3f7eULL},
+    {{56, 58}, 204110, 0x7c0f3c3c3c3c0fULL, 0x7e1f7e03300330ULL},
+    {{56, 59}, 204111, 0x40011004100404ULL, 0x10100210020220ULL},
+    {{56, 60}, 204207, 0x78031c1c1c1807ULL, 0x780330037c0330ULL},
+    {{56, 61}, 204208, 0x40011004100404ULL, 0x02200208100220ULL},
+    {{56, 62}, 204665, 0x78033c3c3c3c0fULL, 0x30037e3f7e0330ULL},
+    {{56, 65}, 204698, 0x0e0a3c3c3c0618ULL, 0x78173c02300110ULL},
+    {{56, 66}, 204699, 0x10021004080410ULL, 0x20040220020220ULL},
+    {{56, 67}, 204891, 0x1e0e1c181c0e1eULL, 0x780330037c0330ULL},
+    {{56, 69}, 205091, 0x1e0e3c3c3c0e1eULL, 0x30037e3f7e0330ULL},
+    {{56, 72}, 205294, 0x1e1e3c3c1e3e1eULL, 0x7c177c07700110ULL},
+    {{56, 73}, 205302, 0x3006180c0c341aULL, 0x6c2d0630060220ULL},
+    {{56, 74}, 205724, 0x3e0e1c1c0e3e1fULL, 0x7c0770077c0330ULL},
+    {{56, 75}, 205730, 0x100618040c1418ULL, 0x0410063e3c0230ULL},
+    {{56, 76}, 206523, 0x3e1e3c3c1e3e1fULL, 0x70077e3f7e0330ULL},
+    {{57, 59}, 206524, 0x40011004100404ULL, 0x10100210022002ULL},
+    {{57, 62}, 206525, 0x40011004100404ULL, 0x20021008022002ULL},
+    {{57, 76}, 206526, 0x20040804080408ULL, 0x40012004022002ULL},
+    {{58, 60}, 206810, 0x7c071c1c1c1807ULL, 0x78033003300378ULL},
+    {{58, 62}, 206906, 0x78031c1c1c1807ULL, 0x30037c03300378ULL},
+    {{58, 63}, 206939, 0x18063c3c3c0a0eULL, 0x78173c02300110ULL},
+    {{58, 67}, 206987, 0x1e0e1c181c0e1eULL, 0x78033001300378ULL},
+    {{58, 69}, 207179, 0x1e0e1c181c0e1eULL, 0x30037c03300378ULL},
+    {{58, 70}, 207717, 0x3e1e3c3c1e3e1eULL, 0x7e3f7e03300150ULL},
+    {{58, 74}, 207917, 0x3e0e1c1c0e3e1eULL, 0x7807700130037cULL},
+    {{58, 75}, 207918, 0x10040804041008ULL, 0x04100402200140ULL},
+    {{58, 76}, 208414, 0x3e0e1c1c0e3e1fULL, 0x70077c0330037cULL},
+    {{59, 61}, 208415, 0x40011004100404ULL, 0x02200210021010ULL},
+    {{59, 62}, 208416, 0x40011004100404ULL, 0x20020210021010ULL},
+    {{59, 63}, 208417, 0x10040804100210ULL, 0x20040220020220ULL},
+    {{59, 69}, 208418, 0x10040804100210ULL, 0x20020220020420ULL},
+    {{59, 70}, 208422, 0x20040804080e1cULL, 0x20040220020770ULL},
+    {{59, 76}, 208426, 0x20040804080e1cULL, 0x70070220020420ULL},
+    {{60, 62}, 209220, 0x7c0f3c3c3c3c0fULL, 0x300330037e1f7eULL},
+    {{60, 63}, 209412, 0x1e0e1c181c0e1eULL, 0x780330037c0330ULL},
+    {{60, 65}, 209460, 0x1e0e1c181c0e1eULL, 0x78033001300378ULL},
+    {{60, 69}, 209493, 0x18063c3c3c0a0eULL, 0x100130023c1778ULL},
+    {{60, 70}, 209989, 0x3e0e1c1c0e3e1fULL, 0x7c0330037c0770ULL},
+    {{60, 71}, 209990, 0x10040804041008ULL, 0x40012002041004ULL},
+    {{60, 72}, 210190, 0x3e0e1c1c0e3e1eULL, 0x7c033001700778ULL},
+    {{60, 76}, 210728, 0x3e1e3c3c1e3e1eULL, 0x500130037e3f7eULL},
+    {{61, 70}, 210729, 0x20040804080408ULL, 0x02200204200140ULL},
+    {{62, 63}, 210929, 0x1e0e3c3c3c0e1eULL, 0x30037e3f7e0330ULL},
+    {{62, 65}, 211121, 0x1e0e1c181c0e1eULL, 0x30037c03300378ULL},
+    {{62, 66}, 211122, 0x10021004080410ULL, 0x20020220020420ULL},
+    {{62, 67}, 211155, 0x0e0a3c3c3c0618ULL, 0x100130023c1778ULL},
+    {{62, 70}, 211948, 0x3e1e3c3c1e3e1fULL, 0x30037e3f7e0770ULL},
+    {{62, 71}, 211954, 0x100618040c1418ULL, 0x30023c3e061004ULL},
+    {{62, 72}, 212376, 0x3e0e1c1c0e3e1fULL, 0x30037c0770077cULL},
+    {{62, 73}, 212384, 0x3006180c0c341aULL, 0x20020630062d6cULL},
+    {{62, 74}, 212587, 0x1e1e3c3c1e3e1eULL, 0x100170077c177cULL},
+    {{63, 65}, 213381, 0x0f3c3c3c3c0f7cULL, 0x7e1f7e03300330ULL},
+    {{63, 66}, 213382, 0x04041004100140ULL, 0x10100210020220ULL},
+    {{63, 67}, 213478, 0x07181c1c1c0378ULL, 0x780330037c0330ULL},
+    {{63, 68}, 213479, 0x04041004100140ULL, 0x02200208100220ULL},
+    {{63, 69}, 213936, 0x0f3c3c3c3c0378ULL, 0x30037e3f7e0330ULL},
+    {{63, 72}, 214991, 0x1e3c3c3c1e1f7eULL, 0x7e3f7e07700330ULL},
+    {{63, 73}, 214993, 0x080410040c0560ULL, 0x30140610020220ULL},
+    {{63, 74}, 215289, 0x0e1c1c1c0e0f7eULL, 0x780770077c0330ULL},
+    {{63, 75}, 215291, 0x0804180c0c0560ULL, 0x0630060a300220ULL},
+    {{63, 76}, 216401, 0x1e3c3c3c1e1f7eULL, 0x70077e3f7e0330ULL},
+    {{64, 66}, 216402, 0x04041004100140ULL, 0x10100210022002ULL},
+    {{64, 69}, 216403, 0x04041004100140ULL, 0x20021008022002ULL},
+    {{64, 73}, 216405, 0x080410040c0560ULL, 0x30140610022002ULL},
+    {{64, 76}, 216407, 0x080410040c0560ULL, 0x6003300c022002ULL},
+    {{65, 67}, 216691, 0x07181c1c1c077cULL, 0x78033003300378ULL},
+    {{65, 69}, 216787, 0x07181c1c1c0378ULL, 0x30037c03300378ULL},
+    {{65, 70}, 218086, 0x1e3c3c3c1e1f7eULL, 0x7e3f7e03300370ULL},
+    {{65, 74}, 218556, 0x0e1c1c1c0e0f7eULL, 0x7c07700330037cULL},
+    {{65, 76}, 218944, 0x0e1c1c1c0e0f7eULL, 0x70077c0330037cULL},
+    {{66, 68}, 218945, 0x04041004100140ULL, 0x02200210021010ULL},
+    {{66, 69}, 218946, 0x04041004100140ULL, 0x20020210021010ULL},
+    {{66, 70}, 218948, 0x080410040c0560ULL, 0x30140230020360ULL},
+    {{66, 71}, 218950, 0x080410040c0560ULL, 0x30140230023006ULL},
+    {{66, 75}, 218952, 0x080410040c0560ULL, 0x06300230021430ULL},
+    {{66, 76}, 218954, 0x080410040c0560ULL, 0x60030230021430ULL},
+    {{67, 69}, 219748, 0x0f3c3c3c3c0f7cULL, 0x300330037e1f7eULL},
+    {{67, 70}, 220136, 0x0e1c1c1c0e0f7eULL, 0x7c0330037c0770ULL},
+    {{67, 72}, 220606, 0x0e1c1c1c0e0f7eULL, 0x7c03300370077cULL},
+    {{67, 76}, 221905, 0x1e3c3c3c1e1f7eULL, 0x700330037e3f7eULL},
+    {{68, 70}, 221907, 0x080410040c0560ULL, 0x0220020c300360ULL},
+    {{68, 73}, 221909, 0x080410040c0560ULL, 0x02200210061430ULL},
+    {{69, 70}, 223019, 0x1e3c3c3c1e1f7eULL, 0x30037e3f7e0770ULL},
+    {{69, 71}, 223021, 0x0804180c0c0560ULL, 0x2002300a063006ULL},
+    {{69, 72}, 223317, 0x0e1c1c1c0e0f7eULL, 0x30037c07700778ULL},
+    {{69, 73}, 223319, 0x080410040c0560ULL, 0x20020210061430ULL},
+    {{69, 74}, 224374, 0x1e3c3c3c1e1f7eULL, 0x300370077e3f7eULL},
+    {{70, 72}, 227683, 0x3c3c3c3c0f7f7fULL, 0x7e3f7e07700770ULL},
+    {{70, 73}, 227695, 0x180c180c063d7cULL, 0x7c3d0630060360ULL},
+    {{70, 74}, 228710, 0x1c1c1c1c073f7fULL, 0x7c0770077c0770ULL},
+    {{70, 75}, 228720, 0x180c180c063574ULL, 0x0630062f7c0360ULL},
+    {{70, 76}, 231373, 0x3c3c3c3c0f7f7fULL, 0x70077e3f7e0770ULL},
+    {{71, 73}, 231385, 0x180c180c063d7cULL, 0x7c3d0630063006ULL},
+    {{71, 74}, 231386, 0x08080804021010ULL, 0x40014001041004ULL},
+    {{71, 76}, 231396, 0x180c180c063574ULL, 0x60037c2f063006ULL},
+    {{72, 74}, 232751, 0x1c1c1c1c073f7fULL, 0x7c07700770077cULL},
+    {{72, 75}, 232752, 0x08080804021010ULL, 0x04100401400140ULL},
+    {{72, 76}, 233767, 0x1c1c1c1c073f7fULL, 0x70077c0770077cULL},
+    {{73, 75}, 233779, 0x180c180c063d7cULL, 0x06300630063d7cULL},
+    {{73, 76}, 233791, 0x180c180c063d7cULL, 0x60030630063d7cULL},
+    {{74, 76}, 237100, 0x3c3c3c3c0f7f7fULL, 0x700770077e3f7eULL},
+};
+
+/* number of layouts */
+#define LAYOUT7_NUM (layout7_table[lenof(layout7_table) - 1].end)
+
+/* constraints of the layouts sought by layout7_enum(): row and column 
+sums (-1: hidden), cells which must be vacant */
+struct layout7_filter {
+    const int *rows, *cols;
+    unsigned long long vacant;
+};
+
+/* visitor of layout7_enum(): called per layout with the positions and 
+the cells of the ships; returns true to stop the enumeration */
+typedef bool (*layout7_visit_fn)(
+  const int *pos, unsigned long long cells, void *ctx
+);
+
+
+/* number of cells of a row (7 bits) */
+static int layout7_bits(unsigned long long row)
+{
+    int n = 0;
+    for (; row; row &= row - 1) n++;
+    return n;
+}
+
+
+/*
+Cells of a ship of the 7x7 grid
+
+Parameters:
+  ship: ship size;
+  p: position (see layout7_table);
+  *halo: set to the cells of the ship and around it.
+
+Returns the cells of the ship, 0 if it does not fit into the grid.
+
+*/
+static unsigned long long layout7_cells(
+  int ship, int p, unsigned long long *halo
+)
+{
+    int vert = p/49, y = (p % 49)/7, x = p % 7;
+    int ship_H = vert*ship + 1 - vert, ship_W = (1 - vert)*ship + vert;
+    int i, j;
+    unsigned long long cells = 0;
+    
+    *halo = 0;
+    if (y + ship_H > 7 || x + ship_W > 7) return 0;
+    for (i = max(y-1, 0); i < min(y + ship_H + 1, 7); i++) {
+        for (j = max(x-1, 0); j < min(x + ship_W + 1, 7); j++) {
+            *halo |= 1ULL << (7*i + j);
+            if (i >= y && i < y + ship_H && j >= x && j < x + ship_W) {
+                cells |= 1ULL << (7*i + j);
+            }
+        }
+    }
+    return cells;
+}
+
+
+/* the row and column sums of the cells do not exceed those of *f (all
+equal if final) */
+static bool layout7_sums(
+  unsigned long long cells, const struct layout7_filter *f, bool final
+)
+{
+    int i, j, n;
+    
+    for (i = 0; i < 7; i++) {
+        if (f->rows[i] < 0) continue;
+        n = layout7_bits((cells >> 7*i) & 0x7f);
+        if (n > f->rows[i] || final && n != f->rows[i]) return false;
+    }
+    for (j = 0; j < 7; j++) {
+        if (f->cols[j] < 0) continue;
+        n = 0;
+        for (i = 0; i < 7; i++) n += (cells >> (7*i + j)) & 1;
+        if (n > f->cols[j] || final && n != f->cols[j]) return false;
+    }
+    return true;
+}
+
+
+/* cells of the ships of sizes 2, 3, 4 per position, and the cells around
+them (see layout7_cells()), tabulated for layout7_enum() */
+struct layout7_geom {
+    unsigned long long cells[3][98], halo[3][98];
+};
+
+
+static void layout7_geom_init(struct layout7_geom *g)
+{
+    int ship, p;
+    
+    for (ship = 2; ship <= 4; ship++) {
+        for (p = 0; p < 98; p++) {
+            g->cells[ship-2][p] = layout7_cells(ship, p, &g->halo[ship-2][p]);
+        }
+    }
+}
+
+
+/*
+Enumerate the layouts of the 7x7 grid which complete given ships
+
+Parameters:
+  *g: cells of the ships per position;
+  k: number of the next ship (layout7_ships);
+  start: first position of ship k (after the previous ship if it has the
+same size);
+  cells, halo: cells of the ships 0, ..., k-1, and the cells around them;
+  *pos: array of size 7 with the positions of the ships 0, ..., k-1, 
+where those of the following ships are set;
+  *f: constraints of the layouts (NULL if none);
+  visit, *ctx: visitor called per layout, with its context.
+
+Returns true if the visitor stopped the enumeration.
+
+*/
+static bool layout7_enum(
+  const struct layout7_geom *g, int k, int start, unsigned long long cells,
+  unsigned long long halo, int *pos, const struct layout7_filter *f, 
+  layout7_visit_fn visit, void *ctx
+)
+{
+    int p, ship;
+    unsigned long long c;
+    
+    if (k == 7) {
+        if (f && ! layout7_sums(cells, f, true)) return false;
+        return visit(pos, cells, ctx);
+    }
+    ship = layout7_ships[k];
+    for (p = start; p < 98; p++) {
+        c = g->cells[ship-2][p];
+        if (! c || (c & halo) || f && (
+          (c & f->vacant) || ! layout7_sums(cells | c, f, false)
+        )) continue;
+        pos[k] = p;
+        if (layout7_enum(
+          g, k + 1, (k < 6 && layout7_ships[k+1] == ship ? p+1 : 0),
+          cells | c, halo | g->halo[ship-2][p], pos, f, visit, ctx
+        )) return true;
+    }
+    return false;
+}
+
+
+/* the puzzle has the fleet of the 7x7 grid */
+static bool layout7_fleet(const struct game_state_const *init_state)
+{
+    return (
+      init_state->H == 7 && init_state->W == 7 && 
+      init_state->num_ships == 7 && ! memcmp(
+        init_state->ships, layout7_ships, sizeof(layout7_ships)
+      )
+    );
+}
+
+
+/* visitor of layout7_sample(): counts down the rank *ctx */
+static bool layout7_rank(const int *pos, unsigned long long cells, void *ctx)
+{
+    return (*(int *) ctx)-- == 0;
+}
+
+
+/*
+Uniformly random layout of the fleet of the 7x7 grid
+
+The layout is drawn by its number: the group is found by bisection of 
+layout7_table, and the layout within it by layout7_enum().
+
+Parameters:
+  *rs: random state;
+  **ship_coord: 7 x 3 array where the ship coordinates (vert, y, x) are
+saved, in the order of layout7_ships.
+
+*/
+static void layout7_sample(random_state *rs, int **ship_coord)
+{
+    int r = random_upto(rs, LAYOUT7_NUM);
+    int lo = 0, hi = lenof(layout7_table) - 1, mid, k, pos[7];
+    struct layout7_geom g;
+    
+    while (lo < hi) {
+        mid = (lo + hi)/2;
+        if (layout7_table[mid].end > r) hi = mid;
+        else lo = mid + 1;
+    }
+    if (lo > 0) r -= layout7_table[lo - 1].end;
+    
+    layout7_geom_init(&g);
+    pos[0] = layout7_table[lo].pos[0];
+    pos[1] = layout7_table[lo].pos[1];
+    layout7_enum(
+      &g, 2, 0, g.cells[2][pos[0]] | g.cells[2][pos[1]], 
+      g.halo[2][pos[0]] | g.halo[2][pos[1]], pos, NULL, layout7_rank, &r
+    );
+    
+    for (k = 0; k < 7; k++) {
+        ship_coord[k][0] = pos[k]/49;
+        ship_coord[k][1] = (pos[k] % 49)/7;
+        ship_coord[k][2] = pos[k] % 7;
+    }
+}
+
+
+/* state of layout7_match() */
+struct layout7_match_ctx {
+    int **init_ext;
+    unsigned long long occup;
+    int num, max;
+    int **coord[2];
+    int *occupied;
+};
+
+
+/* visitor of layout7_match(): checks the disclosed cells */
+static bool layout7_match_visit(
+  const int *pos, unsigned long long cells, void *ctx
+)
+{
+    struct layout7_match_ctx *m = ctx;
+    int **init = m->init_ext;
+    int conf[49], i, k, t, vert, y, x, ship;
+    
+    if ((cells & m->occup) != m->occup) return false;
+    
+    // configuration of the ship cells, as in solution_move()
+    for (i = 0; i < 49; i++) conf[i] = VACANT;
+    for (k = 0; k < 7; k++) {
+        ship = layout7_ships[k];
+        vert = pos[k]/49;
+        for (t = 0; t < ship; t++) {
+            y = (pos[k] % 49)/7 + t*vert;
+            x = pos[k] % 7 + t*(1 - vert);
+            conf[7*y + x] = (
+              t == 0 ? (vert ? NORTH : WEST) : 
+              t == ship - 1 ? (vert ? SOUTH : EAST) : INNER
+            );
+        }
+    }
+    for (i = 0; i < 49; i++) {
+        if ((*init)[i] > OCCUP && (*init)[i] != conf[i]) return false;
+    }
+    
+    if (m->num < 2 && m->coord[m->num]) {
+        for (k = 0; k < 7; k++) {
+            m->coord[m->num][k][0] = pos[k]/49;
+            m->coord[m->num][k][1] = (pos[k] % 49)/7;
+            m->coord[m->num][k][2] = pos[k] % 7;
+        }
+    }
+    if (m->occupied) {
+        for (i = 0; i < 49; i++) m->occupied[i] += (conf[i] >= 0);
+    }
+    m->num++;
+    return (m->max > 0 && m->num >= m->max);
+}
+
+
+/*
+Layouts of the 7x7 grid which satisfy the clues of a puzzle with the 
+fleet of the grid (see layout7_fleet())
+
+The groups of layout7_table are the index of the search: a group is 
+skipped if one of its rows or columns cannot have the sum of the puzzle,
+or if its ships of size 4 cover a cell disclosed as vacant. The layouts
+of the other groups are enumerated with their row and column sums kept 
+within those of the puzzle, and matched against the disclosed cells, 
+which are enriched by solver_init() as in the search of solver() (so 
+that conflicting clues are resolved the same way). The layouts are found
+in the order of solver().
+
+Parameters:
+  *init_state: constant part of game_state;
+  max: number of layouts after which the search is stopped (0 or less: 
+all of them);
+  **coord, **coord2: 7 x 3 arrays where the ship coordinates of the first
+and the second layout found are saved (NULL if not needed);
+  *occupied: array of size 49 where the number of layouts with the cell
+occupied is saved (NULL if not needed).
+
+Returns the number of layouts found.
+
+*/
+static int layout7_match(
+  const struct game_state_const *init_state, int max, int **coord, 
+  int **coord2, int *occupied
+)
+{
+    int *rows = init_state->rows, *cols = init_state->cols;
+    int g, i, pos[7], init_[49], *init[7];
+    unsigned long long c0, c1, h0, h1;
+    struct layout7_filter f = {rows, cols, 0};
+    struct layout7_geom geom;
+    struct layout7_match_ctx m = {
+      init, 0, 0, max, {coord, coord2}, occupied
+    };
+    
+    for (i = 0; i < 7; i++) init[i] = init_ + 7*i;
+    memcpy(init_, *init_state->init, sizeof(init_));
+    solver_init(7, 7, init);
+    
+    // a rows/cols bit per known sum, which the group must have
+    unsigned long long need_rows = 0, need_cols = 0;
+    for (i = 0; i < 7; i++) {
+        if (rows[i] >= 0) need_rows |= 1ULL << (8*i + rows[i]);
+        if (cols[i] >= 0) need_cols |= 1ULL << (8*i + cols[i]);
+    }
+    for (i = 0; i < 49; i++) {
+        if ((*init)[i] == VACANT) f.vacant |= 1ULL << i;
+        else if ((*init)[i] >= 0) m.occup |= 1ULL << i;
+    }
+    if (occupied) {
+        for (i = 0; i < 49; i++) occupied[i] = 0;
+    }
+    layout7_geom_init(&geom);
+    
+    for (g = 0; g < lenof(layout7_table); g++) {
+        if (
+          (layout7_table[g].rows & need_rows) != need_rows ||
+          (layout7_table[g].cols & need_cols) != need_cols
+        ) continue;
+        pos[0] = layout7_table[g].pos[0];
+        pos[1] = layout7_table[g].pos[1];
+        c0 = layout7_cells(4, pos[0], &h0);
+        c1 = layout7_cells(4, pos[1], &h1);
+        if ((c0 | c1) & f.vacant || ! layout7_sums(c0 | c1, &f, false)) {
+            continue;
+        }
+        if (layout7_enum(
+          &geom, 2, 0, c0 | c1, h0 | h1, pos, &f, layout7_match_visit, &m
+        )) break;
+    }
+    return m.num;
+}
+
+
+/* 
+Draw ship segments, see enum Configuration 
+  
+Parameters:
+  *dr: drawing object;
+  conf: element id as in enum Configuration (-1 .. 6);
+  tilesize;
+  xf, yf: left upper corner of the square tile frame 
+(square edge is tilesize + 1);
+  color: color of the element (for conf == 0 not relevant, set to -1, e.g.);
+  color_bg: color of the cell background (set to -1 if not needed, e.g., 
+for printing).
+*/
+static void draw_segment(
+  drawing *dr, const enum Configuration conf, const int tilesize, 
+  const int xf, const int yf, const int color, const int color_bg
+)
+{
+    int elem_size, shift, coords3[6], coords4[8];
+    int const ts = tilesize;
+    
+    switch (conf) {
+        case VACANT:
+            if (color_bg >= 0) 
+              draw_rect(dr, xf + 1, yf + 1, ts - 1, ts - 1, color_bg)
+            ;
+            elem_size = ts/10 + 1;
+            shift = max((ts - elem_size - 1)/2, 3);
+            elem_size = ts - 1 - 2*shift;   // adjust when ts-elem_size-1 odd
+            draw_rect(
+              dr, xf + shift + 1, yf + shift + 1, elem_size, elem_size, color
+            );
+            break;
+        case OCCUP:
+            if (color_bg >= 0) 
+              draw_rect(dr, xf + 1, yf + 1, ts - 1, ts - 1, color_bg)
+            ;
+            break;
+        case NORTH:
+            if (color_bg >= 0) 
+              draw_rect(dr, xf + 1, yf + 1, ts - 1, ts - 1, color_bg)
+            ;
+            elem_size = ts*6/10 + 1;
+            shift = max((ts - elem_size - 1)/2, 3);
+            elem_size = ts - 1 - 2*shift;
+            coords3[0] = xf + (ts - 1)/2 + 1; 
+            coords3[1] = yf + shift + 1;
+            coords3[2] = xf + shift + 1; 
+            coords3[3] = yf + shift + elem_size;
+            coords3[4] = xf + shift + elem_size; 
+            coords3[5] = yf + shift + elem_size;
+            draw_polygon(dr, coords3, 3, color, color);
+            break;
+        case EAST:
+            if (color_bg >= 0) 
+              draw_rect(dr, xf + 1, yf + 1, ts - 1, ts - 1, color_bg)
+            ;
+            elem_size = ts*6/10 + 1;
+            shift = max((ts - elem_size - 1)/2, 3);
+            elem_size = ts - 1 - 2*shift;
+            coords3[0] = xf + shift + 1; 
+            coords3[1] = yf + shift + 1;
+            coords3[2] = xf + shift + elem_size; 
+            coords3[3] = yf + (ts - 1)/2 + 1;
+            coords3[4] = xf + shift + 1; 
+            coords3[5] = yf + shift + elem_size;
+            draw_polygon(dr, coords3, 3, color, color);
+            break;
+        case SOUTH:
+            if (color_bg >= 0) 
+              draw_rect(dr, xf + 1, yf + 1, ts - 1, ts - 1, color_bg)
+            ;
+            elem_size = ts*6/10 + 1;
+            shift = max((ts - elem_size - 1)/2, 3);
+            elem_size = ts - 1 - 2*shift;
+            coords3[0] = xf + shift + 1; 
+            coords3[1] = yf + shift + 1;
+            coords3[2] = xf + shift + elem_size; 
+            coords3[3] = yf + shift + 1;
+            coords3[4] = xf + (ts - 1)/2 + 1; 
+            coords3[5] = yf + shift + elem_size;
+            draw_polygon(dr, coords3, 3, color, color);
+            break;
+        case WEST:
+            if (color_bg >= 0) 
+              draw_rect(dr, xf + 1, yf + 1, ts - 1, ts - 1, color_bg)
+            ;
+            elem_size = ts*6/10 + 1;
+            shift = max((ts - elem_size - 1)/2, 3);
+            elem_size = ts - 1 - 2*shift;
+            coords3[0] = xf + shift + 1; 
+            coords3[1] = yf + (ts - 1)/2 + 1;
+            coords3[2] = xf + shift + elem_size; 
+            coords3[3] = yf + shift + 1;
+            coords3[4] = xf + shift + elem_size; 
+            coords3[5] = yf + shift + elem_size;
+            draw_polygon(dr, coords3, 3, color, color);
+            break;
+        case ONE:
+            if (color_bg >= 0) 
+              draw_rect(dr, xf + 1, yf + 1, ts - 1, ts - 1, color_bg)
+            ;
+            elem_size = ts*6/10 + 1;
+            shift = max((ts - elem_size - 1)/2, 3);
+            elem_size = ts - 1 - 2*shift;
+            coords4[0] = xf + (ts - 1)/2 + 1; 
+            coords4[1] = yf + shift + 1;
+            coords4[2] = xf + shift + elem_size; 
+            coords4[3] = yf + (ts - 1)/2 + 1;
+            coords4[4] = xf + (ts - 1)/2 + 1; 
+            coords4[5] = yf + shift + elem_size;
+            coords4[6] = xf + shift + 1; 
+            coords4[7] = yf + (ts - 1)/2 + 1;
+            draw_polygon(dr, coords4, 4, color, color);
+            break;
+        case INNER:
+            if (color_bg >= 0) 
+              draw_rect(dr, xf + 1, yf + 1, ts - 1, ts - 1, color_bg)
+            ;
+            elem_size = ts*6/10 + 1;
+            shift = max((ts - elem_size - 1)/2, 3);
+            elem_size = ts - 1 - 2*shift;
+            draw_rect(
+              dr, xf + shift + 1, yf + shift + 1, elem_size, elem_size, color
+            );
+    }
+}
+
+
+
+/* 
+Draw cells 
+  
+Parameters:
+  *dr: drawing object;
+  *state: game_state;
+  xc, yc: coordinates of the cell counted from the left upper corner;
+  tilesize;
+  x0pt, y0pt: point coordinates of the upper left corner of the frame of the cell with xc = yc = 0; the point coordinates are counted from the upper left corner of the drawing field;
+  cursor: true if cursor is to be shown in the cell;
+  error: true if error is to be shown in the cell;
+  update: true if draw_update() function is to be executed for the cell;
+  drag: true if drag is underway;
+  clear: true if drag clears cells (disregarded if drag == false);
+  conf: type of segment (-1..6) to draw during drag  (disregarded if 
+drag == false or clear == true);
+  flash: true if flash is underway.
+*/
+static void draw_cell(
+  drawing *dr, const game_state *state, int xc, int yc, 
+  int tilesize, int x0pt, int y0pt, bool cursor, bool error, bool update,
+  bool drag, bool clear, enum Configuration conf, bool flash
+)
+{
+    int const ts = tilesize;
+    int i, j, color_bg, coords3[6];
+    int cell_state = ((drag && ! clear) ? conf : state->grid_state [yc][xc]);
+    
+    // empty
+    if (cell_state == UNDEF) {
+        if (flash) color_bg = COL_FLASH; else color_bg = COL_BACKGROUND;
+        draw_rect(
+          dr, x0pt + ts*xc + 1, y0pt + ts*yc + 1, ts - 1, ts - 1, color_bg
+        );
+    }
+    // filled
+    else {
+        if (flash) color_bg = COL_FLASH; 
+        else if (cell_state == VACANT) color_bg = COL_BACKGROUND;
+        else color_bg = COL_OCCUP;
+        draw_segment(
+          dr, cell_state, ts, x0pt + ts*xc, y0pt + ts*yc, 
+          (! error ? (! drag ? COL_SEGMENT : COL_DRAG) : COL_ERROR), 
+          (error && cell_state == OCCUP ? COL_ERROR : color_bg)
+        );
+    }
+    // cursor
+    if (cursor) {
+        coords3[0] = x0pt + ts*xc + 1; 
+        coords3[1] = y0pt + ts*yc + 1;
+        coords3[2] = x0pt + ts*xc + 5*ts/10; 
+        coords3[3] = y0pt + ts*yc + 1;
+        coords3[4] = x0pt + ts*xc + 1; 
+        coords3[5] = y0pt + ts*yc + 5*ts/10;
+        draw_polygon(dr, coords3, 3, COL_HIGHLIGHT, COL_HIGHLIGHT);
+    }
+    // initially disclosed: thick border
+    if ((state->init_state->init)[yc][xc] > -2) {
+        draw_rect_outline(
+          dr, x0pt + ts*xc + 1, y0pt + ts*yc + 1, ts - 1, ts - 1, COL_GRID
+        );
+        if (ts > 22) {
+            draw_rect_outline(
+              dr, x0pt + ts*xc + 2, y0pt + ts*yc + 2, ts - 3, ts - 3, COL_GRID
+            );
+        }
+    }
+    
+    if (update) {
+        draw_update(dr, x0pt + ts*xc + 1, y0pt + ts*yc + 1, ts - 1, ts - 1);
+    }
+}
+
+
+
+/*
+Validate for errors and check if solved
+
+Parameters:
+  *state: game_state;
+  *solved: the variable is true if the puzzle is solved.
+  
+The function calculates the following elements of struct state:
+  **grid_state_err,
+  *rows_err, 
+  *cols_err,
+  ships_err,
+  *ships_state.
+
+*/
+static void validation(game_state *state, bool *solved)
+{
+    int h = state->init_state->H, w = state->init_state->W;
+    int ns = state->init_state->num_ships;
+    bool **grid_state_err = state->grid_state_err;
+    int **grid_state = state->grid_state;
+    int i, j, k, l, sum, sum1; 
+    int max_ship = state->init_state->ships [0], distr[max_ship];  
+    
+    // initial values
+    for (i = 0; i < h; i++) {
+        for (j = 0; j < w; j++) {
+            grid_state_err[i][j] = false;
+        }
+        state->rows_err[i] = false;
+    }
+    for (j = 0; j < w; j++) state->cols_err[j] = false;
+    state->ships_err = false;
+    for (i = 0; i < max_ship; i++) distr[i] = 0;
+    for (i = 0; i < ns; i++) state->ships_state[i] = false;
+    *solved = true;
+    
+    // neighbor consistency
+    for (i = 0; i < h; i++) {
+        for (j = 0; j < w; j++) {
+        
+            // no diagonal neighbors
+            for (k = -1; k <= 1; k += 2) {
+                for (l = -1; l <= 1; l += 2) {
+                   if (
+                      0 <= i+k && i+k < h && 0 <= j+l && j+l < w && 
+                      grid_state[i][j] >= 0 && grid_state[i+k][j+l] >= 0
+                    ) {
+                        grid_state_err[i][j] = true;
+                       *solved = false;
+                    }
+                }
+            }
+            
+            // check neighbors of VACANT 
+            #define CASE_VACANT(i, j, h, w, conf, mat, m, m_err)            \
+                if (mat((i), (j), m, h, w) == VACANT && (                   \
+                  0 <= (i)-1 && (                                           \
+                    mat((i)-1, (j), m, h, w) == conf ||                     \
+                    mat((i)-1, (j), m, h, w) == INNER &&                    \
+                    (                                                       \
+                      0 <= (i)-2 && mat((i)-2, (j), m, h, w) >= 0        || \
+                      0 <= (j)-1 && mat((i)-1, (j)-1, m, h, w) == VACANT || \
+                      (j)+1 < w  && mat((i)-1, (j)+1, m, h, w) == VACANT    \
+                    )                                                       \
+                  )                                                         \
+                  ||                                                        \
+                  (i) == 0 && (                                             \
+                    0 <= (j)-1 && mat((i), (j)-1, m, h, w) == INNER         \
+                    ||                                                      \
+                    (j)+1 < w  && mat((i), (j)+1, m, h, w) == INNER         \
+                  )                                                         \
+                )) {                                                        \
+                    mat((i), (j), m_err, h, w) = true;                      \
+                    *solved = false;                                        \
+                }
+            // apply the above with rotation symmetry transformations
+            CASE_VACANT(
+              i,     j,     h, w, NORTH, MAT_0, grid_state, grid_state_err
+            );  
+            CASE_VACANT(
+              w-1-j, i,     w, h, EAST,  MAT_1, grid_state, grid_state_err
+            );  
+            CASE_VACANT(
+              h-1-i, w-1-j, h, w, SOUTH, MAT_2, grid_state, grid_state_err
+            );   
+            CASE_VACANT(
+              j,     h-1-i, w, h, WEST,  MAT_3, grid_state, grid_state_err
+            );  
+
+
+            // check neighbors of OCCUP 
+            #define CASE_OCCUP(i, j, h, w, conf, mat, m, m_err)  \
+                if (mat((i), (j), m, h, w) == OCCUP && (         \
+                  0 <= (i)-1 && ! (                              \
+                      mat((i)-1, (j), m, h, w) == conf   ||      \
+                      mat((i)-1, (j), m, h, w) == UNDEF  ||      \
+                      mat((i)-1, (j), m, h, w) == VACANT ||      \
+                      mat((i)-1, (j), m, h, w) == OCCUP  ||      \
+                      mat((i)-1, (j), m, h, w) == INNER          \
+                  )                                              \
+                )) {                                             \
+                    mat((i), (j), m_err, h, w) = true;           \
+                    *solved = false;                             \
+                }
+            CASE_OCCUP(
+              i,     j,     h, w, NORTH, MAT_0, grid_state, grid_state_err
+            );  
+            CASE_OCCUP(
+              w-1-j, i,     w, h, EAST,  MAT_1, grid_state, grid_state_err
+            );  
+            CASE_OCCUP(
+              h-1-i, w-1-j, h, w, SOUTH, MAT_2, grid_state, grid_state_err
+            );   
+            CASE_OCCUP(
+              j,     h-1-i, w, h, WEST,  MAT_3, grid_state, grid_state_err
+            );  
+
+
+            // check neighbors of NORTH, SOUTH, EAST, WEST
+            #define CASE_NSEW(i, j, h, w, conf, mat, m, m_err)        \
+                if (mat((i), (j), m, h, w) == conf && (               \
+                  0 <= (i)-1 && mat((i)-1, (j), m, h, w) >= 0         \
+                  ||                                                  \
+                  (i)+1 < h && ! (                                    \
+                    mat((i)+1, (j), m, h, w) == (conf + 1) % 4 + 1 || \
+                    mat((i)+1, (j), m, h, w) == UNDEF ||              \
+                    mat((i)+1, (j), m, h, w) == OCCUP ||              \
+                    mat((i)+1, (j), m, h, w) == INNER                 \
+                  )                                                   \
+                  ||                                                  \
+                  0 <= (j)-1 && mat((i), (j)-1, m, h, w) >= 0         \
+                  ||                                                  \
+                  (j)+1 < w  && mat((i), (j)+1, m, h, w) >= 0         \
+                  ||                                                  \
+                  (i) == h-1                                          \
+                )) {                                                  \
+                    mat((i), (j), m_err, h, w) = true;                \
+                    *solved = false;                                  \
+                }
+            CASE_NSEW(
+              i,     j,     h, w, NORTH, MAT_0, grid_state, grid_state_err
+            );  
+            CASE_NSEW(
+              w-1-j, i,     w, h, EAST,  MAT_1, grid_state, grid_state_err
+            );  
+            CASE_NSEW(
+              h-1-i, w-1-j, h, w, SOUTH, MAT_2, grid_state, grid_state_err
+            );   
+            CASE_NSEW(
+              j,     h-1-i, w, h, WEST,  MAT_3, grid_state, grid_state_err
+            );  
+                
+                
+            // check neighbors of ONE
+            if (grid_state[i][j] == ONE && ( 
+                0 <= i-1 && grid_state[i-1][j] >= 0 
+                ||
+                i+1 < h && grid_state[i+1][j] >= 0 
+                ||
+                0 <= j-1 && grid_state[i][j-1] >= 0 
+                ||
+                j+1 < w && grid_state[i][j+1] >= 0 
+            )) {
+                grid_state_err[i][j] = true;
+                *solved = false;
+            }
+                    
+                
+            // check neighbors of INNER 
+            #define CASE_INNER(i, j, h, w, conf, mat, m, m_err)      \
+                if (mat((i), (j), m, h, w) == INNER && (             \
+                  0 <= (i)-1 && ! (                                  \
+                    mat((i)-1, (j), m, h, w) == conf  ||             \
+                    mat((i)-1, (j), m, h, w) == UNDEF  ||            \
+                    mat((i)-1, (j), m, h, w) == VACANT ||            \
+                    mat((i)-1, (j), m, h, w) == OCCUP  ||            \
+                    mat((i)-1, (j), m, h, w) == INNER                \
+                  )                                                  \
+                  ||                                                 \
+                  (i) == 0 && (                                      \
+                    mat((i)+1, (j), m, h, w) >= 0                    \
+                    ||                                               \
+                    0 <= (j)-1 && mat((i), (j)-1, m, h, w) == VACANT \
+                    ||                                               \
+                    (j)+1 < w  && mat((i), (j)+1, m, h, w) == VACANT \
+                    ||                                               \
+                    (j) == 0 || (j) == w-1                           \
+                  )                                                  \
+                  ||                                                 \
+                  0 <= (i)-1 && 0 <= (j)-1 &&                        \
+                  mat((i)-1, (j), m, h, w) == VACANT &&              \
+                  mat((i), (j)-1, m, h, w) == VACANT                 \
+                  ||                                                 \
+                  0 <= (i)-1 && (i)+1 < h && (                       \
+                    mat((i)-1, (j), m, h, w) == VACANT &&            \
+                    mat((i)+1, (j), m, h, w) >= 0         ||         \
+                    mat((i)-1, (j), m, h, w) >= 0      &&            \
+                    mat((i)+1, (j), m, h, w) == VACANT               \
+                  )                                                  \
+                )) {                                                 \
+                    mat((i), (j), m_err, h, w) = true;               \
+                    *solved = false;                                 \
+                }
+            CASE_INNER(
+              i,     j,     h, w, NORTH, MAT_0, grid_state, grid_state_err
+            );  
+            CASE_INNER(
+              w-1-j, i,     w, h, EAST,  MAT_1, grid_state, grid_state_err
+            );  
+            CASE_INNER(
+              h-1-i, w-1-j, h, w, SOUTH, MAT_2, grid_state, grid_state_err
+            );   
+            CASE_INNER(
+              j,     h-1-i, w, h, WEST,  MAT_3, grid_state, grid_state_err
+            );  
+
+        }
+    }
+    
+    
+    // sums consistency
+    // rows
+    for (i = 0; i < h; i++) {
+        sum  = 0;
+        sum1 = 0;
+        if (state->init_state->rows [i] >= 0) {
+            for (j = 0; j < w; j++) {
+                sum  += (grid_state[i][j] >= 0      ? 1 : 0);
+                sum1 += (grid_state[i][j] == VACANT ? 1 : 0);
+            }
+            if (sum >  state->init_state->rows [i]) state->rows_err[i] = true;
+            if (sum1 > w - state->init_state->rows [i]) 
+              state->rows_err[i] = true
+            ;
+            if (sum != state->init_state->rows [i]) *solved = false;
+        }
+    }    
+    // columns
+    for (j = 0; j < w; j++) {
+        sum = 0;
+        sum1 = 0;
+        if (state->init_state->cols [j] >= 0) {
+            for (i = 0; i < h; i++) {
+                sum  += (grid_state[i][j] >= 0      ? 1 : 0);
+                sum1 += (grid_state[i][j] == VACANT ? 1 : 0);
+            }
+            if (sum >  state->init_state->cols [j]) state->cols_err[j] = true;
+            if (sum1 > h - state->init_state->cols [j]) 
+              state->cols_err[j] = true
+            ;
+            if (sum != state->init_state->cols [j]) *solved = false;
+        }
+    }    
+    
+    
+    // ships consistency (only the ships are found that are searched for)
+    state->ships_err = compl_ships_distr(h, w, grid_state, max_ship, distr);
+    if (! state->ships_err) {
+        for (k = 0; k < max_ship; k++) {
+            if (distr[k] > state->init_state->ships_distr[k]) {
+                state->ships_err = true;
+                break;
+            }
+        }
+    }
+    if (state->ships_err) *solved = false;
+
+   
+    // mark ships done
+    if (! state->ships_err) {
+        for (i = 0; i < ns; i++) {
+            if (distr [state->init_state->ships [i] - 1] > 0) {
+                state->ships_state[i] = true;
+                (distr [state->init_state->ships [i] - 1])--;
+            }
+            else *solved = false;
+        }
+    }
+
+    
+    // check (number of occupied and specified cells) = sum(ship sizes)
+    if (*solved) {
+        sum = 0;
+        for (i = 0; i < h; i++) {
+            for (j = 0; j < w; j++) {
+                sum += (grid_state[i][j] > 0 ? 1 : 0);
+            }
+        }
+        sum1 = 0;
+        for (i = 0; i < ns; i++) sum1 += state->init_state->ships [i];
+        if (sum != sum1) *solved = false;
+    }
+    
+}
+
+
+/*
+Backbone of the puzzle for the check of the user's marks (still_solvable())
+and for hints (ships_hint())
+
+Parameters:
+  *init_state: constant part of game_state (ships sorted in descending 
+order).
+
+Returns an array of size H*W, to be freed by the caller, with OCCUP or 
+VACANT for the cells which are so in every solution and UNDEF for the 
+others (see backbone()); for a unique solution, this is the solution. 
+NULL if the puzzle has no solution, if the search takes more than 
+LIVE_COUNT_LIM calls of place_ship(), or if no cell is found to be fixed. 
+For several solutions, the backbone search is limited to LIVE_COUNT_LIM
+further calls, the cells not decided by then are left UNDEF.
+
+*/
+static enum Configuration *live_backbone(
+  const struct game_state_const *init_state
+)
+{
+    int i, k;
+    int h = init_state->H, w = init_state->W;
+    int ns = init_state->num_ships;
+    int *init = *(init_state->init);
+    enum Configuration *fixed = NULL;
+    bool found = false;
+    
+    struct scratch *sc = scratch_new(h, w, ns);
+    struct sol soln;
+    scratch_sol(sc, ns, &soln);
+    
+    solver(init_state, LIVE_COUNT_LIM, &soln, sc);
+    
+    if (soln.err == 0 || soln.err == 2) {
+        fixed = snewn(h*w, enum Configuration);
+        for (i = 0; i < h*w; i++) fixed[i] = VACANT;
+        for (i = 0; i < ns; i++) {
+            for (k = 0; k < init_state->ships[i]; k++) {
+                fixed[
+                  (soln.ship_coord[i][1] + k*soln.ship_coord[i][0])*w + 
+                  soln.ship_coord[i][2] + k*(1 - soln.ship_coord[i][0])
+                ] = OCCUP;
+            }
+        }
+        
+        // the search relies on the sums to cover the disclosed ship cells;
+        // do not trust a solution that does not agree with them
+        for (i = 0; i < h*w; i++) {
+            if (
+              init[i] >= 0 && fixed[i] == VACANT || 
+              init[i] == VACANT && fixed[i] == OCCUP
+            ) {
+                sfree(fixed);
+                fixed = NULL;
+                break;
+            }
+        }
+        
+        // several solutions: cells common to all
+        if (i == h*w && soln.err == 2) {
+            backbone(
+              init_state, soln.ship_coord, LIVE_COUNT_LIM, fixed, NULL, sc
+            );
+            for (i = 0; i < h*w; i++) found = found || (fixed[i] != UNDEF);
+            if (! found) {
+                sfree(fixed);
+                fixed = NULL;
+            }
+        }
+    }
+    
+    scratch_free(sc);
+    
+    return fixed;
+}
+
+
+/*
+Check the marks against the row and column sums
+
+Parameters:
+  *init_state: constant part of game_state;
+  **grid: h x w array of the current configuration.
+
+Returns false if a row or column, or the rows or columns with hidden sums
+together, have more occupied cells than their sum, or too few occupied 
+and undecided cells to reach it.
+
+*/
+static bool marks_sums_ok(
+  const struct game_state_const *init_state, enum Configuration **grid
+)
+{
+    int i, j, occ, und, occ_hid, und_hid;
+    int h = init_state->H, w = init_state->W;
+    int *rows = init_state->rows, *cols = init_state->cols;
+    int hidden_rows = init_state->ships_sum - init_state->rows_sum;
+    int hidden_cols = init_state->ships_sum - init_state->cols_sum;
+    
+    occ_hid = und_hid = 0;
+    for (i = 0; i < h; i++) {
+        occ = und = 0;
+        for (j = 0; j < w; j++) {
+            occ += (grid[i][j] >= 0);
+            und += (grid[i][j] == UNDEF);
+        }
+        if (rows[i] < 0) {
+            occ_hid += occ;
+            und_hid += und;
+        }
+        else if (occ > rows[i] || occ + und < rows[i]) return false;
+    }
+    if (occ_hid > hidden_rows || occ_hid + und_hid < hidden_rows) {
+        return false;
+    }
+    
+    occ_hid = und_hid = 0;
+    for (j = 0; j < w; j++) {
+        occ = und = 0;
+        for (i = 0; i < h; i++) {
+            occ += (grid[i][j] >= 0);
+            und += (grid[i][j] == UNDEF);
+        }
+        if (cols[j] < 0) {
+            occ_hid += occ;
+            und_hid += und;
+        }
+        else if (occ > cols[j] || occ + und < cols[j]) return false;
+    }
+    if (occ_hid > hidden_cols || occ_hid + und_hid < hidden_cols) {
+        return false;
+    }
+    
+    return true;
+}
+
+
+/*
+Propagate the marks of the user through the rules of the logical solver
+
+Parameters:
+  *init_state: constant part of game_state;
+  **grid: h x w array with the marks of the user (types of the occupied 
+cells specified by render_grid_conf()), which is extended by the cells 
+they force.
+
+The rules of solve_by_logic() that need no search are applied until 
+nothing changes any more: the neighbors of the occupied cells according 
+to their types (solver_init()), the row and column sums including the 
+hidden ones (logic_sums()), and the types of the occupied cells 
+(render_grid_conf()). Since solver_init() overwrites cells, a 
+contradiction shows up as a cell it turns from vacant to occupied or 
+back; logic_sums() only fills undecided cells, so the sums are checked 
+by marks_sums_ok() before each round. Each round takes O(H*W) time, and 
+there are at most H*W rounds (usually a few).
+
+Returns false if a contradiction is found.
+
+*/
+static bool marks_propagate(
+  const struct game_state_const *init_state, enum Configuration **grid
+)
+{
+    int i;
+    int h = init_state->H, w = init_state->W;
+    enum Configuration *prev = snewn(h*w, enum Configuration);
+    bool ok = true, changed = true;
+    
+    while (ok && changed) {
+        memcpy(prev, *grid, h*w*sizeof(*prev));
+        
+        if (! marks_sums_ok(init_state, grid)) {
+            ok = false;
+            break;
+        }
+        
+        // neighbors of occupied cells
+        solver_init(h, w, grid);
+        for (i = 0; i < h*w; i++) {
+            if (prev[i] != UNDEF && (prev[i] >= 0) != ((*grid)[i] >= 0)) {
+                ok = false;
+                break;
+            }
+        }
+        
+        // row and column sums, types of the occupied cells
+        logic_sums(init_state, grid);
+        render_grid_conf(h, w, grid, NULL, false);
+        
+        changed = (memcmp(prev, *grid, h*w*sizeof(*prev)) != 0);
+    }
+    
+    sfree(prev);
+    return ok;
+}
+
+
+/*
+Check if the marks of the user can still be completed to a solution.
+
+Parameters:
+  *state: game state, after validation().
+
+The marks are compared with the cells known to be fixed in every solution
+(init_state->fixed); if these are the unique solution, this decides. 
+Otherwise (several solutions, or none found within LIVE_COUNT_LIM), the 
+errors flagged by validation() are taken into account, and the marks are 
+propagated by marks_propagate(). On the extended grid, lines of occupied 
+cells longer than the longest ship, too many occupied cells in total and 
+completed ships that are not in the fleet are detected in addition. This 
+finds the dead ends that the rules of the logical solver without search 
+lead to; deeper ones are not detected.
+
+Returns false if no solution is consistent with the marks.
+
+*/
+static bool still_solvable(const game_state *state)
+{
+    const struct game_state_const *is = state->init_state;
+    int h = is->H, w = is->W;
+    int *grid = *(state->grid_state);
+    int i, j, k, run_h, run_v, occ;
+    int distr[is->ships[0]];
+    bool unique = true, ok;
+    
+    // cells fixed in every solution; all of them for a unique solution
+    if (is->fixed) {
+        for (i = 0; i < h*w; i++) {
+            if (
+              grid[i] >= 0 && is->fixed[i] == VACANT || 
+              grid[i] == VACANT && is->fixed[i] == OCCUP
+            ) return false;
+            unique = unique && (is->fixed[i] != UNDEF);
+        }
+        if (unique) return true;
+    }
+    
+    // local inconsistencies
+    if (state->ships_err) return false;
+    for (i = 0; i < h*w; i++) {
+        if ((*(state->grid_state_err))[i]) return false;
+    }
+    for (i = 0; i < h; i++) if (state->rows_err[i]) return false;
+    for (j = 0; j < w; j++) if (state->cols_err[j]) return false;
+    
+    // cells forced by the marks
+    enum Configuration *g_ = snewn(h*w, enum Configuration), *g[SIZEMAX];
+    for (i = 0; i < h; i++) g[i] = g_ + i*w;
+    memcpy(g_, grid, h*w*sizeof(*g_));
+    ok = marks_propagate(is, g);
+    
+    // lines longer than the longest ship; number of occupied cells
+    occ = 0;
+    for (i = 0; ok && i < h; i++) {
+        run_h = 0;
+        for (j = 0; j < w; j++) {
+            if (g[i][j] >= 0) {
+                occ++;
+                run_h++;
+                run_v = 1;
+                while (i - run_v >= 0 && g[i - run_v][j] >= 0) run_v++;
+                if (run_h > is->ships[0] || run_v > is->ships[0]) ok = false;
+            }
+            else run_h = 0;
+        }
+    }
+    if (occ > is->ships_sum) ok = false;
+    
+    // completed ships
+    if (ok) ok = ! compl_ships_distr(h, w, g, is->ships[0], distr);
+    for (k = 0; ok && k < is->ships[0]; k++) {
+        if (distr[k] > is->ships_distr[k]) ok = false;
+    }
+    
+    sfree(g_);
+    return ok;
+}
+
+
+/* wall clock time in microseconds */
+static double time_us(void)
+{
+#ifdef CLOCK_MONOTONIC
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec*1e6 + ts.tv_nsec*1e-3;
+#else
+    return clock()*1e6/CLOCKS_PER_SEC;
+#endif
+}
+
+
+/*
+Set the hook which receives a telemetry record after each generated game
+
+The record is only valid during the call of the hook. The hook is called 
+from new_game_desc(), hence from whatever thread generates the game.
+
+Parameters:
+  fn: function to be called, or NULL to switch telemetry off;
+  *ctx: pointer passed unchanged to fn.
+
+*/
+void ships_set_telemetry_hook(gen_telemetry_fn fn, void *ctx)
+{
+    telemetry_hook = fn;
+    telemetry_ctx = ctx;
+}
+
+
+/*
+Generate a game description from parameters and a seed
+
+The result depends on params and seed only: the random numbers come from
+the framework's random_state (SHA-1 based, identical on all platforms) 
+and the generator uses integer arithmetic only, so that the output is 
+bit-identical across compilers, optimization levels and platforms. It is
+the same description the midend generates for the game ID 
+"{params}#{seed}", so a game reported by its random seed can be
+regenerated exactly. (With SHIPS_THREADS, the Unreasonable games also
+depend on whether repair workers are set, see ships_set_repair_workers().)
+
+Parameters:
+  *params: game parameters (must be valid, see validate_params());
+  *seed: random seed (string).
+
+Returns the description, to be freed by the caller.
+
+*/
+char *ships_generate(const game_params *params, const char *seed)
+{
+    char *aux = NULL;
+    random_state *rs = random_new(seed, strlen(seed));
+    char *desc = new_game_desc(params, rs, &aux, false);
+    sfree(aux);
+    random_free(rs);
+    return desc;
+}
+
+
+/*
+Generate a chain of games of decreasing difficulty with the same layout
+
+The game of the difficulty params->diff is generated first, and each 
+easier one is derived from it by adding clues, so that the clues of a 
+game are a subset of those of every easier one (see generator_diff()). 
+Like ships_generate(), the result depends on params and seed only; the 
+games differ from the ones ships_generate() gives for the same seed.
+
+Parameters:
+  *params: game parameters (must be valid, see validate_params());
+  *seed: random seed (string);
+  **descs: array of size UNREASONABLE + 1 where the descriptions of the 
+levels BASIC .. params->diff will be saved (index = difficulty); the 
+elements for the levels above params->diff are set to NULL.
+
+Returns the number of levels saved, params->diff - BASIC + 1 if the 
+chain is complete. In the improbable case that the repair of a level 
+runs out of clues to add (see generator_diff()), the chain stops there: 
+only the levels above it are saved, and the elements of that level and 
+the easier ones are NULL.
+
+The descriptions are to be freed by the caller.
+
+*/
+int ships_generate_chain(
+  const game_params *params, const char *seed, char **descs
+)
+{
+    int d, n = 0, num_ships, *ships;
+    int h = params->H, w = params->W;
+    random_state *rs = random_new(seed, strlen(seed));
+    struct scratch *sc = scratch_new(h, w, NUM_SHIPS_MAX);
+    int *rows = scratch_newn(sc, h, int), *cols = scratch_newn(sc, w, int);
+    int **init = scratch_grid_int(sc, h, w);
+    
+    for (d = 0; d <= UNREASONABLE; d++) descs[d] = NULL;
+    generator_diff(
+      params, rs, &num_ships, &ships, rows, cols, init, sc, NULL, descs
+    );
+    for (d = BASIC; d <= params->diff; d++) {
+        if (descs[d]) n++;
+    }
+    
+    sfree(ships);
+    scratch_free(sc);
+    random_free(rs);
+    return n;
+}
+
+
+/*
+Check the data of a puzzle (the typed counterpart of validate_desc())
+
+Parameters:
+  *params: game parameters;
+  num_ships: number of ships;
+  *ships: array of size num_ships of ship sizes (any ordering);
+  *rows, *cols: arrays of size H, W of row/column sums (-1 if hidden);
+  *init: array of size H*W of the initially disclosed cells (UNDEF if 
+not disclosed).
+
+Returns an error message (a literal), or NULL if the data are valid.
+
+*/
+const char *ships_validate(
+  const game_params *params, int num_ships, const int *ships,
+  const int *rows, const int *cols, const int *init
+)
+{
+    int i;
+    int h = params->H, w = params->W;
+    const char *err = validate_params(params, false);
+    
+    if (err) return err;
+    if (num_ships < 1) return "Number of ships must be at least one.";
+    for (i = 0; i < num_ships; i++) {
+        if (ships[i] <= 0 || ships[i] > h || ships[i] > w) {
+            return "Ship sizes must be between 1 and the field size.";
+        }
+    }
+    for (i = 0; i < h; i++) {
+        if (rows[i] < -1 || rows[i] > w) {
+            return "Row sums must be between -1 and width.";
+        }
+    }
+    for (i = 0; i < w; i++) {
+        if (cols[i] < -1 || cols[i] > h) {
+            return "Column sums must be between -1 and height.";
+        }
+    }
+    for (i = 0; i < h*w; i++) {
+        if (init[i] < UNDEF || init[i] > INNER) {
+            return "Disclosed cells must be between -2 and 6.";
+        }
+    }
+    return NULL;
+}
+
+
+/* puzzle built from valid data (see ships_puzzle_new()) */
+static struct game_state_const *puzzle_new(
+  int h, int w, int num_ships, const int *ships, const int *rows, 
+  const int *cols, const int *init
+)
+{
+    int i;
+    struct game_state_const *puzzle = snew(struct game_state_const);
+    
+    puzzle->refcount = 1;
+    puzzle->H = h;
+    puzzle->W = w;
+    puzzle->num_ships = num_ships;
+    
+    puzzle->ships = snewn(num_ships, int);
+    puzzle->rows = snewn(h, int);
+    puzzle->cols = snewn(w, int);
+    memcpy(puzzle->ships, ships, num_ships*sizeof(int));
+    memcpy(puzzle->rows, rows, h*sizeof(int));
+    memcpy(puzzle->cols, cols, w*sizeof(int));
+    
+    puzzle->init = snewn(h, int*);
+    *(puzzle->init) = snewn(h*w, int);
+    for (i = 1; i < h; i++) puzzle->init[i] = puzzle->init[0] + i*w;
+    memcpy(*(puzzle->init), init, h*w*sizeof(int));
+    
+    // sums
+    puzzle->ships_sum = puzzle->rows_sum = puzzle->cols_sum = 0;
+    for (i = 0; i < num_ships; i++) puzzle->ships_sum += ships[i];
+    for (i = 0; i < h; i++) {
+        if (rows[i] > -1) puzzle->rows_sum += rows[i];
+    }
+    for (i = 0; i < w; i++) {
+        if (cols[i] > -1) puzzle->cols_sum += cols[i];
+    }
+    
+    // ships in descending order, their distribution
+    int ctx = -1;
+    arraysort(puzzle->ships, num_ships, cmp, &ctx);
+    puzzle->ships_distr = snewn(puzzle->ships[0], int);
+    for (i = 0; i < puzzle->ships[0]; i++) puzzle->ships_distr[i] = 0;
+    for (i = 0; i < num_ships; i++) puzzle->ships_distr[puzzle->ships[i]-1]++;
+    
+    puzzle->fixed = NULL;
+    return puzzle;
+}
+
+
+/*
+Puzzle from its data
+
+Parameters:
+  *params, num_ships, *ships, *rows, *cols, *init: see ships_validate();
+  **error: set to an error message if the data are invalid.
+
+Returns the puzzle, to be freed by ships_puzzle_free(), or NULL. The data
+are copied. The cells fixed in every solution (fixed) are not sought 
+until a game is started on the puzzle (see ships_game_new()).
+
+*/
+struct game_state_const *ships_puzzle_new(
+  const game_params *params, int num_ships, const int *ships,
+  const int *rows, const int *cols, const int *init, const char **error
+)
+{
+    *error = ships_validate(params, num_ships, ships, rows, cols, init);
+    if (*error) return NULL;
+    return puzzle_new(
+      params->H, params->W, num_ships, ships, rows, cols, init
+    );
+}
+
+
+/*
+Generate a puzzle (as new_game_desc(), without the description string)
+
+Parameters:
+  *params: game parameters (must be valid, see validate_params());
+  *rs: random state;
+  *tel: telemetry record of the generation, which is filled in (NULL if
+not needed; the hook of ships_set_telemetry_hook() is not called).
+
+Returns the puzzle, to be freed by ships_puzzle_free().
+
+*/
+struct game_state_const *ships_puzzle_generate(
+  const game_params *params, random_state *rs, struct gen_telemetry *tel
+)
+{
+    int i;
+    int h = params->H, w = params->W;
+    int num_ships, *ships;
+    
+    struct scratch *sc = scratch_new(h, w, NUM_SHIPS_MAX);
+    int *rows = scratch_newn(sc, h, int), *cols = scratch_newn(sc, w, int);
+    int **init = scratch_grid_int(sc, h, w), *init_ = *init;
+    
+    double t0 = 0;
+    if (tel) {
+        memset(tel, 0, sizeof(*tel));
+        tel->H = h; tel->W = w; tel->diff = params->diff;
+        t0 = time_us();
+    }
+    
+    generator_diff(
+      params, rs, &num_ships, &ships, rows, cols, init, sc, tel, NULL
+    );
+    
+    // complete the telemetry record
+    if (tel) {
+        tel->total_ms = (time_us() - t0)*1e-3;
+        tel->num_ships = num_ships;
+        for (i = 0; i < h*w; i++) {
+            if (init_[i] != UNDEF) tel->clues[init_[i] + 1]++;
+        }
+        for (i = 0; i < h; i++) tel->sums_hidden += (rows[i] == -1);
+        for (i = 0; i < w; i++) tel->sums_hidden += (cols[i] == -1);
+    }
+    
+    struct game_state_const *puzzle = 
+      puzzle_new(h, w, num_ships, ships, rows, cols, init_)
+    ;
+    sfree(ships);
+    scratch_free(sc);
+    return puzzle;
+}
+
+
+/* release a reference to a puzzle (taken by ships_puzzle_new(),
+ships_puzzle_generate() or a game on it), and free it with the last one */
+void ships_puzzle_free(struct game_state_const *puzzle)
+{
+    if (--puzzle->refcount > 0) return;
+    sfree(*(puzzle->init));
+    sfree(puzzle->init);
+    sfree(puzzle->ships);
+    sfree(puzzle->ships_distr);
+    sfree(puzzle->rows);
+    sfree(puzzle->cols);
+    sfree(puzzle->fixed);
+    sfree(puzzle);
+}
+
+
+/* num_ships x 3 array of ship coordinates copied to the heap */
+static int **coord_dup(int ns, int **ship_coord)
+{
+    int i;
+    int **m = snewn(ns, int*);
+    
+    *m = snewn(ns*3, int);
+    for (i = 1; i < ns; i++) m[i] = m[0] + i*3;
+    memcpy(*m, *ship_coord, ns*3*sizeof(int));
+    return m;
+}
+
+
+/*
+Solve a puzzle (as solver())
+
+Parameters:
+  *puzzle: the puzzle;
+  count_lim: limit on the nodes of the search (<= 0: none);
+  *ctl: progress report and limits of the search (NULL if not needed).
+
+Returns the solution, to be freed by ships_solution_free().
+
+*/
+struct ships_solution *ships_solve(
+  const struct game_state_const *puzzle, long long count_lim,
+  struct solve_ctl *ctl
+)
+{
+    int ns = puzzle->num_ships;
+    struct ships_solution *ret = snew(struct ships_solution);
+    
+    // arrays of the search are taken from the scratch arena
+    struct scratch *sc = scratch_new(puzzle->H, puzzle->W, ns);
+    struct sol soln;
+    scratch_sol(sc, ns, &soln);
+    soln.ctl = ctl;
+    
+    solver(puzzle, count_lim, &soln, sc);
+    
+    ret->err = soln.err;
+    ret->count = soln.count;
+    ret->ship_coord = ret->ship_coord2 = NULL;
+    if (soln.err == 0 || soln.err == 2) {
+        ret->ship_coord = coord_dup(ns, soln.ship_coord);
+    }
+    if (soln.err == 2) ret->ship_coord2 = coord_dup(ns, soln.ship_coord2);
+    
+    scratch_free(sc);
+    return ret;
+}
+
+
+void ships_solution_free(struct ships_solution *soln)
+{
+    if (soln->ship_coord) {
+        sfree(*(soln->ship_coord));
+        sfree(soln->ship_coord);
+    }
+    if (soln->ship_coord2) {
+        sfree(*(soln->ship_coord2));
+        sfree(soln->ship_coord2);
+    }
+    sfree(soln);
+}
+
+
+/*
+Grade a puzzle by the criteria of the generator (see generator_diff())
+
+The level is the lowest one at which solve_by_logic() solves the puzzle
+(BASIC, INTERMEDIATE: with its simpler strategies, ADVANCED: with the
+more complex ones); failing that, UNREASONABLE if solver() finds a 
+unique solution. A puzzle for which solver() finds no solution, several
+ones, or exceeds count_lim is not graded (-1), whatever solve_by_logic()
+gives. The node count of solver() is given for every puzzle.
+
+Parameters:
+  *puzzle: the puzzle;
+  count_lim: limit on the nodes of solver() (<= 0: none);
+  *grade: the results are saved here.
+
+*/
+void ships_grade(
+  const struct game_state_const *puzzle, long long count_lim,
+  struct ships_grade *grade
+)
+{
+    int d, log_solve, occ, vac;
+    struct scratch *sc = 
+      scratch_new(puzzle->H, puzzle->W, puzzle->num_ships)
+    ;
+    int **grid = scratch_grid_int(sc, puzzle->H, puzzle->W);
+    struct sol soln;
+    
+    grade->diff = -1;
+    for (d = BASIC; d <= ADVANCED && grade->diff < 0; d++) {
+        log_solve = solve_by_logic(d, puzzle, grid, &occ, &vac, sc);
+        if (log_solve == 0 || d == ADVANCED && log_solve == 1) {
+            grade->diff = d;
+        }
+    }
+    grade->logic = solve_by_logic(
+      UNREASONABLE, puzzle, grid, &grade->occ, &grade->vac, sc
+    );
+    
+    scratch_sol(sc, puzzle->num_ships, &soln);
+    solver(puzzle, count_lim, &soln, sc);
+    grade->err = soln.err;
+    grade->count = soln.count;
+    if (soln.err != 0) grade->diff = -1;
+    else if (grade->diff < 0) grade->diff = UNREASONABLE;
+    
+    scratch_free(sc);
+}
+
+
+/*
+Start a game on a puzzle (the typed counterpart of new_game())
+
+The game takes a reference to the puzzle (see ships_puzzle_free()). With
+the first game, the cells fixed in every solution are sought for the 
+check of the player's marks (see live_backbone()).
+
+Parameters:
+  *puzzle: the puzzle.
+
+Returns the game state, to be freed by ships_game_free().
+
+*/
+game_state *ships_game_new(struct game_state_const *puzzle)
+{
+    int i;
+    int h = puzzle->H, w = puzzle->W;
+    game_state *state = snew(game_state);
+    
+    state->init_state = puzzle;
+    puzzle->refcount++;
+    
+    state->rows_state = snewn(h, bool);
+    state->cols_state = snewn(w, bool);
+    state->rows_err   = snewn(h, bool);
+    state->cols_err   = snewn(w, bool);
+    for (i = 0; i < h; i++) state->rows_state [i] = false;
+    for (i = 0; i < w; i++) state->cols_state [i] = false;
+    state->ships_state = snewn(puzzle->num_ships, bool); 
+
+    // 2D arrays; the grid starts with the disclosed cells
+    state->grid_state       = snewn(h, int*);
+    state->grid_state_err   = snewn(h, bool*);
+    *(state->grid_state)       = snewn(h*w, int); 
+    *(state->grid_state_err)   = snewn(h*w, bool); 
+    for (i = 1; i < h; i++) {
+      state->grid_state [i]       = state->grid_state [0]       + i*w;
+      state->grid_state_err [i]   = state->grid_state_err [0]   + i*w;
+    }
+    memcpy(*(state->grid_state), *(puzzle->init), h*w*sizeof(int));
+    
+    // specify type (1 to 6) of OCCUP cells wherever possible
+    render_grid_conf(h, w, state->grid_state, puzzle->init, false);
+    
+    // solution for the check of the user's marks
+    if (! puzzle->fixed) puzzle->fixed = live_backbone(puzzle);
+        
+    // check for errors
+    bool solved; 
+    validation(state, &solved);
+    state->completed  = solved;
+    state->unsolvable = ! still_solvable(state);
+    state->cheated    = false;
+      
+    return state;
+}
+
+
+/*
+Apply a move of the player (the typed counterpart of execute_move())
+
+Parameters:
+  *oldstate: game state before the move;
+  *move: the move.
+
+Returns the new game state, or NULL if the move is invalid (outside the
+grid; a drag not in one row or column).
+
+*/
+game_state *ships_apply_move(
+  const game_state *oldstate, const struct ships_move *move
+)
+{
+    const struct game_state_const *is = oldstate->init_state;
+    int h = is->H, w = is->W;
+    int i, j;
+    enum Configuration **init = is->init;
+    
+    #define OUTSIDE(y, x) ((y) < 0 || (y) >= h || (x) < 0 || (x) >= w)
+    switch (move->kind) {
+        case MOVE_CELL:
+            if (
+              OUTSIDE(move->y, move->x) || 
+              move->conf < UNDEF || move->conf > INNER
+            ) return NULL;
+            break;
+        case MOVE_DRAG:
+            if (
+              OUTSIDE(move->y, move->x) || OUTSIDE(move->y2, move->x2) ||
+              move->y != move->y2 && move->x != move->x2
+            ) return NULL;
+            break;
+        case MOVE_ROW:
+            if (move->y < 0 || move->y >= h) return NULL;
+            break;
+        case MOVE_COL:
+            if (move->x < 0 || move->x >= w) return NULL;
+            break;
+        case MOVE_SOLVE:
+            if (! move->grid) return NULL;
+            for (i = 0; i < h*w; i++) {
+                if (move->grid[i] < UNDEF || move->grid[i] > INNER) {
+                    return NULL;
+                }
+            }
+            break;
+        default:
+            return NULL;
+    }
+    #undef OUTSIDE
+    
+    game_state *state = dup_game(oldstate);
+    enum Configuration **grid = state->grid_state;
+    
+    switch (move->kind) {
+        // Solve button pressed: the disclosed cells and the solution, 
+        // the others vacant
+        case MOVE_SOLVE:
+            for (i = 0; i < h*w; i++) {
+                (*grid)[i] = (*init)[i];
+                if (move->grid[i] != UNDEF) (*grid)[i] = move->grid[i];
+                if ((*grid)[i] == UNDEF) (*grid)[i] = VACANT;
+            }
+            state->cheated = true;
+            break;
+        
+        // right drag/click
+        case MOVE_DRAG:
+            for (i = min(move->y, move->y2); i <= max(move->y, move->y2);
+              i++) {
+                for (j = min(move->x, move->x2); 
+                  j <= max(move->x, move->x2); j++) {
+                    if (
+                      move->clear && init[i][j] == UNDEF && 
+                      grid[i][j] == VACANT
+                    ) grid[i][j] = UNDEF;
+                    if (! move->clear && grid[i][j] == UNDEF) {
+                        grid[i][j] = VACANT;
+                    }
+                }
+            }
+            break;
+        
+        // single move; disclosed cells keep their value
+        case MOVE_CELL:
+            grid[move->y][move->x] = (
+              init[move->y][move->x] == UNDEF ? move->conf : 
+              init[move->y][move->x]
+            );
+            break;
+        case MOVE_ROW:
+            state->rows_state[move->y] = ! oldstate->rows_state[move->y];
+            break;
+        case MOVE_COL:
+            state->cols_state[move->x] = ! oldstate->cols_state[move->x];
+            break;
+    }
+    
+    // specify type (1 to 6) of OCCUP cells wherever possible
+    render_grid_conf(h, w, grid, init, true);
+    
+    bool solved; 
+    validation(state, &solved);
+    state->completed |= solved;
+    state->unsolvable = ! still_solvable(state);
+    
+    return state;
+}
+
+
+void ships_game_free(game_state *state)
+{
+    free_game(state);
+}
+
+
+/*
+Find the next deduction from the current marks of the user
+
+Parameters:
+  *state: game state;
+  *hint: the cell, its value and the rule are saved here.
+
+The strategies of solve_by_logic() are applied to the user's grid, from
+the cheapest to the most complex, each in a single pass, and the first 
+one which determines a cell not yet marked by the user yields the hint 
+(occupied cells are preferred to vacant ones). As the strategies are 
+not iterated to a fixed point, the answer takes O(H*W) time. If no 
+strategy applies, a cell which is fixed in every solution is taken, if 
+known (see live_backbone()). If the marks contradict such a cell, the
+wrong mark is returned instead.
+
+Returns false if no hint is available (puzzle completed, marks 
+contradicting every solution, or no deduction possible).
+
+*/
+bool ships_hint(const game_state *state, struct ships_hint *hint)
+{
+    const struct game_state_const *is = state->init_state;
+    int h = is->H, w = is->W;
+    int ns = is->num_ships;
+    int *ships = is->ships;
+    int *grid0 = *(state->grid_state);
+    enum Configuration *fixed = is->fixed;
+    int distr_all[ships[0]], distr_compl[ships[0]];
+    int i, k, rule;
+    
+    hint->y = hint->x = -1;
+    hint->conf = UNDEF;
+    hint->rule = HINT_NONE;
+    
+    if (state->completed) return false;
+    
+    // wrong mark
+    if (state->unsolvable) {
+        if (! fixed) return false;
+        for (i = 0; i < h*w; i++) {
+            if (grid0[i] >= 0 && fixed[i] == VACANT || 
+              grid0[i] == VACANT && fixed[i] == OCCUP
+            ) {
+                hint->y = i/w;
+                hint->x = i%w;
+                hint->conf = grid0[i];
+                hint->rule = HINT_MISTAKE;
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    struct scratch *sc = scratch_new(h, w, ns);
+    int **grid = scratch_grid_int(sc, h, w);
+    int *gaps = scratch_newn(sc, ns*4, int);
+    bool *alive = scratch_newn(sc, 2*ships[0]*h*w, bool);
+    memcpy(*grid, grid0, sizeof(**grid)*h*w);
+    for (i = 0; i < 2*ships[0]*h*w; i++) alive[i] = true;
+    
+    for (k = 0; k < ships[0]; k++) distr_all[k] = 0;
+    for (i = 0; i < ns; i++) (distr_all[ships[i] - 1])++;
+    
+    // strategies
+    for (rule = HINT_NEIGHBORS; rule < HINT_SOLUTION; rule++) {
+        switch (rule) {
+          case HINT_NEIGHBORS:  
+            solver_init(h, w, grid); 
+            break;
+          case HINT_SUMS:       
+            logic_sums(is, grid); 
+            break;
+          case HINT_STRIPES:    
+            logic_stripes(is, grid, distr_all, distr_compl); 
+            break;
+          case HINT_SHORT_GAPS: 
+            logic_short_gaps(is, grid, distr_all, distr_compl); 
+            break;
+          case HINT_FILL_GAPS:  
+            logic_fill_gaps(is, grid, distr_all, distr_compl, gaps); 
+            break;
+          case HINT_CENSUS:  
+            logic_census(is, grid, distr_all, distr_compl, alive, sc); 
+            break;
+          case HINT_LINES:  
+            logic_lines(is, grid, distr_all, sc); 
+            break;
+        }
+        for (i = 0; i < h*w; i++) {
+            if (grid0[i] == UNDEF && (*grid)[i] != UNDEF && (
+              (*grid)[i] >= 0 || hint->rule == HINT_NONE
+            )) {
+                hint->y = i/w;
+                hint->x = i%w;
+                hint->conf = ((*grid)[i] >= 0 ? OCCUP : VACANT);
+                hint->rule = rule;
+                if ((*grid)[i] >= 0) break;
+            }
+        }
+        if (hint->rule != HINT_NONE) break;
+    }
+    
+    scratch_free(sc);
+    
+    // cell fixed in every solution
+    if (hint->rule == HINT_NONE && fixed) {
+        for (i = 0; i < h*w; i++) {
+            if (grid0[i] == UNDEF && fixed[i] != UNDEF && (
+              fixed[i] == OCCUP || hint->rule == HINT_NONE
+            )) {
+                hint->y = i/w;
+                hint->x = i%w;
+                hint->conf = fixed[i];
+                hint->rule = HINT_SOLUTION;
+                if (fixed[i] == OCCUP) break;
+            }
+        }
+    }
+    
+    return hint->rule != HINT_NONE;
+}
+
+
+/*
+End a phase of the generator in the telemetry record and start the next one
+
+Parameters:
+  *tel: telemetry record, nothing is done if NULL;
+  phase: phase which ends;
+  *t: start time of the phase; set to the current time.
+
+*/
+static void telemetry_phase(
+  struct gen_telemetry *tel, enum Phase phase, double *t
+)
+{
+    if (! tel) return;
+    double t1 = time_us();
+    tel->phase_ms[phase] += (t1 - *t)*1e-3;
+    *t = t1;
+}
+
+
+
+/* search of solver() run in steps by the caller */
+struct ships_search {
+    // scratch arena of the search, private copy of the puzzle taken from
+    // it (the state it comes from can be freed while the search runs)
+    struct scratch *sc;
+    struct game_state_const is;
+    struct sol soln;
+    struct search s;
+    place_ship_fn kernel;
+};
+
+
+/*
+Start a search of solver() which is run in steps
+
+The search does the same as solver(), but only as far as the caller
+advances it by ships_search_step(), so that it can be time-sliced with
+other work on the same thread. Its state can be saved at any time between
+the steps by ships_search_checkpoint() and restored by
+ships_search_resume(). Every search must be released by 
+ships_search_finish().
+
+Parameters:
+  *state: game state whose puzzle is to be solved;
+  count_lim: limit on the nodes of the search (see solver()), 0 or less
+for no limit.
+
+Returns the handle of the search.
+
+*/
+struct ships_search *ships_search_new(
+  const game_state *state, long long count_lim
+)
+{
+    struct ships_search *ss = snew(struct ships_search);
+    const struct game_state_const *is = state->init_state;
+    int h = is->H, w = is->W, ns = is->num_ships;
+
+    ss->sc = scratch_new(h, w, ns);
+    ss->is = *is;
+    ss->is.ships = scratch_newn(ss->sc, ns, int);
+    ss->is.rows = scratch_newn(ss->sc, h, int);
+    ss->is.cols = scratch_newn(ss->sc, w, int);
+    ss->is.init = scratch_grid_int(ss->sc, h, w);
+    memcpy(ss->is.ships, is->ships, sizeof(*is->ships)*ns);
+    memcpy(ss->is.rows, is->rows, sizeof(*is->rows)*h);
+    memcpy(ss->is.cols, is->cols, sizeof(*is->cols)*w);
+    memcpy(*ss->is.init, *is->init, sizeof(**is->init)*h*w);
+    ss->is.ships_distr = NULL;
+    ss->is.fixed = NULL;
+
+    scratch_sol(ss->sc, ns, &ss->soln);
+    search_init(&ss->s, &ss->is, count_lim, &ss->soln, ss->sc);
+    ss->kernel = search_kernel(h, w);
+    return ss;
+}
+
+
+/*
+Start a search of solver() restricted to one shard (see search_shard())
+
+The shards can be run in separate processes; ships_search_finish() gives
+the result of the shard alone (with a solution if the shard found one), 
+and ships_shard_merge() the result of the whole search from the errors 
+and counts of all shards. A shard is stepped and checkpointed as any 
+search.
+
+Parameters:
+  *state, count_lim: see ships_search_new() (count_lim applies to each 
+shard);
+  shard: number of the shard, 0, ..., num_shards-1;
+  num_shards: number of shards.
+
+Returns the handle of the search.
+
+*/
+struct ships_search *ships_search_shard(
+  const game_state *state, long long count_lim, int shard, int num_shards
+)
+{
+    struct ships_search *ss = ships_search_new(state, count_lim);
+    search_shard(&ss->s, shard, num_shards);
+    return ss;
+}
+
+
+/*
+Combine the results of the shards of a search (see ships_search_shard())
+
+Parameters:
+  num_shards: number of shards;
+  *err, *count: error values and counts of the shards, in the order of 
+the shards (see struct sol, ships_search_err());
+  count_lim: limit of the search given to the shards;
+  *total: set to the count of the whole search.
+
+Returns the error value that solver() gives for the whole search: 1 if 
+the total count exceeds count_lim or a shard gave up; otherwise 2 if 
+the shards have two solutions or more, 0 if they have one (found by the
+shard with error value 0), 3 if none.
+
+*/
+int ships_shard_merge(
+  int num_shards, const int *err, const long long *count, 
+  long long count_lim, long long *total
+)
+{
+    int k, num_sol = 0;
+    bool stopped = false;
+    
+    *total = 0;
+    for (k = 0; k < num_shards; k++) {
+        *total += count[k];
+        if (err[k] == 1) stopped = true;
+        else if (err[k] == 0) num_sol++;
+        else if (err[k] == 2) num_sol += 2;
+    }
+    if (stopped || 0 < count_lim && count_lim < *total) return 1;
+    return (num_sol >= 2 ? 2 : num_sol == 1 ? 0 : 3);
+}
+
+
+/*
+Advance a search started by ships_search_new() or ships_search_resume()
+
+Parameters:
+  *ss: handle of the search;
+  nodes: number of nodes of the search to be run at most (0 or less: until
+the search is finished);
+  *count: set to the number of nodes run since the start of the search (if
+not NULL).
+
+Returns true if the search is finished.
+
+*/
+bool ships_search_step(
+  struct ships_search *ss, long nodes, long long *count
+)
+{
+    bool done = (ss->s.depth == 0 || ss->kernel(&ss->s, nodes));
+    if (count) *count = ss->soln.count;
+    return done;
+}
+
+
+/* error value of a finished search (see struct sol), -1 if the search is
+not finished */
+int ships_search_err(const struct ships_search *ss)
+{
+    return (ss->s.depth > 0 ? -1 : ss->soln.err);
+}
+
+
+/* number of values in the header of a checkpoint */
+#define CHECKPOINT_HEAD 11
+
+
+/*
+Checkpoint of a search between its steps
+
+The checkpoint is a line of integers separated by spaces: height, width,
+number of ships, count_lim, count (both long long, as a verification may
+run past 2^31 nodes), error value, depth of the search,
+shard, number of shards, shard depth and number of the next prefix (see
+struct sol, struct search), the coordinates of the first and of the
+second solution (3 per ship, (vert, y, x), 0 where not found), and the
+positions of the frames on the stack (3 per frame). The layers of blocked
+cells are not saved; ships_search_resume() rebuilds them from the
+positions of the ships placed.
+
+Parameters:
+  *ss: handle of the search.
+
+Returns the checkpoint, to be freed by the caller.
+
+*/
+char *ships_search_checkpoint(const struct ships_search *ss)
+{
+    const struct game_state_const *is = &ss->is;
+    const struct search *s = &ss->s;
+    int k, t, ns = is->num_ships;
+    char *str = snewn(12*(CHECKPOINT_HEAD + 9*ns) + 2*21 + 1, char);
+    char *ptr = str;
+
+    ptr += sprintf(ptr, "%d %d %d %lld %lld %d %d %d %d %d %d", is->H, is->W, 
+      ns, s->count_lim, ss->soln.count, ss->soln.err, s->depth, s->shard, 
+      s->num_shards, s->shard_depth, s->prefix
+    );
+    for (k = 0; k < ns; k++) {
+        for (t = 0; t < 3; t++) {
+            ptr += sprintf(ptr, " %d",
+              (ss->soln.err != 3 ? ss->soln.ship_coord[k][t] : 0)
+            );
+        }
+    }
+    for (k = 0; k < ns; k++) {
+        for (t = 0; t < 3; t++) {
+            ptr += sprintf(ptr, " %d",
+              (ss->soln.err == 2 ? ss->soln.ship_coord2[k][t] : 0)
+            );
+        }
+    }
+    for (k = 0; k < s->depth; k++) {
+        ptr += sprintf(ptr, " %d %d %d",
+          s->frame[k].vert, s->frame[k].y, s->frame[k].x
+        );
+    }
+    return str;
+}
+
+
+/*
+Restore a search from its checkpoint (see ships_search_checkpoint())
+
+The ships on the stack are placed again and their cells blocked, and the
+search continues with the node at which it was stopped: it gives the same
+result and count as if it had not been interrupted.
+
+Parameters:
+  *state: game state of the puzzle of the search;
+  *checkpoint: checkpoint of the search.
+
+Returns the handle of the search, or NULL if the checkpoint is invalid or
+does not belong to the puzzle.
+
+*/
+struct ships_search *ships_search_resume(
+  const game_state *state, const char *checkpoint
+)
+{
+    const struct game_state_const *is = state->init_state;
+    int h = is->H, w = is->W, ns = is->num_ships;
+    int *ships = is->ships;
+    int num = 0, k, depth, vert, y, x;
+    int *v = snewn(CHECKPOINT_HEAD + 9*ns, int);
+    long long count_lim = 0, count = 0;
+    const char *ptr = checkpoint;
+    char *end;
+    bool ok;
+
+    // count_lim and count (v[3], v[4]) are kept as long long, the other 
+    // values must be in the range of int
+    while (num < CHECKPOINT_HEAD + 9*ns) {
+        long long val = strtoll(ptr, &end, 10);
+        if (end == ptr) break;
+        if (num == 3) count_lim = val;
+        else if (num == 4) count = val;
+        else if (val < INT_MIN || val > INT_MAX) break;
+        else v[num] = (int) val;
+        num++;
+        ptr = end;
+    }
+    while (*ptr == ' ' || *ptr == '\n') ptr++;
+
+    // header, and the number of values as given by the depth
+    depth = (num >= CHECKPOINT_HEAD ? v[6] : -1);
+    if (
+      *ptr || depth < 0 || depth > ns || 
+      num != CHECKPOINT_HEAD + 6*ns + 3*depth ||
+      v[0] != h || v[1] != w || v[2] != ns || count < 0 ||
+      v[5] < 0 || v[5] > 3 || v[8] < 1 || v[7] < 0 || v[7] >= v[8] ||
+      v[9] < 0 || v[9] > min(2, ns - 1) || v[10] < 0
+    ) {
+        sfree(v);
+        return NULL;
+    }
+
+    struct ships_search *ss = ships_search_new(state, count_lim);
+    struct search *s = &ss->s;
+    ss->soln.count = count;
+    ss->soln.err = v[5];
+    s->shard = v[7];
+    s->num_shards = v[8];
+    s->shard_depth = v[9];
+    s->prefix = v[10];
+
+    // solutions found: ships within the grid
+    ok = true;
+    for (k = 0; k < 2*ns; k++) {
+        vert = v[CHECKPOINT_HEAD + 3*k];
+        y = v[CHECKPOINT_HEAD + 1 + 3*k];
+        x = v[CHECKPOINT_HEAD + 2 + 3*k];
+        if (
+          vert < 0 || vert > 1 || y < 0 || x < 0 ||
+          y + vert*(ships[k % ns] - 1) >= h ||
+          x + (1 - vert)*(ships[k % ns] - 1) >= w
+        ) ok = false;
+        else if (k < ns) {
+            ss->soln.ship_coord[k][0] = vert;
+            ss->soln.ship_coord[k][1] = y;
+            ss->soln.ship_coord[k][2] = x;
+        }
+        else {
+            ss->soln.ship_coord2[k - ns][0] = vert;
+            ss->soln.ship_coord2[k - ns][1] = y;
+            ss->soln.ship_coord2[k - ns][2] = x;
+        }
+    }
+
+    // frames: the ships below the top are placed as during the search,
+    // which must accept them; the top frame is the start of its ship
+    s->depth = depth;
+    s->enter = true;
+    for (k = 0; ok && k < depth; k++) {
+        vert = s->frame[k].vert = v[CHECKPOINT_HEAD + 6*ns + 3*k];
+        y = s->frame[k].y = v[CHECKPOINT_HEAD + 1 + 6*ns + 3*k];
+        x = s->frame[k].x = v[CHECKPOINT_HEAD + 2 + 6*ns + 3*k];
+        if (vert < 0 || vert > 1 || y < 0 || y >= h || x < 0 || x >= w) {
+            ok = false;
+        }
+        else if (k < depth - 1) {
+            ok = (
+              vert < min(2, ships[k]) &&
+              y + vert*(ships[k] - 1) < h &&
+              x + (1 - vert)*(ships[k] - 1) < w &&
+              place_ship_fits(s, k, vert, y, x)
+            );
+            if (ok) {
+                place_ship_mark(s, k, vert, y, x, 1);
+                s->ship_coord_tmp[k][0] = vert;
+                s->ship_coord_tmp[k][1] = y;
+                s->ship_coord_tmp[k][2] = x;
+                ok = place_ship_block(s, k, vert, y, x, 0, 0);
+            }
+        }
+    }
+
+    sfree(v);
+    if (! ok) {
+        const char *error;
+        ships_search_finish(ss, &error);
+        return NULL;
+    }
+    return ss;
+}
+
+
+/*
+Result of a search started by ships_search_new() or ships_search_resume(),
+and release of the search
+
+Parameters:
+  *ss: handle of the search (invalid afterwards);
+  **error: set to an error message if no move string is returned.
+
+Returns the move string of the solution as solve_game(), or NULL (also if
+the search is not finished).
+
+*/
+char *ships_search_finish(struct ships_search *ss, const char **error)
+{
+    char *move = NULL;
+
+    if (ss->s.depth > 0) *error = "Solver was stopped before the end";
+    else if (ss->soln.err == 0) {
+        move = solution_move(&ss->is, ss->soln.ship_coord);
+    }
+    else if (ss->soln.err == 1) {
+        *error = "Solver gave up: the puzzle takes too long to solve";
+    }
+    else if (ss->soln.err == 2) {
+        *error = "Multiple solutions exist for this puzzle";
+    }
+    else *error = "No solution exists for this puzzle";
+
+    scratch_free(ss->sc);
+    sfree(ss);
+    return move;
+}
+
+
+#ifdef SHIPS_THREADS
+
+/* state shared between the thread calling ships_solve_*() and the worker */
+struct ships_async_solve {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    // private copy of the constant part of the game state
+    game_state *state;
+    struct solve_ctl ctl;
+    // protected by lock: progress, cancel request, completion
+    long long nodes;
+    double fraction;
+    bool cancel, done;
+    // result (read after the worker has been joined)
+    char *move;
+    const char *error;
+};
+
+/* progress callback of the worker: publish the progress, fetch the 
+cancel request */
+static bool async_progress(const struct solve_ctl *ctl, void *ctx)
+{
+    struct ships_async_solve *as = ctx;
+    bool cancel;
+    pthread_mutex_lock(&as->lock);
+    as->nodes = ctl->nodes;
+    as->fraction = (double) ctl->first_done/ctl->first_total;
+    cancel = as->cancel;
+    pthread_mutex_unlock(&as->lock);
+    return cancel;
+}
+
+static void *async_worker(void *ctx)
+{
+    struct ships_async_solve *as = ctx;
+    as->move = solve_init_state(as->state->init_state, &as->ctl, &as->error);
+    pthread_mutex_lock(&as->lock);
+    as->nodes = as->ctl.nodes;
+    as->fraction = 1.0;
+    as->done = true;
+    pthread_mutex_unlock(&as->lock);
+    return NULL;
+}
+
+
+/*
+Start solving a game on a worker thread
+
+The worker gets its own copy of the game (the reference count of the 
+shared part of game_state is not thread-safe), so that state can be 
+freed while the worker runs. The search has no time limit; it runs until 
+it is finished or cancelled by ships_solve_cancel(). Every call of 
+ships_solve_start() must be matched by ships_solve_finish().
+
+Parameters:
+  *state: game state whose puzzle is to be solved.
+
+Returns the handle of the running solver, or NULL if no thread could be
+started.
+
+*/
+struct ships_async_solve *ships_solve_start(const game_state *state)
+{
+    const struct game_state_const *is = state->init_state;
+    struct ships_async_solve *as = snew(struct ships_async_solve);
+    game_params params;
+    char *desc;
+    
+    params.H = is->H;
+    params.W = is->W;
+    params.diff = 0;
+    desc = encode_desc(
+      is->H, is->W, is->num_ships, is->ships, is->rows, is->cols, is->init
+    );
+    as->state = new_game(NULL, &params, desc);
+    sfree(desc);
+    
+    memset(&as->ctl, 0, sizeof(as->ctl));
+    as->ctl.progress = async_progress;
+    as->ctl.ctx = as;
+    as->nodes = 0;
+    as->fraction = 0.0;
+    as->cancel = as->done = false;
+    as->move = NULL;
+    as->error = NULL;
+    
+    pthread_mutex_init(&as->lock, NULL);
+    if (pthread_create(&as->thread, NULL, async_worker, as)) {
+        pthread_mutex_destroy(&as->lock);
+        free_game(as->state);
+        sfree(as);
+        return NULL;
+    }
+    return as;
+}
+
+
+/*
+Progress of a solver started by ships_solve_start()
+
+Parameters:
+  *as: handle of the solver;
+  *nodes: set to the number of calls of place_ship() so far (if not NULL);
+  *fraction: set to the fraction of the positions of the first ship that 
+have been tried, between 0 and 1 (if not NULL).
+
+Returns true if the solver has finished (ships_solve_finish() will not 
+block).
+
+*/
+bool ships_solve_progress(
+  struct ships_async_solve *as, long long *nodes, double *fraction
+)
+{
+    bool done;
+    pthread_mutex_lock(&as->lock);
+    if (nodes)    *nodes = as->nodes;
+    if (fraction) *fraction = as->fraction;
+    done = as->done;
+    pthread_mutex_unlock(&as->lock);
+    return done;
+}
+
+
+/* ask a solver started by ships_solve_start() to stop as soon as possible */
+void ships_solve_cancel(struct ships_async_solve *as)
+{
+    pthread_mutex_lock(&as->lock);
+    as->cancel = true;
+    pthread_mutex_unlock(&as->lock);
+}
+
+
+/*
+Wait for a solver started by ships_solve_start() and release it
+
+Parameters:
+  *as: handle of the solver (invalid afterwards);
+  **error: set to an error message if no move string is returned.
+
+Returns the move string of the solution as solve_game(), or NULL.
+
+*/
+char *ships_solve_finish(struct ships_async_solve *as, const char **error)
+{
+    char *move;
+    pthread_join(as->thread, NULL);
+    move = as->move;
+    if (! move) *error = as->error;
+    pthread_mutex_destroy(&as->lock);
+    free_game(as->state);
+    sfree(as);
+    return move;
+}
+
+
+/*
+Set the number of threads on which the generator evaluates the candidate
+changes of the clues at the Unreasonable level
+
+With workers > 0, each candidate of a repair step is solved completely 
+(solve_by_logic() and solver_alt()) on one of the threads, and the one 
+which brings the puzzle closest to the difficulty wanted is taken (see 
+clue_pool_run()); the calling thread counts as one of them. With 0 (the 
+default), the candidates are scored by the logical solver alone (see 
+clue_select()). The games generated depend on whether workers are used, 
+but not on their number.
+
+Parameters:
+  workers: number of threads (larger values than CLUE_CANDIDATES are 
+reduced).
+
+*/
+void ships_set_repair_workers(int workers)
+{
+    repair_workers = max(0, min(workers, CLUE_CANDIDATES));
+}
+
+
+/* candidate change of the clues, solved by struct clue_pool */
+struct clue_task {
+    // own copy of the puzzle, scratch arena of the solvers
+    struct game_state_const is;
+    struct scratch *sc;
+    enum Configuration **grid;
+    // change of the clues (see clue_apply()) and the result of the solvers
+    int pos, val, log_solve;
+    struct sol soln;
+};
+
+/* threads solving the candidate changes of a repair step together */
+struct clue_pool {
+    pthread_t threads[CLUE_CANDIDATES];
+    int num_threads;
+    pthread_mutex_t lock;
+    pthread_cond_t start, done;
+    // protected by lock: number of tasks of the current batch, next task
+    // to be taken, tasks finished, termination request
+    int num, next, finished;
+    bool quit;
+    // puzzle of the current batch, known solution, limit of solver_alt()
+    const struct game_state_const *init_state;
+    int **ship_coord;
+    int count_lim;
+    struct clue_task task[CLUE_CANDIDATES];
+};
+
+
+/* Solve the puzzle of the batch with the change of a task applied */
+static void clue_task_eval(struct clue_pool *pool, struct clue_task *t)
+{
+    const struct game_state_const *is = pool->init_state;
+    int h = is->H, w = is->W, occ, vac;
+    int **init = t->is.init, *rows = t->is.rows, *cols = t->is.cols;
+    
+    t->is = *is;
+    t->is.init = init;
+    t->is.rows = rows;
+    t->is.cols = cols;
+    memcpy(*init, *is->init, sizeof(**init)*h*w);
+    memcpy(rows, is->rows, sizeof(*rows)*h);
+    memcpy(cols, is->cols, sizeof(*cols)*w);
+    clue_apply(&t->is, t->pos, t->val);
+    
+    t->log_solve = solve_by_logic(
+      UNREASONABLE, &t->is, t->grid, &occ, &vac, t->sc
+    );
+    solver_alt(&t->is, pool->ship_coord, pool->count_lim, &t->soln, t->sc);
+}
+
+
+/* Thread of struct clue_pool: take the tasks of each batch in turn */
+static void *clue_worker(void *arg)
+{
+    struct clue_pool *pool = arg;
+    int k;
+    
+    pthread_mutex_lock(&pool->lock);
+    while (true) {
+        while (! pool->quit && pool->next >= pool->num) {
+            pthread_cond_wait(&pool->start, &pool->lock);
+        }
+        if (pool->quit) break;
+        k = pool->next++;
+        pthread_mutex_unlock(&pool->lock);
+        clue_task_eval(pool, &pool->task[k]);
+        pthread_mutex_lock(&pool->lock);
+        if (++pool->finished == pool->num) pthread_cond_signal(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+
+/*
+Create the threads which solve the candidate changes of the clues
+
+Parameters:
+  *init_state: constant part of game_state of the puzzle generated (H, 
+W, num_ships);
+  threads: number of threads including the calling one (at most 
+CLUE_CANDIDATES).
+
+If a thread cannot be created, the remaining work is done by the others.
+
+*/
+static struct clue_pool *clue_pool_new(
+  const struct game_state_const *init_state, int threads
+)
+{
+    int k;
+    int h = init_state->H, w = init_state->W, ns = init_state->num_ships;
+    struct clue_pool *pool = snew(struct clue_pool);
+    
+    for (k = 0; k < CLUE_CANDIDATES; k++) {
+        struct clue_task *t = &pool->task[k];
+        t->sc = scratch_new(h, w, ns);
+        t->is.init = scratch_grid_int(t->sc, h, w);
+        t->is.rows = scratch_newn(t->sc, h, int);
+        t->is.cols = scratch_newn(t->sc, w, int);
+        t->grid = scratch_grid_int(t->sc, h, w);
+        scratch_sol(t->sc, ns, &t->soln);
+    }
+    pool->num = pool->next = pool->finished = 0;
+    pool->quit = false;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    
+    pool->num_threads = 0;
+    for (k = 1; k < threads; k++) {
+        if (pthread_create(
+          &pool->threads[pool->num_threads], NULL, clue_worker, pool
+        )) break;
+        pool->num_threads++;
+    }
+    
+    return pool;
+}
+
+
+/* Stop the threads and free the pool */
+static void clue_pool_free(struct clue_pool *pool)
+{
+    int k;
+    
+    pthread_mutex_lock(&pool->lock);
+    pool->quit = true;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+    for (k = 0; k < pool->num_threads; k++) {
+        pthread_join(pool->threads[k], NULL);
+    }
+    
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->start);
+    pthread_cond_destroy(&pool->done);
+    for (k = 0; k < CLUE_CANDIDATES; k++) scratch_free(pool->task[k].sc);
+    sfree(pool);
+}
+
+
+/*
+Solve the candidate changes of the clues on the threads of the pool and 
+choose the best one (Unreasonable level)
+
+Parameters:
+  *pool: threads (see clue_pool_new());
+  *init_state: constant part of game_state with the current clues (not 
+changed);
+  **ship_coord: num_ships x 3 array of the layout (see solver_alt());
+  *count_int: target range of the count of place_ship() calls (min, max),
+the latter is the limit of solver_alt();
+  *pos, *val, num: candidates (see clue_select());
+  *log_solve, *soln: the result of solve_by_logic() and solver_alt() for
+the chosen candidate is saved here;
+  *tel: telemetry record, where the solver calls for the candidates not
+chosen are added (NULL if not required).
+
+A candidate which makes the puzzle unique, not solvable by logic and 
+takes at least count_int[0] calls of place_ship() is best; then come 
+unique puzzles the more calls they take, then ambiguous puzzles, and 
+then puzzles which are too difficult. Ties go to the earlier candidate,
+so that the choice depends on the random order of *pos only, not on the
+timing of the threads.
+
+Returns the index of the chosen candidate.
+
+*/
+static int clue_pool_run(
+  struct clue_pool *pool, const struct game_state_const *init_state, 
+  int **ship_coord, const int *count_int, const int *pos, const int *val, 
+  int num, int *log_solve, struct sol *soln, struct gen_telemetry *tel
+)
+{
+    int k, dist, best = 0, best_dist = 0;
+    int ns = init_state->num_ships;
+    
+    pthread_mutex_lock(&pool->lock);
+    pool->init_state = init_state;
+    pool->ship_coord = ship_coord;
+    pool->count_lim  = count_int[1];
+    for (k = 0; k < num; k++) {
+        pool->task[k].pos = pos[k];
+        pool->task[k].val = val[k];
+    }
+    pool->num = num;
+    pool->next = pool->finished = 0;
+    pthread_cond_broadcast(&pool->start);
+    
+    // the calling thread takes tasks as well
+    while (pool->next < pool->num) {
+        k = pool->next++;
+        pthread_mutex_unlock(&pool->lock);
+        clue_task_eval(pool, &pool->task[k]);
+        pthread_mutex_lock(&pool->lock);
+        pool->finished++;
+    }
+    while (pool->finished < pool->num) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    
+    // distance from the target range
+    for (k = 0; k < num; k++) {
+        struct clue_task *t = &pool->task[k];
+        if (t->soln.err == 0) {
+            dist = 
+              max(count_int[0] - t->soln.count, 0) + 
+              (t->log_solve < 2 ? count_int[0] : 0)
+            ;
+        }
+        else if (t->soln.err == 2) dist = 2*count_int[0] + 1;
+        else                       dist = 2*count_int[0] + 2;
+        if (k == 0 || dist < best_dist) {
+            best = k;
+            best_dist = dist;
+        }
+    }
+    
+    // the chosen candidate is counted by the caller as a usual step
+    for (k = 0; tel && k < num; k++) {
+        if (k == best) continue;
+        tel->logic_calls++;
+        tel->solver_calls++;
+        tel->solver_count += pool->task[k].soln.count;
+    }
+    
+    struct clue_task *t = &pool->task[best];
+    *log_solve  = t->log_solve;
+    soln->err   = t->soln.err;
+    soln->count = t->soln.count;
+    memcpy(*soln->ship_coord, *t->soln.ship_coord, ns*3*sizeof(int));
+    memcpy(*soln->ship_coord2, *t->soln.ship_coord2, ns*3*sizeof(int));
+    
+    return best;
+}
+
+#endif
+
+
+
+#ifdef SHIPS_STATS
+
+/* names of the phases and of the branches of the repair loop */
+static const char *const phase_names[NPHASES] = {
+    "ships", "layout", "clues", "repair", "solve_by_logic", "solver"
+};
+static const char *const repair_names[NREPAIRS] = {
+    "accept", "hide_sum", "hide_cell", "ambiguous", "show_sum", 
+    "show_vacant", "show_ship"
+};
+
+
+/*
+End a timed phase: accumulate its duration and record a trace event
+
+The first call registers stats_print() to be called at exit.
+
+*/
+static void stats_phase_end(enum Phase phase)
+{
+    struct ships_stats *st = &ships_stats;
+    double t = time_us();
+    
+    if (! st->events) {
+        st->size_events = 1024;
+        st->events = snewn(st->size_events, struct stats_event);
+        atexit(stats_print);
+    }
+    else if (st->num_events == st->size_events) {
+        st->size_events *= 2;
+        st->events = sresize(st->events, st->size_events, struct stats_event);
+    }
+    
+    st->events[st->num_events].phase = phase;
+    st->events[st->num_events].ts    = st->phase_t0[phase];
+    st->events[st->num_events].dur   = t - st->phase_t0[phase];
+    st->num_events++;
+    
+    st->phase_calls[phase]++;
+    st->phase_us[phase] += t - st->phase_t0[phase];
+}
+
+
+/* number of occupied and vacant cells in the grid */
+static void stats_logic_count(int h, int w, int **grid, int *occ, int *vac)
+{
+    int i;
+    
+    *occ = *vac = 0;
+    for (i = 0; i < h*w; i++) {
+        *occ += ((*grid)[i] >= 0);
+        *vac += ((*grid)[i] == VACANT);
+    }
+}
+
+
+/*
+Print the counters and the phase timings to stderr; if the environment 
+variable SHIPS_TRACE is set, write the trace events to the file it names 
+(Chrome trace-event format, the counters are added as "otherData")
+
+*/
+static void stats_print(void)
+{
+    struct ships_stats *st = &ships_stats;
+    const char *fname = getenv("SHIPS_TRACE");
+    FILE *fp;
+    int i;
+    
+    fprintf(stderr, "place_ship: %ld nodes, pruned: %ld sums, %ld halo, "
+      "%ld disclosed cells\n", st->place_ship_nodes, st->prune_sum, 
+      st->prune_halo, st->prune_init
+    );
+    fprintf(stderr, "place_ship_rng: %ld nodes, %ld failed attempts, "
+      "%ld dropped ships\n", st->rng_nodes, st->rng_fail, st->ship_drops
+    );
+    fprintf(stderr, "repair loop:");
+    for (i = 0; i < NREPAIRS; i++) {
+        fprintf(stderr, " %s %ld", repair_names[i], st->repair[i]);
+    }
+    fprintf(stderr, "\nsolve_by_logic cells per strategy:");
+    for (i = 0; i < NSTRATEGIES; i++) 
+      fprintf(stderr, " %d: %ld", i, st->logic_hits[i])
+    ;
+    fprintf(stderr, "\n");
+    for (i = 0; i < NPHASES; i++) {
+        fprintf(stderr, "%-15s %8ld calls %12.3f ms\n", phase_names[i], 
+          st->phase_calls[i], st->phase_us[i]*1e-3
+        );
+    }
+    
+    if (fname && (fp = fopen(fname, "w")) != NULL) {
+        fprintf(fp, "{\"traceEvents\":[\n");
+        for (i = 0; i < st->num_events; i++) {
+            fprintf(fp, "{\"name\":\"%s\",\"cat\":\"ships\",\"ph\":\"X\","
+              "\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}%s\n", 
+              phase_names[st->events[i].phase], st->events[i].ts, 
+              st->events[i].dur, (i < st->num_events - 1 ? "," : "")
+            );
+        }
+        fprintf(fp, "],\n\"displayTimeUnit\":\"ms\",\n\"otherData\":{"
+          "\"place_ship_nodes\":%ld,\"prune_sum\":%ld,\"prune_halo\":%ld,"
+          "\"prune_init\":%ld,\"rng_nodes\":%ld,\"rng_fail\":%ld,"
+          "\"ship_drops\":%ld", st->place_ship_nodes, st->prune_sum, 
+          st->prune_halo, st->prune_init, st->rng_nodes, st->rng_fail, 
+          st->ship_drops
+        );
+        for (i = 0; i < NREPAIRS; i++) {
+            fprintf(fp, ",\"repair_%s\":%ld", repair_names[i], st->repair[i]);
+        }
+        for (i = 0; i < NSTRATEGIES; i++) {
+            fprintf(fp, ",\"logic_%d\":%ld", i, st->logic_hits[i]);
+        }
+        fprintf(fp, "}}\n");
+        fclose(fp);
+    }
+    
+    sfree(st->events);
+}
+
+#endif
+
+
+
+#ifdef STANDALONE_SOLVER
+
+/*
+Headless driver
+
+The game is run without a frontend: drawing goes to a null backend (dr is
+NULL), so that only the cost of the game functions themselves is measured.
+
+Usage:
+  ships --replay FILE [-n REPEAT]
+    replay the move log FILE (or standard input if FILE is "-") REPEAT
+    times and report the latency and memory allocated per move;
+  ships --stress [-m MOVES] [-p PARAMS] [-s SEED]
+    play MOVES (default 10000) random moves on a game with parameters 
+    PARAMS (default SIZEMAX x SIZEMAX) keeping all states alive, and 
+    report the memory held by this undo history;
+  ships --diff [-n BOARDS] [-s SEED]
+    differential test: solve BOARDS (default 1000) random boards, partly 
+    with hidden sums, 1-cell ships and contradictory clues, and generated 
+    games with all solver engines and the logical solver, and grade them
+    (ships_grade(): no level without a unique solution); report any 
+    disagreement with the reference solver() together with a minimized 
+    game ID;
+  ships --fleet
+    generate the games of the presets from FLEET_TEST_SEEDS seeds each and
+    check that their number of ships is the same as before the fleet was
+    scaled with the grid (see fleet_test());
+  ships --generate [-n REPEAT] [-p PARAMS] [-s SEED] [-r THREADS]
+    generate the game with parameters PARAMS from the random seed SEED 
+    (as the game ID "PARAMS#SEED") REPEAT times, print its game ID and 
+    the time taken per generation; with THREADS > 0 (SHIPS_THREADS 
+    only), the repair candidates are solved on THREADS threads, with 0
+    (the default) they are scored by the logical solver alone (see 
+    ships_set_repair_workers());
+  ships --chain [-p PARAMS] [-s SEED] [-r THREADS]
+    generate the games of the difficulty levels of PARAMS down to Basic 
+    from one layout (see ships_generate_chain()), print their game IDs 
+    and the time taken; THREADS as for --generate;
+  ships --regrade FILE [-t WORKERS] [-n WINDOW] [-c COUNT]
+    grade the game IDs in FILE (or standard input if FILE is "-") with 
+    the logical solver and solver() limited to COUNT (default 1000000,
+    0 for no limit) calls of place_ship(), on WORKERS (default 2, 
+    SHIPS_THREADS only) threads holding at most WINDOW (default 256) 
+    lines in memory; print one line per game ID in input order (see 
+    regrade_one()) and the throughput;
+  ships --verify GAME_ID [-n NODES] [-c COUNT] [-k FILE] [--shard I/N]
+    solve GAME_ID with solver() limited to COUNT (default 0, no limit) 
+    nodes, in steps of NODES (default 1000000) nodes; save the search to 
+    the checkpoint FILE after each step, or resume it from FILE if it 
+    exists (see verify()); print the solution or the error; with 
+    --shard, run only the shard I of N of the search (see 
+    ships_search_shard()) and print its result as one line;
+  ships --merge FILE
+    combine the lines printed by all shards of a search, read from FILE 
+    (or standard input if FILE is "-"), and print the solution or the 
+    error of the whole search (see merge_shards());
+  ships --layout-table
+    enumerate the layouts of the 7x7 grid and print the initializer of 
+    layout7_table;
+  ships --serve SOCKET [-t WORKERS] [-n POOL_SIZE] [-s SEED]
+    (SHIPS_THREADS only) puzzle server: keep POOL_SIZE (default 16) ready
+    games per preset, generated by WORKERS (default 2) threads, and serve
+    them on the Unix domain socket SOCKET (see serve());
+  ships --client SOCKET
+    (SHIPS_THREADS only) send the requests read from standard input to 
+    the server on SOCKET and print the answers.
+
+A move log is a text file with one entry per line: a game ID of the form
+"{H}x{W}d{diff}:{description}" starts a new game, any other line is a move
+string as produced by interpret_move() ("y..x..z..", "d..y..x..y..x..", 
+"r..", "c..", "S..."). Empty lines and lines starting with '#' are ignored.
+
+*/
+
+/* block header of the counting allocator, keeps the alignment of malloc */
+#define COUNT_HEADER 16
+
+#ifdef SHIPS_THREADS
+/* the counters are shared by the threads of the puzzle server */
+static pthread_mutex_t count_lock = PTHREAD_MUTEX_INITIALIZER;
+#  define COUNT_LOCK()    pthread_mutex_lock(&count_lock)
+#  define COUNT_UNLOCK()  pthread_mutex_unlock(&count_lock)
+#else
+#  define COUNT_LOCK()    ((void) 0)
+#  define COUNT_UNLOCK()  ((void) 0)
+#endif
+
+static void *count_malloc(size_t size)
+{
+    char *p = malloc(size + COUNT_HEADER);
+    if (! p) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    *(size_t *) p = size;
+    COUNT_LOCK();
+    alloc_count.allocs++;
+    alloc_count.bytes += size;
+    alloc_count.live  += size;
+    if (alloc_count.live > alloc_count.peak) 
+      alloc_count.peak = alloc_count.live
+    ;
+    COUNT_UNLOCK();
+    return p + COUNT_HEADER;
+}
+
+static void *count_realloc(void *p, size_t size)
+{
+    if (! p) return count_malloc(size);
+    char *q = (char *) p - COUNT_HEADER;
+    size_t old = *(size_t *) q;
+    q = realloc(q, size + COUNT_HEADER);
+    if (! q) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    *(size_t *) q = size;
+    COUNT_LOCK();
+    alloc_count.allocs++;
+    alloc_count.bytes += size;
+    alloc_count.live  += size - old;
+    if (alloc_count.live > alloc_count.peak) 
+      alloc_count.peak = alloc_count.live
+    ;
+    COUNT_UNLOCK();
+    return q + COUNT_HEADER;
+}
+
+static void count_free(void *p)
+{
+    if (! p) return;
+    char *q = (char *) p - COUNT_HEADER;
+    COUNT_LOCK();
+    alloc_count.frees++;
+    alloc_count.live -= *(size_t *) q;
+    COUNT_UNLOCK();
+    free(q);
+}
+
+static char *count_dupstr(const char *s)
+{
+    char *r = count_malloc(strlen(s) + 1);
+    strcpy(r, s);
+    return r;
+}
+
+
+/* comparison function for sorting doubles in ascending order */
+static int cmp_double(const void *a, const void *b, void *ctx)
+{
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+
+/* read a line of arbitrary length without the newline; NULL at the end */
+static char *read_line(FILE *fp)
+{
+    int size = 256, len = 0, c;
+    char *line = snewn(size, char);
+    
+    while ((c = fgetc(fp)) != EOF && c != '\n') {
+        if (len + 1 >= size) {
+            size *= 2;
+            line = sresize(line, size, char);
+        }
+        line[len++] = c;
+    }
+    if (c == EOF && len == 0) {
+        sfree(line);
+        return NULL;
+    }
+    if (len > 0 && line[len-1] == '\r') len--;
+    line[len] = '\0';
+    return line;
+}
+
+
+/* kinds of moves, as distinguished by the first character */
+enum ReplayKind {
+    REPLAY_CELL, REPLAY_DRAG, REPLAY_SUM, REPLAY_SOLVE, NREPLAYKINDS
+};
+
+static const char *const replay_kind_names[NREPLAYKINDS] = {
+    "cell", "drag", "sum", "solve"
+};
+
+/* latencies in microseconds and allocations of replayed moves */
+struct replay_stats {
+    double *us;
+    int n, size;
+    long allocs;
+    size_t bytes;
+};
+
+static void replay_add(
+  struct replay_stats *rst, double us, long allocs, size_t bytes
+)
+{
+    if (rst->n >= rst->size) {
+        rst->size = rst->size*2 + 256;
+        rst->us = sresize(rst->us, rst->size, double);
+    }
+    rst->us[rst->n++] = us;
+    rst->allocs += allocs;
+    rst->bytes  += bytes;
+}
+
+static void replay_print(const char *name, struct replay_stats *rst)
+{
+    int n = rst->n;
+    if (n == 0) return;
+    arraysort(rst->us, n, cmp_double, NULL);
+    printf(
+      "%-6s %8d %9.1f %9.1f %9.1f %9.1f %10.1f %10.1f\n", name, n,
+      rst->us[n/2], rst->us[(int) (n*.9)], rst->us[(int) (n*.99)], 
+      rst->us[n-1], (double) rst->allocs/n, (double) rst->bytes/n
+    );
+}
+
+
+/*
+Replay a move log as the midend would do it: execute_move(), 
+game_changed_state() and a redraw of the new state; the old states are 
+kept as undo history until the next game starts
+
+Parameters:
+  *fp: move log;
+  *rst: array of NREPLAYKINDS + 1 statistics (per kind of move, and 
+overall);
+  *games, *invalid: counters of games and of rejected moves.
+
+Returns false if the log is malformed.
+
+*/
+static bool replay(
+  FILE *fp, struct replay_stats *rst, int *games, int *invalid
+)
+{
+    game_params *params = default_params();
+    game_state **hist = NULL;
+    int nhist = 0, sizehist = 0, lineno = 0, i;
+    game_ui *ui = NULL;
+    game_drawstate *ds = NULL;
+    char *line;
+    bool ok = true;
+    
+    while (ok && (line = read_line(fp)) != NULL) {
+        lineno++;
+        char *colon = strchr(line, ':');
+        
+        if (! *line || *line == '#') ;
+        
+        // new game
+        else if (colon) {
+            const char *err;
+            *colon = '\0';
+            decode_params(params, line);
+            err = validate_params(params, true);
+            if (! err) err = validate_desc(params, colon + 1);
+            if (err) {
+                fprintf(stderr, "line %d: %s\n", lineno, err);
+                ok = false;
+            }
+            else {
+                if (ui) {
+                    free_ui(ui);
+                    game_free_drawstate(NULL, ds);
+                    for (i = 0; i < nhist; i++) free_game(hist[i]);
+                }
+                if (! hist) {
+                    sizehist = 64;
+                    hist = snewn(sizehist, game_state *);
+                }
+                nhist = 0;
+                hist[nhist++] = new_game(NULL, params, colon + 1);
+                ui = new_ui(hist[0]);
+                ds = game_new_drawstate(NULL, hist[0]);
+                game_set_size(NULL, ds, params, thegame.preferred_tilesize);
+                game_redraw(NULL, ds, NULL, hist[0], 0, ui, 0.0F, 0.0F);
+                (*games)++;
+            }
+        }
+        
+        else if (! ui) {
+            fprintf(stderr, "line %d: move before the first game ID\n", lineno);
+            ok = false;
+        }
+        
+        // move
+        else {
+            enum ReplayKind kind = 
+              *line == 'S' ? REPLAY_SOLVE : *line == 'd' ? REPLAY_DRAG :
+              *line == 'r' || *line == 'c' ? REPLAY_SUM : REPLAY_CELL
+            ;
+            game_state *old = hist[nhist-1], *new;
+            long allocs0 = alloc_count.allocs;
+            size_t bytes0 = alloc_count.bytes;
+            double t0 = time_us();
+            
+            new = execute_move(old, line);
+            if (new) {
+                game_changed_state(ui, old, new);
+                game_redraw(NULL, ds, old, new, +1, ui, 0.0F, 0.0F);
+            }
+            
+            double t1 = time_us();
+            if (! new) (*invalid)++;
+            else {
+                replay_add(
+                  &rst[kind], t1 - t0, alloc_count.allocs - allocs0, 
+                  alloc_count.bytes - bytes0
+                );
+                replay_add(
+                  &rst[NREPLAYKINDS], t1 - t0, 
+                  alloc_count.allocs - allocs0, alloc_count.bytes - bytes0
+                );
+                if (nhist >= sizehist) {
+                    sizehist *= 2;
+                    hist = sresize(hist, sizehist, game_state *);
+                }
+                hist[nhist++] = new;
+            }
+        }
+        
+        sfree(line);
+    }
+    
+    if (ui) {
+        free_ui(ui);
+        game_free_drawstate(NULL, ds);
+        for (i = 0; i < nhist; i++) free_game(hist[i]);
+    }
+    sfree(hist);
+    free_params(params);
+    return ok;
+}
+
+
+/*
+Play random moves the way a player does, keeping every state alive as the 
+midend keeps the undo history, and report the memory held by the chain
+
+Parameters:
+  *params: game parameters;
+  *seed: random seed for the game and the moves;
+  moves: number of moves to play.
+
+*/
+static void stress(const game_params *params, const char *seed, int moves)
+{
+    int h = params->H, w = params->W;
+    int i, m, y, x, y2, x2, rejected = 0;
+    char move[64];
+    random_state *rs = random_new(seed, strlen(seed));
+    char *aux = NULL;
+    
+    double t0 = time_us();
+    char *desc = new_game_desc(params, rs, &aux, false);
+    double t_gen = time_us() - t0;
+    
+    struct alloc_count count0 = alloc_count;
+    game_state **hist = snewn(moves + 1, game_state *);
+    int nhist = 0;
+    hist[nhist++] = new_game(NULL, params, desc);
+    struct alloc_count count1 = alloc_count;
+    
+    t0 = time_us();
+    for (m = 0; m < moves; m++) {
+        game_state *old = hist[nhist-1], *new;
+        int **init = old->init_state->init, **grid = old->grid_state;
+        int kind = random_upto(rs, 20);
+        
+        // click on a cell: UNDEF -> OCCUP/VACANT (left/right), else UNDEF
+        if (kind < 14) {
+            y = random_upto(rs, h);
+            x = random_upto(rs, w);
+            if (init[y][x] != UNDEF) {m--; continue;}
+            sprintf(move, "y%dx%dz%d", y, x, 
+              grid[y][x] != UNDEF ? UNDEF : random_upto(rs, 2) ? OCCUP : VACANT
+            );
+        }
+        // right drag along a row or column, clearing if it starts at VACANT
+        else if (kind < 17) {
+            y = y2 = random_upto(rs, h);
+            x = x2 = random_upto(rs, w);
+            if (init[y][x] != UNDEF) {m--; continue;}
+            if (random_upto(rs, 2)) y2 = random_upto(rs, h);
+            else                    x2 = random_upto(rs, w);
+            sprintf(move, "d%dy%dx%dy%dx%d", grid[y][x] != UNDEF, y, x, y2, x2);
+        }
+        // row or column done
+        else if (kind < 19) sprintf(move, "r%d", (int) random_upto(rs, h));
+        else                sprintf(move, "c%d", (int) random_upto(rs, w));
+        
+        new = execute_move(old, move);
+        if (! new) {rejected++; continue;}
+        hist[nhist++] = new;
+    }
+    double t_moves = time_us() - t0;
+    
+    size_t live = alloc_count.live - count0.live;
+    size_t per_state = 
+      (nhist > 1 ? (alloc_count.live - count1.live)/(nhist - 1) : 0)
+    ;
+    long allocs = alloc_count.allocs - count1.allocs;
+    
+    printf("game %dx%dd%d, seed %s, generated in %.1f ms\n", 
+      h, w, params->diff, seed, t_gen*1e-3
+    );
+    printf("states kept:        %d (%d rejected moves)\n", nhist, rejected);
+    printf("live bytes:         %lu\n", (unsigned long) live);
+    printf("first state:        %lu bytes\n", 
+      (unsigned long) (count1.live - count0.live)
+    );
+    printf("bytes per state:    %lu\n", (unsigned long) per_state);
+    printf("allocations:        %ld (%.1f per move)\n", 
+      allocs, (nhist > 1 ? (double) allocs/(nhist - 1) : 0.0)
+    );
+    printf("peak live bytes:    %lu\n", (unsigned long) alloc_count.peak);
+    printf("time per move:      %.2f us\n", (moves ? t_moves/moves : 0.0));
+    
+    for (i = 0; i < nhist; i++) free_game(hist[i]);
+    sfree(hist);
+    sfree(desc);
+    random_free(rs);
+}
+
+
+/*
+Differential test of the solvers
+
+Solver engines compared by the test: the first one is the reference, all 
+others must give the same error code and, for a unique solution, the same 
+ship coordinates. Engines are called as solver().
+*/
+struct diff_engine {
+    const char *name;
+    void (*solve)(
+      const struct game_state_const *init_state, long long count_lim, 
+      struct sol *soln, struct scratch *sc
+    );
+};
+
+/* solver() restricted to the generic kernel */
+static void solver_generic(
+  const struct game_state_const *init_state, long long count_lim,
+  struct sol *soln, struct scratch *sc
+)
+{
+    solver_kernel(init_state, count_lim, soln, sc, place_ship);
+}
+
+/* layout7_match() for the fleet of the 7x7 grid, else solver() */
+static void solver_layout7(
+  const struct game_state_const *init_state, long long count_lim,
+  struct sol *soln, struct scratch *sc
+)
+{
+    if (! layout7_fleet(init_state)) {
+        solver(init_state, count_lim, soln, sc);
+        return;
+    }
+    soln->count = 
+      layout7_match(init_state, 2, soln->ship_coord, soln->ship_coord2, NULL)
+    ;
+    soln->err = (soln->count == 0 ? 3 : soln->count == 1 ? 0 : 2);
+}
+
+static const struct diff_engine diff_engines[] = {
+    {"solver", solver},
+    {"generic", solver_generic},
+    {"layout7", solver_layout7},
+};
+
+/* results of diff_check() */
+enum DiffResult {
+    DIFF_OK,        // all agree
+    DIFF_REF,       // the unique solution of the reference violates the clues
+    DIFF_MISMATCH   // an engine or the logical solver disagrees
+};
+
+/* test board */
+struct diff_board {
+    game_params params;
+    int num_ships, ships[NUM_SHIPS_MAX];
+    int rows[SIZEMAX], cols[SIZEMAX];
+    int init[SIZEMAX*SIZEMAX];
+};
+
+
+/* game description of a test board, to be freed by the caller */
+static char *diff_desc(const struct diff_board *b)
+{
+    int i, h = b->params.H, w = b->params.W;
+    int *init[SIZEMAX];
+    for (i = 0; i < h; i++) init[i] = (int *) b->init + i*w;
+    return encode_desc(h, w, b->num_ships, b->ships, b->rows, b->cols, init);
+}
+
+
+/*
+Configuration of the cells for given ship coordinates
+
+Parameters:
+  h, w: height, width;
+  ns: number of ships;
+  *ships: array of ship sizes;
+  **coord: ns x 3 array of ship coordinates (vert, y, x);
+  *conf: h*w array where the configuration (VACANT, NORTH, ...) is written.
+
+Returns false if ships leave the grid, overlap or touch each other.
+
+*/
+static bool diff_layout(
+  int h, int w, int ns, const int *ships, int **coord, int *conf
+)
+{
+    int i, j, k, l, y, x;
+    
+    for (i = 0; i < h*w; i++) conf[i] = VACANT;
+    for (k = 0; k < ns; k++) {
+        int vert = coord[k][0], y0 = coord[k][1], x0 = coord[k][2];
+        int ship_H = vert*ships[k] + 1 - vert, ship_W = ships[k] + 1 - ship_H;
+        if (y0 < 0 || x0 < 0 || y0 + ship_H > h || x0 + ship_W > w) 
+          return false
+        ;
+        for (i = max(y0-1, 0); i < min(y0 + ship_H + 1, h); i++) {
+            for (j = max(x0-1, 0); j < min(x0 + ship_W + 1, w); j++) {
+                if (conf[i*w + j] != VACANT) return false;
+            }
+        }
+        for (l = 0; l < ships[k]; l++) {
+            y = y0 + l*vert; 
+            x = x0 + l*(1 - vert);
+            conf[y*w + x] = 
+              ships[k] == 1 ? ONE : 
+              l == 0 ? (vert ? NORTH : WEST) :
+              l == ships[k] - 1 ? (vert ? SOUTH : EAST) : INNER
+            ;
+        }
+    }
+    return true;
+}
+
+
+/* check that a solution satisfies the sums and the disclosed cells */
+static bool diff_verify(
+  const struct game_state_const *is, int **coord, int *conf
+)
+{
+    int i, j, h = is->H, w = is->W, sum;
+    
+    if (! diff_layout(h, w, is->num_ships, is->ships, coord, conf)) 
+      return false
+    ;
+    for (i = 0; i < h; i++) {
+        for (sum = j = 0; j < w; j++) sum += (conf[i*w + j] >= 0);
+        if (is->rows[i] != -1 && is->rows[i] != sum) return false;
+    }
+    for (j = 0; j < w; j++) {
+        for (sum = i = 0; i < h; i++) sum += (conf[i*w + j] >= 0);
+        if (is->cols[j] != -1 && is->cols[j] != sum) return false;
+    }
+    for (i = 0; i < h*w; i++) {
+        int c = (*is->init)[i];
+        if (
+          c == VACANT && conf[i] != VACANT ||
+          c == OCCUP  && conf[i] < 0 ||
+          c > OCCUP   && conf[i] != c
+        ) return false;
+    }
+    return true;
+}
+
+
+/*
+Run all solver engines, the logical solver and ships_grade() on a board 
+and compare them with the reference
+
+Parameters:
+  *b: test board;
+  count_lim: limit on the calls of place_ship() (see solver());
+  *msg: buffer of size 256 for the description of a disagreement.
+
+Returns the result as in enum DiffResult. Boards with an invalid 
+description are skipped (DIFF_OK).
+
+The reference itself is checked against the clues: with contradictory
+clues place_ship() may report a solution which leaves a disclosed ship
+cell uncovered, since this is only enforced through the sums; this is 
+reported as DIFF_REF, apart from real disagreements.
+
+*/
+static enum DiffResult diff_check(
+  const struct diff_board *b, int count_lim, char *msg
+)
+{
+    int i, e, occ, vac;
+    int h = b->params.H, w = b->params.W, ns = b->num_ships;
+    enum DiffResult bad = DIFF_OK;
+    char *desc = diff_desc(b);
+    
+    if (validate_desc(&b->params, desc)) {
+        sfree(desc);
+        return DIFF_OK;
+    }
+    game_state *state = new_game(NULL, &b->params, desc);
+    const struct game_state_const *is = state->init_state;
+    struct scratch *sc = scratch_new(h, w, ns);
+    struct sol ref, soln;
+    struct ships_grade grade;
+    scratch_sol(sc, ns, &ref);
+    scratch_sol(sc, ns, &soln);
+    int *conf = scratch_newn(sc, h*w, int), *conf2 = scratch_newn(sc, h*w, int);
+    int *conf3 = scratch_newn(sc, h*w, int);
+    
+    // reference; solutions which violate the clues are disregarded below
+    diff_engines[0].solve(is, count_lim, &ref, sc);
+    bool valid1 = 
+      (ref.err == 0 || ref.err == 2) && diff_verify(is, ref.ship_coord, conf)
+    ;
+    bool valid2 = ref.err == 2 && diff_verify(is, ref.ship_coord2, conf2);
+    if (ref.err == 0 && ! valid1) {
+        sprintf(msg, "%s: solution violates the clues", diff_engines[0].name);
+        bad = DIFF_REF;
+    }
+    
+    // grading: a level only for a unique solution, none (-1) for a board
+    // without a solution (contradictory clues) or with several
+    ships_grade(is, count_lim, &grade);
+    if (grade.err != ref.err || (grade.diff >= 0) != (ref.err == 0)) {
+        sprintf(msg, "ships_grade: level %d, err %d, %s: err %d", 
+          grade.diff, grade.err, diff_engines[0].name, ref.err
+        );
+        bad = DIFF_MISMATCH;
+    }
+    
+    // further engines
+    for (e = 1; bad != DIFF_MISMATCH && e < lenof(diff_engines); e++) {
+        diff_engines[e].solve(is, count_lim, &soln, sc);
+        if (soln.err != ref.err) {
+            sprintf(msg, "%s: err %d, %s: err %d", diff_engines[0].name, 
+              ref.err, diff_engines[e].name, soln.err
+            );
+            bad = DIFF_MISMATCH;
+        }
+        else if (
+          ref.err == 0 && memcmp(
+            *ref.ship_coord, *soln.ship_coord, ns*3*sizeof(int)
+          )
+        ) {
+            sprintf(msg, "%s and %s: different solutions", 
+              diff_engines[0].name, diff_engines[e].name
+            );
+            bad = DIFF_MISMATCH;
+        }
+    }
+    
+    // relative search (solver_alt()) with the first solution of the 
+    // reference as the known one: same verdict, and a second solution 
+    // must differ from it and satisfy the clues
+    if (bad != DIFF_MISMATCH && valid1) {
+        solver_alt(is, ref.ship_coord, count_lim, &soln, sc);
+        if (soln.err != ref.err) {
+            sprintf(msg, "%s: err %d, solver_alt: err %d", 
+              diff_engines[0].name, ref.err, soln.err
+            );
+            bad = DIFF_MISMATCH;
+        }
+        else if (soln.err == 2 && (
+          ! diff_verify(is, soln.ship_coord2, conf3) || 
+          ! memcmp(conf, conf3, h*w*sizeof(int))
+        )) {
+            sprintf(msg, "solver_alt: second solution invalid or not new");
+            bad = DIFF_MISMATCH;
+        }
+    }
+    
+    // backbone of an ambiguous puzzle (as in live_backbone(), with a 
+    // small fraction of count_lim, as it takes one search per cell): the
+    // cells found to be fixed must agree with both solutions of the 
+    // reference
+    if (bad != DIFF_MISMATCH && valid1 && valid2) {
+        enum Configuration *bb = scratch_newn(sc, h*w, enum Configuration);
+        backbone(is, ref.ship_coord, count_lim/100, bb, NULL, sc);
+        for (i = 0; i < h*w; i++) {
+            if (
+              bb[i] == OCCUP  && (conf[i] < 0  || conf2[i] < 0) ||
+              bb[i] == VACANT && (conf[i] >= 0 || conf2[i] >= 0)
+            ) {
+                sprintf(msg, "backbone: cell y%dx%d is wrong", i/w, i%w);
+                bad = DIFF_MISMATCH;
+                break;
+            }
+        }
+    }
+    
+    // logical solver: every cell it determines must agree with the 
+    // valid solution(s) found by the reference
+    if (bad != DIFF_MISMATCH && (valid1 || valid2)) {
+        int **grid = scratch_grid_int(sc, h, w);
+        solve_by_logic(UNREASONABLE, is, grid, &occ, &vac, sc);
+        if (! valid1) memcpy(conf, conf2, h*w*sizeof(int));
+        if (! valid2) memcpy(conf2, conf, h*w*sizeof(int));
+        for (i = 0; i < h*w; i++) {
+            int g = (*grid)[i];
+            if (
+              g >= 0 && (conf[i] < 0 || conf2[i] < 0) || 
+              g == VACANT && (conf[i] >= 0 || conf2[i] >= 0)
+            ) {
+                sprintf(msg, 
+                  "solve_by_logic: cell y%dx%d is %s, a solution of %s not", 
+                  i/w, i%w, g == VACANT ? "vacant" : "occupied", 
+                  diff_engines[0].name
+                );
+                bad = DIFF_MISMATCH;
+                break;
+            }
+        }
+    }
     
+    scratch_free(sc);
+    free_game(state);
+    sfree(desc);
+    return bad;
+}
+
+
+/* random grid size: a preset size (with a specialized solver kernel) or 
+any size up to 10 x 10 */
+static void diff_random_size(random_state *rs, game_params *params)
+{
+    static const int presets[][2] = {{7, 7}, {8, 10}, {10, 12}};
+    if (random_upto(rs, 2)) {
+        int k = random_upto(rs, lenof(presets));
+        params->H = presets[k][0];
+        params->W = presets[k][1];
+    }
+    else {
+        params->H = SIZEMIN + random_upto(rs, 4);
+        params->W = SIZEMIN + random_upto(rs, 4);
+    }
+}
+
+
+/* random board, possibly with contradictory clues */
+static void diff_random_board(random_state *rs, struct diff_board *b)
+{
+    int i, j, k, t, a;
+    diff_random_size(rs, &b->params);
+    int h = b->params.H, w = b->params.W;
+    // at most as many ships as the generator's base fleet
+    int ns = 1 + random_upto(rs, NUM_SHIPS_BASE);
+    int ship_max = (min(h, w)*3 + 2)/5;
+    int coord_[NUM_SHIPS_MAX*3], *coord[NUM_SHIPS_MAX], conf[SIZEMAX*SIZEMAX];
+    
+    b->params.diff = UNREASONABLE;
+    for (k = 0; k < NUM_SHIPS_MAX; k++) coord[k] = coord_ + k*3;
+    for (k = 0; k < ns; k++) b->ships[k] = 1 + random_upto(rs, ship_max);
+    int ctx = -1;
+    arraysort(b->ships, ns, cmp, &ctx);
+    
+    // place the ships one after another at random positions; 
+    // drop the smallest ship if this fails repeatedly
+    while (true) {
+        for (a = 0; a < 50; a++) {
+            for (k = 0; k < ns; k++) {
+                for (t = 0; t < 100; t++) {
+                    coord[k][0] = random_upto(rs, 2);
+                    coord[k][1] = random_upto(rs, h);
+                    coord[k][2] = random_upto(rs, w);
+                    if (diff_layout(h, w, k+1, b->ships, coord, conf)) break;
+                }
+                if (t == 100) break;
+            }
+            if (k == ns) break;
+        }
+        if (a < 50) break;
+        ns--;
+    }
+    b->num_ships = ns;
+    
+    // sums, some of them hidden
+    int hide = random_upto(rs, 4)*15;
+    for (i = 0; i < h; i++) {
+        for (b->rows[i] = j = 0; j < w; j++) b->rows[i] += (conf[i*w + j] >= 0);
+        if (random_upto(rs, 100) < hide) b->rows[i] = -1;
+    }
+    for (j = 0; j < w; j++) {
+        for (b->cols[j] = i = 0; i < h; i++) b->cols[j] += (conf[i*w + j] >= 0);
+        if (random_upto(rs, 100) < hide) b->cols[j] = -1;
+    }
+    
+    // disclosed cells, ship cells as OCCUP or with their configuration
+    int clue = random_upto(rs, 4)*5;
+    for (i = 0; i < h*w; i++) {
+        b->init[i] = UNDEF;
+        if (random_upto(rs, 100) < clue) {
+            b->init[i] = 
+              (conf[i] >= 0 && random_upto(rs, 3) == 0 ? OCCUP : conf[i])
+            ;
+        }
+    }
+    
+    // contradiction in every fourth board: a wrong cell or a wrong sum
+    if (random_upto(rs, 4) == 0) {
+        i = random_upto(rs, h*w);
+        if (random_upto(rs, 2)) {
+            if (conf[i] >= 0) {
+                b->init[i] = random_upto(rs, INNER + 1);
+                if (b->init[i] == OCCUP || b->init[i] == conf[i]) 
+                  b->init[i] = VACANT
+                ;
+            }
+            else b->init[i] = random_upto(rs, INNER + 1);
+        }
+        else if (b->rows[i/w] > 0)  b->rows[i/w]--;
+        else if (b->rows[i/w] == 0) b->rows[i/w]++;
+    }
 }
 
-/* 
-Draw ship segments, see enum Configuration 
-  
-Parameters:
-  *dr: drawing object;
-  conf: element id as in enum Configuration (-1 .. 6);
-  tilesize;
-  xf, yf: left upper corner of the square tile frame 
-(square edge is tilesize + 1);
-  color: color of the element (for conf == 0 not relevant, set to -1, e.g.);
-  color_bg: color of the cell background (set to -1 if not needed, e.g., 
-for printing).
-*/
-static void draw_segment(
-  drawing *dr, const enum Configuration conf, const int tilesize, 
-  const int xf, const int yf, const int color, const int color_bg
+
+/* test board from the description of a game */
+static void diff_board_from_desc(
+  struct diff_board *b, const game_params *params, const char *desc
 )
 {
-    int elem_size, shift, coords3[6], coords4[8];
-    int const ts = tilesize;
+    game_state *state = new_game(NULL, params, desc);
+    const struct game_state_const *is = state->init_state;
+    int h = params->H, w = params->W;
     
-    switch (conf) {
-        case VACANT:
-            if (color_bg >= 0) 
-              draw_rect(dr, xf + 1, yf + 1, ts - 1, ts - 1, color_bg)
-            ;
-            elem_size = ts/10 + 1;
-            shift = max((ts - elem_size - 1)/2, 3);
-            elem_size = ts - 1 - 2*shift;   // adjust when ts-elem_size-1 odd
-            draw_rect(
-              dr, xf + shift + 1, yf + shift + 1, elem_size, elem_size, color
-            );
-            break;
-        case OCCUP:
-            if (color_bg >= 0) 
-              draw_rect(dr, xf + 1, yf + 1, ts - 1, ts - 1, color_bg)
-            ;
-            break;
-        case NORTH:
-            if (color_bg >= 0) 
-              draw_rect(dr, xf + 1, yf + 1, ts - 1, ts - 1, color_bg)
-            ;
-            elem_size = ts*6/10 + 1;
-            shift = max((ts - elem_size - 1)/2, 3);
-            elem_size = ts - 1 - 2*shift;
-            coords3[0] = xf + (ts - 1)/2 + 1; 
-            coords3[1] = yf + shift + 1;
-            coords3[2] = xf + shift + 1; 
-            coords3[3] = yf + shift + elem_size;
-            coords3[4] = xf + shift + elem_size; 
-            coords3[5] = yf + shift + elem_size;
-            draw_polygon(dr, coords3, 3, color, color);
-            break;
-        case EAST:
-            if (color_bg >= 0) 
-              draw_rect(dr, xf + 1, yf + 1, ts - 1, ts - 1, color_bg)
-            ;
-            elem_size = ts*6/10 + 1;
-            shift = max((ts - elem_size - 1)/2, 3);
-            elem_size = ts - 1 - 2*shift;
-            coords3[0] = xf + shift + 1; 
-            coords3[1] = yf + shift + 1;
-            coords3[2] = xf + shift + elem_size; 
-            coords3[3] = yf + (ts - 1)/2 + 1;
-            coords3[4] = xf + shift + 1; 
-            coords3[5] = yf + shift + elem_size;
-            draw_polygon(dr, coords3, 3, color, color);
-            break;
-        case SOUTH:
-            if (color_bg >= 0) 
-              draw_rect(dr, xf + 1, yf + 1, ts - 1, ts - 1, color_bg)
-            ;
-            elem_size = ts*6/10 + 1;
-            shift = max((ts - elem_size - 1)/2, 3);
-            elem_size = ts - 1 - 2*shift;
-            coords3[0] = xf + shift + 1; 
-            coords3[1] = yf + shift + 1;
-            coords3[2] = xf + shift + elem_size; 
-            coords3[3] = yf + shift + 1;
-            coords3[4] = xf + (ts - 1)/2 + 1; 
-            coords3[5] = yf + shift + elem_size;
-            draw_polygon(dr, coords3, 3, color, color);
-            break;
-        case WEST:
-            if (color_bg >= 0) 
-              draw_rect(dr, xf + 1, yf + 1, ts - 1, ts - 1, color_bg)
-            ;
-            elem_size = ts*6/10 + 1;
-            shift = max((ts - elem_size - 1)/2, 3);
-            elem_size = ts - 1 - 2*shift;
-            coords3[0] = xf + shift + 1; 
-            coords3[1] = yf + (ts - 1)/2 + 1;
-            coords3[2] = xf + shift + elem_size; 
-            coords3[3] = yf + shift + 1;
-            coords3[4] = xf + shift + elem_size; 
-            coords3[5] = yf + shift + elem_size;
-            draw_polygon(dr, coords3, 3, color, color);
-            break;
-        case ONE:
-            if (color_bg >= 0) 
-              draw_rect(dr, xf + 1, yf + 1, ts - 1, ts - 1, color_bg)
-            ;
-            elem_size = ts*6/10 + 1;
-            shift = max((ts - elem_size - 1)/2, 3);
-            elem_size = ts - 1 - 2*shift;
-            coords4[0] = xf + (ts - 1)/2 + 1; 
-            coords4[1] = yf + shift + 1;
-            coords4[2] = xf + shift + elem_size; 
-            coords4[3] = yf + (ts - 1)/2 + 1;
-            coords4[4] = xf + (ts - 1)/2 + 1; 
-            coords4[5] = yf + shift + elem_size;
-            coords4[6] = xf + shift + 1; 
-            coords4[7] = yf + (ts - 1)/2 + 1;
-            draw_polygon(dr, coords4, 4, color, color);
-            break;
-        case INNER:
-            if (color_bg >= 0) 
-              draw_rect(dr, xf + 1, yf + 1, ts - 1, ts - 1, color_bg)
+    b->params = *params;
+    b->num_ships = is->num_ships;
+    memcpy(b->ships, is->ships, is->num_ships*sizeof(int));
+    memcpy(b->rows, is->rows, h*sizeof(int));
+    memcpy(b->cols, is->cols, w*sizeof(int));
+    memcpy(b->init, *is->init, h*w*sizeof(int));
+    free_game(state);
+}
+
+
+/* remove clues from a board as long as diff_check() gives the same 
+result res */
+static void diff_minimize(
+  struct diff_board *b, int count_lim, enum DiffResult res
+)
+{
+    int i, v, h = b->params.H, w = b->params.W;
+    char msg[256];
+    bool changed = true;
+    
+    while (changed) {
+        changed = false;
+        for (i = 0; i < h + w + h*w; i++) {
+            int *p = 
+              i < h ? &b->rows[i] : i < h + w ? &b->cols[i-h] : 
+              &b->init[i-h-w]
             ;
-            elem_size = ts*6/10 + 1;
-            shift = max((ts - elem_size - 1)/2, 3);
-            elem_size = ts - 1 - 2*shift;
-            draw_rect(
-              dr, xf + shift + 1, yf + shift + 1, elem_size, elem_size, color
-            );
+            int none = (i < h + w ? -1 : UNDEF);
+            if (*p == none) continue;
+            v = *p;
+            *p = none;
+            if (diff_check(b, count_lim, msg) == res) changed = true;
+            else                                      *p = v;
+        }
     }
 }
 
 
+/*
+Differential test: check random boards and generated games with 
+diff_check(); print each disagreement (and each invalid solution of the
+reference) with the board and a minimized board as game IDs
 
-/* 
-Draw cells 
-  
 Parameters:
-  *dr: drawing object;
-  *state: game_state;
-  xc, yc: coordinates of the cell counted from the left upper corner;
-  tilesize;
-  x0pt, y0pt: point coordinates of the upper left corner of the frame of the cell with xc = yc = 0; the point coordinates are counted from the upper left corner of the drawing field;
-  cursor: true if cursor is to be shown in the cell;
-  error: true if error is to be shown in the cell;
-  update: true if draw_update() function is to be executed for the cell;
-  drag: true if drag is underway;
-  clear: true if drag clears cells (disregarded if drag == false);
-  conf: type of segment (-1..6) to draw during drag  (disregarded if 
-drag == false or clear == true);
-  flash: true if flash is underway.
+  *seed: random seed;
+  n: number of boards.
+
+Returns the number of disagreements.
+
 */
-static void draw_cell(
-  drawing *dr, const game_state *state, int xc, int yc, 
-  int tilesize, int x0pt, int y0pt, bool cursor, bool error, bool update,
-  bool drag, bool clear, enum Configuration conf, bool flash
-)
+static int diff_test(const char *seed, int n)
 {
-    int const ts = tilesize;
-    int i, j, color_bg, coords3[6];
-    int cell_state = ((drag && ! clear) ? conf : state->grid_state [yc][xc]);
+    random_state *rs = random_new(seed, strlen(seed));
+    struct diff_board b;
+    int k, fails = 0, ref_fails = 0, count_lim = 200000;
+    enum DiffResult res;
+    char msg[256], *desc;
+    
+    for (k = 0; k < n; k++) {
+    
+        // every fourth board is a generated game
+        if (k % 4 == 3) {
+            game_params params;
+            char *aux = NULL;
+            diff_random_size(rs, &params);
+            params.diff = random_upto(rs, UNREASONABLE + 1);
+            desc = new_game_desc(&params, rs, &aux, false);
+            diff_board_from_desc(&b, &params, desc);
+            sfree(desc);
+        }
+        else diff_random_board(rs, &b);
+        
+        res = diff_check(&b, count_lim, msg);
+        if (res == DIFF_OK) continue;
+        
+        if (res == DIFF_MISMATCH) fails++;
+        else                      ref_fails++;
+        printf("board %d: %s\n", k, msg);
+        desc = diff_desc(&b);
+        printf("  %dx%dd%d:%s\n", b.params.H, b.params.W, b.params.diff, desc);
+        sfree(desc);
+        diff_minimize(&b, count_lim, res);
+        desc = diff_desc(&b);
+        printf("  minimized: %dx%dd%d:%s\n", 
+          b.params.H, b.params.W, b.params.diff, desc
+        );
+        sfree(desc);
+    }
     
-    // empty
-    if (cell_state == UNDEF) {
-        if (flash) color_bg = COL_FLASH; else color_bg = COL_BACKGROUND;
-        draw_rect(
-          dr, x0pt + ts*xc + 1, y0pt + ts*yc + 1, ts - 1, ts - 1, color_bg
+    printf("%d boards, %d disagreements, %d invalid reference solutions\n", 
+      n, fails, ref_fails
+    );
+    random_free(rs);
+    return fails;
+}
+
+/* number of seeds of fleet_test() per preset */
+#define FLEET_TEST_SEEDS 100
+
+/*
+Fleet test (--fleet): generate the games of the presets (see 
+game_fetch_preset()) from the seeds "1" ... FLEET_TEST_SEEDS and compare
+the total number of ships per preset with the generator before its fleet 
+was scaled with the grid (see generator_fleet()): the presets are at or
+above the target density, so their fleets, including the ships dropped 
+when no layout is found, must not change
+
+Returns the number of presets whose total differs.
+
+*/
+static int fleet_test(void)
+{
+    // total number of ships over the seeds, per preset
+    static const int expected[] = {700, 636, 668, 692, 692, 700, 753, 753, 753};
+    int i, k, total, fails = 0;
+    char seed[16], *name;
+    game_params *params;
+    struct gen_telemetry tel;
+    
+    for (i = 0; game_fetch_preset(i, &name, &params); i++) {
+        total = 0;
+        for (k = 1; k <= FLEET_TEST_SEEDS; k++) {
+            sprintf(seed, "%d", k);
+            random_state *rs = random_new(seed, strlen(seed));
+            ships_puzzle_free(ships_puzzle_generate(params, rs, &tel));
+            random_free(rs);
+            total += tel.num_ships;
+        }
+        bool ok = (i < lenof(expected) && total == expected[i]);
+        if (! ok) fails++;
+        printf("%-20s %5.2f ships per game", name, 
+          (double) total/FLEET_TEST_SEEDS
         );
+        if (! ok && i < lenof(expected)) {
+            printf(" (expected %.2f)", (double) expected[i]/FLEET_TEST_SEEDS);
+        }
+        printf("%s\n", (ok ? "" : ": FAILED"));
+        sfree(name);
+        free_params(params);
     }
-    // filled
+    return fails;
+}
+
+
+/*
+Game of a game ID given to the driver
+
+Parameters:
+  *id: game ID "{params}:{desc}";
+  **err: set to an error message if the game ID is invalid.
+
+Returns the game state, to be freed by free_game(), or NULL.
+
+*/
+static game_state *driver_game(const char *id, const char **err)
+{
+    game_params *params = default_params();
+    const char *desc = strchr(id, ':');
+    game_state *state = NULL;
+    
+    if (! desc) *err = "no ':' in game ID";
     else {
-        if (flash) color_bg = COL_FLASH; 
-        else if (cell_state == VACANT) color_bg = COL_BACKGROUND;
-        else color_bg = COL_OCCUP;
-        draw_segment(
-          dr, cell_state, ts, x0pt + ts*xc, y0pt + ts*yc, 
-          (! error ? (! drag ? COL_SEGMENT : COL_DRAG) : COL_ERROR), 
-          (error && cell_state == OCCUP ? COL_ERROR : color_bg)
-        );
+        char *par = dupstr(id);
+        par[desc - id] = '\0';
+        desc++;
+        decode_params(params, par);
+        sfree(par);
+        *err = validate_params(params, false);
+        if (! *err) *err = validate_desc(params, desc);
+        if (! *err) state = new_game(NULL, params, desc);
     }
-    // cursor
-    if (cursor) {
-        coords3[0] = x0pt + ts*xc + 1; 
-        coords3[1] = y0pt + ts*yc + 1;
-        coords3[2] = x0pt + ts*xc + 5*ts/10; 
-        coords3[3] = y0pt + ts*yc + 1;
-        coords3[4] = x0pt + ts*xc + 1; 
-        coords3[5] = y0pt + ts*yc + 5*ts/10;
-        draw_polygon(dr, coords3, 3, COL_HIGHLIGHT, COL_HIGHLIGHT);
+    free_params(params);
+    return state;
+}
+
+
+/*
+Grade a game ID for the re-grader (--regrade)
+
+Parameters:
+  *id: game ID "{params}:{desc}";
+  count_lim: limit on the calls of place_ship() (see solver()).
+
+Returns the output line (without newline, to be freed by the caller): the
+game ID followed by "logic L solver E nodes N", where L is the result of
+solve_by_logic() with all strategies, E the error value and N the count 
+of solver(), or by "invalid: {message}".
+
+*/
+static char *regrade_one(const char *id, long long count_lim)
+{
+    const char *err;
+    char *ret;
+    game_state *state = driver_game(id, &err);
+    
+    if (! state) {
+        ret = snewn(strlen(id) + strlen(err) + 16, char);
+        sprintf(ret, "%s invalid: %s", id, err);
+        return ret;
     }
-    // initially disclosed: thick border
-    if ((state->init_state->init)[yc][xc] > -2) {
-        draw_rect_outline(
-          dr, x0pt + ts*xc + 1, y0pt + ts*yc + 1, ts - 1, ts - 1, COL_GRID
-        );
-        if (ts > 22) {
-            draw_rect_outline(
-              dr, x0pt + ts*xc + 2, y0pt + ts*yc + 2, ts - 3, ts - 3, COL_GRID
-            );
-        }
+    
+    struct ships_grade grade;
+    ships_grade(state->init_state, count_lim, &grade);
+    
+    ret = snewn(strlen(id) + 64, char);
+    sprintf(ret, "%s logic %d solver %d nodes %lld", 
+      id, grade.logic, grade.err, grade.count
+    );
+    
+    free_game(state);
+    return ret;
+}
+
+
+#ifdef SHIPS_THREADS
+
+/* Pipeline of the re-grader: the reader (calling thread) puts the input
+lines into a ring of slots, the workers grade them, and the writer prints
+the results in input order. Line n goes to slot n % window, and the 
+reader waits while the writer is a full window behind, so that at most 
+window lines are held at any time. */
+
+enum SlotState {SLOT_FREE, SLOT_QUEUED, SLOT_DONE};
+
+struct regrade_slot {
+    char *line, *result;
+    enum SlotState state;
+};
+
+struct regrade {
+    struct regrade_slot *slots;
+    int window;
+    long long count_lim;
+    // next line to be read, graded, written
+    long next_read, next_take, next_write;
+    // end of input reached; number of invalid game IDs
+    bool eof;
+    long invalid;
+    // protects all of the above; signalled on every change
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+};
+
+
+/* worker thread of the re-grader */
+static void *regrade_worker(void *ctx)
+{
+    struct regrade *rg = ctx;
+    struct regrade_slot *slot;
+    
+    pthread_mutex_lock(&rg->lock);
+    for (;;) {
+        while (rg->next_take == rg->next_read && ! rg->eof) 
+          pthread_cond_wait(&rg->changed, &rg->lock)
+        ;
+        if (rg->next_take == rg->next_read) break;
+        slot = &rg->slots[rg->next_take++ % rg->window];
+        pthread_mutex_unlock(&rg->lock);
+        
+        char *result = regrade_one(slot->line, rg->count_lim);
+        
+        pthread_mutex_lock(&rg->lock);
+        slot->result = result;
+        slot->state = SLOT_DONE;
+        pthread_cond_broadcast(&rg->changed);
+    }
+    pthread_mutex_unlock(&rg->lock);
+    
+    return NULL;
+}
+
+
+/* writer thread of the re-grader */
+static void *regrade_writer(void *ctx)
+{
+    struct regrade *rg = ctx;
+    struct regrade_slot *slot;
+    
+    pthread_mutex_lock(&rg->lock);
+    for (;;) {
+        slot = &rg->slots[rg->next_write % rg->window];
+        while (
+          slot->state != SLOT_DONE && 
+          ! (rg->eof && rg->next_write == rg->next_read)
+        ) pthread_cond_wait(&rg->changed, &rg->lock);
+        if (slot->state != SLOT_DONE) break;
+        char *line = slot->line, *result = slot->result;
+        slot->line = slot->result = NULL;
+        slot->state = SLOT_FREE;
+        rg->next_write++;
+        pthread_cond_broadcast(&rg->changed);
+        pthread_mutex_unlock(&rg->lock);
+        
+        puts(result);
+        bool invalid = (strstr(result, " invalid: ") != NULL);
+        sfree(line);
+        sfree(result);
+        
+        pthread_mutex_lock(&rg->lock);
+        if (invalid) rg->invalid++;
     }
+    pthread_mutex_unlock(&rg->lock);
     
-    if (update) {
-        draw_update(dr, x0pt + ts*xc + 1, y0pt + ts*yc + 1, ts - 1, ts - 1);
-    }
+    return NULL;
 }
 
+#endif
 
 
 /*
-Validate for errors and check if solved
+Re-grade the game IDs read from a file and print the results in input 
+order (see regrade_one())
 
 Parameters:
-  *state: game_state;
-  *solved: the variable is true if the puzzle is solved.
-  
-The function calculates the following elements of struct state:
-  **grid_state_err,
-  *rows_err, 
-  *cols_err,
-  ships_err,
-  *ships_state.
+  *fp: input file, one game ID per line (empty lines and lines starting 
+with '#' are ignored);
+  workers: number of worker threads (1 and no threads without 
+SHIPS_THREADS);
+  window: largest number of lines held in memory at a time;
+  count_lim: limit on the calls of place_ship() (see solver()).
+
+The throughput is reported to standard error.
 
 */
-static void validation(game_state *state, bool *solved)
+static void regrade(FILE *fp, int workers, int window, long long count_lim)
 {
-    int h = state->init_state->H, w = state->init_state->W;
-    int ns = state->init_state->num_ships;
-    bool **grid_state_err = state->grid_state_err;
-    int **grid_state = state->grid_state;
-    int i, j, k, l, sum, sum1; 
-    int max_ship = state->init_state->ships [0], distr[max_ship];  
+    long n = 0, invalid = 0;
+    double t0 = time_us();
+    char *line;
+    
+#ifdef SHIPS_THREADS
+    struct regrade rg;
+    pthread_t *threads = snewn(workers + 1, pthread_t);
+    int k;
+    
+    rg.slots = snewn(window, struct regrade_slot);
+    for (k = 0; k < window; k++) {
+        rg.slots[k].line = rg.slots[k].result = NULL;
+        rg.slots[k].state = SLOT_FREE;
+    }
+    rg.window = window;
+    rg.count_lim = count_lim;
+    rg.next_read = rg.next_take = rg.next_write = 0;
+    rg.eof = false;
+    rg.invalid = 0;
+    pthread_mutex_init(&rg.lock, NULL);
+    pthread_cond_init(&rg.changed, NULL);
+    
+    for (k = 0; k < workers; k++) 
+      pthread_create(&threads[k], NULL, regrade_worker, &rg)
+    ;
+    pthread_create(&threads[workers], NULL, regrade_writer, &rg);
     
-    // initial values
-    for (i = 0; i < h; i++) {
-        for (j = 0; j < w; j++) {
-            grid_state_err[i][j] = false;
+    while ((line = read_line(fp)) != NULL) {
+        if (! *line || *line == '#') {
+            sfree(line);
+            continue;
         }
-        state->rows_err[i] = false;
+        pthread_mutex_lock(&rg.lock);
+        while (rg.next_read >= rg.next_write + window) 
+          pthread_cond_wait(&rg.changed, &rg.lock)
+        ;
+        rg.slots[rg.next_read % window].line = line;
+        rg.slots[rg.next_read % window].state = SLOT_QUEUED;
+        rg.next_read++;
+        pthread_cond_broadcast(&rg.changed);
+        pthread_mutex_unlock(&rg.lock);
+        n++;
     }
-    for (j = 0; j < w; j++) state->cols_err[j] = false;
-    state->ships_err = false;
-    for (i = 0; i < max_ship; i++) distr[i] = 0;
-    for (i = 0; i < ns; i++) state->ships_state[i] = false;
-    *solved = true;
+    pthread_mutex_lock(&rg.lock);
+    rg.eof = true;
+    pthread_cond_broadcast(&rg.changed);
+    pthread_mutex_unlock(&rg.lock);
+    
+    for (k = 0; k <= workers; k++) pthread_join(threads[k], NULL);
+    invalid = rg.invalid;
+    
+    pthread_mutex_destroy(&rg.lock);
+    pthread_cond_destroy(&rg.changed);
+    sfree(rg.slots);
+    sfree(threads);
+#else
+    while ((line = read_line(fp)) != NULL) {
+        if (*line && *line != '#') {
+            char *result = regrade_one(line, count_lim);
+            puts(result);
+            if (strstr(result, " invalid: ")) invalid++;
+            sfree(result);
+            n++;
+        }
+        sfree(line);
+    }
+#endif
+    fflush(stdout);
     
-    // neighbor consistency
-    for (i = 0; i < h; i++) {
-        for (j = 0; j < w; j++) {
+    double s = (time_us() - t0)*1e-6;
+    fprintf(stderr, "%ld puzzles (%ld invalid) in %.2f s: %.1f puzzles/s\n", 
+      n, invalid, s, (s > 0 ? n/s : 0)
+    );
+}
+
+
+/*
+Solve a game ID in steps (--verify): the search (see ships_search_new()) 
+is saved to a checkpoint file after each step, and resumed from it if the 
+file exists, so that a long verification can be stopped and continued
+
+Parameters:
+  *id: game ID "{params}:{desc}";
+  count_lim: limit on the nodes of the search (see solver());
+  nodes: nodes per step;
+  *file: checkpoint file (NULL if not needed);
+  shard, num_shards: run only this shard of the search (see 
+ships_search_shard()) and print its result as a line for merge_shards();
+num_shards = 0: the whole search.
+
+Returns 0 if the search is finished, 1 on an error.
+
+*/
+static int verify(
+  const char *id, long long count_lim, long nodes, const char *file, int shard,
+  int num_shards
+)
+{
+    const char *err;
+    game_state *state = driver_game(id, &err);
+    struct ships_search *ss = NULL;
+    char *line, *tmp, *move;
+    long long count = 0;
+    bool done, ok;
+    int err_num, ck_shard, ck_num;
+    FILE *fp;
+    
+    if (! state) {
+        fprintf(stderr, "%s: invalid game ID: %s\n", id, err);
+        return 1;
+    }
+    if (file && (fp = fopen(file, "r")) != NULL) {
+        line = read_line(fp);
+        fclose(fp);
         
-            // no diagonal neighbors
-            for (k = -1; k <= 1; k += 2) {
-                for (l = -1; l <= 1; l += 2) {
-                   if (
-                      0 <= i+k && i+k < h && 0 <= j+l && j+l < w && 
-                      grid_state[i][j] >= 0 && grid_state[i+k][j+l] >= 0
-                    ) {
-                        grid_state_err[i][j] = true;
-                       *solved = false;
-                    }
-                }
+        // the checkpoint must be of the same shard (see 
+        // ships_search_checkpoint())
+        if (line && (
+          sscanf(line, "%*s %*s %*s %*s %*s %*s %*s %d %d", 
+            &ck_shard, &ck_num
+          ) == 2 &&
+          ck_shard == shard && ck_num == max(num_shards, 1)
+        )) ss = ships_search_resume(state, line);
+        sfree(line);
+        if (! ss) {
+            fprintf(stderr, "%s: invalid checkpoint for this game\n", file);
+            free_game(state);
+            return 1;
+        }
+    }
+    if (! ss) {
+        ss = (num_shards > 0 ? 
+          ships_search_shard(state, count_lim, shard, num_shards) : 
+          ships_search_new(state, count_lim)
+        );
+    }
+    
+    // the checkpoint is written to a temporary file first, so that an
+    // interruption never leaves a truncated one
+    tmp = snewn(strlen(file ? file : "") + 8, char);
+    sprintf(tmp, "%s.tmp", (file ? file : ""));
+    double t0 = time_us();
+    do {
+        done = ships_search_step(ss, nodes, &count);
+        if (file) {
+            line = ships_search_checkpoint(ss);
+            ok = ((fp = fopen(tmp, "w")) != NULL);
+            if (ok) {
+                ok = (fprintf(fp, "%s\n", line) >= 0);
+                ok = ! fclose(fp) && ok;
             }
-            
-            // check neighbors of VACANT 
-            #define CASE_VACANT(i, j, h, w, conf, mat, m, m_err)            \
-                if (mat((i), (j), m, h, w) == VACANT && (                   \
-                  0 <= (i)-1 && (                                           \
-                    mat((i)-1, (j), m, h, w) == conf ||                     \
-                    mat((i)-1, (j), m, h, w) == INNER &&                    \
-                    (                                                       \
-                      0 <= (i)-2 && mat((i)-2, (j), m, h, w) >= 0        || \
-                      0 <= (j)-1 && mat((i)-1, (j)-1, m, h, w) == VACANT || \
-                      (j)+1 < w  && mat((i)-1, (j)+1, m, h, w) == VACANT    \
-                    )                                                       \
-                  )                                                         \
-                  ||                                                        \
-                  (i) == 0 && (                                             \
-                    0 <= (j)-1 && mat((i), (j)-1, m, h, w) == INNER         \
-                    ||                                                      \
-                    (j)+1 < w  && mat((i), (j)+1, m, h, w) == INNER         \
-                  )                                                         \
-                )) {                                                        \
-                    mat((i), (j), m_err, h, w) = true;                      \
-                    *solved = false;                                        \
-                }
-            // apply the above with rotation symmetry transformations
-            CASE_VACANT(
-              i,     j,     h, w, NORTH, MAT_0, grid_state, grid_state_err
-            );  
-            CASE_VACANT(
-              w-1-j, i,     w, h, EAST,  MAT_1, grid_state, grid_state_err
-            );  
-            CASE_VACANT(
-              h-1-i, w-1-j, h, w, SOUTH, MAT_2, grid_state, grid_state_err
-            );   
-            CASE_VACANT(
-              j,     h-1-i, w, h, WEST,  MAT_3, grid_state, grid_state_err
-            );  
+            if (! ok || rename(tmp, file)) {
+                fprintf(stderr, "%s: cannot write the checkpoint\n", file);
+                sfree(line);
+                sfree(tmp);
+                sfree(ships_search_finish(ss, &err));
+                free_game(state);
+                return 1;
+            }
+            sfree(line);
+        }
+        fprintf(stderr, "%lld nodes, %.1f s\n", count, 
+          (time_us() - t0)*1e-6
+        );
+    } while (! done);
+    
+    err_num = ships_search_err(ss);
+    move = ships_search_finish(ss, &err);
+    if (num_shards > 0) {
+        printf("%s shard %d/%d err %d count %lld limit %lld%s%s\n", id, shard, 
+          num_shards, err_num, count, count_lim, (move ? " " : ""), 
+          (move ? move : "")
+        );
+    }
+    else printf("%s\n%s\n", id, (move ? move : err));
+    sfree(move);
+    sfree(tmp);
+    free_game(state);
+    return 0;
+}
 
 
-            // check neighbors of OCCUP 
-            #define CASE_OCCUP(i, j, h, w, conf, mat, m, m_err)  \
-                if (mat((i), (j), m, h, w) == OCCUP && (         \
-                  0 <= (i)-1 && ! (                              \
-                      mat((i)-1, (j), m, h, w) == conf   ||      \
-                      mat((i)-1, (j), m, h, w) == UNDEF  ||      \
-                      mat((i)-1, (j), m, h, w) == VACANT ||      \
-                      mat((i)-1, (j), m, h, w) == OCCUP  ||      \
-                      mat((i)-1, (j), m, h, w) == INNER          \
-                  )                                              \
-                )) {                                             \
-                    mat((i), (j), m_err, h, w) = true;           \
-                    *solved = false;                             \
-                }
-            CASE_OCCUP(
-              i,     j,     h, w, NORTH, MAT_0, grid_state, grid_state_err
-            );  
-            CASE_OCCUP(
-              w-1-j, i,     w, h, EAST,  MAT_1, grid_state, grid_state_err
-            );  
-            CASE_OCCUP(
-              h-1-i, w-1-j, h, w, SOUTH, MAT_2, grid_state, grid_state_err
-            );   
-            CASE_OCCUP(
-              j,     h-1-i, w, h, WEST,  MAT_3, grid_state, grid_state_err
-            );  
+/*
+Combine the results of the shards of a search (--merge, see 
+ships_shard_merge()) and print them as --verify does for the whole search
 
+Parameters:
+  *fp: file with the lines printed by the shards ("{id} shard {i}/{n} err 
+{err} count {count} limit {count_lim} [{move}]", see verify()), in any
+order; each shard of the game must be given once.
 
-            // check neighbors of NORTH, SOUTH, EAST, WEST
-            #define CASE_NSEW(i, j, h, w, conf, mat, m, m_err)        \
-                if (mat((i), (j), m, h, w) == conf && (               \
-                  0 <= (i)-1 && mat((i)-1, (j), m, h, w) >= 0         \
-                  ||                                                  \
-                  (i)+1 < h && ! (                                    \
-                    mat((i)+1, (j), m, h, w) == (conf + 1) % 4 + 1 || \
-                    mat((i)+1, (j), m, h, w) == UNDEF ||              \
-                    mat((i)+1, (j), m, h, w) == OCCUP ||              \
-                    mat((i)+1, (j), m, h, w) == INNER                 \
-                  )                                                   \
-                  ||                                                  \
-                  0 <= (j)-1 && mat((i), (j)-1, m, h, w) >= 0         \
-                  ||                                                  \
-                  (j)+1 < w  && mat((i), (j)+1, m, h, w) >= 0         \
-                  ||                                                  \
-                  (i) == h-1                                          \
-                )) {                                                  \
-                    mat((i), (j), m_err, h, w) = true;                \
-                    *solved = false;                                  \
-                }
-            CASE_NSEW(
-              i,     j,     h, w, NORTH, MAT_0, grid_state, grid_state_err
-            );  
-            CASE_NSEW(
-              w-1-j, i,     w, h, EAST,  MAT_1, grid_state, grid_state_err
-            );  
-            CASE_NSEW(
-              h-1-i, w-1-j, h, w, SOUTH, MAT_2, grid_state, grid_state_err
-            );   
-            CASE_NSEW(
-              j,     h-1-i, w, h, WEST,  MAT_3, grid_state, grid_state_err
-            );  
-                
-                
-            // check neighbors of ONE
-            if (grid_state[i][j] == ONE && ( 
-                0 <= i-1 && grid_state[i-1][j] >= 0 
-                ||
-                i+1 < h && grid_state[i+1][j] >= 0 
-                ||
-                0 <= j-1 && grid_state[i][j-1] >= 0 
-                ||
-                j+1 < w && grid_state[i][j+1] >= 0 
-            )) {
-                grid_state_err[i][j] = true;
-                *solved = false;
-            }
-                    
-                
-            // check neighbors of INNER 
-            #define CASE_INNER(i, j, h, w, conf, mat, m, m_err)      \
-                if (mat((i), (j), m, h, w) == INNER && (             \
-                  0 <= (i)-1 && ! (                                  \
-                    mat((i)-1, (j), m, h, w) == conf  ||             \
-                    mat((i)-1, (j), m, h, w) == UNDEF  ||            \
-                    mat((i)-1, (j), m, h, w) == VACANT ||            \
-                    mat((i)-1, (j), m, h, w) == OCCUP  ||            \
-                    mat((i)-1, (j), m, h, w) == INNER                \
-                  )                                                  \
-                  ||                                                 \
-                  (i) == 0 && (                                      \
-                    mat((i)+1, (j), m, h, w) >= 0                    \
-                    ||                                               \
-                    0 <= (j)-1 && mat((i), (j)-1, m, h, w) == VACANT \
-                    ||                                               \
-                    (j)+1 < w  && mat((i), (j)+1, m, h, w) == VACANT \
-                    ||                                               \
-                    (j) == 0 || (j) == w-1                           \
-                  )                                                  \
-                  ||                                                 \
-                  0 <= (i)-1 && 0 <= (j)-1 &&                        \
-                  mat((i)-1, (j), m, h, w) == VACANT &&              \
-                  mat((i), (j)-1, m, h, w) == VACANT                 \
-                  ||                                                 \
-                  0 <= (i)-1 && (i)+1 < h && (                       \
-                    mat((i)-1, (j), m, h, w) == VACANT &&            \
-                    mat((i)+1, (j), m, h, w) >= 0         ||         \
-                    mat((i)-1, (j), m, h, w) >= 0      &&            \
-                    mat((i)+1, (j), m, h, w) == VACANT               \
-                  )                                                  \
-                )) {                                                 \
-                    mat((i), (j), m_err, h, w) = true;               \
-                    *solved = false;                                 \
-                }
-            CASE_INNER(
-              i,     j,     h, w, NORTH, MAT_0, grid_state, grid_state_err
-            );  
-            CASE_INNER(
-              w-1-j, i,     w, h, EAST,  MAT_1, grid_state, grid_state_err
-            );  
-            CASE_INNER(
-              h-1-i, w-1-j, h, w, SOUTH, MAT_2, grid_state, grid_state_err
-            );   
-            CASE_INNER(
-              j,     h-1-i, w, h, WEST,  MAT_3, grid_state, grid_state_err
-            );  
+Returns 0 if the result is printed, 1 on an error.
+
+*/
+static int merge_shards(FILE *fp)
+{
+    char *line, *id = NULL, *move = NULL, *sp;
+    int *err = NULL, n = 0, k, i, e, ret, pos, num = 0;
+    long long *count = NULL, c, l, lim = 0, total;
+    bool ok = true;
+    
+    while (ok && (line = read_line(fp)) != NULL) {
+        if (! *line) {
+            sfree(line);
+            continue;
+        }
+        sp = strchr(line, ' ');
+        ok = (
+          sp && sscanf(sp, " shard %d/%d err %d count %lld limit %lld %n", 
+            &i, &k, &e, &c, &l, &pos
+          ) == 5 && k > 0 && 0 <= i && i < k && 0 <= e && e <= 3 && c >= 0
+        );
+        if (ok) *sp = '\0';
+        
+        // the first line gives the game and the number of shards
+        if (ok && ! id) {
+            id = dupstr(line);
+            n = k;
+            lim = l;
+            err = snewn(n, int);
+            count = snewn(n, long long);
+            for (k = 0; k < n; k++) err[k] = -1;
+        }
+        // a shard with a solution gives its move
+        ok = (
+          ok && ! strcmp(id, line) && k == n && l == lim && err[i] < 0 &&
+          (e == 0) == (sp[pos] != '\0')
+        );
+        if (ok) {
+            err[i] = e;
+            count[i] = c;
+            num++;
+            if (e == 0 && ! move) move = dupstr(sp + pos);
+        }
+        sfree(line);
+    }
+    if (! ok || num == 0 || num < n) {
+        fprintf(stderr, "merge: %s\n", (ok ? "missing shards" : 
+          "invalid line, or shard of another game or given twice"
+        ));
+        sfree(id);
+        sfree(move);
+        sfree(err);
+        sfree(count);
+        return 1;
+    }
+    
+    ret = ships_shard_merge(n, err, count, lim, &total);
+    printf("%s\n%s\n", id, 
+      ret == 0 ? move : 
+      ret == 1 ? "Solver gave up: the puzzle takes too long to solve" :
+      ret == 2 ? "Multiple solutions exist for this puzzle" :
+      "No solution exists for this puzzle"
+    );
+    fprintf(stderr, "%d shards, %lld nodes\n", n, total);
+    sfree(id);
+    sfree(move);
+    sfree(err);
+    sfree(count);
+    return 0;
+}
+
+
+/* layouts of a group of layout7_table, their row and column sums */
+struct layout_group {
+    int num;
+    unsigned long long rows, cols;
+};
+
+/* visitor of layout_table() */
+static bool layout_table_visit(
+  const int *pos, unsigned long long cells, void *ctx
+)
+{
+    struct layout_group *g = ctx;
+    int i, j, n;
+    
+    for (i = 0; i < 7; i++) {
+        n = layout7_bits((cells >> 7*i) & 0x7f);
+        g->rows |= 1ULL << (8*i + n);
+    }
+    for (j = 0; j < 7; j++) {
+        for (n = i = 0; i < 7; i++) n += (cells >> (7*i + j)) & 1;
+        g->cols |= 1ULL << (8*j + n);
+    }
+    g->num++;
+    return false;
+}
+
+
+/* print the initializer of layout7_table (--layout-table) */
+static void layout_table(void)
+{
+    int p0, p1, end = 0, pos[7];
+    unsigned long long c0, c1, h0, h1;
+    struct layout_group g;
+    struct layout7_geom geom;
+    
+    layout7_geom_init(&geom);
+    for (p0 = 0; p0 < 98; p0++) {
+        if (! (c0 = layout7_cells(4, p0, &h0))) continue;
+        for (p1 = p0 + 1; p1 < 98; p1++) {
+            c1 = layout7_cells(4, p1, &h1);
+            if (! c1 || (c1 & h0)) continue;
+            g.num = 0;
+            g.rows = g.cols = 0;
+            pos[0] = p0;
+            pos[1] = p1;
+            layout7_enum(
+              &geom, 2, 0, c0 | c1, h0 | h1, pos, NULL, layout_table_visit, 
+              &g
+            );
+            if (! g.num) continue;
+            end += g.num;
+            printf("    {{%2d, %2d}, %6d, 0x%014llxULL, 0x%014llxULL},\n", 
+              p0, p1, end, g.rows, g.cols
+            );
+        }
+    }
+}
 
+
+#ifdef SHIPS_THREADS
+
+/* Puzzle server: pools of ready puzzles for the presets, refilled by
+worker threads and served over a Unix domain socket. The protocol has one
+request per line:
+  GET PARAMS  answer "OK {params}:{desc}" (a game ID) or "ERR {message}";
+              games for parameters without a pool are generated on the 
+              spot;
+  STATS       answer one line "POOL ..." per pool, then "END";
+  QUIT        the connection is closed;
+  SHUTDOWN    the server stops. */
+
+/* pool of ready puzzles for one preset */
+struct serve_pool {
+    game_params params;
+    // encode_params(params, true)
+    char *name;
+    // ring buffer of size capacity of ready descriptions: first element,
+    // number of elements, number of descriptions being generated
+    char **descs;
+    int head, count, pending;
+    // counters and total generation time (microseconds)
+    long served, generated, misses;
+    double gen_us;
+};
+
+struct serve_conn;
+
+struct server {
+    struct serve_pool *pools;
+    int npools, capacity;
+    // base of the random seeds of the generated games; number of seeds used
+    const char *seed;
+    long seq;
+    // start time (see time_us()), listening socket, number and list of 
+    // the open connections
+    double start;
+    int listen_fd, conns;
+    struct serve_conn *conn_list;
+    bool stop;
+    // protects all of the above; signalled when a pool needs refilling,
+    // when the server stops or when a connection is closed
+    pthread_mutex_t lock;
+    pthread_cond_t refill, closed;
+};
+
+struct serve_conn {
+    struct server *srv;
+    int fd;
+    // neighbors in the list of open connections (srv->conn_list)
+    struct serve_conn *prev, *next;
+};
+
+
+/* random seed of the next generated game (to be freed by the caller);
+called with srv->lock held */
+static char *serve_seed(struct server *srv)
+{
+    char *seed = snewn(strlen(srv->seed) + 32, char);
+    sprintf(seed, "%s-%ld", srv->seed, srv->seq++);
+    return seed;
+}
+
+
+/* worker thread: keeps the pools filled, emptiest first */
+static void *serve_worker(void *ctx)
+{
+    struct server *srv = ctx;
+    struct serve_pool *p;
+    int k, fill, best;
+    
+    pthread_mutex_lock(&srv->lock);
+    while (! srv->stop) {
+        p = NULL;
+        best = srv->capacity;
+        for (k = 0; k < srv->npools; k++) {
+            fill = srv->pools[k].count + srv->pools[k].pending;
+            if (fill < best) {
+                best = fill;
+                p = &srv->pools[k];
+            }
+        }
+        if (! p) {
+            pthread_cond_wait(&srv->refill, &srv->lock);
+            continue;
         }
+        
+        p->pending++;
+        char *seed = serve_seed(srv);
+        pthread_mutex_unlock(&srv->lock);
+        
+        double t0 = time_us();
+        char *desc = ships_generate(&p->params, seed);
+        double us = time_us() - t0;
+        sfree(seed);
+        
+        pthread_mutex_lock(&srv->lock);
+        p->pending--;
+        p->generated++;
+        p->gen_us += us;
+        p->descs[(p->head + p->count) % srv->capacity] = desc;
+        p->count++;
     }
+    pthread_mutex_unlock(&srv->lock);
     
+    return NULL;
+}
+
+
+/* answer to a request line (to be freed by the caller); NULL to close
+the connection */
+static char *serve_request(struct server *srv, const char *line)
+{
+    int k;
+    char *ret;
     
-    // sums consistency
-    // rows
-    for (i = 0; i < h; i++) {
-        sum  = 0;
-        sum1 = 0;
-        if (state->init_state->rows [i] >= 0) {
-            for (j = 0; j < w; j++) {
-                sum  += (grid_state[i][j] >= 0      ? 1 : 0);
-                sum1 += (grid_state[i][j] == VACANT ? 1 : 0);
-            }
-            if (sum >  state->init_state->rows [i]) state->rows_err[i] = true;
-            if (sum1 > w - state->init_state->rows [i]) 
-              state->rows_err[i] = true
-            ;
-            if (sum != state->init_state->rows [i]) *solved = false;
+    if (! strncmp(line, "GET ", 4)) {
+        game_params params;
+        struct serve_pool *p = NULL;
+        char *desc = NULL, *seed = NULL;
+        
+        params.diff = INTERMEDIATE;
+        decode_params(&params, line + 4);
+        const char *err = validate_params(&params, true);
+        if (err) {
+            ret = snewn(strlen(err) + 8, char);
+            sprintf(ret, "ERR %s\n", err);
+            return ret;
         }
-    }    
-    // columns
-    for (j = 0; j < w; j++) {
-        sum = 0;
-        sum1 = 0;
-        if (state->init_state->cols [j] >= 0) {
-            for (i = 0; i < h; i++) {
-                sum  += (grid_state[i][j] >= 0      ? 1 : 0);
-                sum1 += (grid_state[i][j] == VACANT ? 1 : 0);
-            }
-            if (sum >  state->init_state->cols [j]) state->cols_err[j] = true;
-            if (sum1 > h - state->init_state->cols [j]) 
-              state->cols_err[j] = true
-            ;
-            if (sum != state->init_state->cols [j]) *solved = false;
+        
+        pthread_mutex_lock(&srv->lock);
+        for (k = 0; k < srv->npools; k++) {
+            if (
+              srv->pools[k].params.H == params.H && 
+              srv->pools[k].params.W == params.W && 
+              srv->pools[k].params.diff == params.diff
+            ) p = &srv->pools[k];
         }
-    }    
+        if (p && p->count > 0) {
+            desc = p->descs[p->head];
+            p->head = (p->head + 1) % srv->capacity;
+            p->count--;
+            pthread_cond_signal(&srv->refill);
+        }
+        else seed = serve_seed(srv);
+        if (p) {
+            p->served++;
+            if (! desc) p->misses++;
+        }
+        pthread_mutex_unlock(&srv->lock);
+        
+        // pool empty or no pool: generate here
+        if (! desc) {
+            desc = ships_generate(&params, seed);
+            sfree(seed);
+        }
+        
+        char *par = encode_params(&params, false);
+        ret = snewn(strlen(par) + strlen(desc) + 8, char);
+        sprintf(ret, "OK %s:%s\n", par, desc);
+        sfree(par);
+        sfree(desc);
+        return ret;
+    }
     
+    if (! strcmp(line, "STATS")) {
+        int size = 128*(srv->npools + 1), len = 0;
+        ret = snewn(size, char);
+        pthread_mutex_lock(&srv->lock);
+        double s = (time_us() - srv->start)*1e-6;
+        for (k = 0; k < srv->npools; k++) {
+            struct serve_pool *p = &srv->pools[k];
+            len += sprintf(ret + len, 
+              "POOL %s depth %d/%d served %ld generated %ld misses %ld "
+              "refill %.2f/s gen %.1f ms\n", 
+              p->name, p->count, srv->capacity, p->served, p->generated, 
+              p->misses, p->generated/s, 
+              (p->generated ? p->gen_us*1e-3/p->generated : 0)
+            );
+        }
+        pthread_mutex_unlock(&srv->lock);
+        sprintf(ret + len, "END\n");
+        return ret;
+    }
     
-    // ships consistency (only the ships are found that are searched for)
-    state->ships_err = compl_ships_distr(h, w, grid_state, max_ship, distr);
-    if (! state->ships_err) {
-        for (k = 0; k < max_ship; k++) {
-            if (distr[k] > state->init_state->ships_distr[k]) {
-                state->ships_err = true;
-                break;
-            }
+    if (! strcmp(line, "SHUTDOWN")) {
+        pthread_mutex_lock(&srv->lock);
+        srv->stop = true;
+        pthread_cond_broadcast(&srv->refill);
+        pthread_mutex_unlock(&srv->lock);
+        // wakes up accept() in serve()
+        shutdown(srv->listen_fd, SHUT_RDWR);
+        return NULL;
+    }
+    
+    if (! strcmp(line, "QUIT")) return NULL;
+    
+    return dupstr("ERR unknown request\n");
+}
+
+
+/* thread serving one connection */
+static void *serve_client(void *ctx)
+{
+    struct serve_conn *conn = ctx;
+    struct server *srv = conn->srv;
+    // separate streams for reading and writing
+    FILE *in = fdopen(conn->fd, "r"), *out = fdopen(dup(conn->fd), "w");
+    char *line, *answer;
+    
+    while ((line = read_line(in)) != NULL) {
+        answer = serve_request(srv, line);
+        sfree(line);
+        if (! answer) break;
+        fputs(answer, out);
+        fflush(out);
+        sfree(answer);
+    }
+    
+    // leave the list before the descriptor is closed (and can be reused)
+    pthread_mutex_lock(&srv->lock);
+    if (conn->prev) conn->prev->next = conn->next;
+    else            srv->conn_list = conn->next;
+    if (conn->next) conn->next->prev = conn->prev;
+    pthread_mutex_unlock(&srv->lock);
+    
+    fclose(out);
+    fclose(in);
+    sfree(conn);
+    
+    pthread_mutex_lock(&srv->lock);
+    srv->conns--;
+    pthread_cond_signal(&srv->closed);
+    pthread_mutex_unlock(&srv->lock);
+    
+    return NULL;
+}
+
+
+/*
+Run the puzzle server until it receives SHUTDOWN
+
+Parameters:
+  *path: path of the Unix domain socket (removed and created anew);
+  workers: number of worker threads generating puzzles;
+  capacity: number of puzzles kept per preset;
+  *seed: base of the random seeds of the generated games.
+
+Returns false if the socket cannot be set up.
+
+*/
+static bool serve(const char *path, int workers, int capacity, const char *seed)
+{
+    struct server srv;
+    struct serve_conn *c;
+    struct sockaddr_un addr;
+    pthread_t *threads = snewn(workers, pthread_t);
+    game_params *params;
+    char *name;
+    int k;
+    
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "socket path too long: %s\n", path);
+        return false;
+    }
+    strcpy(addr.sun_path, path);
+    unlink(path);
+    srv.listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (
+      srv.listen_fd < 0 || 
+      bind(srv.listen_fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 ||
+      listen(srv.listen_fd, 16) < 0
+    ) {
+        perror(path);
+        return false;
+    }
+    // a client closing its connection early must not end the server
+    signal(SIGPIPE, SIG_IGN);
+    
+    // a pool for each preset
+    srv.npools = 0;
+    while (game_fetch_preset(srv.npools, &name, &params)) {
+        sfree(name);
+        free_params(params);
+        srv.npools++;
+    }
+    srv.pools = snewn(srv.npools, struct serve_pool);
+    for (k = 0; k < srv.npools; k++) {
+        struct serve_pool *p = &srv.pools[k];
+        game_fetch_preset(k, &name, &params);
+        p->params = *params;
+        p->name = encode_params(params, true);
+        p->descs = snewn(capacity, char *);
+        p->head = p->count = p->pending = 0;
+        p->served = p->generated = p->misses = 0;
+        p->gen_us = 0;
+        sfree(name);
+        free_params(params);
+    }
+    srv.capacity = capacity;
+    srv.seed = seed;
+    srv.seq = 0;
+    srv.start = time_us();
+    srv.conns = 0;
+    srv.conn_list = NULL;
+    srv.stop = false;
+    pthread_mutex_init(&srv.lock, NULL);
+    pthread_cond_init(&srv.refill, NULL);
+    pthread_cond_init(&srv.closed, NULL);
+    
+    for (k = 0; k < workers; k++) {
+        pthread_create(&threads[k], NULL, serve_worker, &srv);
+    }
+    printf("serving %d pools of %d puzzles on %s\n", 
+      srv.npools, capacity, path
+    );
+    fflush(stdout);
+    
+    // connections
+    for (;;) {
+        int fd = accept(srv.listen_fd, NULL, NULL);
+        pthread_mutex_lock(&srv.lock);
+        bool stop = srv.stop;
+        pthread_mutex_unlock(&srv.lock);
+        if (stop) {
+            if (fd >= 0) close(fd);
+            break;
+        }
+        if (fd < 0) continue;
+        
+        struct serve_conn *conn = snew(struct serve_conn);
+        pthread_t thread;
+        conn->srv = &srv;
+        conn->fd = fd;
+        pthread_mutex_lock(&srv.lock);
+        srv.conns++;
+        conn->prev = NULL;
+        conn->next = srv.conn_list;
+        if (srv.conn_list) srv.conn_list->prev = conn;
+        srv.conn_list = conn;
+        pthread_mutex_unlock(&srv.lock);
+        if (pthread_create(&thread, NULL, serve_client, conn)) {
+            pthread_mutex_lock(&srv.lock);
+            srv.conn_list = conn->next;
+            if (conn->next) conn->next->prev = NULL;
+            srv.conns--;
+            pthread_mutex_unlock(&srv.lock);
+            close(fd);
+            sfree(conn);
         }
+        else pthread_detach(thread);
     }
-    if (state->ships_err) *solved = false;
+    
+    // wait for the workers and the open connections; the latter are 
+    // shut down, so that idle clients cannot keep the server alive
+    for (k = 0; k < workers; k++) pthread_join(threads[k], NULL);
+    pthread_mutex_lock(&srv.lock);
+    for (c = srv.conn_list; c; c = c->next) {
+        shutdown(c->fd, SHUT_RDWR);
+    }
+    while (srv.conns > 0) pthread_cond_wait(&srv.closed, &srv.lock);
+    pthread_mutex_unlock(&srv.lock);
+    
+    close(srv.listen_fd);
+    unlink(path);
+    for (k = 0; k < srv.npools; k++) {
+        struct serve_pool *p = &srv.pools[k];
+        while (p->count > 0) {
+            sfree(p->descs[p->head]);
+            p->head = (p->head + 1) % capacity;
+            p->count--;
+        }
+        sfree(p->descs);
+        sfree(p->name);
+    }
+    sfree(srv.pools);
+    sfree(threads);
+    pthread_mutex_destroy(&srv.lock);
+    pthread_cond_destroy(&srv.refill);
+    pthread_cond_destroy(&srv.closed);
+    return true;
+}
 
-   
-    // mark ships done
-    if (! state->ships_err) {
-        for (i = 0; i < ns; i++) {
-            if (distr [state->init_state->ships [i] - 1] > 0) {
-                state->ships_state[i] = true;
-                (distr [state->init_state->ships [i] - 1])--;
-            }
-            else *solved = false;
+
+/*
+Client of the puzzle server, e.g. for tests: sends the request lines
+read from standard input and prints the answers
+
+Parameters:
+  *path: path of the socket of the server.
+
+Returns false if the server cannot be reached.
+
+*/
+static bool serve_client_stdin(const char *path)
+{
+    struct sockaddr_un addr;
+    char *line, *answer;
+    int fd;
+    
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) return false;
+    strcpy(addr.sun_path, path);
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+        perror(path);
+        return false;
+    }
+    FILE *in = fdopen(fd, "r"), *out = fdopen(dup(fd), "w");
+    
+    while ((line = read_line(stdin)) != NULL) {
+        fprintf(out, "%s\n", line);
+        fflush(out);
+        bool last = (! strcmp(line, "QUIT") || ! strcmp(line, "SHUTDOWN"));
+        sfree(line);
+        if (last) break;
+        // the answer ends with a line "OK ...", "ERR ..." or "END"
+        while ((answer = read_line(in)) != NULL) {
+            printf("%s\n", answer);
+            bool end = (
+              ! strncmp(answer, "OK", 2) || ! strncmp(answer, "ERR", 3) || 
+              ! strcmp(answer, "END")
+            );
+            sfree(answer);
+            if (end) break;
         }
     }
+    fclose(out);
+    fclose(in);
+    return true;
+}
 
-    
-    // check (number of occupied and specified cells) = sum(ship sizes)
-    if (*solved) {
-        sum = 0;
-        for (i = 0; i < h; i++) {
-            for (j = 0; j < w; j++) {
-                sum += (grid_state[i][j] > 0 ? 1 : 0);
+#endif
+
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, 
+      "usage: %s --replay FILE [-n REPEAT]\n"
+      "       %s --stress [-m MOVES] [-p PARAMS] [-s SEED]\n"
+      "       %s --diff [-n BOARDS] [-s SEED]\n"
+      "       %s --fleet\n"
+      "       %s --generate [-n REPEAT] [-p PARAMS] [-s SEED] [-r THREADS]\n"
+      "       %s --chain [-p PARAMS] [-s SEED] [-r THREADS]\n"
+      "       %s --regrade FILE [-t WORKERS] [-n WINDOW] [-c COUNT]\n"
+      "       %s --verify GAME_ID [-n NODES] [-c COUNT] [-k FILE] "
+      "[--shard I/N]\n"
+      "       %s --merge FILE\n"
+      "       %s --layout-table\n"
+#ifdef SHIPS_THREADS
+      "       %s --serve SOCKET [-t WORKERS] [-n POOL_SIZE] [-s SEED]\n"
+      "       %s --client SOCKET\n"
+#endif
+      , prog, prog, prog, prog, prog, prog, prog, prog, prog, prog
+#ifdef SHIPS_THREADS
+      , prog, prog
+#endif
+    );
+    exit(1);
+}
+
+
+int main(int argc, char **argv)
+{
+    const char *replay_file = NULL, *seed = "1";
+    const char *serve_path = NULL, *client_path = NULL, *regrade_file = NULL;
+    bool do_stress = false, do_diff = false, do_generate = false;
+    const char *verify_id = NULL, *checkpoint_file = NULL;
+    const char *merge_file = NULL;
+    bool do_chain = false, do_layout_table = false, do_fleet = false;
+    int shard = 0, num_shards = 0;
+    int i, k, repeat = -1, moves = 10000, workers = 2;
+    long long count_lim = -1;
+    game_params *params = default_params();
+    params->H = params->W = SIZEMAX;
+    
+    for (i = 1; i < argc; i++) {
+        if (! strcmp(argv[i], "--replay") && i+1 < argc) 
+          replay_file = argv[++i]
+        ;
+        else if (! strcmp(argv[i], "--stress")) do_stress = true;
+        else if (! strcmp(argv[i], "--diff"))   do_diff = true;
+        else if (! strcmp(argv[i], "--fleet"))  do_fleet = true;
+        else if (! strcmp(argv[i], "--generate")) do_generate = true;
+        else if (! strcmp(argv[i], "--chain"))    do_chain = true;
+        else if (! strcmp(argv[i], "--layout-table")) do_layout_table = true;
+        else if (! strcmp(argv[i], "--regrade") && i+1 < argc) 
+          regrade_file = argv[++i]
+        ;
+        else if (! strcmp(argv[i], "--verify") && i+1 < argc) 
+          verify_id = argv[++i]
+        ;
+        else if (! strcmp(argv[i], "-k") && i+1 < argc) 
+          checkpoint_file = argv[++i]
+        ;
+        else if (! strcmp(argv[i], "--shard") && i+1 < argc) {
+            if (
+              sscanf(argv[++i], "%d/%d", &shard, &num_shards) != 2 ||
+              num_shards < 1 || shard < 0 || shard >= num_shards
+            ) usage(argv[0]);
+        }
+        else if (! strcmp(argv[i], "--merge") && i+1 < argc) 
+          merge_file = argv[++i]
+        ;
+        else if (! strcmp(argv[i], "-c") && i+1 < argc) {
+            count_lim = strtoll(argv[++i], NULL, 10);
+            if (count_lim < 0) usage(argv[0]);
+        }
+#ifdef SHIPS_THREADS
+        else if (! strcmp(argv[i], "--serve") && i+1 < argc) 
+          serve_path = argv[++i]
+        ;
+        else if (! strcmp(argv[i], "--client") && i+1 < argc) 
+          client_path = argv[++i]
+        ;
+        else if (! strcmp(argv[i], "-t") && i+1 < argc) {
+            workers = atoi(argv[++i]);
+            if (workers < 1) usage(argv[0]);
+        }
+        else if (! strcmp(argv[i], "-r") && i+1 < argc) {
+            k = atoi(argv[++i]);
+            if (k < 0) usage(argv[0]);
+            ships_set_repair_workers(k);
+        }
+#endif
+        else if (! strcmp(argv[i], "-n") && i+1 < argc) {
+            repeat = atoi(argv[++i]);
+            if (repeat < 1) usage(argv[0]);
+        }
+        else if (! strcmp(argv[i], "-m") && i+1 < argc) {
+            moves = atoi(argv[++i]);
+            if (moves < 0) usage(argv[0]);
+        }
+        else if (! strcmp(argv[i], "-p") && i+1 < argc) {
+            decode_params(params, argv[++i]);
+            const char *err = validate_params(params, true);
+            if (err) {
+                fprintf(stderr, "%s: %s\n", argv[0], err);
+                return 1;
             }
         }
-        sum1 = 0;
-        for (i = 0; i < ns; i++) sum1 += state->init_state->ships [i];
-        if (sum != sum1) *solved = false;
+        else if (! strcmp(argv[i], "-s") && i+1 < argc) seed = argv[++i];
+        else usage(argv[0]);
+    }
+    if (
+      (replay_file != NULL) + do_stress + do_diff + do_generate + do_chain +
+      (regrade_file != NULL) + (verify_id != NULL) + (merge_file != NULL) + 
+      (serve_path != NULL) + (client_path != NULL) + do_layout_table + 
+      do_fleet != 1 ||
+      num_shards > 0 && ! verify_id
+    ) usage(argv[0]);
+    
+    
+    //****** re-grade game IDs
+    
+    if (regrade_file) {
+        FILE *fp = (strcmp(regrade_file, "-") ? fopen(regrade_file, "r") : stdin);
+        if (! fp) {
+            fprintf(stderr, "%s: cannot open %s\n", argv[0], regrade_file);
+            return 1;
+        }
+        regrade(
+          fp, workers, (repeat > 0 ? repeat : 256), 
+          (count_lim >= 0 ? count_lim : 1000000)
+        );
+        if (fp != stdin) fclose(fp);
+        free_params(params);
+        return 0;
+    }
+    
+    
+    //****** solve a game in steps with checkpoints
+    
+    if (verify_id) {
+        free_params(params);
+        return verify(
+          verify_id, max(count_lim, 0), (repeat > 0 ? repeat : 1000000), 
+          checkpoint_file, shard, num_shards
+        );
+    }
+    
+    
+    //****** table of the 7x7 layouts
+    
+    if (do_layout_table) {
+        layout_table();
+        free_params(params);
+        return 0;
+    }
+    
+    
+    //****** merge the results of the shards of a search
+    
+    if (merge_file) {
+        FILE *fp = (strcmp(merge_file, "-") ? fopen(merge_file, "r") : stdin);
+        if (! fp) {
+            fprintf(stderr, "%s: cannot open %s\n", argv[0], merge_file);
+            return 1;
+        }
+        k = merge_shards(fp);
+        if (fp != stdin) fclose(fp);
+        free_params(params);
+        return k;
+    }
+    
+    
+#ifdef SHIPS_THREADS
+    //****** puzzle server and its client
+    
+    if (serve_path) {
+        free_params(params);
+        return ! serve(serve_path, workers, (repeat > 0 ? repeat : 16), seed);
+    }
+    if (client_path) {
+        free_params(params);
+        return ! serve_client_stdin(client_path);
+    }
+#endif
+    
+    
+    //****** regenerate a game from its seed
+    
+    if (do_generate) {
+        if (repeat < 0) repeat = 1;
+        double *us = snewn(repeat, double);
+        char *desc = NULL, *par = encode_params(params, true);
+        k = 0;
+        do {
+            sfree(desc);
+            double t0 = time_us();
+            desc = ships_generate(params, seed);
+            us[k] = time_us() - t0;
+        } while (++k < repeat);
+        arraysort(us, repeat, cmp_double, NULL);
+        printf("%s:%s\n", par, desc);
+        printf("generation: min %.1f us, median %.1f us, max %.1f us\n", 
+          us[0], us[repeat/2], us[repeat-1]
+        );
+        sfree(us);
+        sfree(par);
+        sfree(desc);
+        free_params(params);
+        return 0;
+    }
+    
+    
+    //****** chain of games with the same layout
+    
+    if (do_chain) {
+        char *descs[UNREASONABLE + 1];
+        double t0 = time_us();
+        int levels = ships_generate_chain(params, seed, descs);
+        int total = params->diff - BASIC + 1;
+        t0 = time_us() - t0;
+        for (k = params->diff; k >= BASIC; k--) {
+            if (! descs[k]) continue;
+            params->diff = k;
+            char *par = encode_params(params, true);
+            printf("%s:%s\n", par, descs[k]);
+            sfree(par);
+            sfree(descs[k]);
+        }
+        printf("generation: %.1f us\n", t0);
+        if (levels < total) {
+            fprintf(stderr, "chain incomplete: %d of %d levels\n", 
+              levels, total
+            );
+        }
+        free_params(params);
+        return (levels < total);
+    }
+    
+    
+    //****** differential test of the solvers
+    
+    if (do_diff) {
+        k = diff_test(seed, (repeat > 0 ? repeat : 1000));
+        free_params(params);
+        return (k > 0);
+    }
+    
+    
+    //****** fleets of the presets
+    
+    if (do_fleet) {
+        k = fleet_test();
+        free_params(params);
+        return (k > 0);
     }
     
+    
+    //****** undo-history stress test
+    
+    if (do_stress) {
+        stress(params, seed, moves);
+        free_params(params);
+        return 0;
+    }
+    
+    
+    //****** replay benchmark
+    
+    struct replay_stats rst[NREPLAYKINDS + 1];
+    int games = 0, invalid = 0;
+    memset(rst, 0, sizeof(rst));
+    
+    if (repeat < 0) repeat = 1;
+    for (k = 0; k < repeat; k++) {
+        FILE *fp = (strcmp(replay_file, "-") ? fopen(replay_file, "r") : stdin);
+        if (! fp) {
+            fprintf(stderr, "%s: cannot open %s\n", argv[0], replay_file);
+            return 1;
+        }
+        bool ok = replay(fp, rst, &games, &invalid);
+        if (fp != stdin) fclose(fp);
+        if (! ok) return 1;
+        // standard input can only be read once
+        if (fp == stdin) break;
+    }
+    
+    printf("games: %d, moves: %d, rejected moves: %d\n", 
+      games, rst[NREPLAYKINDS].n, invalid
+    );
+    printf(
+      "%-6s %8s %9s %9s %9s %9s %10s %10s\n", "move", "count", 
+      "p50 us", "p90 us", "p99 us", "max us", "allocs", "bytes"
+    );
+    for (k = 0; k < NREPLAYKINDS; k++) {
+        replay_print(replay_kind_names[k], &rst[k]);
+    }
+    replay_print("all", &rst[NREPLAYKINDS]);
+    
+    for (k = 0; k <= NREPLAYKINDS; k++) sfree(rst[k].us);
+    free_params(params);
+    return 0;
 }
 
-
+#endif